@@ -42,6 +42,12 @@ win32 {
 
 CONFIG += c++11
 
+# test build mode reporting every heap allocation made in the audio thread: qmake CONFIG+=rt_allocation_tripwire
+rt_allocation_tripwire {
+    DEFINES += JAMTABA_RT_ALLOCATION_TRIPWIRE
+    !win32:QMAKE_LFLAGS += -rdynamic # symbol names in the reported backtraces
+}
+
 
 PRECOMPILED_HEADER += PreCompiledHeaders.h
 
@@ -51,22 +57,37 @@ HEADERS += looper/Looper.h
 HEADERS += looper/LooperLayer.h
 HEADERS += looper/LooperStates.h
 HEADERS += looper/LooperPersistence.h
+HEADERS += looper/LoopInfo.h
+HEADERS += looper/LoopLibrary.h
 HEADERS += audio/core/AudioDriver.h
 HEADERS += audio/core/AudioNode.h
 HEADERS += audio/core/LocalInputNode.h
 HEADERS += audio/core/LocalInputGroup.h
 HEADERS += audio/core/AudioNodeProcessor.h
 HEADERS += audio/core/AudioMixer.h
+HEADERS += audio/core/ParallelRenderer.h
+HEADERS += audio/core/RenderEpoch.h
+HEADERS += audio/core/LatencyProbes.h
 HEADERS += audio/core/SamplesBuffer.h
+HEADERS += audio/core/SamplesBufferView.h
+HEADERS += audio/core/SamplesKernels.h
 HEADERS += audio/core/AudioPeak.h
+HEADERS += audio/core/ScratchArena.h
+HEADERS += audio/core/PeakPyramid.h
+HEADERS += audio/core/AllocationTripwire.h
 HEADERS += audio/core/Plugins.h
 HEADERS += audio/core/Filters.h
 HEADERS += audio/core/PluginDescriptor.h
 HEADERS += audio/Encoder.h
+HEADERS += audio/Decoder.h
 HEADERS += audio/vorbis/VorbisDecoder.h
 HEADERS += audio/vorbis/VorbisEncoder.h
+HEADERS += audio/voicechat/VoiceChat.h
+HEADERS += audio/voicechat/VoiceChatDecoder.h
+HEADERS += audio/voicechat/VoiceChatEncoder.h
 HEADERS += audio/RoomStreamerNode.h
 HEADERS += audio/NinjamTrackNode.h
+HEADERS += audio/DecodeService.h
 HEADERS += audio/MetronomeTrackNode.h
 HEADERS += audio/MidiSyncTrackNode.h
 HEADERS += audio/SamplesBufferResampler.h
@@ -85,6 +106,7 @@ HEADERS += file/OggFileReader.h
 HEADERS += file/Mp3FileReader.h
 HEADERS += file/FileUtils.h
 HEADERS += recorder/JamRecorder.h
+HEADERS += recorder/RecordingWriter.h
 HEADERS += recorder/ReaperProjectGenerator.h
 HEADERS += recorder/ClipSortLogGenerator.h
 HEADERS += loginserver/LoginService.h
@@ -94,14 +116,18 @@ HEADERS += loginserver/natmap.h
 HEADERS += MainController.h
 HEADERS += NinjamController.h
 HEADERS += MetronomeUtils.h
+HEADERS += ninjam/MessageFramer.h
 HEADERS += ninjam/client/User.h
 HEADERS += ninjam/client/UserChannel.h
 HEADERS += ninjam/client/Service.h
+HEADERS += ninjam/client/UploadScheduler.h
 HEADERS += ninjam/client/ServerInfo.h
 HEADERS += ninjam/client/ServerMessages.h
 HEADERS += ninjam/client/ClientMessages.h
 HEADERS += ninjam/client/ServerMessagesHandler.h
 HEADERS += ninjam/server/Server.h
+HEADERS += ninjam/server/ClientConnection.h
+HEADERS += ninjam/server/IntervalArchive.h
 HEADERS += gui/plugins/Guis.h
 HEADERS += gui/PluginScanDialog.h
 HEADERS += gui/PreferencesDialog.h
@@ -164,6 +190,7 @@ HEADERS += Configurator.h
 HEADERS += persistence/Settings.h
 HEADERS += persistence/UsersDataCache.h
 HEADERS += persistence/CacheHeader.h
+HEADERS += persistence/ResampledAudioCache.h
 HEADERS += log/Logging.h
 HEADERS += UploadIntervalData.h
 HEADERS += performance/PerformanceMonitor.h
@@ -179,25 +206,38 @@ SOURCES += looper/LooperLayer.cpp
 SOURCES += looper/LooperStates.cpp
 SOURCES += file/WaveFileWriter.cpp
 SOURCES += looper/LooperPersistence.cpp
+SOURCES += looper/LoopInfo.cpp
+SOURCES += looper/LoopLibrary.cpp
 SOURCES += audio/core/AudioDriver.cpp
 SOURCES += audio/core/AudioNode.cpp
 SOURCES += audio/core/LocalInputNode.cpp
 SOURCES += audio/core/LocalInputGroup.cpp
 SOURCES += audio/core/AudioNodeProcessor.cpp
 SOURCES += audio/core/AudioMixer.cpp
+SOURCES += audio/core/ParallelRenderer.cpp
+SOURCES += audio/core/RenderEpoch.cpp
+SOURCES += audio/core/LatencyProbes.cpp
 SOURCES += audio/core/Filters.cpp
 SOURCES += audio/RoomStreamerNode.cpp
 SOURCES += audio/core/Plugins.cpp
 SOURCES += audio/Mp3Decoder.cpp
 SOURCES += audio/NinjamTrackNode.cpp
+SOURCES += audio/DecodeService.cpp
 SOURCES += audio/MetronomeTrackNode.cpp
 SOURCES += audio/MidiSyncTrackNode.cpp
 SOURCES += audio/core/SamplesBuffer.cpp
+SOURCES += audio/core/SamplesKernels.cpp
 SOURCES += audio/core/PluginDescriptor.cpp
 SOURCES += audio/SamplesBufferResampler.cpp
 SOURCES += audio/vorbis/VorbisDecoder.cpp
 SOURCES += audio/vorbis/VorbisEncoder.cpp
+SOURCES += audio/voicechat/VoiceChat.cpp
+SOURCES += audio/voicechat/VoiceChatDecoder.cpp
+SOURCES += audio/voicechat/VoiceChatEncoder.cpp
 SOURCES += audio/core/AudioPeak.cpp
+SOURCES += audio/core/ScratchArena.cpp
+SOURCES += audio/core/PeakPyramid.cpp
+SOURCES += audio/core/AllocationTripwire.cpp
 SOURCES += audio/Resampler.cpp
 SOURCES += video/FFMpegMuxer.cpp
 SOURCES += video/FFMpegDemuxer.cpp
@@ -209,17 +249,22 @@ SOURCES += file/OggFileReader.cpp
 SOURCES += file/Mp3FileReader.cpp
 SOURCES += file/FileUtils.cpp
 SOURCES += recorder/JamRecorder.cpp
+SOURCES += recorder/RecordingWriter.cpp
 SOURCES += recorder/ReaperProjectGenerator.cpp
 SOURCES += recorder/ClipSortLogGenerator.cpp
 SOURCES += ninjam/Ninjam.cpp
+SOURCES += ninjam/MessageFramer.cpp
 SOURCES += ninjam/client/ServerInfo.cpp
 SOURCES += ninjam/client/Service.cpp
+SOURCES += ninjam/client/UploadScheduler.cpp
 SOURCES += ninjam/client/User.cpp
 SOURCES += ninjam/client/ServerMessages.cpp
 SOURCES += ninjam/client/ClientMessages.cpp
 SOURCES += ninjam/client/ServerMessagesHandler.cpp
 SOURCES += ninjam/client/UserChannel.cpp
 SOURCES += ninjam/server/Server.cpp
+SOURCES += ninjam/server/ClientConnection.cpp
+SOURCES += ninjam/server/IntervalArchive.cpp
 SOURCES += gui/widgets/PeakMeter.cpp
 SOURCES += gui/widgets/WavePeakPanel.cpp
 SOURCES += gui/widgets/ChatTabWidget.cpp
@@ -292,6 +337,7 @@ SOURCES += Configurator.cpp
 SOURCES += persistence/UsersDataCache.cpp
 SOURCES += persistence/Settings.cpp
 SOURCES += persistence/CacheHeader.cpp
+SOURCES += persistence/ResampledAudioCache.cpp
 SOURCES += UploadIntervalData.cpp
 SOURCES += upnp/UPnPManager.cpp
 
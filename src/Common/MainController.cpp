@@ -11,17 +11,25 @@
 #include "audio/core/AudioNode.h"
 #include "audio/core/LocalInputNode.h"
 #include "audio/core/LocalInputGroup.h"
+#include "audio/core/AllocationTripwire.h"
+#include "audio/core/LatencyProbes.h"
 #include "audio/RoomStreamerNode.h"
+#include "audio/NinjamTrackNode.h"
+#include "audio/DecodeService.h"
+#include "audio/voicechat/VoiceChat.h"
 #include "ninjam/client/Service.h"
+#include "persistence/ResampledAudioCache.h"
 #include "recorder/JamRecorder.h"
 #include "recorder/ReaperProjectGenerator.h"
 #include "recorder/ClipSortLogGenerator.h"
+#include "recorder/RecordingWriter.h"
 #include "gui/MainWindow.h"
 #include "gui/ThemeLoader.h"
 #include "log/Logging.h"
 #include "ninjam/client/Types.h"
 
 #include <QBuffer>
+#include <QTimerEvent>
 #include <QByteArray>
 #include <QDateTime>
 #include <QSize>
@@ -41,14 +49,16 @@ const QString MainController::CRASH_FLAG_STRING = "JamTaba closed without crash
 
 MainController::MainController(const Settings &settings) :
     loginService(this),
-    audioMixer(44100),
+    audioMixer(44100, scratchArena, renderEpoch),
     ninjamService(new Service()),
     settings(settings),
     mainWindow(nullptr),
-    mutex(QMutex::Recursive),
     videoEncoder(),
     currentStreamingRoomID(-1000),
+    inputGroups(new InputGroups()),
+    processingNinjamController(nullptr),
     started(false),
+    reclaimTimerID(0),
     masterGain(1),
     usersDataCache(Configurator::getInstance()->getCacheDir()),
     lastInputTrackID(0),
@@ -56,13 +66,21 @@ MainController::MainController(const Settings &settings) :
     emojiManager(":/emoji/emoji.json", ":/emoji/icons")
 {
     QDir cacheDir = Configurator::getInstance()->getCacheDir();
+    persistence::ResampledAudioCache::getInstance().setCacheDir(QDir(cacheDir.absoluteFilePath("audio")));
 
     // Register known JamRecorders here:
     jamRecorders.append(new recorder::JamRecorder(new recorder::ReaperProjectGenerator()));
     jamRecorders.append(new recorder::JamRecorder(new recorder::ClipSortLogGenerator()));
 
+    for (auto jamRecorder : jamRecorders)
+        jamRecorder->setSingleFilePerTrack(settings.isSingleFilePerTrackRecording());
+
     connect(&videoEncoder, &FFMpegMuxer::dataEncoded, this, &MainController::enqueueVideoDataToUpload);
 
+    ninjamService->setQueuedIntervalsBytesCounter([]() {
+        return NinjamTrackNode::getBufferedIntervalsBytes();
+    });
+
     for (auto emojiCode: settings.getRecentEmojis())
         emojiManager.addRecent(emojiCode);
 
@@ -101,6 +119,14 @@ long MainController::getTotalDownloadTransferRate() const
     return ninjamService->getTotalDownloadTransferRate();
 }
 
+quint64 MainController::getDroppedDownloads() const
+{
+    if (!isPlayingInNinjamRoom())
+        return 0;
+
+    return ninjamService->getDroppedDownloads();
+}
+
 long MainController::getTotalUploadTransferRate() const
 {
     if (!isPlayingInNinjamRoom())
@@ -175,6 +201,13 @@ void MainController::setEncodingQuality(float newEncodingQuality)
         ninjamController->recreateEncoders();
 }
 
+void MainController::setRenderWorkers(int workers)
+{
+    audioMixer.setRenderWorkers(qMax(workers, 0));
+
+    settings.setRenderWorkers(audioMixer.getRenderWorkers());
+}
+
 void MainController::finishUploads()
 {
     for (int channelIndex : audioIntervalsToUpload.keys()) {
@@ -228,7 +261,7 @@ void MainController::connectInNinjamServer(const ServerInfo &server)
 {
     qCDebug(jtCore) << "connected in ninjam server";
 
-    stopNinjamController();
+    stopNinjamController(); // the old controller is not published, no problem deleting it
 
     auto newNinjamController = createNinjamController();
     ninjamController.reset(newNinjamController);
@@ -245,6 +278,8 @@ void MainController::connectInNinjamServer(const ServerInfo &server)
 
     newNinjamController->start(server);
 
+    publishNinjamController(newNinjamController);
+
     if (settings.isSaveMultiTrackActivated()) {
         QString userName = getUserName();
         QDir recordBasePath = QDir(settings.getRecordingPath());
@@ -329,7 +364,7 @@ void MainController::updateBpm(int newBpm)
 
 void MainController::enqueueAudioDataToUpload(const QByteArray &encodedData, quint8 channelIndex, bool isFirstPart)
 {
-    Q_ASSERT(encodedData.left(4) == "OggS");
+    Q_ASSERT(!isFirstPart || encodedData.left(4) == "OggS" || voicechat::isVoiceChatStream(encodedData));
 
     if (isFirstPart) {
         if (audioIntervalsToUpload.contains(channelIndex)) {
@@ -339,10 +374,26 @@ void MainController::enqueueAudioDataToUpload(const QByteArray &encodedData, qui
             ninjamService->sendIntervalPart(audioInterval.getGUID(), audioInterval.getData(), true); // is the last part of interval
         }
 
-        UploadIntervalData newInterval; // generate a new GUID
-        audioIntervalsToUpload.insert(channelIndex, newInterval);
+        UploadIntervalData newInterval(voicechat::isVoiceChatStream(encodedData)); // generate a new GUID
 
-        ninjamService->sendIntervalBegin(newInterval.getGUID(), channelIndex, true); // starting a new audio interval
+        // starting a new audio interval
+        if (!newInterval.isVoiceChatCodec()) {
+            audioIntervalsToUpload.insert(channelIndex, newInterval);
+            ninjamService->sendIntervalBegin(newInterval.getGUID(), channelIndex, true);
+        }
+        else if (ninjamController && ninjamController->isVoiceChatCodecAccepted()) {
+            audioIntervalsToUpload.insert(channelIndex, newInterval);
+            ninjamService->sendIntervalBegin(newInterval.getGUID(), channelIndex, QByteArray(voicechat::FOURCC));
+        }
+        else {
+            audioIntervalsToUpload.remove(channelIndex); // the encoder is replaced in the next interval, not uploading this one
+        }
+    }
+    else if (audioIntervalsToUpload.contains(channelIndex) && audioIntervalsToUpload[channelIndex].isVoiceChatCodec()
+             && !(ninjamController && ninjamController->isVoiceChatCodecAccepted())) {
+        // an user not decoding the voice chat codec entered, the remaining parts of this interval are not uploaded
+        ninjamService->sendIntervalPart(audioIntervalsToUpload[channelIndex].getGUID(), QByteArray(), true);
+        audioIntervalsToUpload.remove(channelIndex);
     }
 
     if (audioIntervalsToUpload.contains(channelIndex)) {
@@ -404,11 +455,9 @@ void MainController::enqueueVideoDataToUpload(const QByteArray &encodedData, boo
 
 int MainController::getMaxAudioChannelsForEncoding(uint trackGroupIndex) const
 {
-    if (trackGroups.contains(trackGroupIndex)) {
-        audio::LocalInputGroup *group = trackGroups[trackGroupIndex];
-        if (group)
-            return group->getMaxInputChannelsForEncoding();
-    }
+    auto group = getInputGroup(trackGroupIndex);
+    if (group)
+        return group->getMaxInputChannelsForEncoding();
 
     return 0;
 }
@@ -455,16 +504,41 @@ login::Location MainController::getGeoLocation(const QString &ip)
 
 void MainController::mixGroupedInputs(int groupIndex, audio::SamplesBuffer &out)
 {
-    if (groupIndex >= 0 && groupIndex < trackGroups.size())
-        trackGroups[groupIndex]->mixGroupedInputs(out);
+    auto group = getInputGroup(groupIndex);
+    if (group)
+        group->mixGroupedInputs(out);
+}
+
+audio::LocalInputGroup *MainController::getInputGroup(int groupIndex) const
+{
+    auto groups = inputGroups.load(); // not deleted until the end of the current render epoch
+    if (groupIndex >= 0 && groupIndex < static_cast<int>(groups->size()))
+        return groups->at(groupIndex);
+
+    return nullptr;
+}
+
+void MainController::publishInputGroups()
+{
+    const int groupsCount = trackGroups.isEmpty() ? 0 : qMax(trackGroups.lastKey() + 1, 0);
+    auto newGroups = new InputGroups(groupsCount, nullptr);
+    for (auto group : trackGroups) {
+        if (group->getIndex() >= 0)
+            newGroups->at(group->getIndex()) = group;
+    }
+
+    auto oldGroups = inputGroups.exchange(newGroups);
+    renderEpoch.retire([oldGroups]() {
+        delete oldGroups;
+    });
 }
 
 // this is called when a new ninjam interval is received and the 'record multi track' option is enabled
-void MainController::saveEncodedAudio(const QString &userName, quint8 channelIndex, const QByteArray &encodedAudio)
+void MainController::saveEncodedAudio(const QString &userName, quint8 channelIndex, const QList<QByteArray> &encodedChunks)
 {
     if (settings.isSaveMultiTrackActivated()) { // just in case
         for (auto jamRecorder : getActiveRecorders())
-            jamRecorder->addRemoteUserAudio(userName, encodedAudio, channelIndex);
+            jamRecorder->addRemoteUserAudio(userName, encodedChunks, channelIndex);
     }
 }
 
@@ -476,16 +550,19 @@ void MainController::removeAllInputTracks()
 
 void MainController::removeInputTrackNode(int inputTrackIndex)
 {
-    QMutexLocker locker(&mutex);
-
     if (inputTracks.contains(inputTrackIndex)) {
         // remove from group
         audio::LocalInputNode *inputTrack = inputTracks[inputTrackIndex];
         int trackGroupIndex = inputTrack->getChanneGroupIndex();
         if (trackGroups.contains(trackGroupIndex)) {
             trackGroups[trackGroupIndex]->removeInput(inputTrack);
-            if (trackGroups[trackGroupIndex]->isEmpty())
-                trackGroups.remove(trackGroupIndex);
+            if (trackGroups[trackGroupIndex]->isEmpty()) {
+                auto emptyGroup = trackGroups.take(trackGroupIndex);
+                publishInputGroups();
+                renderEpoch.retire([emptyGroup]() {
+                    delete emptyGroup; // the audio thread can be using the old groups snapshot
+                });
+            }
         }
 
         inputTracks.remove(inputTrackIndex);
@@ -500,10 +577,13 @@ int MainController::addInputTrackNode(audio::LocalInputNode *inputTrackNode)
     addTrack(inputTrackID, inputTrackNode);
 
     int trackGroupIndex = inputTrackNode->getChanneGroupIndex();
-    if (!trackGroups.contains(trackGroupIndex))
-        trackGroups.insert(trackGroupIndex, new audio::LocalInputGroup(trackGroupIndex, inputTrackNode));
-    else
+    if (!trackGroups.contains(trackGroupIndex)) {
+        trackGroups.insert(trackGroupIndex, new audio::LocalInputGroup(trackGroupIndex, inputTrackNode, renderEpoch));
+        publishInputGroups();
+    }
+    else {
         trackGroups[trackGroupIndex]->addInputNode(inputTrackNode);
+    }
 
     return inputTrackID;
 }
@@ -528,7 +608,7 @@ audio::AudioNode *MainController::getTrackNode(long ID)
 
 bool MainController::addTrack(long trackID, audio::AudioNode *trackNode)
 {
-    QMutexLocker locker(&mutex);
+    QMutexLocker locker(&tracksMutex); // audio thread is not blocked, the mixer is publishing a new render graph
 
     tracksNodes.insert(trackID, trackNode);
     audioMixer.addNode(trackNode);
@@ -583,6 +663,13 @@ void MainController::storeJamRecorderStatus(const QString &writerId, bool status
     settings.setJamRecorderActivated(writerId, status);
 }
 
+void MainController::storeSingleFilePerTrackRecording(bool singleFile)
+{
+    settings.setSingleFilePerTrackRecording(singleFile);
+    for (auto jamRecorder : jamRecorders)
+        jamRecorder->setSingleFilePerTrack(singleFile); // running recordings are restarted
+}
+
 void MainController::storeMultiTrackRecordingPath(const QString &newPath)
 {
     settings.setMultiTrackRecordingPath(newPath);
@@ -662,16 +749,40 @@ void MainController::storeIOSettings(int firstIn, int lastIn, int firstOut, int
 
 void MainController::removeTrack(long trackID)
 {
-    QMutexLocker locker(&mutex);
-    /** remove Track is called from ninjam service thread, and cause a crash if the process callback (audio Thread) is iterating over tracksNodes to render audio */
+    QMutexLocker locker(&tracksMutex);
+    /** remove Track is called from ninjam service thread. The audio thread can be rendering the removed node
+        using the previous render graph, so the node is deleted later, when the audio thread is not using it */
 
-    auto trackNode = tracksNodes[trackID];
+    auto trackNode = tracksNodes.value(trackID);
     if (trackNode) {
-        trackNode->suspendProcessors();
         audioMixer.removeNode(trackNode);
         tracksNodes.remove(trackID);
-        delete trackNode;
+        renderEpoch.retire([trackNode]() {
+            trackNode->suspendProcessors();
+            delete trackNode;
+        });
+    }
+}
+
+void MainController::timerEvent(QTimerEvent *event)
+{
+    if (event->timerId() == reclaimTimerID) {
+        renderEpoch.reclaim();
+
+        if (isPlayingInNinjamRoom())
+            reserveLoopersMemory(ninjamController->getSamplesPerInterval()); // the sample rate can be changed too
+
+        for (auto inputTrack : inputTracks.values())
+            inputTrack->getLooper()->reclaimMemory();
     }
+    else
+        QObject::timerEvent(event);
+}
+
+void MainController::reserveLoopersMemory(uint samplesPerInterval)
+{
+    for (auto inputTrack : inputTracks.values())
+        inputTrack->getLooper()->reserve(samplesPerInterval);
 }
 
 void MainController::setAllLoopersStatus(bool activated)
@@ -685,25 +796,35 @@ void MainController::doAudioProcess(const audio::SamplesBuffer &in, audio::Sampl
     auto incommingMidi = pullMidiMessagesFromDevices();
     audioMixer.process(in, out, sampleRate, incommingMidi);
 
-    out.applyGain(masterGain, 1.0f); // using 1 as boost factor/multiplier (no boost)
-    masterPeak.update(out.computePeak());
+    masterPeak.update(out.applyGainAndComputePeak(masterGain, 1.0f, 1.0f, 1.0f)); // using 1 as pan gains and boost factor/multiplier (no boost)
+}
+
+void MainController::prepareToProcess(int maxInputChannels, int maxFramesPerBuffer)
+{
+    // called before the first callback, the audio thread is not using the scratch arena
+    scratchArena.prepare(qMax(maxInputChannels, 0), qMax(maxFramesPerBuffer, 0));
+    audioMixer.prepareParallelRendering();
+
+    if (ninjamController)
+        ninjamController->prepareToProcess(scratchArena.getMaxFrames());
 }
 
 void MainController::process(const audio::SamplesBuffer &in, audio::SamplesBuffer &out, int sampleRate)
 {
-    QMutexLocker locker(&mutex);
+    audio::AllocationTripwire::Scope tripwireScope; // only active in rt_allocation_tripwire builds
+    audio::RenderEpoch::Scope epochScope(renderEpoch); // published render graphs are not deleted while this callback is running
+    audio::LatencyProbes::Scope probe(audio::LatencyProbes::MainControllerProcess);
 
     if (!started)
         return;
 
     try
     {
-        if (!isPlayingInNinjamRoom()) {
+        auto ninjamController = processingNinjamController.load(); // not stopped until the end of the current render epoch
+        if (!ninjamController)
             doAudioProcess(in, out, sampleRate);
-        } else {
-            if (ninjamController)
-                ninjamController->process(in, out, sampleRate);
-        }
+        else
+            ninjamController->process(in, out, sampleRate);
     }
     catch (...)
     {
@@ -771,8 +892,9 @@ void MainController::setTransmitingStatus(int channelID, bool transmiting)
 
 bool MainController::isTransmiting(int channelID) const
 {
-    if (trackGroups.contains(channelID))
-        return trackGroups[channelID]->isTransmiting();
+    auto group = getInputGroup(channelID);
+    if (group)
+        return group->isTransmiting();
 
     return false;
 }
@@ -887,6 +1009,8 @@ MainController::~MainController()
 
     qCDebug(jtCore()) << "main controller stopped!";
 
+    renderEpoch.reclaim(); // audio is stopped, deleting retired nodes
+
     qCDebug(jtCore()) << "cleaning tracksNodes...";
 
     tracksNodes.clear();
@@ -900,6 +1024,7 @@ MainController::~MainController()
         delete group;
 
     trackGroups.clear();
+    delete inputGroups.exchange(new InputGroups());
 
     qCDebug(jtCore()) << "cleaning tracksNodes done!";
 
@@ -908,6 +1033,8 @@ MainController::~MainController()
     for (auto jamRecorder : jamRecorders)
         delete jamRecorder;
 
+    recorder::RecordingWriter::getInstance().waitForPendingWrites(); // intervals recorded before exit
+
     audioIntervalsToUpload.clear();
 
     qCDebug(jtCore()) << "cleaning jamRecorders done!";
@@ -1042,6 +1169,16 @@ void MainController::start()
         roomStreamer.reset(new audio::NinjamRoomStreamerNode()); // new Audio::AudioFileStreamerNode(":/teste.mp3");
         this->audioMixer.addNode(roomStreamer.data());
 
+        audioMixer.setRenderWorkers(qMax(settings.getRenderWorkers(), 0));
+
+        auto &decodeService = audio::DecodeService::getInstance();
+        decodeService.setLookAhead(settings.getDecodeLookAhead());
+        decodeService.setMemoryLimit(static_cast<size_t>(settings.getDecodeMemoryLimit()) * 1024 * 1024);
+
+        audio::LatencyProbes::setEnabled(settings.isLatencyProbesEnabled());
+
+        reclaimTimerID = startTimer(1000);
+
         connect(ninjamService.data(), &Service::connectedInServer, this, &MainController::connectInNinjamServer);
 
         connect(ninjamService.data(), &Service::disconnectedFromServer, this, &MainController::disconnectFromNinjamServer);
@@ -1070,6 +1207,8 @@ void MainController::stop()
     if (started) {
         qCDebug(jtCore) << "Stopping MainController...";
 
+        publishNinjamController(nullptr);
+
         if (ninjamController)
             ninjamController->stop(false); // block disconnected signal
 
@@ -1109,9 +1248,16 @@ bool MainController::isPlayingInNinjamRoom() const
 
 // ++++++++++++= NINJAM ++++++++++++++++
 
+void MainController::publishNinjamController(controller::NinjamController *controller)
+{
+    processingNinjamController = controller;
+
+    renderEpoch.synchronize(); // the unpublished controller can be stopped after the running callback
+}
+
 void MainController::stopNinjamController()
 {
-    QMutexLocker locker(&mutex);
+    publishNinjamController(nullptr);
 
     if (ninjamController && ninjamController->isRunning())
         ninjamController->stop(true);
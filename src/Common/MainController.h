@@ -9,10 +9,15 @@
 #include "persistence/Settings.h"
 #include "persistence/UsersDataCache.h"
 #include "audio/core/AudioMixer.h"
+#include "audio/core/ScratchArena.h"
+#include "audio/core/RenderEpoch.h"
 #include "midi/MidiDriver.h"
 #include "video/FFMpegMuxer.h"
 #include "gui/chat/EmojiManager.h"
 
+#include <atomic>
+#include <vector>
+
 class MainWindow;
 
 namespace ninjam { namespace client {
@@ -59,6 +64,8 @@ using audio::LocalInputGroup;
 using audio::SamplesBuffer;
 using audio::AbstractMp3Streamer;
 using audio::AudioMixer;
+using audio::ScratchArena;
+using audio::RenderEpoch;
 using login::RoomInfo;
 using login::LoginService;
 using recorder::JamRecorder;
@@ -82,6 +89,7 @@ public:
     long getTotalUploadTransferRate() const;
     long getTotalDownloadTransferRate() const;
     long getDownloadTransferRate(const QString userFullName, quint8 channelIndex) const;
+    quint64 getDroppedDownloads() const; // incomplete intervals dropped by the downloads memory limit
 
     void setVideoProperties(const QSize &resolution);
 
@@ -109,6 +117,12 @@ public:
     // main audio processing routine
     virtual void process(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate);
 
+    // pre allocate the scratch buffers used in audio thread. Called when the audio driver or the plugin host (re)starts processing.
+    void prepareToProcess(int maxInputChannels, int maxFramesPerBuffer);
+
+    ScratchArena &getScratchArena();
+    RenderEpoch &getRenderEpoch();
+
     void sendNewChannelsNames(const QList<ChannelMetadata> &channels);
     void sendRemovedChannelMessage(int removedChannelIndex);
 
@@ -191,7 +205,7 @@ public:
     LocalInputNode *getInputTrackInGroup(quint8 groupIndex, quint8 trackIndex) const;
 
     int getInputTracksCount() const;
-    int getInputTrackGroupsCount() const;
+    int getInputTrackGroupsCount() const; // groups are indexed from zero to count - 1, some indexes can be unused
 
     void mixGroupedInputs(int groupIndex, SamplesBuffer &out);
 
@@ -199,6 +213,8 @@ public:
 
     float getEncodingQuality() const;
 
+    int getRenderWorkers() const;
+
     static QByteArray newGUID();
 
     const Settings &getSettings() const;
@@ -218,6 +234,7 @@ public:
     void storeMultiTrackRecordingStatus(bool savingMultiTracks);
     bool isMultiTrackRecordingActivated() const;
     void storeMultiTrackRecordingPath(const QString &newPath);
+    void storeSingleFilePerTrackRecording(bool singleFile);
     void storeDirNameDateFormat(const QString &newDateFormat);
 
     void storeJamRecorderStatus(const QString &writerId, bool status);
@@ -243,7 +260,7 @@ public:
     QString getMetronomeAccentBeatFile() const;
 
     void saveEncodedAudio(const QString &userName, quint8 channelIndex,
-                          const QByteArray &encodedAudio);
+                          const QList<QByteArray> &encodedChunks);
 
     AbstractMp3Streamer *getRoomStreamer() const;
 
@@ -288,6 +305,7 @@ public:
     quint8 getLooperBitDepth() const;
 
     void setAllLoopersStatus(bool activated);
+    void reserveLoopersMemory(uint samplesPerInterval); // loopers never allocate in the audio thread
 
     // sync methods
     virtual void startMidiClock() const = 0;
@@ -323,6 +341,7 @@ signals:
 public slots:
     virtual void setSampleRate(int newSampleRate);
     void setEncodingQuality(float newEncodingQuality);
+    void setRenderWorkers(int workers);
     void storeLooperBitDepth(quint8 bitDepth);
 
     void storeRemoteUserRememberSettings(bool boost, bool level, bool pan, bool mute, bool lowCut);
@@ -342,10 +361,14 @@ protected:
 
     static QString LOG_CONFIG_FILE;
 
+    void timerEvent(QTimerEvent *event) override; // reclaim retired nodes
+
     LoginService loginService;
 
     QMap<QString, login::Location> locationCache;
 
+    RenderEpoch renderEpoch; // retired nodes and render graphs are deleted when the audio thread is not using them
+    ScratchArena scratchArena; // declared before audioMixer, the mixer is using the scratch arena
     AudioMixer audioMixer;
 
     // ninjam
@@ -364,8 +387,6 @@ protected:
     QMap<quint8, UploadIntervalData> audioIntervalsToUpload;
     QScopedPointer<UploadIntervalData> videoIntervalToUpload;
 
-    QMutex mutex;
-
     virtual void setupNinjamControllerSignals();
 
     virtual void setCSS(const QString &css) = 0;
@@ -386,13 +407,25 @@ private:
     QScopedPointer<AbstractMp3Streamer> roomStreamer;
     QString currentStreamingRoomID;
 
-    QMap<int, LocalInputGroup *> trackGroups;
+    QMap<int, LocalInputGroup *> trackGroups; // control threads copy, the audio thread is using the published inputGroups
+
+    typedef std::vector<LocalInputGroup *> InputGroups; // indexed by group index, null in unused indexes
+    std::atomic<const InputGroups *> inputGroups; // immutable snapshot, replaced when groups are added or removed
+    void publishInputGroups();
+    LocalInputGroup *getInputGroup(int groupIndex) const; // called in audio thread too
+
+    // the ninjam controller processed by the audio thread, null when not playing in a ninjam room
+    std::atomic<controller::NinjamController *> processingNinjamController;
+    void publishNinjamController(controller::NinjamController *controller); // wait until the running callback finish
 
     QMap<int, bool> getXmitChannelsFlags() const;
 
     QMap<long, AudioNode *> tracksNodes;
+    QMutex tracksMutex; // tracks are added/removed by GUI and ninjam threads, the audio thread is not locking this mutex
+
+    int reclaimTimerID;
 
-    bool started;
+    std::atomic<bool> started;
 
     void tryConnectInNinjamServer(const RoomInfo &ninjamRoom, const QList<ChannelMetadata> &channels,
                                   const QString &password = "");
@@ -489,6 +522,16 @@ inline EmojiManager *MainController::getEmojiManager() const
     return const_cast<EmojiManager *>(&emojiManager);
 }
 
+inline ScratchArena &MainController::getScratchArena()
+{
+    return scratchArena;
+}
+
+inline RenderEpoch &MainController::getRenderEpoch()
+{
+    return renderEpoch;
+}
+
 inline UsersDataCache *MainController::getUsersDataCache()
 {
     return &usersDataCache;
@@ -544,6 +587,11 @@ inline float MainController::getEncodingQuality() const
     return settings.getEncodingQuality();
 }
 
+inline int MainController::getRenderWorkers() const
+{
+    return settings.getRenderWorkers();
+}
+
 inline int MainController::getInputTracksCount() const
 {
     return inputTracks.size();     // return the individual tracks (subchannels) count
@@ -551,7 +599,7 @@ inline int MainController::getInputTracksCount() const
 
 inline int MainController::getInputTrackGroupsCount() const
 {
-    return trackGroups.size();     // return the track groups (channels) count
+    return inputGroups.load()->size();     // return the track groups (channels) count
 }
 
 inline bool MainController::isStarted() const
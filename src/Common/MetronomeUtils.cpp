@@ -1,9 +1,7 @@
 #include "MetronomeUtils.h"
 
 #include "audio/core/SamplesBuffer.h"
-#include "file/FileReaderFactory.h"
-#include "file/FileReader.h"
-#include "audio/Resampler.h"
+#include "persistence/ResampledAudioCache.h"
 #include <QString>
 #include <QFileInfo>
 #include <QFile>
@@ -131,37 +129,6 @@ void metronomeUtils::removeSilenceInBufferStart(SamplesBuffer &buffer)
 
 void metronomeUtils::createBuffer(const QString &audioFilePath, SamplesBuffer &outBuffer, quint32 localSampleRate)
 {
-    std::unique_ptr<FileReader> reader = FileReaderFactory::createFileReader(audioFilePath);
-    quint32 audioFileSampleRate; //will be changed inside reader->read
-    SamplesBuffer originalBuffer(1);//assuming mono for while
-    reader->read(audioFilePath, originalBuffer, audioFileSampleRate);//buffer will be filled with audio file samples
-
-    //need resample?
-    if (audioFileSampleRate != (uint)localSampleRate) {
-        createResampledBuffer(originalBuffer, outBuffer, audioFileSampleRate, localSampleRate);
-    }
-    else{
-        if (originalBuffer.isMono())
-            outBuffer.setToMono();
-        outBuffer.setFrameLenght(originalBuffer.getFrameLenght());
-        outBuffer.set(originalBuffer);
-    }
-}
-
-void metronomeUtils::createResampledBuffer(const SamplesBuffer &buffer, SamplesBuffer &outBuffer, int originalSampleRate,
-                                     int finalSampleRate)
-{
-    int finalSize = (double)finalSampleRate/originalSampleRate * buffer.getFrameLenght();
-    int channels = buffer.getChannels();
-    if (channels > 1)
-        outBuffer.setToStereo();
-    else
-        outBuffer.setToMono();
-    outBuffer.setFrameLenght(finalSize);
-
-    for (int c = 0; c < channels; ++c) {
-        SimpleResampler resampler;
-        resampler.process(buffer.getSamplesArray(c),
-                          buffer.getFrameLenght(), outBuffer.getSamplesArray(c), finalSize);
-    }
+    outBuffer.setFrameLenght(0); // the entire file
+    persistence::ResampledAudioCache::getInstance().load(audioFilePath, localSampleRate, outBuffer);
 }
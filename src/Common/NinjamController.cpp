@@ -1,6 +1,7 @@
 #include "NinjamController.h"
 #include "MainController.h"
 
+#include "ninjam/Ninjam.h"
 #include "ninjam/client/Service.h"
 #include "ninjam/client/User.h"
 #include "ninjam/client/UserChannel.h"
@@ -8,7 +9,7 @@
 #include "audio/core/AudioNode.h"
 #include "audio/core/SamplesBuffer.h"
 #include "audio/core/AudioDriver.h"
-#include "audio/core/SamplesBuffer.h"
+#include "audio/core/ScratchArena.h"
 #include "file/FileReaderFactory.h"
 #include "file/FileReader.h"
 #include "audio/NinjamTrackNode.h"
@@ -18,6 +19,7 @@
 #include "audio/SamplesBufferRecorder.h"
 #include "audio/vorbis/VorbisEncoder.h"
 #include "audio/vorbis/Vorbis.h"
+#include "audio/voicechat/VoiceChatEncoder.h"
 #include "gui/NinjamRoomWindow.h"
 #include "log/Logging.h"
 #include "MetronomeUtils.h"
@@ -30,104 +32,102 @@
 #include <QDebug>
 #include <QThread>
 #include <QFileInfo>
-#include <QWaitCondition>
 
+#include "audio/readerwriterqueue.h"
+
+#include <algorithm>
 #include <cmath>
 #include <cassert>
+#include <iterator>
 #include <vector>
+#include <memory>
+#include <atomic>
 
 using controller::NinjamController;
 using ninjam::client::ServerInfo;
 
-// +++++++++++++  ENCODING THREAD  +++++++++++++
+// +++++++++++++  ENCODING POOL  +++++++++++++
 
-class NinjamController::EncodingThread : public QThread // TODO: use better thread approach, avoid inheritance form QThread
+/**
+ * Encode the transmitted channel groups in a few worker threads. Each channel is always encoded by the
+ * same worker (channelIndex % workers), so the chunks of a channel are encoded in order. The audio thread
+ * feeds each worker using a lock free SPSC queue, and the encoded chunks are recycled in another queue.
+ * When a worker is lagging the audio blocks are packed in full chunks and the worker allocates more chunks,
+ * so a whole interval can be queued. Chunks are dropped only when this backlog limit is reached.
+ */
+
+class NinjamController::EncodingPool
 {
 public:
 
-    explicit EncodingThread(NinjamController *controller) :
-        stopRequested(false),
+    explicit EncodingPool(NinjamController *controller) :
         controller(controller)
     {
-        qCDebug(jtNinjamCore) << "Starting Encoding Thread";
-        start();
+        const uint workersCount = qBound(1, QThread::idealThreadCount() - 1, static_cast<int>(MAX_WORKERS));
+
+        qCDebug(jtNinjamCore) << "Starting encoding pool with" << workersCount << "workers";
+
+        for (uint w = 0; w < workersCount; ++w)
+            workers.emplace_back(new Worker(controller));
     }
 
-    ~EncodingThread()
+    ~EncodingPool()
     {
         stop();
     }
 
+    // called from audio thread
     void addSamplesToEncode(const audio::SamplesBuffer &samplesToEncode, quint8 channelIndex,
                             bool isFirstPart, bool isLastPart)
     {
-        // qCDebug(jtNinjamCore) << "Adding samples to encode";
-        QMutexLocker locker(&mutex);
-        chunksToEncode.push_back(EncodingChunk(samplesToEncode, channelIndex, isFirstPart,
-                                               isLastPart));
-        // this method is called by Qt main thread (the producer thread).
-        hasAvailableChunksToEncode.wakeAll();// wakeup the encoding thread (consumer thread)
+        workers[channelIndex % workers.size()]->addSamplesToEncode(samplesToEncode, channelIndex, isFirstPart, isLastPart);
     }
 
     void stop()
     {
-        if (!stopRequested)
-        {
-            // QMutexLocker locker(&mutex);
-            stopRequested = true;
-            hasAvailableChunksToEncode.wakeAll();
-            qCDebug(jtNinjamCore) << "Stopping Encoding Thread";
-        }
-    }
+        for (auto &worker : workers)
+            worker->stop();
 
-protected:
+        for (auto &worker : workers)
+            worker->wait(); // wait the encoding threads to finish
+    }
 
-    void run()
+    uint getWorkers() const
     {
-        while (!stopRequested)
-        {
-            mutex.lock();
-            if (chunksToEncode.empty())
-                hasAvailableChunksToEncode.wait(&mutex);
-
-            if (stopRequested)
-            {
-                mutex.unlock();
-                break;
-            }
-
-            EncodingChunk chunk = !chunksToEncode.empty() ? chunksToEncode.front() : EncodingChunk(
-                audio::SamplesBuffer::ZERO_BUFFER, 0, false, false);
+        return workers.size();
+    }
 
-            chunksToEncode.erase(chunksToEncode.begin()); // remove first element
+    uint getQueueDepth(uint worker) const
+    {
+        return worker < workers.size() ? workers[worker]->getQueueDepth() : 0;
+    }
 
-            mutex.unlock();
+    uint getPeakQueueDepth(uint worker) const
+    {
+        return worker < workers.size() ? workers[worker]->getPeakQueueDepth() : 0;
+    }
 
-            if (!chunk.buffer.isEmpty())
-            {
-                QByteArray encodedBytes(controller->encode(chunk.buffer, chunk.channelIndex));
-                if (chunk.lastPart)
-                    encodedBytes.append(controller->encodeLastPartOfInterval(chunk.channelIndex));
+    uint getDroppedChunks() const
+    {
+        uint droppedChunks = 0;
+        for (const auto &worker : workers)
+            droppedChunks += worker->getDroppedChunks();
 
-                if (!encodedBytes.isEmpty())
-                    emit controller->encodedAudioAvailableToSend(encodedBytes, chunk.channelIndex,
-                                                                 chunk.firstPart, chunk.lastPart);
-            }
-        }
-        qCDebug(jtNinjamCore) << "Encoding thread stopped!";
+        return droppedChunks;
     }
 
+    static const uint MAX_WORKERS = 4;
+
 private:
 
     class EncodingChunk
     {
     public:
-        EncodingChunk(const audio::SamplesBuffer &buffer, quint8 channelIndex, bool firstPart,
-                      bool lastPart) :
-            buffer(buffer),
-            channelIndex(channelIndex),
-            firstPart(firstPart),
-            lastPart(lastPart)
+        EncodingChunk() :
+            buffer(2, MAX_CHUNK_FRAMES),
+            channelIndex(0),
+            firstPart(false),
+            lastPart(false)
         {
         }
 
@@ -137,11 +137,173 @@ private:
         bool lastPart;
     };
 
-    std::vector<EncodingChunk> chunksToEncode;
-    QMutex mutex;
-    volatile bool stopRequested;
+    class Worker : public QThread
+    {
+    public:
+        explicit Worker(NinjamController *controller) :
+            chunksToEncode(MAX_CHUNKS_PER_WORKER),
+            freeChunks(MAX_CHUNKS_PER_WORKER),
+            queueDepth(0),
+            peakQueueDepth(0),
+            droppedChunks(0),
+            stopRequested(false),
+            controller(controller)
+        {
+            std::fill(std::begin(fillingChunks), std::end(fillingChunks), nullptr);
+
+            chunks.reserve(MAX_CHUNKS_PER_WORKER);
+            allocateChunks();
+
+            start();
+        }
+
+        ~Worker()
+        {
+            stop();
+            wait();
+        }
+
+        // called from audio thread, the chunks and the queues are preallocated
+        void addSamplesToEncode(const audio::SamplesBuffer &samplesToEncode, quint8 channelIndex,
+                                bool isFirstPart, bool isLastPart)
+        {
+            const int channels = qMin(samplesToEncode.getChannels(), 2); // mono or stereo encoders
+            const uint frames = samplesToEncode.getFrameLenght();
+            uint offset = 0;
+            do { // big audio blocks are split in many chunks
+                const bool firstPart = isFirstPart && offset == 0;
+
+                EncodingChunk *&chunk = fillingChunks[channelIndex];
+                if (chunk && (firstPart || chunk->buffer.getChannels() != channels))
+                    enqueue(chunk); // the interval boundaries are never packed in the same chunk
+
+                if (!chunk) {
+                    // the last free chunks are reserved to the interval boundaries, the encoder stream is never broken
+                    const bool canUseChunk = firstPart || isLastPart || freeChunks.size_approx() > RESERVED_CHUNKS;
+                    if (!canUseChunk || !freeChunks.try_dequeue(chunk)) {
+                        ++droppedChunks; // the backlog limit is reached, reported in the UI
+                        offset += qMin(frames - offset, static_cast<uint>(MAX_CHUNK_FRAMES));
+                        continue;
+                    }
+
+                    // not reallocating, chunks are allocated with 2 channels and MAX_CHUNK_FRAMES
+                    chunk->buffer.setChannels(channels);
+                    chunk->buffer.setFrameLenght(0);
+                    chunk->channelIndex = channelIndex;
+                    chunk->firstPart = firstPart;
+                    chunk->lastPart = false;
+                }
+
+                const uint chunkOffset = chunk->buffer.getFrameLenght();
+                const uint chunkFrames = qMin(frames - offset, MAX_CHUNK_FRAMES - chunkOffset);
+                chunk->buffer.setFrameLenght(chunkOffset + chunkFrames);
+                chunk->buffer.set(samplesToEncode, offset, chunkFrames, chunkOffset);
+                offset += chunkFrames;
+
+                chunk->lastPart = isLastPart && offset == frames;
+
+                // packing the audio blocks only when the worker is lagging, no latency is added
+                if (chunk->lastPart || chunk->buffer.getFrameLenght() == MAX_CHUNK_FRAMES || queueDepth == 0)
+                    enqueue(chunk);
+
+            } while (offset < frames);
+        }
+
+        void stop()
+        {
+            stopRequested = true; // the worker is checking the flag after IDLE_WAIT_TIME
+        }
+
+        uint getQueueDepth() const
+        {
+            return queueDepth;
+        }
+
+        uint getPeakQueueDepth() const
+        {
+            return peakQueueDepth;
+        }
+
+        uint getDroppedChunks() const
+        {
+            return droppedChunks;
+        }
+
+    protected:
+
+        void run() override
+        {
+            while (!stopRequested) {
+                if (freeChunks.size_approx() < CHUNKS_PER_WORKER / 2)
+                    allocateChunks(); // the worker is lagging, the audio thread never allocates
+
+                EncodingChunk *chunk = nullptr;
+                if (!chunksToEncode.wait_dequeue_timed(chunk, IDLE_WAIT_TIME * 1000))
+                    continue;
+
+                if (chunk->firstPart)
+                    controller->prepareEncoder(chunk->channelIndex, chunk->buffer.getChannels());
+
+                if (!chunk->buffer.isEmpty()) {
+                    QByteArray encodedBytes(controller->encode(chunk->buffer, chunk->channelIndex));
+                    if (chunk->lastPart)
+                        encodedBytes.append(controller->encodeLastPartOfInterval(chunk->channelIndex));
+
+                    if (!encodedBytes.isEmpty())
+                        emit controller->encodedAudioAvailableToSend(encodedBytes, chunk->channelIndex,
+                                                                     chunk->firstPart, chunk->lastPart);
+                }
+
+                --queueDepth;
+                freeChunks.try_enqueue(chunk);
+            }
+
+            qCDebug(jtNinjamCore) << "Encoding thread stopped! Dropped chunks:" << droppedChunks;
+        }
+
+    private:
+        void enqueue(EncodingChunk *&chunk) // audio thread
+        {
+            chunksToEncode.try_enqueue(chunk); // always succeeds, the queue can store all chunks
+            chunk = nullptr;
+
+            uint depth = ++queueDepth;
+            if (depth > peakQueueDepth)
+                peakQueueDepth = depth; // written by audio thread only
+        }
+
+        void allocateChunks() // worker thread, the free chunks producer
+        {
+            for (uint c = 0; c < CHUNKS_PER_WORKER && chunks.size() < MAX_CHUNKS_PER_WORKER; ++c) {
+                chunks.emplace_back(new EncodingChunk());
+                freeChunks.try_enqueue(chunks.back().get());
+            }
+        }
+
+        static const uint CHUNKS_PER_WORKER = 64; // allocated when the worker is created, and each time the worker is lagging
+        static const uint MAX_CHUNKS_PER_WORKER = 1024; // 4M frames, a full interval of a few channels in the worst case
+        static const uint RESERVED_CHUNKS = 4;
+        static const int IDLE_WAIT_TIME = 5; // ms
+
+        EncodingChunk *fillingChunks[256]; // audio thread only, the chunk being packed for each channel
+
+        // the audio thread signals the worker using a lightweight semaphore (atomic counter, no mutex)
+        moodycamel::BlockingReaderWriterQueue<EncodingChunk *> chunksToEncode; // audio thread -> worker
+        moodycamel::ReaderWriterQueue<EncodingChunk *> freeChunks; // worker -> audio thread
+        std::vector<std::unique_ptr<EncodingChunk>> chunks; // all chunks, allocated by the worker thread
+
+        std::atomic<uint> queueDepth;
+        std::atomic<uint> peakQueueDepth;
+        std::atomic<uint> droppedChunks;
+        std::atomic<bool> stopRequested;
+
+        NinjamController *controller;
+    };
+
+    static const uint MAX_CHUNK_FRAMES = 4096; // audio thread is copying the mixed input in preallocated chunks
+
+    std::vector<std::unique_ptr<Worker>> workers;
     NinjamController *controller;
-    QWaitCondition hasAvailableChunksToEncode;
 };
 
 // +++++++++++++++++ Nested classes to handle schedulable events ++++++++++++++++
@@ -221,7 +383,7 @@ public:
 
     void process()
     {
-        controller->recreateEncoderForChannel(channelIndex, voiceChannelActivated);
+        controller->setVoiceChatEncoding(channelIndex, voiceChannelActivated); // the encoder is replaced by the encoding worker
     }
 
 private:
@@ -234,6 +396,7 @@ private:
 NinjamController::NinjamController(controller::MainController *mainController) :
     intervalPosition(0),
     samplesInInterval(0),
+    processingTrackNodes(new TrackNodes()),
     mainController(mainController),
     metronomeTrackNode(createMetronomeTrackNode(mainController->getSampleRate())),
     midiSyncTrackNode(new audio::MidiSyncTrackNode(mainController)),
@@ -242,7 +405,11 @@ NinjamController::NinjamController(controller::MainController *mainController) :
     currentBpm(0),
     mutex(QMutex::Recursive),
     encodersMutex(QMutex::Recursive),
-    encodingThread(nullptr),
+    voiceChatChannels(0),
+    voiceChatCodecAccepted(false),
+    processedEvents(0),
+    deletedEvents(0),
+    encodingPool(nullptr),
     preparedForTransmit(false),
     waitingIntervals(0) // waiting for start transmit
 {
@@ -279,6 +446,8 @@ void NinjamController::setBpmBpi(int initialBpm, int initialBpi)
     metronomeTrackNode->setSamplesPerBeat(getSamplesPerBeat());
     midiSyncTrackNode->setPulseTiming(currentBpi * 24, getSamplesPerBeat()/24.0);
 
+    mainController->reserveLoopersMemory(samplesInInterval);
+
     emit currentBpmChanged(currentBpm);
     emit currentBpiChanged(currentBpi);
 }
@@ -294,18 +463,24 @@ void NinjamController::setSyncEnabled(bool enabled)
 
 void NinjamController::removeEncoder(int groupChannelIndex)
 {
-    QMutexLocker locker(&mutex);
+    QMutexLocker locker(&encodersMutex);
     if (encoders.contains(groupChannelIndex))
         encoders.remove(groupChannelIndex);
 }
 
+void NinjamController::prepareToProcess(uint maxFrames)
+{
+    QMutexLocker locker(&mutex);
+    for (auto trackNode : trackNodes)
+        trackNode->prepareToProcess(maxFrames);
+}
+
 // +++++++++++++++++++++++++ THE MAIN LOGIC IS HERE  ++++++++++++++++++++++++++++++++++++++++++++++++
 
 void NinjamController::process(const audio::SamplesBuffer &in, audio::SamplesBuffer &out,
                                int sampleRate)
 {
-    QMutexLocker locker(&mutex);
-
+    // the controller is published to the audio thread after start() and unpublished before stop(), no locks here
     if (currentBpi == 0 || currentBpm == 0)
         processScheduledChanges(); // check if we have the initial bpm and bpi change pending
 
@@ -327,12 +502,14 @@ void NinjamController::process(const audio::SamplesBuffer &in, audio::SamplesBuf
 
         assert(samplesToProcessInThisStep);
 
-        static audio::SamplesBuffer tempOutBuffer(out.getChannels(), samplesToProcessInThisStep);
-        tempOutBuffer.setFrameLenght(samplesToProcessInThisStep);
-        tempOutBuffer.zero();
+        // temporary buffers are taken from the pre allocated scratch arena, no allocations in audio thread
+        auto &scratchArena = mainController->getScratchArena();
+        audio::ScratchArena::Scope scratchScope(scratchArena);
+
+        auto &tempOutBuffer = scratchArena.takeBuffer(out.getChannels(), samplesToProcessInThisStep);
 
-        audio::SamplesBuffer tempInBuffer(in.getChannels(), samplesToProcessInThisStep);
-        tempInBuffer.set(in, offset, samplesToProcessInThisStep, 0);
+        // input samples are not copied, just wrapping the current interval part
+        const audio::SamplesBuffer inputPart(in.getView(offset, samplesToProcessInThisStep));
 
         bool newInterval = intervalPosition == 0;
         if (newInterval)   // starting new interval
@@ -351,7 +528,7 @@ void NinjamController::process(const audio::SamplesBuffer &in, audio::SamplesBuf
         bool isLastPart = intervalPosition + samplesToProcessInThisStep >= samplesInInterval;
         //for (NinjamTrackNode *track : trackNodes)
         //    track->setProcessingLastPartOfInterval(isLastPart); // TODO resampler still need a flag indicating the last part?
-        mainController->doAudioProcess(tempInBuffer, tempOutBuffer, sampleRate);
+        mainController->doAudioProcess(inputPart, tempOutBuffer, sampleRate);
         out.add(tempOutBuffer, offset); // generate audio output
         // ++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
@@ -367,17 +544,14 @@ void NinjamController::process(const audio::SamplesBuffer &in, audio::SamplesBuf
                     int channels = mainController->getMaxAudioChannelsForEncoding(groupIndex);
                     if (channels > 0)
                     {
-                        audio::SamplesBuffer inputMixBuffer(channels, samplesToProcessInThisStep);
-
-                        if (encoders.contains(groupIndex))
-                        {
-                            inputMixBuffer.zero();
-                            mainController->mixGroupedInputs(groupIndex, inputMixBuffer);
-
-                            // encoding is running in another thread to avoid slow down the audio thread
-                            encodingThread->addSamplesToEncode(inputMixBuffer, groupIndex,
-                                                               isFirstPart, isLastPart);
-                        }
+                        audio::ScratchArena::Scope mixScope(scratchArena);
+                        auto &inputMixBuffer = scratchArena.takeBuffer(channels, samplesToProcessInThisStep);
+                        mainController->mixGroupedInputs(groupIndex, inputMixBuffer);
+
+                        // encoding is running in another thread to avoid slow down the audio thread,
+                        // the encoders are created by the encoding workers in the interval start
+                        encodingPool->addSamplesToEncode(inputMixBuffer, groupIndex,
+                                                         isFirstPart, isLastPart);
                     }
                 }
             }
@@ -464,30 +638,30 @@ void NinjamController::stop(bool emitDisconnectedSignal)
         }
 
         // clear all tracks
-        for (auto trackNode : trackNodes.values()) {
+        QList<NinjamTrackNode *> removedTracks;
+        {
+            QMutexLocker locker(&mutex);
+            removedTracks = trackNodes.values();
+            trackNodes.clear();
+            publishTrackNodes();
+        }
+
+        for (auto trackNode : removedTracks) {
             if (trackNode)
                 mainController->removeTrack(trackNode->getID());
         }
-        trackNodes.clear();
     }
 
-    if (encodingThread)
+    if (encodingPool)
     {
-        encodingThread->stop();
-        encodingThread->wait(); // wait the encoding thread to finish
-        delete encodingThread;
-        encodingThread = nullptr;
+        encodingPool->stop(); // wait the encoding threads to finish
+        delete encodingPool;
+        encodingPool = nullptr;
     }
 
-    for (AudioEncoder *encoder : encoders.values())
-        delete encoder;
     encoders.clear();
 
-    // delete possible non consumed events
-    for (SchedulableEvent *e : scheduledEvents)
-        delete e;
-
-    scheduledEvents.clear();
+    deleteScheduledEvents(); // delete possible non consumed events
 
     qCDebug(jtNinjamCore) << "NinjamController destructor - disconnecting...";
 
@@ -525,40 +699,43 @@ NinjamController::~NinjamController()
     if (isRunning())
         stop(false);
 
-    // delete possible non consumed events
-    for (SchedulableEvent *e : scheduledEvents)
-        delete e;
+    deleteScheduledEvents(); // delete possible non consumed events
+
+    delete processingTrackNodes.load(); // the controller is not published, the audio thread is not using it
 }
 
 void NinjamController::start(const ServerInfo &server)
 {
     qCDebug(jtNinjamCore) << "starting ninjam controller...";
-    QMutexLocker locker(&mutex);
 
     // schedule an update in internal attributes
     auto bpi = server.getBpi();
     if (bpi > 0)
-        scheduledEvents.append(new BpiChangeEvent(this, bpi));
+        scheduleEvent(new BpiChangeEvent(this, bpi));
 
     auto bpm = server.getBpm();
     if (bpm > 0)
-        scheduledEvents.append(new BpmChangeEvent(this, bpm));
+        scheduleEvent(new BpmChangeEvent(this, bpm));
 
     preparedForTransmit = false; // the xmit start after the first interval is received
     emit preparingTransmission();
 
+    encodersMutex.lock();
+    voiceChatCodecAccepted = canUseVoiceChatCodec();
+    encodersMutex.unlock();
+
     // schedule the encoders creation (one encoder for each channel)
     int channels = mainController->getInputTrackGroupsCount();
     for (int channelIndex = 0; channelIndex < channels; ++channelIndex) {
         bool voiceChannelActivated = mainController->isVoiceChatActivated(channelIndex);
-        scheduledEvents.append(new InputChannelChangedEvent(this, channelIndex, voiceChannelActivated));
+        scheduleEvent(new InputChannelChangedEvent(this, channelIndex, voiceChannelActivated));
     }
 
-    processScheduledChanges();
+    processScheduledChanges(); // the controller is not published yet, processing the events in GUI thread
 
     if (!running)
     {
-        encodingThread = new NinjamController::EncodingThread(this);
+        encodingPool = new NinjamController::EncodingPool(this);
 
         // add a sine wave generator as input to test audio transmission
         // mainController->addInputTrackNode(new Audio::LocalInputTestStreamer(440, mainController->getAudioDriverSampleRate()));
@@ -679,6 +856,16 @@ void NinjamController::addTrack(const User &user, const UserChannel &channel)
         return;
 
     auto trackNode = new NinjamTrackNode(generateNewTrackID());
+    trackNode->prepareToProcess(mainController->getScratchArena().getMaxFrames()); // not rendered yet
+
+    // muted channels are not downloaded, unless the remote intervals are recorded
+    const QString userFullName = user.getFullName();
+    const quint8 channelIndex = channel.getIndex();
+    connect(trackNode, &NinjamTrackNode::muteChanged, this, [=](bool muted) {
+        auto service = mainController->getNinjamService();
+        if (service)
+            service->setChannelMuted(userFullName, channelIndex, muted && !mainController->isMultiTrackRecordingActivated());
+    });
 
     bool trackAdded = false;
 
@@ -686,6 +873,7 @@ void NinjamController::addTrack(const User &user, const UserChannel &channel)
     {
         QMutexLocker locker(&mutex);
         trackNodes.insert(getUniqueKeyForChannel(channel, user.getFullName()), trackNode);
+        publishTrackNodes();
     } // release the mutex before emit the signal
 
     trackAdded = mainController->addTrack(trackNode->getID(), trackNode);
@@ -696,10 +884,31 @@ void NinjamController::addTrack(const User &user, const UserChannel &channel)
     }
     else
     {
-        QMutexLocker locker(&mutex);
-        trackNodes.remove(getUniqueKeyForChannel(channel, user.getFullName()));
-        delete trackNode;
+        {
+            QMutexLocker locker(&mutex);
+            trackNodes.remove(getUniqueKeyForChannel(channel, user.getFullName()));
+            publishTrackNodes();
+        }
+
+        mainController->getRenderEpoch().retire([trackNode]() {
+            delete trackNode; // the audio thread can be using the old tracks snapshot
+        });
+    }
+}
+
+void NinjamController::publishTrackNodes()
+{
+    auto newTrackNodes = new TrackNodes();
+    newTrackNodes->reserve(trackNodes.size());
+    for (auto trackNode : trackNodes) {
+        if (trackNode)
+            newTrackNodes->push_back(trackNode);
     }
+
+    auto oldTrackNodes = processingTrackNodes.exchange(newTrackNodes);
+    mainController->getRenderEpoch().retire([oldTrackNodes]() {
+        delete oldTrackNodes;
+    });
 }
 
 void NinjamController::removeTrack(const User &user, const UserChannel &channel)
@@ -716,13 +925,16 @@ void NinjamController::removeTrack(const User &user, const UserChannel &channel)
             auto trackNode = trackNodes[uniqueKey];
             ID = trackNode->getID();
             trackNodes.remove(uniqueKey);
-            mainController->removeTrack(ID);
+            publishTrackNodes();
             channelDeleted = true;
         }
-    }
+    } // release the mutex before publish the new render graph
 
     if (channelDeleted)
+    {
+        mainController->removeTrack(ID);
         emit channelRemoved(user, channel, ID);
+    }
 }
 
 void NinjamController::voteBpi(int bpi)
@@ -784,17 +996,13 @@ void NinjamController::handleNewInterval()
     if (hasScheduledChanges())
         processScheduledChanges();
 
-    //mutex.lock();
-    for (auto track : trackNodes.values())
+    for (auto track : *processingTrackNodes.load()) // not deleted until the end of the current render epoch
     {
-        if (track) {
-            bool trackWasPlaying = track->isPlaying();
-            bool trackIsPlaying = track->startNewInterval();
-            if (trackWasPlaying != trackIsPlaying)
-                emit channelXmitChanged(track->getID(), trackIsPlaying);
-        }
+        bool trackWasPlaying = track->isPlaying();
+        bool trackIsPlaying = track->startNewInterval(samplesInInterval);
+        if (trackWasPlaying != trackIsPlaying)
+            emit channelXmitChanged(track->getID(), trackIsPlaying);
     }
-    //mutex.unlock();
 
     emit startingNewInterval(); // update the UI
 
@@ -803,12 +1011,42 @@ void NinjamController::handleNewInterval()
 
 void NinjamController::processScheduledChanges()
 {
-    for (SchedulableEvent *event : scheduledEvents)
+    SchedulableEvent *event = nullptr;
+    while (scheduledEvents.try_dequeue(event))
     {
         event->process();
-        delete event;
+        ++processedEvents; // the event is deleted in GUI thread
+    }
+}
+
+void NinjamController::scheduleEvent(SchedulableEvent *event)
+{
+    deleteProcessedEvents();
+
+    ownedEvents.append(event);
+    scheduledEvents.enqueue(event); // allocating in GUI thread when necessary, the audio thread is only dequeuing
+}
+
+void NinjamController::deleteProcessedEvents()
+{
+    // the events are processed in the same order they are scheduled
+    const uint processed = processedEvents;
+    while (deletedEvents != processed && !ownedEvents.isEmpty()) {
+        delete ownedEvents.takeFirst();
+        ++deletedEvents;
     }
-    scheduledEvents.clear();
+}
+
+void NinjamController::deleteScheduledEvents()
+{
+    SchedulableEvent *event = nullptr;
+    while (scheduledEvents.try_dequeue(event))
+        continue; // deleted below
+
+    qDeleteAll(ownedEvents);
+    ownedEvents.clear();
+    processedEvents = 0;
+    deletedEvents = 0;
 }
 
 long NinjamController::getSamplesPerBeat()
@@ -818,13 +1056,20 @@ long NinjamController::getSamplesPerBeat()
 
 long NinjamController::computeTotalSamplesInInterval()
 {
-    double intervalPeriod = 60000.0 / currentBpm * currentBpi;
+    return computeTotalSamplesInInterval(currentBpm, currentBpi);
+}
+
+long NinjamController::computeTotalSamplesInInterval(int bpm, int bpi) const
+{
+    double intervalPeriod = 60000.0 / bpm * bpi;
     return (long)(mainController->getSampleRate() * intervalPeriod / 1000.0);
 }
 
 // ninjam slots
 void NinjamController::handleNinjamUserEntering(const User &user)
 {
+    updateVoiceChatCodecStatus(); // the user can be subscribing the local channels without announcing channels
+
     emit userEnter(user.getFullName());
 }
 
@@ -833,21 +1078,29 @@ void NinjamController::handleNinjamUserExiting(const User &user)
     for (const auto &channel : user.getChannels())
         removeTrack(user, channel);
 
+    updateVoiceChatCodecStatus();
+
     emit userLeave(user.getFullName());
 }
 
 void NinjamController::addNinjamRemoteChannel(const User &user, const UserChannel &channel)
 {
     addTrack(user, channel);
+
+    updateVoiceChatCodecStatus();
 }
 
 void NinjamController::removeNinjamRemoteChannel(const User &user, const UserChannel &channel)
 {
     removeTrack(user, channel);
+
+    updateVoiceChatCodecStatus();
 }
 
 void NinjamController::updateNinjamRemoteChannel(const User &user, const UserChannel &channel)
 {
+    updateVoiceChatCodecStatus(); // flags can be changed
+
     auto uniqueKey = getUniqueKeyForChannel(channel, user.getFullName());
     QMutexLocker locker(&mutex);
     if (trackNodes.contains(uniqueKey))
@@ -862,22 +1115,28 @@ void NinjamController::updateNinjamRemoteChannel(const User &user, const UserCha
 void NinjamController::scheduleBpiChangeEvent(quint16 newBpi, quint16 oldBpi)
 {
     Q_UNUSED(oldBpi);
-    scheduledEvents.append(new BpiChangeEvent(this, newBpi));
+    scheduleEvent(new BpiChangeEvent(this, newBpi));
+
+    if (currentBpm > 0) // loopers memory is allocated now, the new interval length is used in the audio thread
+        mainController->reserveLoopersMemory(computeTotalSamplesInInterval(currentBpm, newBpi));
 }
 
 void NinjamController::scheduleBpmChangeEvent(quint16 newBpm)
 {
-    scheduledEvents.append(new BpmChangeEvent(this, newBpm));
+    scheduleEvent(new BpmChangeEvent(this, newBpm));
+
+    if (currentBpi > 0)
+        mainController->reserveLoopersMemory(computeTotalSamplesInInterval(newBpm, currentBpi));
 }
 
 void NinjamController::handleIntervalCompleted(const User &user, quint8 channelIndex,
-                                               const QByteArray &encodedData)
+                                               const QList<QByteArray> &encodedChunks)
 {
     if (mainController->isMultiTrackRecordingActivated())
     {
         auto geoLocation = mainController->getGeoLocation(user.getIp());
         QString userName = user.getName() + " from " + geoLocation.countryName;
-        mainController->saveEncodedAudio(userName, channelIndex, encodedData);
+        mainController->saveEncodedAudio(userName, channelIndex, encodedChunks); // chunks are streamed to disk
     }
 
     auto channel = user.getChannel(channelIndex);
@@ -888,7 +1147,7 @@ void NinjamController::handleIntervalCompleted(const User &user, quint8 channelI
         NinjamTrackNode *trackNode = trackNodes[channelKey];
         if (trackNode)
         {
-            trackNode->addVorbisEncodedInterval(encodedData);
+            trackNode->addVorbisEncodedInterval(encodedChunks);
             emit channelAudioFullyDownloaded(trackNode->getID());
         }
     }
@@ -911,48 +1170,164 @@ void NinjamController::reset()
 
 void NinjamController::scheduleEncoderChangeForChannel(int channelIndex, bool voiceChatActivated)
 {
-    scheduledEvents.append(new InputChannelChangedEvent(this, channelIndex, voiceChatActivated));
+    scheduleEvent(new InputChannelChangedEvent(this, channelIndex, voiceChatActivated));
 }
 
-QByteArray NinjamController::encode(const audio::SamplesBuffer &buffer, uint channelIndex)
+QSharedPointer<AudioEncoder> NinjamController::getEncoder(quint8 channelIndex)
 {
+    // encoders are shared, the encoding workers are not holding the mutex while encoding
     QMutexLocker locker(&encodersMutex);
-    if (encoders.contains(channelIndex))
-        return encoders[channelIndex]->encode(buffer);
+    return encoders.value(channelIndex);
+}
+
+QByteArray NinjamController::encode(const audio::SamplesBuffer &buffer, uint channelIndex)
+{
+    auto encoder = getEncoder(channelIndex);
+    if (encoder)
+        return encoder->encode(buffer);
     return QByteArray();
 }
 
+void NinjamController::prepareEncoder(uint channelIndex, int channels)
+{
+    // replace the encoder when the channel input or the voice chat status changed
+    recreateEncoderForChannel(channelIndex, isVoiceChatEncoding(channelIndex), channels);
+}
+
+void NinjamController::setVoiceChatEncoding(int channelIndex, bool voiceChannelActivated)
+{
+    if (channelIndex < 0 || channelIndex >= 64)
+        return;
+
+    const quint64 channelBit = quint64(1) << channelIndex;
+    if (voiceChannelActivated)
+        voiceChatChannels |= channelBit;
+    else
+        voiceChatChannels &= ~channelBit;
+}
+
+bool NinjamController::isVoiceChatEncoding(int channelIndex) const
+{
+    if (channelIndex < 0 || channelIndex >= 64)
+        return false;
+
+    return (voiceChatChannels.load() >> channelIndex) & 1;
+}
+
 QByteArray NinjamController::encodeLastPartOfInterval(uint channelIndex)
 {
-    QMutexLocker locker(&encodersMutex);
-    if (encoders.contains(channelIndex))
-        return encoders[channelIndex]->finishIntervalEncoding();
+    auto encoder = getEncoder(channelIndex);
+    if (encoder)
+        return encoder->finishIntervalEncoding();
     return QByteArray();
 }
 
-void NinjamController::recreateEncoderForChannel(int channelIndex, bool voiceChannelActivated)
+uint NinjamController::getEncodingWorkers() const
+{
+    return encodingPool ? encodingPool->getWorkers() : 0;
+}
+
+uint NinjamController::getEncodingQueueDepth(uint worker) const
+{
+    return encodingPool ? encodingPool->getQueueDepth(worker) : 0;
+}
+
+uint NinjamController::getEncodingPeakQueueDepth(uint worker) const
+{
+    return encodingPool ? encodingPool->getPeakQueueDepth(worker) : 0;
+}
+
+uint NinjamController::getEncodingDroppedChunks() const
+{
+    return encodingPool ? encodingPool->getDroppedChunks() : 0;
+}
+
+void NinjamController::recreateEncoderForChannel(int channelIndex, bool voiceChannelActivated, int maxChannelsForEncoding)
 {
     QMutexLocker locker(&encodersMutex);
-    int maxChannelsForEncoding = mainController->getMaxAudioChannelsForEncoding(channelIndex);
 
     if (maxChannelsForEncoding <= 0) // input track is setted as noInput?
         return;
 
+    int voiceChatFrameDuration = mainController->getSettings().getVoiceChatFrameDuration();
+    bool useVoiceChatCodec = voiceChannelActivated && voiceChatCodecAccepted && voiceChatFrameDuration > 0;
+
     bool currentEncoderIsInvalid = encoders.contains(channelIndex)
                                    && (encoders[channelIndex]->getChannels()
                                        != maxChannelsForEncoding
                                        || encoders[channelIndex]->getSampleRate()
-                                       != mainController->getSampleRate());
+                                       != mainController->getSampleRate()
+                                       || isVoiceChatEncoder(encoders[channelIndex]) != useVoiceChatCodec);
 
     if (!encoders.contains(channelIndex) || currentEncoderIsInvalid)   // a new encoder is necessary?
     {
-        if (currentEncoderIsInvalid && encoders.contains(channelIndex))
-            delete encoders[channelIndex];
-
         int sampleRate = mainController->getSampleRate();
-        float encodingQuality = voiceChannelActivated ? vorbis::EncoderQualityLow : mainController->getEncodingQuality();
 
-        encoders[channelIndex] = new vorbis::Encoder(maxChannelsForEncoding, sampleRate, encodingQuality);
+        // the invalid encoder is deleted when not used by encoding workers
+        if (useVoiceChatCodec) {
+            encoders[channelIndex].reset(new voicechat::Encoder(maxChannelsForEncoding, sampleRate, voiceChatFrameDuration));
+        }
+        else {
+            float encodingQuality = voiceChannelActivated ? vorbis::EncoderQualityLow : mainController->getEncodingQuality();
+            encoders[channelIndex].reset(new vorbis::Encoder(maxChannelsForEncoding, sampleRate, encodingQuality));
+        }
+    }
+}
+
+bool NinjamController::isVoiceChatEncoder(const QSharedPointer<AudioEncoder> &encoder)
+{
+    return dynamic_cast<voicechat::Encoder *>(encoder.data()) != nullptr;
+}
+
+bool NinjamController::isVoiceChatCodecAccepted() const
+{
+    QMutexLocker locker(&encodersMutex);
+    return voiceChatCodecAccepted;
+}
+
+bool NinjamController::canUseVoiceChatCodec() const
+{
+    // the low latency voice chat codec is used only when all users can decode it. The server is not telling
+    // which users are subscribing the local channels, so all users are checked, including bots and users
+    // without channels (listeners, bots streaming or recording the room)
+    auto service = mainController->getNinjamService();
+    auto server = service->getCurrentServer();
+    if (!server)
+        return false;
+
+    const QString localUserName = service->getConnectedUserName();
+    for (const auto &user : server->getUsers()) {
+        if (user.getName() == localUserName)
+            continue;
+
+        bool supported = false;
+        for (const auto &channel : user.getChannels())
+            supported = supported || channel.supportsVoiceChatCodec();
+
+        if (!supported)
+            return false; // older Jamtaba versions, other ninjam clients, bots, or all channels in voice chat mode
+    }
+
+    return true;
+}
+
+void NinjamController::updateVoiceChatCodecStatus()
+{
+    bool accepted = canUseVoiceChatCodec();
+
+    {
+        QMutexLocker locker(&encodersMutex);
+        if (accepted == voiceChatCodecAccepted)
+            return;
+
+        voiceChatCodecAccepted = accepted;
+    }
+
+    // voice chat encoders are replaced in the next interval
+    int channels = mainController->getInputTrackGroupsCount();
+    for (int channelIndex = 0; channelIndex < channels; ++channelIndex) {
+        if (mainController->isVoiceChatActivated(channelIndex))
+            scheduleEncoderChangeForChannel(channelIndex, true);
     }
 }
 
@@ -961,13 +1336,12 @@ void NinjamController::recreateEncoders()
     if (isRunning())
     {
         QMutexLocker locker(&encodersMutex); // this method is called from main thread, and the encoders are used in audio thread every time
-        for (int e = 0; e < encoders.size(); ++e)
-            delete encoders[e];
         encoders.clear(); // new encoders will be create on demand
 
         int trackGroupsCount = mainController->getInputTrackGroupsCount();
         for (int channelIndex = 0; channelIndex < trackGroupsCount; ++channelIndex) {
-            recreateEncoderForChannel(channelIndex, mainController->isVoiceChatActivated(channelIndex));
+            recreateEncoderForChannel(channelIndex, mainController->isVoiceChatActivated(channelIndex),
+                                      mainController->getMaxAudioChannelsForEncoding(channelIndex));
         }
     }
 }
@@ -5,8 +5,13 @@
 #include <QMutex>
 #include <QThread>
 #include <QMap>
+#include <QSharedPointer>
 
 #include "audio/Encoder.h"
+#include "audio/readerwriterqueue.h"
+
+#include <atomic>
+#include <vector>
 
 class NinjamTrackNode;
 
@@ -41,6 +46,7 @@ public:
     explicit NinjamController(MainController *mainController);
     virtual ~NinjamController();
     virtual void process(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate);
+    void prepareToProcess(uint maxFrames); // the audio driver is stopped, remote tracks are preparing the resamplers
     void start(const ServerInfo &server);
     void stop(bool emitDisconnectedSignal);
     bool isRunning() const;
@@ -69,8 +75,16 @@ public:
 
     QByteArray encode(const SamplesBuffer &buffer, uint channelIndex);
     QByteArray encodeLastPartOfInterval(uint channelIndex);
+    void prepareEncoder(uint channelIndex, int channels); // called by encoding workers in the interval start
+
+    // encoding queue metrics, queue depth is the number of chunks waiting (or being encoded) in each worker
+    uint getEncodingWorkers() const;
+    uint getEncodingQueueDepth(uint worker) const;
+    uint getEncodingPeakQueueDepth(uint worker) const;
+    uint getEncodingDroppedChunks() const; // audio blocks not transmitted because the encoding backlog limit was reached
 
     void scheduleEncoderChangeForChannel(int channelIndex, bool voiceChatActivated);
+    bool isVoiceChatCodecAccepted() const; // all users receiving the uploaded intervals can decode the voice chat codec
     void removeEncoder(int groupChannelIndex);
 
     void scheduleXmitChange(int channelID, bool transmiting);     // schedule the change for the next interval
@@ -123,7 +137,10 @@ protected:
     long intervalPosition;
     long samplesInInterval;
 
-    QMap<QString, NinjamTrackNode *> trackNodes;     // the other users channels
+    QMap<QString, NinjamTrackNode *> trackNodes;     // the other users channels, protected by mutex
+
+    typedef std::vector<NinjamTrackNode *> TrackNodes;
+    std::atomic<const TrackNodes *> processingTrackNodes; // immutable snapshot used in audio thread, replaced when tracks change
 
     MainController *mainController;
 
@@ -135,6 +152,7 @@ private:
 
     void addTrack(const User &user, const UserChannel &channel);
     void removeTrack(const User &user, const UserChannel &channel);
+    void publishTrackNodes(); // must be called with mutex locked
 
     bool running;
     int lastBeat;
@@ -142,10 +160,11 @@ private:
     int currentBpi;
     int currentBpm;
 
-    QMutex mutex;
-    QMutex encodersMutex;
+    QMutex mutex; // never locked in audio thread
+    mutable QMutex encodersMutex; // used by GUI and encoding threads
 
     long computeTotalSamplesInInterval();
+    long computeTotalSamplesInInterval(int bpm, int bpi) const;
     long getSamplesPerBeat();
 
     void processScheduledChanges();
@@ -155,11 +174,20 @@ private:
 
     MetronomeTrackNode *createMetronomeTrackNode(int sampleRate);
 
-    QMap<int, AudioEncoder *> encoders;
-    AudioEncoder *getEncoder(quint8 channelIndex);
+    QMap<int, QSharedPointer<AudioEncoder>> encoders;
+    QSharedPointer<AudioEncoder> getEncoder(quint8 channelIndex);
 
     void handleNewInterval();
-    void recreateEncoderForChannel(int channelIndex, bool voiceChannelActivated);
+    void recreateEncoderForChannel(int channelIndex, bool voiceChannelActivated, int maxChannelsForEncoding);
+
+    std::atomic<quint64> voiceChatChannels; // channels using voice chat encoders, updated in the interval start
+    void setVoiceChatEncoding(int channelIndex, bool voiceChannelActivated);
+    bool isVoiceChatEncoding(int channelIndex) const;
+
+    bool voiceChatCodecAccepted; // all users can decode the low latency voice chat codec, protected by encodersMutex
+    bool canUseVoiceChatCodec() const;
+    void updateVoiceChatCodecStatus(); // called when users or channels change
+    static bool isVoiceChatEncoder(const QSharedPointer<AudioEncoder> &encoder);
 
     void setXmitStatus(int channelID, bool transmiting);
 
@@ -169,11 +197,18 @@ private:
     class BpiChangeEvent;
     class BpmChangeEvent;
     class InputChannelChangedEvent;    // user change the channel input selection from mono to stereo or vice-versa, or user added a new channel, both cases requires a new encoder in next interval
-    QList<SchedulableEvent *> scheduledEvents;
+    void scheduleEvent(SchedulableEvent *event);
+    void deleteProcessedEvents();
+    void deleteScheduledEvents(); // the audio thread is not processing the events
+
+    moodycamel::ReaderWriterQueue<SchedulableEvent *> scheduledEvents; // GUI thread -> audio thread
+    QList<SchedulableEvent *> ownedEvents; // scheduled events in order, deleted in GUI thread after processed
+    std::atomic<uint> processedEvents; // incremented by audio thread
+    uint deletedEvents;
 
-    class EncodingThread;
+    class EncodingPool;
 
-    EncodingThread *encodingThread;
+    EncodingPool *encodingPool;
 
     bool preparedForTransmit;
     int waitingIntervals;
@@ -184,7 +219,7 @@ private slots:
     void scheduleBpmChangeEvent(quint16 newBpm);
     void scheduleBpiChangeEvent(quint16 newBpi, quint16 oldBpi);
     void handleIntervalCompleted(const User &user, quint8 channelIndex,
-                                 const QByteArray &encodedAudioData);
+                                 const QList<QByteArray> &encodedAudioChunks);
     void handleIntervalDownloading(const User &user, quint8 channelIndex, const QByteArray &encodedAudio, bool isFirstPart, bool isLastPart);
     void addNinjamRemoteChannel(const User &user, const UserChannel &channel);
     void removeNinjamRemoteChannel(const User &user, const UserChannel &channel);
@@ -202,7 +237,7 @@ inline QList<NinjamTrackNode *> NinjamController::getTrackNodes() const
 
 inline bool NinjamController::hasScheduledChanges() const
 {
-    return !scheduledEvents.isEmpty();
+    return scheduledEvents.peek() != nullptr;
 }
 
 inline bool NinjamController::isPreparedForTransmit() const
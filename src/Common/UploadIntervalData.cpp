@@ -1,8 +1,9 @@
 #include "UploadIntervalData.h"
 #include <QUuid>
 
-UploadIntervalData::UploadIntervalData() :
-    GUID(newGUID())
+UploadIntervalData::UploadIntervalData(bool voiceChatCodec) :
+    GUID(newGUID()),
+    voiceChatCodec(voiceChatCodec)
 {
 }
 
@@ -7,7 +7,7 @@ class UploadIntervalData
 {
 
 public:
-    UploadIntervalData();
+    explicit UploadIntervalData(bool voiceChatCodec = false);
     ~UploadIntervalData();
 
     inline QByteArray getGUID() const
@@ -37,10 +37,16 @@ public:
         dataToUpload.clear();
     }
 
+    inline bool isVoiceChatCodec() const // 'JTVC' interval, only sent when all users can decode it
+    {
+        return voiceChatCodec;
+    }
+
 private:
     static QByteArray newGUID();
     QByteArray GUID;
     QByteArray dataToUpload;
+    bool voiceChatCodec;
 
 };
 
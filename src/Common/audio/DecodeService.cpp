@@ -0,0 +1,146 @@
+#include "DecodeService.h"
+#include "audio/core/LatencyProbes.h"
+#include "log/Logging.h"
+
+#include <QThread>
+#include <QMutexLocker>
+
+using audio::DecodeService;
+
+class DecodeService::Worker : public QThread
+{
+public:
+    explicit Worker(DecodeService &service) :
+        service(service)
+    {
+
+    }
+
+protected:
+    void run() override
+    {
+        service.run();
+        audio::LatencyProbes::releaseThreadRing();
+    }
+
+private:
+    DecodeService &service;
+};
+
+// -------------------------------------------------------------
+
+DecodeService::Job::Job() :
+    owners(1)
+{
+
+}
+
+DecodeService::Job::~Job()
+{
+
+}
+
+// -------------------------------------------------------------
+
+DecodeService &DecodeService::getInstance()
+{
+    static DecodeService instance;
+    return instance;
+}
+
+DecodeService::DecodeService() :
+    lookAhead(DEFAULT_LOOK_AHEAD),
+    memoryLimit(DEFAULT_MEMORY_LIMIT),
+    bufferedBytes(0),
+    stopRequested(false)
+{
+
+}
+
+DecodeService::~DecodeService()
+{
+    if (worker) {
+        {
+            QMutexLocker locker(&mutex);
+            stopRequested = true;
+            jobsAdded.wakeAll();
+        }
+        worker->wait();
+    }
+
+    qDeleteAll(jobs);
+    qDeleteAll(newJobs);
+}
+
+void DecodeService::startWorker()
+{
+    qCDebug(jtAudio) << "Starting decode service thread";
+
+    worker.reset(new Worker(*this));
+    worker->start(QThread::HighPriority); // below audio thread, above GUI
+}
+
+void DecodeService::addJob(Job *job)
+{
+    Q_ASSERT(job);
+
+    QMutexLocker locker(&mutex);
+
+    if (!worker)
+        startWorker();
+
+    newJobs.append(job);
+    jobsAdded.wakeAll();
+}
+
+void DecodeService::setLookAhead(uint milliseconds)
+{
+    lookAhead = milliseconds;
+}
+
+void DecodeService::setMemoryLimit(size_t bytes)
+{
+    memoryLimit = bytes;
+}
+
+void DecodeService::run()
+{
+    while (!stopRequested) {
+        {
+            QMutexLocker locker(&mutex);
+            jobs.append(newJobs);
+            newJobs.clear();
+        }
+
+        size_t totalBytes = 0;
+        for (auto job : jobs)
+            totalBytes += job->getBufferedBytes();
+
+        // jobs are decoded in arrival order, the next intervals to be played are the first jobs
+        bool decodedSomething = false;
+        auto it = jobs.begin();
+        while (it != jobs.end()) {
+            auto job = *it;
+            if (job->isRetired()) {
+                delete job;
+                it = jobs.erase(it);
+                continue;
+            }
+
+            if (totalBytes < memoryLimit) {
+                size_t decodedBytes = job->decodeAhead(lookAhead);
+                totalBytes += decodedBytes;
+                decodedSomething = decodedSomething || decodedBytes > 0;
+            }
+            ++it;
+        }
+
+        bufferedBytes = totalBytes;
+
+        if (!decodedSomething) {
+            QMutexLocker locker(&mutex);
+            if (newJobs.isEmpty() && !stopRequested)
+                jobsAdded.wait(&mutex, IDLE_WAIT_TIME);
+        }
+    }
+}
@@ -0,0 +1,117 @@
+#ifndef DECODE_SERVICE_H
+#define DECODE_SERVICE_H
+
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QScopedPointer>
+
+#include <atomic>
+
+namespace audio {
+
+/**
+ * Decode downloaded intervals ahead of playback in a dedicated thread, so the audio thread
+ * only copy already decoded samples. Each Job keeps its decoded samples in a SPSC queue, the
+ * service decodes jobs until they have 'lookAhead' milliseconds buffered or the decoded samples
+ * in all jobs reach the memory limit. Jobs are decoding inline (in audio thread) if the service is late.
+ */
+
+class DecodeService
+{
+
+public:
+
+    class Job
+    {
+    public:
+        Job();
+        virtual ~Job();
+
+        void retain(); // one more owner, each owner call retire()
+        void retire(); // the job is deleted by the service when all owners retired, the owner can't use the job after retire()
+        bool isRetired() const;
+
+        virtual size_t decodeAhead(uint lookAheadMs) = 0; // called in service thread, return the decoded bytes
+        virtual size_t getBufferedBytes() const = 0;
+
+    private:
+        std::atomic<int> owners;
+    };
+
+    static DecodeService &getInstance();
+
+    ~DecodeService();
+
+    void addJob(Job *job); // the service is owning the job
+
+    void setLookAhead(uint milliseconds);
+    void setMemoryLimit(size_t bytes);
+
+    uint getLookAhead() const;
+    size_t getMemoryLimit() const;
+    size_t getBufferedBytes() const; // decoded samples in all jobs, updated in each service loop
+
+    static const uint DEFAULT_LOOK_AHEAD = 2000; // ms
+    static const size_t DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024;
+
+private:
+    DecodeService();
+    DecodeService(const DecodeService &other);
+    DecodeService &operator=(const DecodeService &other);
+
+    class Worker;
+
+    void run(); // service thread loop
+    void startWorker();
+
+    QScopedPointer<Worker> worker;
+
+    mutable QMutex mutex;
+    QWaitCondition jobsAdded;
+    QList<Job *> newJobs; // protected by mutex, moved to 'jobs' by the service thread
+    QList<Job *> jobs; // used in service thread only
+
+    std::atomic<uint> lookAhead;
+    std::atomic<size_t> memoryLimit;
+    std::atomic<size_t> bufferedBytes;
+    std::atomic<bool> stopRequested;
+
+    static const int IDLE_WAIT_TIME = 5; // ms, waiting for playback to consume decoded samples
+};
+
+inline bool DecodeService::Job::isRetired() const
+{
+    return owners <= 0;
+}
+
+inline void DecodeService::Job::retain()
+{
+    owners++;
+}
+
+inline void DecodeService::Job::retire()
+{
+    Q_ASSERT(owners > 0);
+
+    owners--;
+}
+
+inline uint DecodeService::getLookAhead() const
+{
+    return lookAhead;
+}
+
+inline size_t DecodeService::getMemoryLimit() const
+{
+    return memoryLimit;
+}
+
+inline size_t DecodeService::getBufferedBytes() const
+{
+    return bufferedBytes;
+}
+
+} // namespace
+
+#endif // DECODE_SERVICE_H
@@ -0,0 +1,26 @@
+#ifndef _JTBA_AUDIO_DECODER_
+#define _JTBA_AUDIO_DECODER_
+
+#include <QByteArray>
+
+#include "audio/core/SamplesBuffer.h"
+
+/**
+ * @brief The 'interface' for the decoders used to play the downloaded intervals
+ */
+class AudioDecoder
+{
+    public:
+        virtual ~AudioDecoder(){}
+        virtual const audio::SamplesBuffer &decode(int maxSamplesToDecode) = 0; // the returned buffer is always stereo
+        virtual void addInputData(const QByteArray &encodedData) = 0;
+        virtual void setInputData(const QByteArray &encodedData) = 0;
+        virtual int getSampleRate() const = 0;
+        virtual bool isStereo() const = 0;
+        virtual bool isFinished() const = 0;
+        virtual bool isValid() const = 0;
+        virtual void setInputComplete() = 0; // all encoded data was added, the end of input is the end of stream
+        virtual qint64 getTotalFrames() const = 0; // stream lenght, -1 if unknown before the stream is decoded
+};
+
+#endif
@@ -6,18 +6,35 @@
 #include <QByteArray>
 #include <QMutexLocker>
 #include <QDateTime>
-#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <vector>
 
 #include "audio/core/Filters.h"
 #include "audio/core/AudioDriver.h"
+#include "audio/core/LatencyProbes.h"
 #include "audio/vorbis/VorbisDecoder.h"
+#include "audio/voicechat/VoiceChatDecoder.h"
+#include "audio/DecodeService.h"
 
 
 const double NinjamTrackNode::LOW_CUT_DRASTIC_FREQUENCY = 220.0; // in Hertz
 const double NinjamTrackNode::LOW_CUT_NORMAL_FREQUENCY = 120.0; // in Hertz
+const int NinjamTrackNode::MAX_BUFFERED_INTERVALS = 3; // one interval is enough when the audio device is consuming the intervals
 
 using audio::Filter;
 
+namespace {
+
+std::atomic<qint64> bufferedIntervalsBytes(0); // encoded bytes in all interval decoders
+
+const double MAX_CLOCK_DRIFT = 0.01; // sound card clocks are drifting much less than 1%
+
+} // namespace
+
 class NinjamTrackNode::LowCutFilter
 {
 public:
@@ -87,111 +104,378 @@ public:
     void execute() override {
         trackNode->setChannelMode(newChannelMode);
     }
+
+    bool waitsForNextInterval() const override {
+        return true;
+    }
+};
+
+class NinjamTrackNode::AddDecoderCommand : public NinjamTrackNode::TrackNodeCommand
+{
+private:
+    IntervalDecoder *decoder;
+
+public:
+    AddDecoderCommand(NinjamTrackNode *node, IntervalDecoder *decoder)
+        : NinjamTrackNode::TrackNodeCommand(node),
+          decoder(decoder)
+    {
+        //
+    }
+
+    void execute() override {
+        trackNode->addDecoder(decoder);
+    }
+};
+
+class NinjamTrackNode::DiscardIntervalsCommand : public NinjamTrackNode::TrackNodeCommand
+{
+public:
+    explicit DiscardIntervalsCommand(NinjamTrackNode *node)
+        : NinjamTrackNode::TrackNodeCommand(node)
+    {
+        //
+    }
+
+    void execute() override {
+        trackNode->discardIntervals();
+    }
 };
 
 //--------------------------------------------------------------------------
 
-class NinjamTrackNode::IntervalDecoder
+class NinjamTrackNode::IntervalDecoder : public audio::DecodeService::Job
 {
 public:
-    explicit IntervalDecoder(const QByteArray &vorbisData = QByteArray());
-    void decode(quint32 maxSamplesToDecode);
-    void addEncodedData(const QByteArray &vorbisData);
-    quint32 getDecodedSamples(audio::SamplesBuffer &outBuffer, uint samplesToDecode);
-    inline int getSampleRate() const { return vorbisDecoder.getSampleRate(); }
-    inline bool isStereo() const { return vorbisDecoder.isStereo(); }
-    void stopDecoding();
-    bool isFullyDecoded() const { return vorbisDecoder.isFinished(); }
-    bool isValid() const { return vorbisDecoder.isValid(); }
+    explicit IntervalDecoder(const QList<QByteArray> &encodedChunks = QList<QByteArray>(), bool inputComplete = true);
+    ~IntervalDecoder();
+    void addEncodedData(const QByteArray &encodedData, bool isLastPart);
+    quint32 getDecodedSamples(audio::SamplesBuffer &outBuffer, uint samplesToDecode); // audio thread, never decoding
+    inline bool hasFormat() const { return sampleRate > 0; } // false until the first decoded chunk is published
+    inline int getSampleRate() const { return sampleRate; }
+    inline bool isStereo() const { return stereo; }
+    bool isFullyDecoded() const { return finished && bufferedFrames == 0; }
+    qint64 getTotalFrames() const; // exact when all data is decoded, read from the stream before. -1 if unknown
+    bool isValid() const { return valid; }
+
+    size_t decodeAhead(uint lookAheadMs) override; // called in decode service thread
+    size_t getBufferedBytes() const override;
+
 private:
-    vorbis::Decoder vorbisDecoder;
-    audio::SamplesBuffer decodedBuffer;
-    QMutex mutex;
+    void appendInput(const QByteArray &encodedData); // mutex must be locked
+    void completeInput(); // mutex must be locked
+
+    std::unique_ptr<AudioDecoder> decoder; // vorbis or voice chat codec, created when the first encoded bytes are received
+    QMutex mutex; // protecting decoder, shared by control threads and decode service
+    bool inputComplete; // all interval bytes received, protected by mutex
+
+    static const uint CHUNK_FRAMES = 2048;
+    static const uint MAX_CHUNKS = 128;
+
+    // decoded chunks are allocated in decode service thread and recycled by audio thread
+    moodycamel::ReaderWriterQueue<audio::SamplesBuffer *> decodedChunks; // service thread -> audio thread
+    moodycamel::ReaderWriterQueue<audio::SamplesBuffer *> freeChunks; // audio thread -> service thread
+    std::vector<std::unique_ptr<audio::SamplesBuffer>> chunks;
+    audio::SamplesBuffer *spareChunk; // service thread only
+    audio::SamplesBuffer *currentChunk; // audio thread only
+    uint currentChunkOffset;
+
+    // written by decode service before the chunks (or the end of stream) are published
+    std::atomic<uint> bufferedFrames;
+    std::atomic<quint64> decodedFrames;
+    std::atomic<int> sampleRate; // zero until the first decoded chunk
+    std::atomic<bool> stereo;
+    std::atomic<bool> finished;
+    std::atomic<bool> valid;
+    std::atomic<qint64> streamFrames; // the stream lenght when the input is complete
+    qint64 encodedBytes; // protected by mutex
 };
 
-NinjamTrackNode::IntervalDecoder::IntervalDecoder(const QByteArray &vorbisData)
-    :decodedBuffer(2)
+NinjamTrackNode::IntervalDecoder::IntervalDecoder(const QList<QByteArray> &encodedChunks, bool inputComplete) :
+    inputComplete(false),
+    decodedChunks(MAX_CHUNKS),
+    freeChunks(MAX_CHUNKS),
+    spareChunk(nullptr),
+    currentChunk(nullptr),
+    currentChunkOffset(0),
+    bufferedFrames(0),
+    decodedFrames(0),
+    sampleRate(0),
+    stereo(false),
+    finished(false),
+    valid(true),
+    streamFrames(-1),
+    encodedBytes(0)
 {
     // this funcion is called from GUI thread
 
-
+    chunks.reserve(MAX_CHUNKS);
 
     QMutexLocker locker(&mutex);
-    vorbisDecoder.setInputData(vorbisData);
+    for (const auto &chunk : encodedChunks)
+        appendInput(chunk); // downloaded chunks are shared with the decoder, not copied
+
+    if (inputComplete)
+        completeInput();
+}
+
+NinjamTrackNode::IntervalDecoder::~IntervalDecoder()
+{
+    // deleted by decode service after retire()
+
+    bufferedIntervalsBytes -= encodedBytes;
 }
 
-void NinjamTrackNode::IntervalDecoder::addEncodedData(const QByteArray &vorbisData)
+void NinjamTrackNode::IntervalDecoder::addEncodedData(const QByteArray &encodedData, bool isLastPart)
 {
     // this funcion is called from GUI thread
 
     QMutexLocker locker(&mutex);
-    vorbisDecoder.addInputData(vorbisData);
+    appendInput(encodedData);
+
+    if (isLastPart)
+        completeInput();
 }
 
-void NinjamTrackNode::IntervalDecoder::decode(quint32 maxSamplesToDecode)
+void NinjamTrackNode::IntervalDecoder::appendInput(const QByteArray &encodedData)
 {
-    mutex.lock();
+    if (!decoder) {
+        if (encodedData.isEmpty())
+            return;
 
-    decodedBuffer.append(vorbisDecoder.decode(maxSamplesToDecode));
+        // voice chat channels can use the low latency codec, the stream header is in the first chunk
+        if (voicechat::isVoiceChatStream(encodedData))
+            decoder.reset(new voicechat::Decoder());
+        else
+            decoder.reset(new vorbis::Decoder());
+    }
 
-    mutex.unlock();
+    encodedBytes += encodedData.size();
+    bufferedIntervalsBytes += encodedData.size();
+
+    decoder->addInputData(encodedData);
 }
 
-void NinjamTrackNode::IntervalDecoder::stopDecoding()
+void NinjamTrackNode::IntervalDecoder::completeInput()
 {
-    mutex.lock(); // this funcion is called from GUI thread
+    inputComplete = true;
 
-    vorbisDecoder.setInputData(QByteArray()); // empty data
+    if (decoder) {
+        decoder->setInputComplete();
+        streamFrames = decoder->getTotalFrames();
+    }
+}
+
+qint64 NinjamTrackNode::IntervalDecoder::getTotalFrames() const
+{
+    if (!finished)
+        return streamFrames; // the drift is compensated from the interval start
 
-    mutex.unlock();
+    return static_cast<qint64>(decodedFrames); // updated before 'finished' is published
+}
+
+size_t NinjamTrackNode::IntervalDecoder::getBufferedBytes() const
+{
+    return bufferedFrames * 2 * sizeof(float); // decoded chunks are always stereo
+}
+
+size_t NinjamTrackNode::IntervalDecoder::decodeAhead(uint lookAheadMs)
+{
+    if (finished || !valid)
+        return 0;
+
+    const quint64 lookAheadRate = hasFormat() ? sampleRate.load() : 44100; // the first chunk is decoded as soon as possible
+    if (bufferedFrames >= lookAheadRate * lookAheadMs / 1000)
+        return 0;
+
+    audio::SamplesBuffer *chunk = spareChunk;
+    if (!chunk && !freeChunks.try_dequeue(chunk)) {
+        if (chunks.size() >= MAX_CHUNKS)
+            return 0; // audio thread is not consuming
+
+        chunks.emplace_back(new audio::SamplesBuffer(2, CHUNK_FRAMES));
+        chunk = chunks.back().get();
+    }
+    spareChunk = nullptr;
+
+    QMutexLocker locker(&mutex);
+
+    if (!decoder) {
+        spareChunk = chunk;
+        finished = inputComplete; // empty interval
+        return 0; // waiting for the first encoded bytes
+    }
+
+    // partial input is decoded while downloading, the decoders are waiting for more input until the last part is received
+    const auto &decodedSamples = decoder->decode(static_cast<int>(CHUNK_FRAMES));
+
+    const uint frames = decodedSamples.getFrameLenght();
+    if (frames) {
+        chunk->setFrameLenght(frames);
+        chunk->set(decodedSamples);
+
+        stereo = decoder->isStereo();
+        sampleRate = decoder->getSampleRate();
+        bufferedFrames += frames;
+        decodedFrames += frames;
+        decodedChunks.try_enqueue(chunk); // never fail, the queue can hold all chunks
+    }
+    else {
+        spareChunk = chunk; // waiting for more encoded data or all data decoded
+    }
+
+    valid = decoder->isValid();
+    finished = decoder->isFinished(); // published after the decoded frames
+
+    return frames * 2 * sizeof(float);
 }
 
 quint32 NinjamTrackNode::IntervalDecoder::getDecodedSamples(audio::SamplesBuffer &outBuffer, uint samplesToDecode)
 {
-    mutex.lock();
-    while (decodedBuffer.getFrameLenght() < samplesToDecode) { //need decode more samples to fill outBuffer?
-        quint32 toDecode = samplesToDecode - decodedBuffer.getFrameLenght();
-        const auto &decodedSamples = vorbisDecoder.decode(toDecode);
-        decodedBuffer.append(decodedSamples);
-        if (decodedSamples.isEmpty())
-            break; //no more samples to decode
+    outBuffer.setFrameLenght(samplesToDecode);
+
+    uint totalSamples = 0;
+    while (totalSamples < samplesToDecode) {
+        if (!currentChunk && !decodedChunks.try_dequeue(currentChunk))
+            break; // all decoded samples consumed, the remaining samples are consumed in the next audio blocks
+
+        const uint frames = qMin(currentChunk->getFrameLenght() - currentChunkOffset, samplesToDecode - totalSamples);
+        outBuffer.set(*currentChunk, currentChunkOffset, frames, totalSamples);
+        totalSamples += frames;
+        currentChunkOffset += frames;
+        bufferedFrames -= frames;
+
+        if (currentChunkOffset >= currentChunk->getFrameLenght()) {
+            freeChunks.try_enqueue(currentChunk); // recycling the chunk
+            currentChunk = nullptr;
+            currentChunkOffset = 0;
+        }
     }
 
-    quint32 totalSamples = qMin(samplesToDecode, decodedBuffer.getFrameLenght());
     outBuffer.setFrameLenght(totalSamples);
-    outBuffer.set(decodedBuffer);
-    decodedBuffer.discardFirstSamples(totalSamples);
-    mutex.unlock();
 
     return totalSamples;
 }
 
 //-------------------------------------------------------------
 
+/**
+ * Choose how many decoded frames are consumed in each audio block, so the decoded interval is played
+ * in exactly 'samplesInInterval' local frames. The ratio is recomputed in each block using the remaining
+ * input and output frames (a phase locked to the interval end): a different remote sample rate and
+ * decoded intervals a bit longer or shorter than expected are absorbed along the interval and the last
+ * block lands exactly in the interval end. Only clock drift is compensated (MAX_CLOCK_DRIFT), the pitch
+ * is never changed audibly: longer intervals are truncated in the interval end and shorter intervals are
+ * padded with silence. The fractional ratio is used by the resampler, which keeps the fractional input
+ * position, the returned frames are just covering the resampler reads.
+ */
+
+class NinjamTrackNode::DriftCompensator
+{
+public:
+    DriftCompensator() :
+        outputTotal(0),
+        outputPosition(0),
+        inputPosition(0),
+        consumedFrames(0),
+        ratio(1.0)
+    {
+
+    }
+
+    void startInterval(uint samplesInInterval)
+    {
+        outputTotal = samplesInInterval;
+        outputPosition = 0;
+        inputPosition = 0;
+        consumedFrames = 0;
+    }
+
+    // 'inputTotal' is the interval lenght in the remote sample rate, or -1 if the lenght is unknown
+    uint getInputFrames(uint outputFrames, int inputSampleRate, int outputSampleRate, qint64 inputTotal)
+    {
+        if (!outputFrames)
+            return 0;
+
+        const double nominalRatio = static_cast<double>(inputSampleRate) / outputSampleRate;
+        const double minRatio = nominalRatio * (1.0 - MAX_CLOCK_DRIFT);
+        const double maxRatio = nominalRatio * (1.0 + MAX_CLOCK_DRIFT);
+
+        const double previousPosition = inputPosition;
+
+        if (outputTotal && outputPosition < outputTotal) {
+            const double expectedInput = inputTotal >= 0 ? inputTotal : outputTotal * nominalRatio;
+            const uint remainingOutput = outputTotal - outputPosition;
+            const double remainingRatio = qBound(minRatio, (expectedInput - inputPosition) / remainingOutput, maxRatio);
+            inputPosition += remainingRatio * qMin(remainingOutput, outputFrames); // the last block lands in the interval end
+        }
+        else {
+            inputPosition += nominalRatio * outputFrames; // interval lenght is unknown
+        }
+
+        outputPosition += outputFrames;
+        ratio = (inputPosition - previousPosition) / outputFrames;
+
+        // all samples read by the resampler (up to the fractional position) are provided
+        const qint64 targetFrames = static_cast<qint64>(std::ceil(inputPosition - 1e-9));
+        const uint frames = targetFrames > consumedFrames ? static_cast<uint>(targetFrames - consumedFrames) : 0;
+        consumedFrames += frames;
+
+        return frames;
+    }
+
+    void skipOutput(uint outputFrames) // nothing was played, the remaining input is played in the remaining output
+    {
+        outputPosition += outputFrames;
+    }
+
+    void restoreInput(uint frames) // frames not decoded yet, consumed in the next getInputFrames() calls
+    {
+        frames = static_cast<uint>(qMin(static_cast<qint64>(frames), consumedFrames));
+        inputPosition -= frames;
+        consumedFrames -= frames;
+    }
+
+    inline double getRatio() const { return ratio; } // used in the last getInputFrames() call
+
+private:
+
+    uint outputTotal;
+    uint outputPosition;
+    double inputPosition;
+    qint64 consumedFrames;
+    double ratio;
+};
+
+//-------------------------------------------------------------
+
 NinjamTrackNode::NinjamTrackNode(int ID) :
     ID(ID),
     lowCut(new NinjamTrackNode::LowCutFilter(44100)),
+    driftCompensator(new NinjamTrackNode::DriftCompensator()),
     //processingLastPartOfInterval(false),
     currentDecoder(nullptr),
-    decodersMutex(QMutex::NonRecursive)
+    decodersMutex(QMutex::NonRecursive),
+    feedingDecoder(nullptr),
+    downloadingInterval(false),
+    droppedIntervals(0),
+    lateIntervals(0),
+    decoderPlaying(false),
+    playingSampleRate(44100),
+    playingStereo(true),
+    mode(Intervalic)
 {
-
+    decoders.reserve(MAX_BUFFERED_INTERVALS + 1); // never allocating in audio thread
 }
 
 bool NinjamTrackNode::isStereo() const
 {
-    if (currentDecoder)
-        return currentDecoder->isStereo();
-
-    return true;
+    return playingStereo;
 }
 
 void NinjamTrackNode::stopDecoding()
 {
-    discardDownloadedIntervals();
-
-    if (currentDecoder != nullptr)
-        currentDecoder->stopDecoding();
+    discardDownloadedIntervals(); // the playing interval is discarded too
 }
 
 NinjamTrackNode::LowCutState NinjamTrackNode::setLowCutToNextState()
@@ -228,71 +512,127 @@ void NinjamTrackNode::setLowCutState(LowCutState newState)
 
 int NinjamTrackNode::getSampleRate() const
 {
-    if (currentDecoder)
-        return currentDecoder->getSampleRate();
-    return 44100;
+    return playingSampleRate;
 }
 
 NinjamTrackNode::~NinjamTrackNode()
 {
     //qDebug() << "Deastrutor NinjamTrackNode";
 
-    decodersMutex.lock();
-    for (auto decoder : decoders)
-        delete decoder;
+    // the node is not rendered anymore, the pending decoders are added and retired here
+    QMutexLocker locker(&decodersMutex);
 
-    decoders.clear();
-    if (currentDecoder) {
-        //delete currentDecoder;
-        currentDecoder = nullptr;
+    if (feedingDecoder) {
+        feedingDecoder->retire();
+        feedingDecoder = nullptr;
     }
-    decodersMutex.unlock();
+
+    consumePendingEvents(true);
+    discardIntervals(); // decoders are deleted by decode service
 }
 
 void NinjamTrackNode::discardDownloadedIntervals()
 {
     QMutexLocker locker(&decodersMutex);
 
-    while (!decoders.isEmpty())
-        delete decoders.takeFirst();
+    if (feedingDecoder) {
+        feedingDecoder->retire(); // the audio thread is retiring the decoder too
+        feedingDecoder = nullptr;
+    }
 
-    currentDecoder = nullptr;
+    pendingCommands.enqueue(new DiscardIntervalsCommand(this));
 
     //qDebug() << "intervals discarded";
 }
 
-bool NinjamTrackNode::isPlaying()
+void NinjamTrackNode::discardIntervals()
 {
-    QMutexLocker locker(&decodersMutex);
+    for (auto decoder : decoders)
+        decoder->retire();
+
+    decoders.clear();
+
+    if (currentDecoder) {
+        currentDecoder->retire();
+        setCurrentDecoder(nullptr);
+    }
+}
+
+void NinjamTrackNode::addDecoder(IntervalDecoder *decoder)
+{
+    decoders.push_back(decoder); // the capacity is reserved for one more decoder
+    dropOldestIntervals(); // the audio device is not consuming the intervals
+}
+
+void NinjamTrackNode::dropOldestIntervals()
+{
+    while (decoders.size() > static_cast<size_t>(MAX_BUFFERED_INTERVALS)) {
+        decoders.front()->retire();
+        decoders.erase(decoders.begin());
+        droppedIntervals++;
+    }
+}
+
+void NinjamTrackNode::setCurrentDecoder(IntervalDecoder *decoder)
+{
+    currentDecoder = decoder;
+    decoderPlaying = decoder != nullptr;
+}
+
+qint64 NinjamTrackNode::getBufferedIntervalsBytes()
+{
+    return bufferedIntervalsBytes;
+}
+
+uint NinjamTrackNode::getDroppedIntervals() const
+{
+    return droppedIntervals;
+}
+
+uint NinjamTrackNode::getLateIntervals() const
+{
+    return lateIntervals;
+}
 
-    return currentDecoder != nullptr || mode == VoiceChat; // voice chat is always playing
+bool NinjamTrackNode::isPlaying() const
+{
+    return decoderPlaying || mode == VoiceChat; // voice chat is always playing
 }
 
-void NinjamTrackNode::consumePendingEvents()
+void NinjamTrackNode::consumePendingEvents(bool intervalStarted)
 {
     TrackNodeCommand *command = nullptr;
-    while (pendingCommands.try_dequeue(command)) {
+    while (pendingCommands.peek()) {
+        command = *pendingCommands.peek();
+        if (!intervalStarted && command->waitsForNextInterval())
+            break; // the next commands are executed in order after the interval start
+
+        pendingCommands.pop();
         command->execute();
         delete command;
     }
 }
 
-bool NinjamTrackNode::startNewInterval()
+bool NinjamTrackNode::startNewInterval(uint samplesInInterval)
 {
     //qDebug() << "--------START INTERVAL------------";
 
-    consumePendingEvents();
+    consumePendingEvents(true);
+
+    driftCompensator->startInterval(samplesInInterval);
 
     if (mode == Intervalic) {
-        decodersMutex.lock();
         if (currentDecoder) {
-            delete currentDecoder; //discard the previous interval decoder
-            currentDecoder = nullptr;
+            currentDecoder->retire(); //discard the previous interval decoder
+            setCurrentDecoder(nullptr);
+        }
+        if (!decoders.empty()) {
+            setCurrentDecoder(decoders.front()); //using the next buffered decoder (next interval)
+            decoders.erase(decoders.begin());
+        }
+        else if (downloadingInterval) {
+            lateIntervals++;
         }
-        if (!decoders.isEmpty())
-            currentDecoder = decoders.takeFirst(); //using the next buffered decoder (next interval)
-
-        decodersMutex.unlock();
     }
 
     return isPlaying();
@@ -303,51 +643,59 @@ void NinjamTrackNode::addVorbisEncodedChunk(const QByteArray &chunkBytes, bool i
 {
     //qDebug() << "   Chunk received " << chunkBytes.left(4) << "\tFirst:" << isFirstPart << " Last:" << isLastPart << " Bytes received:" << chunkBytes.size();
 
-    if(mode != VoiceChat)
-        return;
+    QMutexLocker locker(&decodersMutex);
 
+    downloadingInterval = !isLastPart; // chunks are received in all modes, used to count the late intervals
 
-    QMutexLocker locker(&decodersMutex);
+    if(mode != VoiceChat)
+        return;
 
-    if (decoders.isEmpty()) {
+    if (!feedingDecoder) {
 
-        if (!isFirstPart) { // if decoders are empty and the chunk is not the first part we are receinving partial data of the previous interval, we must wait until receive a new interval
+        if (!isFirstPart) { // if there is no decoder and the chunk is not the first part we are receinving partial data of the previous interval, we must wait until receive a new interval
             //qDebug() << "Returning, not the first part of an interval";
             return;
         }
 
        // qDebug() << "First interval part received, creating new interval";
-        decoders.push_back(new IntervalDecoder());
+        feedingDecoder = createDecoder(QList<QByteArray>(), false);
     }
 
-
-    decoders.last()->addEncodedData(chunkBytes);
+    feedingDecoder->addEncodedData(chunkBytes, isLastPart);
 
     if (isLastPart) {
         //qDebug() << "Last part received, creating new IntervalDecoder";
-        decoders.push_back(new IntervalDecoder());
+        feedingDecoder->retire(); // the audio thread is the last owner
+        feedingDecoder = createDecoder(QList<QByteArray>(), false);
     }
 
 }
 
  // this function is used only for Intervalic mode. The parameter is a full Ogg Vorbis Interval data
-void NinjamTrackNode::addVorbisEncodedInterval(const QByteArray &fullIntervalBytes)
+void NinjamTrackNode::addVorbisEncodedInterval(const QList<QByteArray> &intervalChunks)
 {
     //qDebug() << "Full Interval received " << fullIntervalBytes.left(4);
 
     if (mode != Intervalic)
         return;
 
-    auto newIntervalDecoder = new IntervalDecoder(fullIntervalBytes);
+    QMutexLocker locker(&decodersMutex);
+
+    createDecoder(intervalChunks); // decoded ahead to avoid slow down the audio thread in interval start (first beat)
+}
+
+NinjamTrackNode::IntervalDecoder *NinjamTrackNode::createDecoder(const QList<QByteArray> &vorbisChunks, bool inputComplete)
+{
+    auto decoder = new IntervalDecoder(vorbisChunks, inputComplete);
 
-    decodersMutex.lock();
+    if (!inputComplete)
+        decoder->retain(); // the caller is adding the remaining chunks
 
-    decoders.append(newIntervalDecoder);
+    audio::DecodeService::getInstance().addJob(decoder);
 
-    decodersMutex.unlock();
+    pendingCommands.enqueue(new AddDecoderCommand(this, decoder)); // the audio thread is owning the decoder
 
-    //decoding the first samples in a separated thread to avoid slow down the audio thread in interval start (first beat)
-    QtConcurrent::run(newIntervalDecoder, &NinjamTrackNode::IntervalDecoder::decode, 256);
+    return decoder;
 }
 
 // ++++++++++++++
@@ -365,71 +713,91 @@ void NinjamTrackNode::schefuleSetChannelMode(ChannelMode mode)
 {
     this->mode = NinjamTrackNode::Changing; // nothing is played when is 'changing'
 
+    discardDownloadedIntervals(); // executed before the mode change, the channel is silent until the next interval
+
+    QMutexLocker locker(&decodersMutex);
     pendingCommands.enqueue(new ChangeChannelModeCommand(this, mode));
+}
 
-    discardDownloadedIntervals();
+void NinjamTrackNode::prepareToProcess(uint maxFrames)
+{
+    // covering the remote sample rates up to 96 KHz in a 44.1 KHz jam, plus the drift compensation
+    resampler.prepare(static_cast<int>(maxFrames), Resampler::DEFAULT_MAX_STEP * (1.0 + MAX_CLOCK_DRIFT));
 }
 
 int NinjamTrackNode::getFramesToProcess(int targetSampleRate, int outFrameLenght)
 {
+    const int sampleRate = currentDecoder->getSampleRate();
+
+    if (mode == Intervalic)
+        return driftCompensator->getInputFrames(outFrameLenght, sampleRate, targetSampleRate, currentDecoder->getTotalFrames());
+
     return needResamplingFor(targetSampleRate) ? getInputResamplingLength(
-        getSampleRate(), targetSampleRate, outFrameLenght) : outFrameLenght;
+        sampleRate, targetSampleRate, outFrameLenght) : outFrameLenght;
 }
 
 void NinjamTrackNode::processReplacing(const audio::SamplesBuffer &in, audio::SamplesBuffer &out,
                                        int sampleRate, std::vector<midi::MidiMessage> &midiBuffer)
 {
-    if (!isPlaying())
+    consumePendingEvents(false); // decoders published by control threads
+
+    if (!currentDecoder && mode == VoiceChat && !decoders.empty()) { // in voice chat we will not wait until startInterval to use the next available downloaded decoder
+        //qDebug() << "USING FIRST DECODER";
+        setCurrentDecoder(decoders.front());
+        decoders.erase(decoders.begin());
+    }
+
+    if (!currentDecoder) {
+        //qDebug() << "Current decoder is null, not playing!";
+        return;
+    }
+
+    if (!currentDecoder->isValid()) {
+        //qDebug() << "Current decoder is not valid, returning!";
+        discardIntervals(); // the current decoder is corrupted, forcing a new decoder usage
+        internalInputBuffer.zero();
         return;
+    }
 
-    { // mutex scope
-        QMutexLocker locker(&decodersMutex);
-
-        if (!currentDecoder) {
-            if (mode == VoiceChat && !decoders.isEmpty()) {
-                currentDecoder = decoders.first();
-                //qDebug() << "USING FIRST DECODER";
-            }
-            else {
-                //qDebug() << "Current decoder is null, not playing!";
-                return;
-            }
-        }
+    if (!currentDecoder->hasFormat()) {
+        // the decode service did not publish the first chunk yet, the interval timing is kept
+        if (mode == Intervalic)
+            driftCompensator->skipOutput(out.getFrameLenght());
 
-        if (!currentDecoder || !currentDecoder->isValid()) {
-            if (currentDecoder && !currentDecoder->isValid()){
-                //qDebug() << "Current decoder is not valid, returning!";
-                currentDecoder = nullptr; // the current decoder is corrupted, setting to nullptr to force a new decoder usage
-                decoders.clear();
-                internalInputBuffer.zero();
-            }
-            return;
-        }
+        return;
+    }
 
-        auto framesToProcess = getFramesToProcess(sampleRate, out.getFrameLenght());
-        internalInputBuffer.setFrameLenght(framesToProcess);
+    playingSampleRate = currentDecoder->getSampleRate();
+    playingStereo = currentDecoder->isStereo();
 
-        auto samplesDecoded = 0;
+    auto framesToProcess = getFramesToProcess(sampleRate, out.getFrameLenght());
+    internalInputBuffer.setFrameLenght(framesToProcess);
 
-        if (currentDecoder)
-            currentDecoder->getDecodedSamples(internalInputBuffer, framesToProcess);
+    const uint decodedFrames = currentDecoder->getDecodedSamples(internalInputBuffer, framesToProcess);
+    if (mode == Intervalic && decodedFrames < static_cast<uint>(framesToProcess)) {
+        // interval is shorter than expected or the decode service is late, padding with silence to keep the interval timing
+        if (!currentDecoder->isFullyDecoded())
+            driftCompensator->restoreInput(framesToProcess - decodedFrames); // the missing frames are played later, not dropped
 
-        if (mode == VoiceChat) { // in voice chat we will not wait until startInterval to use the next available downloaded decoder
-            if (samplesDecoded <= framesToProcess && currentDecoder->isFullyDecoded()) {
-                //qDebug() << "current decoder consumed, using the next decoder";
-                currentDecoder = nullptr;
-                if (!decoders.isEmpty()) {
-                    auto decoder = decoders.takeFirst();
-                    delete decoder;
-                }
-            }
+        internalInputBuffer.setFrameLenght(framesToProcess);
+        for (int c = 0; c < internalInputBuffer.getChannels(); ++c) {
+            float *samples = internalInputBuffer.getSamplesArray(c);
+            std::fill(samples + decodedFrames, samples + framesToProcess, 0.0f);
         }
+    }
 
+    if (mode == VoiceChat && currentDecoder->isFullyDecoded()) { // using the next decoder in the next audio block
+        //qDebug() << "current decoder consumed, using the next decoder";
+        currentDecoder->retire();
+        setCurrentDecoder(nullptr);
     }
 
     if (!internalInputBuffer.isEmpty()) {
-        if (needResamplingFor(sampleRate)) {
-            const auto &resampledBuffer = resampler.resample(internalInputBuffer, out.getFrameLenght());
+        // intervals are always resampled, the drift compensation can change the ratio even when the sample rates are the same
+        if (mode == Intervalic || needResamplingFor(sampleRate)) {
+            audio::LatencyProbes::Scope probe(audio::LatencyProbes::Resampling);
+            const auto &resampledBuffer = mode == Intervalic ? resampler.resample(internalInputBuffer, out.getFrameLenght(), driftCompensator->getRatio())
+                                                             : resampler.resample(internalInputBuffer, out.getFrameLenght());
             internalInputBuffer.setFrameLenght(resampledBuffer.getFrameLenght());
             internalInputBuffer.set(resampledBuffer);
         }
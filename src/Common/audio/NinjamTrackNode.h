@@ -3,6 +3,10 @@
 
 #include "core/AudioNode.h"
 #include <QByteArray>
+#include <QList>
+#include <QMutex>
+#include <atomic>
+#include <vector>
 #include "SamplesBufferResampler.h"
 #include "readerwriterqueue.h"
 
@@ -29,21 +33,25 @@ public:
 
     explicit NinjamTrackNode(int ID);
     virtual ~NinjamTrackNode();
-    void addVorbisEncodedInterval(const QByteArray &fullIntervalBytes);
+    void addVorbisEncodedInterval(const QList<QByteArray> &intervalChunks);
     void addVorbisEncodedChunk(const QByteArray &chunkBytes, bool isFirstPart, bool isLastPart);
     void processReplacing(const audio::SamplesBuffer &in, audio::SamplesBuffer &out, int sampleRate,
                           std::vector<midi::MidiMessage> &midiBuffer) override;
 
+    bool canBeRenderedInParallel() const override; // remote tracks are independent, decoding can run in worker threads
+
+    void prepareToProcess(uint maxFrames); // called before the track is published or while the audio driver is stopped
+
     void setLowCutState(LowCutState newState);
     LowCutState setLowCutToNextState();
     LowCutState getLowCutState() const;
 
-    bool startNewInterval();
+    bool startNewInterval(uint samplesInInterval = 0); // interval lenght in local sample rate, 0 if unknown (drift is not compensated)
     int getID() const;
 
-    int getSampleRate() const;
+    int getSampleRate() const; // the playing interval sample rate
 
-    bool isPlaying();
+    bool isPlaying() const;
 
     bool isStereo() const;
 
@@ -56,6 +64,13 @@ public:
     // Discard all downloaded (but not played yet) intervals
     void discardDownloadedIntervals();
 
+    uint getDroppedIntervals() const; // downloaded intervals discarded because too many intervals were buffered
+    uint getLateIntervals() const; // intervals started while the next interval was downloading
+
+    static qint64 getBufferedIntervalsBytes(); // encoded bytes of the playing and waiting intervals in all tracks
+
+    static const int MAX_BUFFERED_INTERVALS;
+
     void stopDecoding();
 
     //void setProcessingLastPartOfInterval(bool status);
@@ -70,9 +85,12 @@ protected:
     public:
         virtual ~TrackNodeCommand() {}
         virtual void execute() = 0;
+        virtual bool waitsForNextInterval() const { return false; } // executed in startNewInterval()
     };
 
     class ChangeChannelModeCommand;
+    class AddDecoderCommand;
+    class DiscardIntervalsCommand;
 
     void setChannelMode(ChannelMode newMode);
 
@@ -89,19 +107,42 @@ private:
 
     int getFramesToProcess(int targetSampleRate, int outFrameLenght);
 
+    class DriftCompensator;
+    QScopedPointer<DriftCompensator> driftCompensator; // audio thread only
+
     //bool processingLastPartOfInterval;
 
     class IntervalDecoder;
 
-    QList<IntervalDecoder*> decoders;
+    // registered in decode service and published to the audio thread, incomplete intervals are shared with the caller
+    IntervalDecoder *createDecoder(const QList<QByteArray> &vorbisChunks, bool inputComplete = true);
+
+    // audio thread only, decoders are added and discarded using pendingCommands
+    std::vector<IntervalDecoder*> decoders;
     IntervalDecoder* currentDecoder;
-    QMutex decodersMutex;
 
-    ChannelMode mode = Intervalic;
+    void addDecoder(IntervalDecoder *decoder);
+    void discardIntervals();
+    void dropOldestIntervals();
+    void setCurrentDecoder(IntervalDecoder *decoder);
+
+    QMutex decodersMutex; // serializing the control threads, never locked in audio thread
+    IntervalDecoder *feedingDecoder; // voice chat interval receiving chunks, protected by decodersMutex
+
+    std::atomic<bool> downloadingInterval;
+    std::atomic<uint> droppedIntervals;
+    std::atomic<uint> lateIntervals;
+
+    // playing interval state, read by GUI
+    std::atomic<bool> decoderPlaying;
+    std::atomic<int> playingSampleRate;
+    std::atomic<bool> playingStereo;
+
+    std::atomic<ChannelMode> mode;
 
     moodycamel::ReaderWriterQueue<TrackNodeCommand *> pendingCommands;
 
-    void consumePendingEvents();
+    void consumePendingEvents(bool intervalStarted);
 
 };
 
@@ -111,4 +152,9 @@ inline int NinjamTrackNode::getID() const
     return ID;
 }
 
+inline bool NinjamTrackNode::canBeRenderedInParallel() const
+{
+    return true;
+}
+
 #endif // NINJAMTRACKNODE_H
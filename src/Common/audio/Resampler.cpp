@@ -1,18 +1,325 @@
 #include "Resampler.h"
+#include "core/SamplesKernels.h"
 
-SimpleResampler::SimpleResampler()
+#include <QtGlobal>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+const int DEFAULT_MAX_BLOCK = 4096 * 2; // samples, bigger blocks require prepare()
+
+struct FilterConfig
+{
+    int taps;
+    int phases;
+    double rolloff; // cutoff frequency, relative to the lower Nyquist frequency
+    double beta; // Kaiser window shape, ~60 dB (Medium) and ~90 dB (High) stop band
+};
+
+const FilterConfig MEDIUM_CONFIG = { 32, 128, 0.85, 6.0 };
+const FilterConfig HIGH_CONFIG = { 64, 256, 0.90, 9.0 };
+
+const FilterConfig &getConfig(Resampler::Quality quality)
+{
+    return quality == Resampler::High ? HIGH_CONFIG : MEDIUM_CONFIG;
+}
+
+// filter banks are cached by cutoff, downsampling ratios are rounded down to a 1/CUTOFF_STEPS multiple
+const int CUTOFF_STEPS = 64;
+
+int getCutoffStep(double step)
+{
+    const double relativeCutoff = step > 1.0 ? 1.0 / step : 1.0;
+    return qBound(1, static_cast<int>(std::floor(relativeCutoff * CUTOFF_STEPS)), CUTOFF_STEPS);
+}
+
+std::atomic<PolyphaseResampler::FilterBank *> &getFilterBankSlot(Resampler::Quality quality, int cutoffStep)
+{
+    static std::atomic<PolyphaseResampler::FilterBank *> banks[2][CUTOFF_STEPS + 1]; // filter banks are never deleted
+    return banks[quality == Resampler::High ? 1 : 0][cutoffStep];
+}
+
+double besselI0(double x)
+{
+    double sum = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+            break;
+    }
+    return sum;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------
+
+class PolyphaseResampler::FilterBank
+{
+
+public:
+    FilterBank(int taps, int phases, double cutoff, double beta) :
+        taps(taps),
+        phases(phases),
+        coefficients((phases + 1) * taps)
+    {
+        static const double PI = 3.14159265358979323846;
+
+        const double center = taps / 2 - 1;
+        const double halfLength = taps / 2;
+        const double windowNormalization = besselI0(beta);
+
+        for (int phase = 0; phase <= phases; ++phase) { // the extra phase is used to interpolate the last phase
+            const double fraction = static_cast<double>(phase) / phases;
+            float *row = &coefficients[phase * taps];
+            double sum = 0;
+            for (int k = 0; k < taps; ++k) {
+                const double x = k - center - fraction;
+                const double sinc = x == 0 ? 1.0 : std::sin(PI * cutoff * x) / (PI * cutoff * x);
+                const double w = x / halfLength;
+                const double window = std::abs(w) < 1.0 ? besselI0(beta * std::sqrt(1.0 - w * w)) / windowNormalization : 0.0;
+                const double coefficient = cutoff * sinc * window;
+                row[k] = static_cast<float>(coefficient);
+                sum += coefficient;
+            }
+
+            for (int k = 0; k < taps; ++k) // unity gain in DC for all phases
+                row[k] = static_cast<float>(row[k] / sum);
+        }
+    }
+
+    inline int getPhases() const { return phases; }
+
+    inline const float *getPhase(int phase) const
+    {
+        return coefficients.data() + phase * taps;
+    }
+
+private:
+    int taps;
+    int phases;
+    std::vector<float> coefficients;
+};
+
+// ---------------------------------------------------------------------
+
+Resampler *Resampler::create(Quality quality)
+{
+    if (quality == Fast)
+        return new SimpleResampler();
+
+    return new PolyphaseResampler(quality);
+}
+
+const double Resampler::DEFAULT_MAX_STEP = 2.0 * 48000.0 / 44100.0;
+
+Resampler::Resampler(Quality quality, int taps) :
+    quality(quality),
+    taps(taps),
+    work(taps - 1 + DEFAULT_MAX_BLOCK, 0.0f),
+    buffered(taps - 1),
+    position(0.0)
+{
+
+}
+
+Resampler::~Resampler()
+{
+
+}
+
+void Resampler::prepare(int maxInLength, double maxStep)
+{
+    reserve(taps + 2 * maxInLength); // the input not consumed yet is kept when the caller is rounding the block lenghts
+    prepareFilters(maxStep);
+}
+
+void Resampler::prepareFilters(double maxStep)
+{
+    Q_UNUSED(maxStep)
+}
+
+void Resampler::reserve(int samples)
+{
+    if (work.size() < static_cast<size_t>(samples))
+        work.resize(samples, 0.0f);
+}
+
+void Resampler::reset()
+{
+    std::fill(work.begin(), work.begin() + (taps - 1), 0.0f);
+    buffered = taps - 1;
+    position = 0.0;
+}
+
+void Resampler::process(const float *in, int inLength, float *out, int outLength)
+{
+    if (outLength <= 0)
+        return;
+
+    if (inLength <= 0) {
+        std::fill(out, out + outLength, 0.0f);
+        return;
+    }
+
+    process(in, inLength, out, outLength, static_cast<double>(inLength) / outLength);
+}
+
+void Resampler::process(const float *in, int inLength, float *out, int outLength, double step)
+{
+    if (outLength <= 0 || step <= 0.0)
+        return;
+
+    inLength = qMax(inLength, 0);
+
+    // the work buffer is allocated in prepare(), never in the audio thread
+    const int capacity = static_cast<int>(work.size());
+    const int required = static_cast<int>(position + (outLength - 1) * step) + taps;
+    Q_ASSERT(buffered + inLength <= capacity && required <= capacity);
+    if (buffered + inLength > capacity || required > capacity) { // not prepared for this block, playing silence
+        std::fill(out, out + outLength, 0.0f);
+        reset();
+        return;
+    }
+
+    std::copy(in, in + inLength, work.begin() + buffered);
+    buffered += inLength;
+
+    // the caller is late, missing input is silence
+    if (required > buffered) {
+        std::fill(work.begin() + buffered, work.begin() + required, 0.0f);
+        buffered = required;
+    }
+
+    if (step == 1.0 && position == 0.0) // same rate, just copying the samples with the same latency
+        std::copy(work.begin() + (taps / 2 - 1), work.begin() + (taps / 2 - 1) + outLength, out);
+    else
+        render(work.data(), position, step, out, outLength);
+
+    position += outLength * step;
+
+    const double nearest = std::floor(position + 0.5);
+    if (std::abs(position - nearest) < 1e-9) // removing the accumulated rounding error, block ratios are usually exact
+        position = nearest;
+
+    // samples before the next read position are not used anymore
+    const int consumed = qMin(static_cast<int>(position), buffered);
+    position -= consumed;
+    std::copy(work.begin() + consumed, work.begin() + buffered, work.begin());
+    buffered -= consumed;
+}
+
+void Resampler::processAll(const float *in, int inLength, float *out, int outLength)
+{
+    if (outLength <= 0)
+        return;
+
+    if (inLength <= 0) {
+        std::fill(out, out + outLength, 0.0f);
+        return;
+    }
+
+    // the filter center is 'taps/2 - 1' samples after the read position, padding with zeros to compensate
+    const int padding = taps / 2 - 1;
+    std::vector<float> paddedInput(padding + inLength + taps, 0.0f);
+    std::copy(in, in + inLength, paddedInput.begin() + padding);
+
+    render(paddedInput.data(), 0.0, static_cast<double>(inLength) / outLength, out, outLength);
+}
+
+// ---------------------------------------------------------------------
+
+SimpleResampler::SimpleResampler() :
+    Resampler(Fast, 2)
 {
 
 }
 
-void SimpleResampler::process(const float *in, int inLength, float *out, int outLenght)
+void SimpleResampler::render(const float *input, double position, double step, float *out, int outLength)
 {
-    double step = static_cast<double>(inLength)/static_cast<double>(outLenght);
-    double doubleCursor = 0;
-    for (int i = 0; i < outLenght; ++i) {
-        int cursor = (int)doubleCursor;
-        double frac = (cursor < inLength-1) ? doubleCursor - cursor : 0; // the last input samples are just copied
-        out[i] = in[cursor] * (1.0-frac) + in[cursor+1] * frac;
-        doubleCursor += step;
+    for (int i = 0; i < outLength; ++i) {
+        const double cursor = position + i * step;
+        const int index = static_cast<int>(cursor);
+        const float frac = static_cast<float>(cursor - index);
+        out[i] = input[index] + (input[index + 1] - input[index]) * frac;
+    }
+}
+
+// ---------------------------------------------------------------------
+
+PolyphaseResampler::PolyphaseResampler(Quality quality) :
+    Resampler(quality, getConfig(quality).taps)
+{
+    // the common Ninjam ratios (and the drift compensation around them) are created here, out of the audio thread
+    prepareFilters(DEFAULT_MAX_STEP);
+}
+
+void PolyphaseResampler::prepareFilters(double maxStep)
+{
+    for (int cutoffStep = getCutoffStep(maxStep); cutoffStep <= CUTOFF_STEPS; ++cutoffStep)
+        getFilterBank(getQuality(), CUTOFF_STEPS / (cutoffStep + 0.5)); // a step in the middle of the cutoff range
+}
+
+const PolyphaseResampler::FilterBank *PolyphaseResampler::findFilterBank(Quality quality, double step)
+{
+    const int cutoffStep = getCutoffStep(step);
+
+    for (int s = cutoffStep; s >= 1; --s) { // a lower cutoff is avoiding aliasing
+        if (const FilterBank *bank = getFilterBankSlot(quality, s).load(std::memory_order_acquire))
+            return bank;
+    }
+
+    for (int s = cutoffStep + 1; s <= CUTOFF_STEPS; ++s) {
+        if (const FilterBank *bank = getFilterBankSlot(quality, s).load(std::memory_order_acquire))
+            return bank;
+    }
+
+    return nullptr;
+}
+
+const PolyphaseResampler::FilterBank *PolyphaseResampler::getFilterBank(Quality quality, double step)
+{
+    const int cutoffStep = getCutoffStep(step);
+    auto &slot = getFilterBankSlot(quality, cutoffStep);
+
+    FilterBank *bank = slot.load(std::memory_order_acquire);
+    if (bank)
+        return bank;
+
+    const auto &config = getConfig(quality);
+    const double cutoff = config.rolloff * cutoffStep / CUTOFF_STEPS;
+    FilterBank *newBank = new FilterBank(config.taps, config.phases, cutoff, config.beta);
+
+    if (slot.compare_exchange_strong(bank, newBank, std::memory_order_acq_rel))
+        return newBank;
+
+    delete newBank; // other thread created the same bank
+    return bank;
+}
+
+void PolyphaseResampler::render(const float *input, double position, double step, float *out, int outLength)
+{
+    const FilterBank *bank = findFilterBank(getQuality(), step); // at least the constructor banks exist
+    const int phases = bank->getPhases();
+    const uint taps = static_cast<uint>(getTaps());
+    const auto &kernels = audio::kernels::get();
+
+    for (int i = 0; i < outLength; ++i) {
+        const double cursor = position + i * step;
+        const int index = static_cast<int>(cursor);
+        const double phasePosition = (cursor - index) * phases;
+        const int phase = static_cast<int>(phasePosition);
+        const float frac = static_cast<float>(phasePosition - phase);
+
+        const float *samples = input + index;
+        const float current = kernels.dot(samples, bank->getPhase(phase), taps);
+        const float next = kernels.dot(samples, bank->getPhase(phase + 1), taps);
+
+        out[i] = current + (next - current) * frac;
     }
 }
@@ -1,13 +1,110 @@
 #ifndef RESAMPLER_H
 #define RESAMPLER_H
 
-class SimpleResampler
+#include <vector>
+
+/**
+ * Stateful resamplers. Each process() call appends 'inLength' input samples and computes exactly
+ * 'outLength' output samples, reading the input in 'step' increments (step = input rate / output rate).
+ * The fractional read position and the input samples not consumed yet are kept for the next block, so
+ * block boundaries are continuous even when the caller is rounding the input lenght of each block.
+ * The caller must provide at least the input covered by the accumulated steps (missing input is read
+ * as silence). The streamed output is delayed by getLatency() input samples.
+ *
+ * When 'step' is not informed the block ratio (inLength/outLength) is used, blocks with the same input
+ * and output lenght are just delayed.
+ *
+ * processAll() is used when a complete signal is resampled at once (metronome sounds, loops loaded
+ * from disk), the latency is compensated and the kept samples are not used.
+ */
+
+class Resampler
 {
 
 public:
-    explicit SimpleResampler();
-    void process(const float *in, int inLength, float *out, int outLenght);
 
+    enum Quality
+    {
+        Fast,   // linear interpolation, cheap but not band limited
+        Medium, // 32 taps windowed sinc
+        High    // 64 taps windowed sinc
+    };
+
+    static Resampler *create(Quality quality);
+
+    virtual ~Resampler();
+
+    void process(const float *in, int inLength, float *out, int outLength);
+    void process(const float *in, int inLength, float *out, int outLength, double step);
+    void processAll(const float *in, int inLength, float *out, int outLength); // allocating, not real time safe
+
+    void reset(); // discard the kept input samples and the fractional position
+
+    // pre allocate the work buffer and the filters used for steps up to 'maxStep', called out of the audio thread.
+    // process() never allocates, blocks bigger than the prepared lenght are rendered as silence
+    void prepare(int maxInLength, double maxStep = DEFAULT_MAX_STEP);
+
+    static const double DEFAULT_MAX_STEP; // drift compensation bound when downsampling 48000 to 44100
+
+    inline Quality getQuality() const { return quality; }
+    inline int getTaps() const { return taps; }
+    inline int getLatency() const { return taps / 2; } // input samples, streaming only
+
+protected:
+    Resampler(Quality quality, int taps);
+
+    // compute 'outLength' samples, the sample 'i' is computed using input[floor(position + i * step) + k], k in [0, taps)
+    virtual void render(const float *input, double position, double step, float *out, int outLength) = 0;
+
+    virtual void prepareFilters(double maxStep); // called out of the audio thread
+
+private:
+    Resampler(const Resampler &other);
+    Resampler &operator=(const Resampler &other);
+
+    void reserve(int samples); // work buffer size, not real time safe
+
+    Quality quality;
+    int taps;
+    std::vector<float> work; // kept samples + input not consumed yet + current input block
+    int buffered; // valid samples in work buffer
+    double position; // read position in work buffer, always in [0, 1) between blocks
+};
+
+class SimpleResampler : public Resampler
+{
+
+public:
+    SimpleResampler();
+
+protected:
+    void render(const float *input, double position, double step, float *out, int outLength) override;
+};
+
+/**
+ * Band limited resampler using a Kaiser windowed sinc. The filter is precomputed for 'phases'
+ * fractional positions (coefficients are interpolated between two phases) and the dot products are
+ * computed using the SIMD kernels. Filter banks depend on the ratio (cutoff frequency when
+ * downsampling) and are shared by all resamplers. Banks are created in prepare(), render() never
+ * allocates and uses the nearest lower cutoff bank when a step was not prepared.
+ */
+
+class PolyphaseResampler : public Resampler
+{
+
+public:
+    explicit PolyphaseResampler(Quality quality);
+
+    class FilterBank;
+
+    static const FilterBank *getFilterBank(Quality quality, double step); // step = inLength/outLength, allocating
+
+protected:
+    void render(const float *input, double position, double step, float *out, int outLength) override;
+    void prepareFilters(double maxStep) override;
+
+private:
+    static const FilterBank *findFilterBank(Quality quality, double step); // real time safe, null if no bank was created
 };
 
 #endif // RESAMPLER_H
@@ -222,24 +222,28 @@ void NinjamRoomStreamerNode::processReplacing(const SamplesBuffer &in, SamplesBu
                                               int sampleRate, std::vector<midi::MidiMessage> &midiBuffer)
 {
     Q_UNUSED(in)
-    QMutexLocker locker(&mutex);
+    if (!mutex.tryLock())
+        return; // the network thread is appending the downloaded bytes, rendering silence
+
     if (buffering && bytesToDecode.size() >= BUFFER_SIZE)
         buffering = false;
     if (!buffering && bytesToDecode.isEmpty())
         buffering = true;
-    if (buffering)
-        return;
-    uint samplesToRender = getSamplesToRender(sampleRate, out.getFrameLenght());
-    while (bufferedSamples.getFrameLenght() < samplesToRender) {// need decoding?
-        decode(256);
-        if (bytesToDecode.isEmpty()) {// no more bytes to decode
-            qCritical() << "no more bytes to decode and not enough buffered samples. Buffering ...";
-            buffering = true;
-            break;
+    if (!buffering) {
+        uint samplesToRender = getSamplesToRender(sampleRate, out.getFrameLenght());
+        while (bufferedSamples.getFrameLenght() < samplesToRender) {// need decoding?
+            decode(256);
+            if (bytesToDecode.isEmpty()) {// no more bytes to decode
+                qCritical() << "no more bytes to decode and not enough buffered samples. Buffering ...";
+                buffering = true;
+                break;
+            }
         }
+        if (!bufferedSamples.isEmpty())
+            AbstractMp3Streamer::processReplacing(in, out, sampleRate, midiBuffer);
     }
-    if (!bufferedSamples.isEmpty())
-        AbstractMp3Streamer::processReplacing(in, out, sampleRate, midiBuffer);
+
+    mutex.unlock();
 }
 
 int NinjamRoomStreamerNode::getBufferingPercentage() const
@@ -79,6 +79,7 @@ protected:
 private:
     QNetworkAccessManager httpClient;
     bool buffering;
+    QMutex mutex; // protecting the downloaded bytes, the audio thread is only trying to lock
 
     static const int BUFFER_SIZE;
 
@@ -1,11 +1,37 @@
 #include "SamplesBufferResampler.h"
 #include <algorithm>
+#include <cmath>
 #include <QDebug>
 
-SamplesBufferResampler::SamplesBufferResampler() :
-    outBuffer(2, 4096 * 2)
+SamplesBufferResampler::SamplesBufferResampler(Resampler::Quality quality) :
+    outBuffer(2, 4096 * 2),
+    quality(quality),
+    preparedOutLenght(0),
+    preparedStep(Resampler::DEFAULT_MAX_STEP)
 {
-    //
+    createResamplers();
+}
+
+SamplesBufferResampler::SamplesBufferResampler(const SamplesBufferResampler &other) :
+    outBuffer(2, 4096 * 2),
+    quality(other.quality),
+    preparedOutLenght(0),
+    preparedStep(Resampler::DEFAULT_MAX_STEP)
+{
+    createResamplers();
+    if (other.preparedOutLenght > 0)
+        prepare(other.preparedOutLenght, other.preparedStep);
+}
+
+SamplesBufferResampler &SamplesBufferResampler::operator=(const SamplesBufferResampler &other)
+{
+    if (this != &other) {
+        preparedOutLenght = other.preparedOutLenght;
+        preparedStep = other.preparedStep;
+        setQuality(other.quality); // prepared using the copied lenght
+    }
+
+    return *this;
 }
 
 SamplesBufferResampler::~SamplesBufferResampler()
@@ -13,17 +39,80 @@ SamplesBufferResampler::~SamplesBufferResampler()
 
 }
 
+void SamplesBufferResampler::createResamplers()
+{
+    for (auto &resampler : resamplers)
+        resampler.reset(Resampler::create(quality));
+}
+
+void SamplesBufferResampler::prepare(int maxOutLenght, double maxStep)
+{
+    preparedOutLenght = std::max(maxOutLenght, 0);
+    preparedStep = maxStep;
+
+    const int maxInLenght = static_cast<int>(std::ceil(preparedOutLenght * maxStep)) + 1;
+    for (auto &resampler : resamplers)
+        resampler->prepare(maxInLenght, maxStep);
+
+    if (outBuffer.getCapacity() < static_cast<uint>(preparedOutLenght)) {
+        const uint frames = outBuffer.getFrameLenght();
+        outBuffer.setFrameLenght(preparedOutLenght); // allocating now, not in the audio thread
+        outBuffer.setFrameLenght(frames);
+    }
+}
+
+void SamplesBufferResampler::setQuality(Resampler::Quality quality)
+{
+    this->quality = quality;
+    createResamplers();
+    if (preparedOutLenght > 0)
+        prepare(preparedOutLenght, preparedStep);
+}
+
+void SamplesBufferResampler::reset()
+{
+    for (auto &resampler : resamplers)
+        resampler->reset();
+}
+
 const audio::SamplesBuffer &SamplesBufferResampler::resample(const audio::SamplesBuffer &in,
                                                              int desiredOutLenght)
 {
+    outBuffer.setFrameLenght(desiredOutLenght);
     outBuffer.zero();
-    outBuffer.setFrameLenght(desiredOutLenght * 2); // enough space
     uint channels = std::min(in.getChannels(), outBuffer.getChannels());
     for (uint c = 0; c < channels; ++c) {
         float *input = in.getSamplesArray(c);
         float *output = outBuffer.getSamplesArray(c);
-        resamplers[c].process(input, in.getFrameLenght(), output, desiredOutLenght);
+        resamplers[c]->process(input, in.getFrameLenght(), output, desiredOutLenght);
     }
+    return outBuffer;
+}
+
+const audio::SamplesBuffer &SamplesBufferResampler::resample(const audio::SamplesBuffer &in,
+                                                             int desiredOutLenght, double ratio)
+{
     outBuffer.setFrameLenght(desiredOutLenght);
+    outBuffer.zero();
+    uint channels = std::min(in.getChannels(), outBuffer.getChannels());
+    for (uint c = 0; c < channels; ++c) {
+        float *input = in.getSamplesArray(c);
+        float *output = outBuffer.getSamplesArray(c);
+        resamplers[c]->process(input, in.getFrameLenght(), output, desiredOutLenght, ratio);
+    }
+    return outBuffer;
+}
+
+const audio::SamplesBuffer &SamplesBufferResampler::resampleAll(const audio::SamplesBuffer &in,
+                                                                int desiredOutLenght)
+{
+    outBuffer.setFrameLenght(desiredOutLenght);
+    outBuffer.zero();
+    uint channels = std::min(in.getChannels(), outBuffer.getChannels());
+    for (uint c = 0; c < channels; ++c) {
+        float *input = in.getSamplesArray(c);
+        float *output = outBuffer.getSamplesArray(c);
+        resamplers[c]->processAll(input, in.getFrameLenght(), output, desiredOutLenght);
+    }
     return outBuffer;
 }
@@ -4,17 +4,37 @@
 #include "Resampler.h"
 #include "core/SamplesBuffer.h"
 
+#include <memory>
+
 class SamplesBufferResampler
 {
 
 public:
-    SamplesBufferResampler();
+    explicit SamplesBufferResampler(Resampler::Quality quality = Resampler::Medium);
+    SamplesBufferResampler(const SamplesBufferResampler &other); // copies the quality, not the kept samples
+    SamplesBufferResampler &operator=(const SamplesBufferResampler &other);
     ~SamplesBufferResampler();
-    const audio::SamplesBuffer &resample(const audio::SamplesBuffer &in, int desiredOutLenght);
+
+    const audio::SamplesBuffer &resample(const audio::SamplesBuffer &in, int desiredOutLenght); // streaming, consecutive blocks
+    const audio::SamplesBuffer &resample(const audio::SamplesBuffer &in, int desiredOutLenght, double ratio); // ratio = input rate / output rate
+    const audio::SamplesBuffer &resampleAll(const audio::SamplesBuffer &in, int desiredOutLenght); // a complete signal
+
+    // called out of the audio thread, 'maxStep' is the max input rate / output rate
+    void prepare(int maxOutLenght, double maxStep = Resampler::DEFAULT_MAX_STEP);
+
+    void setQuality(Resampler::Quality quality); // not real time safe, the resamplers are recreated
+    inline Resampler::Quality getQuality() const { return quality; }
+
+    void reset();
 
 private:
+    void createResamplers();
+
     audio::SamplesBuffer outBuffer;
-    SimpleResampler resamplers[2];
+    Resampler::Quality quality;
+    std::unique_ptr<Resampler> resamplers[2];
+    int preparedOutLenght;
+    double preparedStep;
 };
 
 #endif // SAMPLESBUFFERRESAMPLER_H
@@ -0,0 +1,183 @@
+#include "AllocationTripwire.h"
+
+#ifdef JAMTABA_RT_ALLOCATION_TRIPWIRE
+
+#include "log/Logging.h"
+
+#include <QDebug>
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#if defined(Q_OS_WIN)
+    #include <windows.h>
+#else
+    #include <execinfo.h>
+    #include <unistd.h>
+#endif
+
+using audio::AllocationTripwire;
+
+namespace {
+
+thread_local int armedScopes = 0; // how many Scopes are alive in the current thread
+thread_local bool reporting = false; // avoid recursion when reporting an allocation (reporting is allocating too)
+
+std::atomic<quint64> trippedAllocations(0);
+
+// call sites already reported, only the first allocation in each call site is dumped
+const int MAX_REPORTED_SITES = 128;
+quintptr reportedSites[MAX_REPORTED_SITES];
+int reportedSitesCount = 0;
+std::atomic_flag reportedSitesLock = ATOMIC_FLAG_INIT;
+
+const int MAX_BACKTRACE_FRAMES = 32;
+
+int captureBacktrace(void **frames)
+{
+#if defined(Q_OS_WIN)
+    return CaptureStackBackTrace(0, MAX_BACKTRACE_FRAMES, frames, nullptr);
+#else
+    return backtrace(frames, MAX_BACKTRACE_FRAMES);
+#endif
+}
+
+quintptr hashBacktrace(void **frames, int count)
+{
+    quintptr hash = 0;
+    for (int i = 0; i < count; ++i)
+        hash = hash * 31 + reinterpret_cast<quintptr>(frames[i]);
+
+    return hash;
+}
+
+bool isNewSite(quintptr site)
+{
+    while (reportedSitesLock.test_and_set(std::memory_order_acquire))
+        ; // spin, contention only happens when two audio threads are allocating at same time
+
+    bool newSite = true;
+    for (int i = 0; i < reportedSitesCount && newSite; ++i)
+        newSite = reportedSites[i] != site;
+
+    if (newSite && reportedSitesCount < MAX_REPORTED_SITES)
+        reportedSites[reportedSitesCount++] = site;
+
+    reportedSitesLock.clear(std::memory_order_release);
+
+    return newSite;
+}
+
+void dumpBacktrace(void **frames, int count)
+{
+#if defined(Q_OS_WIN)
+    for (int i = 0; i < count; ++i)
+        qCritical(jtAudio) << "    " << frames[i];
+#else
+    backtrace_symbols_fd(frames, count, STDERR_FILENO);
+#endif
+}
+
+} // namespace
+
+AllocationTripwire::Scope::Scope()
+{
+    armedScopes++;
+}
+
+AllocationTripwire::Scope::~Scope()
+{
+    armedScopes--;
+}
+
+bool AllocationTripwire::isCompiledIn()
+{
+    return true;
+}
+
+quint64 AllocationTripwire::getTrippedAllocations()
+{
+    return trippedAllocations.load();
+}
+
+void AllocationTripwire::handleAllocation(size_t bytes)
+{
+    if (armedScopes <= 0 || reporting)
+        return;
+
+    reporting = true;
+
+    trippedAllocations++;
+
+    void *frames[MAX_BACKTRACE_FRAMES];
+    int framesCount = captureBacktrace(frames);
+    if (isNewSite(hashBacktrace(frames, framesCount))) {
+        qCritical(jtAudio) << "Allocating" << bytes << "bytes in real time audio thread!";
+        dumpBacktrace(frames, framesCount);
+    }
+
+    reporting = false;
+}
+
+// +++++++++++++++++++++++ HOOKS +++++++++++++++++++++++++++++
+
+#if defined(__GLIBC__)
+
+// glibc allows the executable to interpose malloc, operator new is calling malloc too
+extern "C" {
+
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+
+void *malloc(size_t size)
+{
+    AllocationTripwire::handleAllocation(size);
+    return __libc_malloc(size);
+}
+
+void *calloc(size_t count, size_t size)
+{
+    AllocationTripwire::handleAllocation(count * size);
+    return __libc_calloc(count, size);
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    AllocationTripwire::handleAllocation(size);
+    return __libc_realloc(ptr, size);
+}
+
+} // extern "C"
+
+#else
+
+void *operator new(size_t size)
+{
+    AllocationTripwire::handleAllocation(size);
+    void *ptr = std::malloc(size ? size : 1);
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return ptr;
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+#endif // JAMTABA_RT_ALLOCATION_TRIPWIRE
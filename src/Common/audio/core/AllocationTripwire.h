@@ -0,0 +1,70 @@
+#ifndef ALLOCATION_TRIPWIRE_H
+#define ALLOCATION_TRIPWIRE_H
+
+#include <QtGlobal>
+
+namespace audio {
+
+/**
+ * Debug helper to catch heap allocations in the audio thread.
+ *
+ * When Jamtaba is compiled with CONFIG+=rt_allocation_tripwire (defining JAMTABA_RT_ALLOCATION_TRIPWIRE)
+ * malloc/new are hooked and every allocation made while a Scope is alive in the current thread is counted.
+ * The first allocation of each call site is reported with a backtrace. In normal builds Scope is an empty
+ * class and nothing is hooked.
+ */
+
+class AllocationTripwire
+{
+
+public:
+
+    class Scope
+    {
+    public:
+        Scope();
+        ~Scope();
+
+    private:
+        Scope(const Scope &other);
+        Scope &operator=(const Scope &other);
+    };
+
+    static bool isCompiledIn();
+    static quint64 getTrippedAllocations();
+
+    static void handleAllocation(size_t bytes); // called by the malloc/new hooks
+};
+
+#ifndef JAMTABA_RT_ALLOCATION_TRIPWIRE
+
+inline AllocationTripwire::Scope::Scope()
+{
+
+}
+
+inline AllocationTripwire::Scope::~Scope()
+{
+
+}
+
+inline bool AllocationTripwire::isCompiledIn()
+{
+    return false;
+}
+
+inline quint64 AllocationTripwire::getTrippedAllocations()
+{
+    return 0;
+}
+
+inline void AllocationTripwire::handleAllocation(size_t bytes)
+{
+    Q_UNUSED(bytes)
+}
+
+#endif
+
+} // namespace
+
+#endif // ALLOCATION_TRIPWIRE_H
@@ -53,8 +53,11 @@ AudioDriver::AudioDriver(controller::MainController *mainController) :
 
 void AudioDriver::recreateBuffers()
 {
-    inputBuffer = SamplesBuffer(globalInputRange.getChannels());
-    outputBuffer = SamplesBuffer(globalOutputRange.getChannels());
+    // buffers are created with the full buffer size, so the first audio callbacks are not allocating
+    inputBuffer = SamplesBuffer(globalInputRange.getChannels(), bufferSize);
+    outputBuffer = SamplesBuffer(globalOutputRange.getChannels(), bufferSize);
+
+    emit buffersRecreated(globalInputRange.getChannels(), bufferSize);
 }
 
 AudioDriver::~AudioDriver()
@@ -80,6 +80,7 @@ signals:
     void sampleRateChanged(int newSampleRate);
     void stopped();
     void started();
+    void buffersRecreated(int maxInputChannels, int maxFramesPerBuffer); // emitted before the first callback, connect using Qt::DirectConnection
 
 public:
     explicit AudioDriver(controller::MainController *mainController);
@@ -252,6 +253,7 @@ inline void NullAudioDriver::stop(bool)
 
 inline bool NullAudioDriver::start()
 {
+    recreateBuffers(); // the audio nodes are prepared even without audio callbacks
     return true;
 }
 
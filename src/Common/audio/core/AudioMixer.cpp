@@ -1,5 +1,9 @@
 #include "AudioMixer.h"
 #include "AudioNode.h"
+#include "ScratchArena.h"
+#include "ParallelRenderer.h"
+#include "RenderEpoch.h"
+#include "LatencyProbes.h"
 #include <QDebug>
 #include "Plugins.h"
 #include "midi/MidiDriver.h"
@@ -9,64 +13,162 @@
 using audio::AudioMixer;
 using audio::AudioNode;
 using audio::SamplesBuffer;
+using audio::LatencyProbes;
 
-AudioMixer::AudioMixer(int sampleRate) :
-    sampleRate(sampleRate)
+// immutable snapshot of the mixer nodes, the audio thread only reads the nodes list
+struct AudioMixer::RenderGraph
+{
+    std::vector<AudioNode *> nodes;
+    std::shared_ptr<ParallelRenderer> parallelRenderer;
+
+    // used by audio thread only, preallocated with room for all nodes
+    std::vector<AudioNode *> parallelNodes;
+    std::vector<bool> parallelNodesAudible;
+    audio::ParallelRenderer::Buffers parallelBuffers;
+};
+
+AudioMixer::AudioMixer(int sampleRate, ScratchArena &scratchArena, RenderEpoch &renderEpoch) :
+    sampleRate(sampleRate),
+    scratchArena(scratchArena),
+    renderEpoch(renderEpoch),
+    graph(new RenderGraph())
 {
 
 }
 
 void AudioMixer::addNode(AudioNode *node)
 {
+    QMutexLocker locker(&graphMutex);
+
     nodes.append(node);
     resamplers.insert(node, SamplesBufferResampler());
+
+    publishGraph();
 }
 
 void AudioMixer::removeNode(AudioNode *node)
 {
+    QMutexLocker locker(&graphMutex);
+
     nodes.removeOne(node);
     resamplers.remove(node);
+
+    publishGraph();
+}
+
+void AudioMixer::publishGraph()
+{
+    auto newGraph = new RenderGraph();
+    newGraph->nodes.assign(nodes.begin(), nodes.end());
+    newGraph->parallelRenderer = parallelRenderer;
+
+    if (parallelRenderer) {
+        newGraph->parallelNodes.reserve(nodes.size());
+        newGraph->parallelNodesAudible.reserve(nodes.size());
+        newGraph->parallelBuffers.prepare(nodes.size(), scratchArena.getMaxFrames());
+    }
+
+    auto oldGraph = graph.exchange(newGraph);
+    renderEpoch.retire([oldGraph]() {
+        delete oldGraph;
+    });
+
+    renderEpoch.reclaim();
+}
+
+void AudioMixer::setRenderWorkers(uint workers)
+{
+    QMutexLocker locker(&graphMutex);
+
+    if (workers == getRenderWorkers())
+        return;
+
+    parallelRenderer.reset(workers > 0 ? new ParallelRenderer(workers) : nullptr); // the old graph is keeping the old workers
+
+    publishGraph();
+}
+
+uint AudioMixer::getRenderWorkers() const
+{
+    return parallelRenderer ? parallelRenderer->getWorkers() : 0;
+}
+
+void AudioMixer::prepareParallelRendering()
+{
+    QMutexLocker locker(&graphMutex);
+
+    if (parallelRenderer)
+        publishGraph(); // the new graph buffers are using the current scratch arena max frames
 }
 
 AudioMixer::~AudioMixer()
 {
     qCDebug(jtAudio) << "Audio mixer destructor...";
 
-    for (auto node : resamplers.keys()) {
-        removeNode(node);
-    }
+    nodes.clear();
+    resamplers.clear();
+
+    delete graph.exchange(nullptr); // audio thread is stopped, retired graphs are deleted by RenderEpoch
 
     qCDebug(jtAudio) << "Audio mixer destructor finished!";
 }
 
 void AudioMixer::process(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate, const std::vector<midi::MidiMessage> &midiBuffer, bool attenuateAfterSumming)
 {
+    LatencyProbes::Scope probe(LatencyProbes::AudioMixerProcess);
+
     static int soloedBuffersInLastProcess = 0;
     // --------------------------------------
     bool hasSoloedBuffers = soloedBuffersInLastProcess > 0;
     soloedBuffersInLastProcess = 0;
-    for (auto node : nodes) {
+
+    auto graph = this->graph.load(); // not deleted until the end of the current render epoch
+    auto &parallelNodes = graph->parallelNodes;
+    auto &parallelNodesAudible = graph->parallelNodesAudible;
+    auto parallelRenderer = graph->parallelRenderer.get();
+    parallelNodes.clear(); // clear() is keeping the reserved capacity
+    parallelNodesAudible.clear();
+
+    for (auto node : graph->nodes) {
         bool canProcess = (!hasSoloedBuffers && !node->isMuted()) || (hasSoloedBuffers && node->isSoloed());
-        if (canProcess) {
+        if (parallelRenderer && node->canBeRenderedInParallel() && parallelNodes.size() < audio::ParallelRenderer::MAX_NODES) {
+            parallelNodes.push_back(node); // muted nodes are rendered too, but the output is discarded
+            parallelNodesAudible.push_back(canProcess);
+        }
+        else if (canProcess) {
+
+            ScratchArena::Scope scratchScope(scratchArena);
 
             // each channel (not subchannel) will receive a full copy of incomming midi messages
-            std::vector<midi::MidiMessage> midiMessages(midiBuffer.size());
-            midiMessages.insert(midiMessages.begin(), midiBuffer.begin(), midiBuffer.end());
+            auto &midiMessages = scratchArena.takeMidiBuffer();
+            midiMessages.insert(midiMessages.end(), midiBuffer.begin(), midiBuffer.end());
 
+            LatencyProbes::Scope nodeProbe(LatencyProbes::NodeProcess);
             node->processReplacing(in, out, sampleRate, midiMessages);
         }
         else { // just discard the samples if node is muted, the internalBuffer is not copyed to out buffer
-            static audio::SamplesBuffer internalBuffer(2);
-            static std::vector<midi::MidiMessage> emptyMidiBuffer;
-            internalBuffer.setFrameLenght(out.getFrameLenght());
+            ScratchArena::Scope scratchScope(scratchArena);
+            auto &internalBuffer = scratchArena.takeBuffer(2, out.getFrameLenght());
+            auto &emptyMidiBuffer = scratchArena.takeMidiBuffer();
+            LatencyProbes::Scope nodeProbe(LatencyProbes::NodeProcess);
             node->processReplacing(in, internalBuffer, sampleRate, emptyMidiBuffer);
         }
         if (node->isSoloed())
             soloedBuffersInLastProcess++;
     }
 
+    if (!parallelNodes.empty()) {
+        parallelRenderer->render(parallelNodes, graph->parallelBuffers, in, out.getChannels(), out.getFrameLenght(), sampleRate);
+
+        // summing in nodes order, the result is the same no matter which thread rendered each node
+        for (uint i = 0; i < parallelNodes.size(); ++i) {
+            if (parallelNodesAudible[i])
+                out.add(*graph->parallelBuffers.outputs[i]);
+        }
+    }
+
     if (attenuateAfterSumming) {
-        int nodesConnected = nodes.size();
+        int nodesConnected = graph->nodes.size();
         if (nodesConnected > 1) // attenuate
             out.applyGain(1.0/nodesConnected, 0.0);
     }
@@ -4,9 +4,12 @@
 #include <QList>
 #include <QMutex>
 #include <QMap>
-#include <QScopedPointer>
 #include "audio/SamplesBufferResampler.h"
 
+#include <atomic>
+#include <memory>
+#include <vector>
+
 namespace midi {
 class MidiMessage;
 }
@@ -16,6 +19,9 @@ namespace audio {
 class AudioNode;
 class SamplesBuffer;
 class LocalInputNode;
+class ScratchArena;
+class ParallelRenderer;
+class RenderEpoch;
 
 class AudioMixer
 {
@@ -24,18 +30,37 @@ private:
     AudioMixer(const AudioMixer &other);
 
 public:
-    explicit AudioMixer(int sampleRate);
+    AudioMixer(int sampleRate, ScratchArena &scratchArena, RenderEpoch &renderEpoch);
     ~AudioMixer();
+
+    // called in audio thread inside a RenderEpoch::Scope, the nodes are not locked
     void process(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate, const std::vector<midi::MidiMessage> &midiBuffer, bool attenuateAfterSumming = false);
+    // called by control threads, a new render graph is published and the old one is retired
     void addNode(AudioNode *node);
     void removeNode(AudioNode *node);
 
     void setSampleRate(int newSampleRate);
 
+    // the replaced workers are stopped when the audio thread is not using the old render graph
+    void setRenderWorkers(uint workers); // zero workers is rendering all nodes in audio thread
+    uint getRenderWorkers() const;
+    void prepareParallelRendering(); // preallocate buffers used by parallel renderer
+
 private:
-    QList<AudioNode *> nodes;
+    struct RenderGraph;
+
+    void publishGraph(); // must be called with graphMutex locked
+
+    QList<AudioNode *> nodes; // control threads copy, the audio thread is using the published graph
     int sampleRate;
     QMap<AudioNode *, SamplesBufferResampler> resamplers;
+    ScratchArena &scratchArena; // temporary midi and audio buffers, avoiding allocations in audio thread
+
+    RenderEpoch &renderEpoch;
+    std::atomic<RenderGraph *> graph;
+    QMutex graphMutex; // serialize graph changes made by GUI and ninjam threads, never locked in audio thread
+
+    std::shared_ptr<ParallelRenderer> parallelRenderer; // null when rendering in audio thread only, shared with the published graphs
 
 };
 
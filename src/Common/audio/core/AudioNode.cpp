@@ -3,8 +3,11 @@
 #include "SamplesBuffer.h"
 #include "AudioNodeProcessor.h"
 #include "AudioPeak.h"
+#include "LatencyProbes.h"
+#include "RenderEpoch.h"
 #include <cmath>
 #include <cassert>
+#include <algorithm>
 #include <QDebug>
 #include "midi/MidiDriver.h"
 #include <QMutexLocker>
@@ -15,6 +18,7 @@ using audio::AudioNode;
 using audio::SamplesBuffer;
 using audio::AudioPeak;
 using audio::AudioNodeProcessor;
+using audio::LatencyProbes;
 
 const double AudioNode::ROOT_2_OVER_2 = 1.414213562373095 * 0.5;
 const double AudioNode::PI_OVER_2 = 3.141592653589793238463 * 0.5;
@@ -29,25 +33,25 @@ void AudioNode::processReplacing(const SamplesBuffer &in, SamplesBuffer &out, in
     internalInputBuffer.setFrameLenght(out.getFrameLenght());
     internalOutputBuffer.setFrameLenght(out.getFrameLenght());
 
-    {
-        QMutexLocker locker(&mutex);
-        for (auto node : connections) { // ask connected nodes to generate audio
-            node->processReplacing(internalInputBuffer, internalOutputBuffer, sampleRate, midiBuffer);
-        }
+    for (auto node : *connections.load()) { // ask connected nodes to generate audio
+        node->processReplacing(internalInputBuffer, internalOutputBuffer, sampleRate, midiBuffer);
     }
 
     internalOutputBuffer.set(internalInputBuffer); // if we have no plugins inserted the input samples are just copied  to output buffer.
 
-    static SamplesBuffer tempInputBuffer(2);
+    thread_local static SamplesBuffer tempInputBuffer(2); // nodes can be rendered by more than one thread
 
     // process inserted plugins
     for (int i=0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        auto processor = processors[i];
+        auto processor = processors[i].load(std::memory_order_acquire);
         if (processor && !processor->isBypassed()) {
             tempInputBuffer.setFrameLenght(internalOutputBuffer.getFrameLenght());
             tempInputBuffer.set(internalOutputBuffer); // the output from previous plugin is used as input to the next plugin in the chain
 
-            processor->process(tempInputBuffer, internalOutputBuffer, midiBuffer);
+            {
+                LatencyProbes::Scope probe(LatencyProbes::PluginProcess);
+                processor->process(tempInputBuffer, internalOutputBuffer, midiBuffer);
+            }
 
             // some plugins are blocking the midi messages. If a VSTi can't generate messages the previous messages list will be sended for the next plugin in the chain. The messages list is cleared only when the plugin can generate midi messages.
             if (processor->isVirtualInstrument() && processor->canGenerateMidiMessages())
@@ -61,9 +65,7 @@ void AudioNode::processReplacing(const SamplesBuffer &in, SamplesBuffer &out, in
 
     preFaderProcess(internalOutputBuffer); //call overrided preFaderProcess in subclasses to allow some preFader process.
 
-    internalOutputBuffer.applyGain(gain, leftGain, rightGain, boost);
-
-    lastPeak.update(internalOutputBuffer.computePeak());
+    lastPeak.update(internalOutputBuffer.applyGainAndComputePeak(gain, leftGain, rightGain, boost)); // gain, pan, boost and peaks in one pass
 
     postFaderProcess(internalOutputBuffer);
 
@@ -89,6 +91,7 @@ AudioNode::AudioNode() :
     boost(1),
     resamplingCorrection(0)
 {
+    connections = new Connections();
 
     for (int i=0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
         processors[i] = nullptr;
@@ -189,71 +192,86 @@ void AudioNode::updateGains()
 
 AudioNode::~AudioNode()
 {
-    for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i]){
-            delete processors[i];
-            processors[i] = nullptr;
-        }
-    }
+    delete connections.load();
+
+    for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i)
+        delete processors[i].exchange(nullptr);
 }
 
-bool AudioNode::connect(AudioNode &other)
+bool AudioNode::connect(AudioNode &other, RenderEpoch &renderEpoch)
 {
-    QMutexLocker(&(other.mutex));
-
-    other.connections.insert(this);
+    other.updateConnections(this, true, renderEpoch);
 
     return true;
 }
 
-bool AudioNode::disconnect(AudioNode &otherNode)
+bool AudioNode::disconnect(AudioNode &otherNode, RenderEpoch &renderEpoch)
 {
-    QMutexLocker(&(otherNode.mutex));
-    otherNode.connections.remove(this);
+    otherNode.updateConnections(this, false, renderEpoch);
+
     return true;
 }
 
+void AudioNode::updateConnections(AudioNode *node, bool connected, RenderEpoch &renderEpoch)
+{
+    QMutexLocker locker(&connectionsMutex);
+
+    auto newConnections = new Connections(*connections.load());
+    auto it = std::find(newConnections->begin(), newConnections->end(), node);
+    if (connected && it == newConnections->end())
+        newConnections->push_back(node);
+    else if (!connected && it != newConnections->end())
+        newConnections->erase(it);
+
+    auto oldConnections = connections.exchange(newConnections);
+    renderEpoch.retire([oldConnections]() {
+        delete oldConnections;
+    });
+}
+
 void AudioNode::addProcessor(AudioNodeProcessor *newProcessor, quint32 slotIndex)
 {
     assert(newProcessor);
     assert(slotIndex < MAX_PROCESSORS_PER_TRACK);
-    processors[slotIndex] = newProcessor;
+    processors[slotIndex].store(newProcessor, std::memory_order_release); // the processor is ready when published
 }
 
-void AudioNode::removeProcessor(AudioNodeProcessor *processor)
+void AudioNode::removeProcessor(AudioNodeProcessor *processor, RenderEpoch &renderEpoch)
 {
     assert(processor);
-    processor->suspend();
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i] == processor){
-            processors[i] = nullptr;
+        AudioNodeProcessor *expected = processor;
+        if (processors[i].compare_exchange_strong(expected, nullptr))
             break;
-        }
     }
-    delete processor;
+
+    // the running callback can be using the processor, plugins are deleted by reclaim() in the GUI thread
+    renderEpoch.retire([processor]() {
+        processor->suspend();
+        delete processor;
+    });
 }
 
 void AudioNode::suspendProcessors()
 {
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i])
-            processors[i]->suspend();
+        if (auto processor = processors[i].load())
+            processor->suspend();
     }
 }
 
 void AudioNode::updateProcessorsGui()
 {
-    QMutexLocker locker(&mutex);
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i])
-            processors[i]->updateGui();
+        if (auto processor = processors[i].load())
+            processor->updateGui();
     }
 }
 
 void AudioNode::resumeProcessors()
 {
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i])
-            processors[i]->resume();
+        if (auto processor = processors[i].load())
+            processor->resume();
     }
 }
@@ -9,9 +9,13 @@
 #include <QDebug>
 #include <QList>
 
+#include <atomic>
+#include <vector>
+
 namespace audio {
 
 class AudioNodeProcessor;
+class RenderEpoch;
 
 class AudioNode : public QObject
 {
@@ -32,11 +36,12 @@ public:
     bool isMuted() const;
     bool isSoloed() const;
 
-    virtual bool connect(AudioNode &other);
-    virtual bool disconnect(AudioNode &otherNode);
+    // the replaced connections list is retired, the audio thread can be iterating it
+    virtual bool connect(AudioNode &other, RenderEpoch &renderEpoch);
+    virtual bool disconnect(AudioNode &otherNode, RenderEpoch &renderEpoch);
 
-    virtual void addProcessor(AudioNodeProcessor *newProcessor, quint32 slotIndex);
-    void removeProcessor(AudioNodeProcessor *processor);
+    virtual void addProcessor(AudioNodeProcessor *newProcessor, quint32 slotIndex); // used in the next callback
+    void removeProcessor(AudioNodeProcessor *processor, RenderEpoch &renderEpoch); // retired, deleted when the audio thread is not using it
     void suspendProcessors();
     void resumeProcessors();
     virtual void updateProcessorsGui();
@@ -62,6 +67,9 @@ public:
 
     virtual bool isActivated() const;
 
+    // nodes not sharing state with other nodes (no plugins, no connections) can be rendered by worker threads
+    virtual bool canBeRenderedInParallel() const;
+
     virtual void reset(); // reset pan, gain, boost, etc
 
     static const quint8 MAX_PROCESSORS_PER_TRACK = 4;
@@ -73,13 +81,13 @@ protected:
 
     int getInputResamplingLength(int sourceSampleRate, int targetSampleRate, int outFrameLenght);
 
-    QSet<AudioNode *> connections;
-    AudioNodeProcessor *processors[MAX_PROCESSORS_PER_TRACK];
+    typedef std::vector<AudioNode *> Connections;
+    std::atomic<const Connections *> connections; // immutable list, replaced when nodes are connected/disconnected
+    std::atomic<AudioNodeProcessor *> processors[MAX_PROCESSORS_PER_TRACK]; // published to the audio thread, changed by control threads
     SamplesBuffer internalInputBuffer;
     SamplesBuffer internalOutputBuffer;
 
     mutable audio::AudioPeak lastPeak;
-    QMutex mutex; // used to protected connections manipulation because nodes can be added or removed by different threads
 
     // pan
     float pan;
@@ -95,6 +103,10 @@ private:
 
     bool activated; // used when room stream is played. All tracks are disabled, except the room streamer.
 
+    QMutex connectionsMutex; // serialize connect() and disconnect(), never locked in audio thread
+
+    void updateConnections(AudioNode *node, bool connected, RenderEpoch &renderEpoch);
+
     float gain;
     float boost;
 
@@ -129,6 +141,11 @@ inline bool AudioNode::isActivated() const
     return activated;
 }
 
+inline bool AudioNode::canBeRenderedInParallel() const
+{
+    return false;
+}
+
 inline float AudioNode::getPan() const
 {
     return pan;
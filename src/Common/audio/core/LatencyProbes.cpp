@@ -0,0 +1,286 @@
+#include "LatencyProbes.h"
+
+#include <QMutex>
+#include <QMutexLocker>
+#include <QStringList>
+
+#include <chrono>
+#include <cmath>
+#include <thread>
+
+using audio::LatencyProbes;
+
+std::atomic<bool> LatencyProbes::enabled(false);
+
+namespace {
+
+struct Record
+{
+    quint64 start;
+    quint64 duration; // timestamp ticks
+    quint8 probe;
+};
+
+// single producer (the owner thread) single consumer (collect) ring
+struct Ring
+{
+    static const quint64 SIZE = 4096; // power of 2
+
+    Record records[SIZE];
+    std::atomic<quint64> head{0}; // written by owner thread
+    std::atomic<quint64> tail{0}; // written by collect()
+    std::atomic<quint64> dropped{0};
+    std::atomic<bool> inUse{false};
+    std::atomic<quint32> generation{0}; // incremented when released, the old owner is not writing anymore
+    std::atomic<bool> audioCallback{false}; // owned by an audio driver thread
+};
+
+const int MAX_RINGS = 16; // threads writing records, records of other threads are dropped
+
+Ring ringsPool[MAX_RINGS]; // preallocated, the audio threads don't lock or allocate in the first record
+
+std::atomic<quint64> droppedWithoutRing{0};
+
+Ring *acquireRing() // lock free, released rings are reused
+{
+    for (Ring &ring : ringsPool) {
+        bool inUse = false;
+        if (ring.inUse.compare_exchange_strong(inUse, true))
+            return &ring;
+    }
+
+    return nullptr;
+}
+
+void releaseRing(Ring &ring)
+{
+    ring.audioCallback.store(false, std::memory_order_relaxed);
+    ring.generation.fetch_add(1, std::memory_order_relaxed);
+    ring.inUse.store(false, std::memory_order_release);
+}
+
+// trivially destructible, no thread exit handlers in the audio threads
+thread_local Ring *threadRing = nullptr;
+thread_local quint32 threadRingGeneration = 0;
+
+// logarithmic histogram, 8 buckets per octave of nanoseconds
+const int BUCKETS_PER_OCTAVE = 8;
+const int BUCKETS = 32 * BUCKETS_PER_OCTAVE;
+
+int bucketIndex(double nanoseconds)
+{
+    if (nanoseconds < 1.0)
+        return 0;
+
+    return qMin(BUCKETS - 1, static_cast<int>(std::log2(nanoseconds) * BUCKETS_PER_OCTAVE));
+}
+
+double bucketUpperBound(int bucket) // nanoseconds
+{
+    return std::exp2(static_cast<double>(bucket + 1) / BUCKETS_PER_OCTAVE);
+}
+
+struct Histogram
+{
+    quint64 buckets[BUCKETS] = {};
+    quint64 count = 0;
+    quint64 totalTicks = 0;
+    double max = 0; // nanoseconds
+
+    double percentile(double p) const
+    {
+        if (!count)
+            return 0;
+
+        const quint64 target = static_cast<quint64>(std::ceil(p * count));
+        quint64 accumulated = 0;
+        for (int b = 0; b < BUCKETS; ++b) {
+            accumulated += buckets[b];
+            if (accumulated >= target)
+                return qMin(bucketUpperBound(b), max);
+        }
+
+        return max;
+    }
+};
+
+const std::chrono::milliseconds CALIBRATION_TIME(5);
+const double RECALIBRATION_TIME = 1e9; // nanoseconds, collect() is using the long measure after 1 second
+
+struct Calibration
+{
+    quint64 firstTicks = 0;
+    std::chrono::steady_clock::time_point firstTime;
+    quint64 lastCollectTicks = 0;
+    double ticksPerNs = 0;
+};
+
+QMutex calibrationMutex; // used by collect() and setEnabled()
+Calibration calibration;
+
+void calibrate() // calibrationMutex is locked
+{
+    if (calibration.ticksPerNs > 0)
+        return;
+
+    calibration.firstTime = std::chrono::steady_clock::now();
+    calibration.firstTicks = calibration.lastCollectTicks = LatencyProbes::readTimestamp();
+
+#if defined(Q_PROCESSOR_X86)
+    std::this_thread::sleep_for(CALIBRATION_TIME); // the first report is not using uncalibrated ticks
+    const quint64 ticks = LatencyProbes::readTimestamp() - calibration.firstTicks;
+    const double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - calibration.firstTime).count();
+    calibration.ticksPerNs = (elapsedNs > 0 && ticks > 0) ? ticks / elapsedNs : 1.0;
+#else
+    typedef std::chrono::steady_clock::period Period; // the timestamps are steady_clock ticks
+    calibration.ticksPerNs = static_cast<double>(Period::den) / (Period::num * 1e9);
+#endif
+}
+
+} // namespace
+
+void LatencyProbes::setEnabled(bool enabled)
+{
+    if (enabled) {
+        QMutexLocker locker(&calibrationMutex);
+        calibrate();
+    }
+
+    LatencyProbes::enabled = enabled;
+}
+
+void LatencyProbes::releaseThreadRing()
+{
+    Ring *ring = threadRing;
+    threadRing = nullptr;
+
+    if (ring && ring->generation.load(std::memory_order_relaxed) == threadRingGeneration)
+        releaseRing(*ring); // the records are drained in the next collect()
+}
+
+void LatencyProbes::releaseAudioCallbackRings()
+{
+    for (Ring &ring : ringsPool) {
+        if (ring.inUse.load(std::memory_order_acquire) && ring.audioCallback.load(std::memory_order_relaxed))
+            releaseRing(ring); // a driver reusing the callback thread will acquire a new ring
+    }
+}
+
+void LatencyProbes::addRecord(quint8 probe, quint64 start, quint64 end)
+{
+    Ring *ring = threadRing;
+    if (!ring || ring->generation.load(std::memory_order_relaxed) != threadRingGeneration) {
+        ring = acquireRing(); // first record in this thread, or the ring was released when the driver stopped
+        if (!ring) {
+            threadRing = nullptr;
+            droppedWithoutRing.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        threadRing = ring;
+        threadRingGeneration = ring->generation.load(std::memory_order_relaxed);
+    }
+
+    if (probe == MainControllerProcess && !ring->audioCallback.load(std::memory_order_relaxed))
+        ring->audioCallback.store(true, std::memory_order_relaxed);
+
+    const quint64 head = ring->head.load(std::memory_order_relaxed);
+    if (head - ring->tail.load(std::memory_order_acquire) >= Ring::SIZE) {
+        ring->dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    ring->records[head & (Ring::SIZE - 1)] = { start, end - start, probe };
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+LatencyProbes::Report LatencyProbes::collect()
+{
+    QMutexLocker collectLocker(&calibrationMutex);
+
+    calibrate(); // probes never enabled
+
+    const quint64 nowTicks = readTimestamp();
+
+    Report report = {};
+
+#if defined(Q_PROCESSOR_X86)
+    const double elapsedNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - calibration.firstTime).count();
+    if (elapsedNs > RECALIBRATION_TIME && nowTicks > calibration.firstTicks)
+        calibration.ticksPerNs = (nowTicks - calibration.firstTicks) / elapsedNs; // more precise than the initial calibration
+#endif
+
+    const double ticksPerNs = calibration.ticksPerNs;
+
+    Histogram histograms[PROBES_COUNT];
+
+    for (Ring &ring : ringsPool) { // the records of finished threads are drained too
+        const quint64 head = ring.head.load(std::memory_order_acquire);
+        quint64 tail = ring.tail.load(std::memory_order_relaxed);
+        for (; tail < head; ++tail) {
+            const Record &record = ring.records[tail & (Ring::SIZE - 1)];
+            if (record.probe >= PROBES_COUNT)
+                continue;
+
+            const double ns = record.duration / ticksPerNs;
+            auto &histogram = histograms[record.probe];
+            histogram.buckets[bucketIndex(ns)]++;
+            histogram.count++;
+            histogram.totalTicks += record.duration;
+            histogram.max = qMax(histogram.max, ns);
+        }
+        ring.tail.store(tail, std::memory_order_release);
+
+        report.droppedRecords += ring.dropped.exchange(0, std::memory_order_relaxed);
+    }
+
+    report.droppedRecords += droppedWithoutRing.exchange(0, std::memory_order_relaxed);
+
+    for (int p = 0; p < PROBES_COUNT; ++p) {
+        const auto &histogram = histograms[p];
+        report.probes[p] = { histogram.count, histogram.percentile(0.5) / 1000.0, histogram.percentile(0.99) / 1000.0, histogram.max / 1000.0 };
+    }
+
+    const quint64 windowTicks = nowTicks - calibration.lastCollectTicks;
+    if (windowTicks > 0)
+        report.dspLoad = 100.0 * histograms[MainControllerProcess].totalTicks / windowTicks;
+
+    calibration.lastCollectTicks = nowTicks;
+
+    return report;
+}
+
+QString LatencyProbes::getName(Probe probe)
+{
+    switch (probe) {
+    case MainControllerProcess: return "callback";
+    case AudioMixerProcess:     return "mixer";
+    case NodeProcess:           return "nodes";
+    case PluginProcess:         return "plugins";
+    case VorbisDecode:          return "decode";
+    case Resampling:            return "resample";
+    default:                    return "unknown";
+    }
+}
+
+QString LatencyProbes::toString(const Report &report)
+{
+    QStringList lines;
+    lines << QString("DSP: %1%").arg(report.dspLoad, 0, 'f', 1);
+
+    for (int p = 0; p < PROBES_COUNT; ++p) {
+        const auto &statistics = report.probes[p];
+        if (!statistics.count)
+            continue;
+
+        lines << QString("%1 p50 %2 p99 %3 max %4 us")
+                 .arg(getName(static_cast<Probe>(p)))
+                 .arg(statistics.p50, 0, 'f', 1)
+                 .arg(statistics.p99, 0, 'f', 1)
+                 .arg(statistics.max, 0, 'f', 1);
+    }
+
+    if (report.droppedRecords)
+        lines << QString("dropped: %1").arg(report.droppedRecords);
+
+    return lines.join("\n");
+}
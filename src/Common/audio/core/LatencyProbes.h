@@ -0,0 +1,128 @@
+#ifndef LATENCY_PROBES_H
+#define LATENCY_PROBES_H
+
+#include <QtGlobal>
+#include <QString>
+
+#include <atomic>
+
+#if defined(Q_PROCESSOR_X86)
+#   ifdef _MSC_VER
+#       include <intrin.h>
+#   else
+#       include <x86intrin.h>
+#   endif
+#else
+#   include <chrono>
+#endif
+
+namespace audio {
+
+/**
+ * Lightweight timing probes for the audio hot path.
+ *
+ * A Scope measures the block it is wrapping using the CPU timestamp counter and writes a fixed-size
+ * record in a ring owned by the current thread. The rings are preallocated and claimed without locks
+ * in the first record of each thread. The threads release their rings explicitly (there is no thread_local
+ * destructor), the rings of the audio driver threads are released when the driver is stopped.
+ * collect() is called by a non real time thread (GUI timer), draining all rings into histograms.
+ * When probes are disabled a Scope is just a relaxed atomic load.
+ */
+
+class LatencyProbes
+{
+
+public:
+
+    enum Probe
+    {
+        MainControllerProcess,
+        AudioMixerProcess,
+        NodeProcess,
+        PluginProcess,
+        VorbisDecode,
+        Resampling,
+        PROBES_COUNT
+    };
+
+    class Scope
+    {
+    public:
+        explicit Scope(Probe probe);
+        ~Scope();
+
+    private:
+        Scope(const Scope &other);
+        Scope &operator=(const Scope &other);
+
+        quint64 start;
+        quint8 probe;
+        bool active;
+    };
+
+    struct Statistics
+    {
+        quint64 count;
+        double p50; // microseconds
+        double p99;
+        double max;
+    };
+
+    struct Report
+    {
+        Statistics probes[PROBES_COUNT];
+        double dspLoad; // percentage of the wall time spent in MainControllerProcess
+        quint64 droppedRecords; // records lost because a ring was full or all rings were in use
+    };
+
+    static void setEnabled(bool enabled); // the timestamp counter is calibrated when probes are enabled
+    static bool isEnabled();
+
+    static void releaseThreadRing(); // called by probed threads before finishing
+    static void releaseAudioCallbackRings(); // called after the audio driver is stopped, the callback threads are not running
+
+    static Report collect(); // aggregate the records written since the last call, not real time safe
+
+    static QString getName(Probe probe);
+    static QString toString(const Report &report);
+
+    static quint64 readTimestamp();
+
+private:
+    static void addRecord(quint8 probe, quint64 start, quint64 end);
+
+    static std::atomic<bool> enabled;
+};
+
+inline bool LatencyProbes::isEnabled()
+{
+    return enabled.load(std::memory_order_relaxed);
+}
+
+inline quint64 LatencyProbes::readTimestamp()
+{
+#if defined(Q_PROCESSOR_X86)
+    return __rdtsc(); // converted to time in collect(), calibrated using steady_clock
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+inline LatencyProbes::Scope::Scope(Probe probe) :
+    start(0),
+    probe(static_cast<quint8>(probe)),
+    active(LatencyProbes::isEnabled())
+{
+    if (active)
+        start = LatencyProbes::readTimestamp();
+}
+
+inline LatencyProbes::Scope::~Scope()
+{
+    if (active)
+        LatencyProbes::addRecord(probe, start, LatencyProbes::readTimestamp());
+}
+
+} // namespace
+
+#endif // LATENCY_PROBES_H
@@ -1,12 +1,17 @@
 #include "LocalInputGroup.h"
 #include "LocalInputNode.h"
+#include "RenderEpoch.h"
+
+#include <algorithm>
 
 using audio::LocalInputGroup;
 using audio::LocalInputNode;
 using audio::SamplesBuffer;
 
-LocalInputGroup::LocalInputGroup(int groupIndex, LocalInputNode *firstInput) :
+LocalInputGroup::LocalInputGroup(int groupIndex, LocalInputNode *firstInput, RenderEpoch &renderEpoch) :
     groupIndex(groupIndex),
+    renderEpoch(renderEpoch),
+    groupedInputs(new Inputs()),
     transmiting(true),
     voiceChatActivated(false)
 {
@@ -15,18 +20,29 @@ LocalInputGroup::LocalInputGroup(int groupIndex, LocalInputNode *firstInput) :
 
 LocalInputGroup::~LocalInputGroup()
 {
-    groupedInputs.clear();
+    delete groupedInputs.load(); // the group is deleted when the audio thread is not using it
+}
+
+void LocalInputGroup::publishInputs(const Inputs *newInputs)
+{
+    auto oldInputs = groupedInputs.exchange(newInputs);
+    renderEpoch.retire([oldInputs]() {
+        delete oldInputs;
+    });
 }
 
 void LocalInputGroup::addInputNode(LocalInputNode *input)
 {
-    groupedInputs.append(input);
+    auto newInputs = new Inputs(*groupedInputs.load());
+    newInputs->push_back(input);
+    publishInputs(newInputs);
 }
 
 LocalInputNode *LocalInputGroup::getInputNode(quint8 index) const
 {
-    if (index < groupedInputs.size()) {
-        return groupedInputs.at(index);
+    auto inputs = groupedInputs.load();
+    if (index < inputs->size()) {
+        return inputs->at(index);
     }
 
     return nullptr;
@@ -34,7 +50,7 @@ LocalInputNode *LocalInputGroup::getInputNode(quint8 index) const
 
 void LocalInputGroup::mixGroupedInputs(SamplesBuffer &out)
 {
-    for (auto inputTrack : groupedInputs) {
+    for (auto inputTrack : *groupedInputs.load()) {
         auto lastBuffer = inputTrack->getLastBuffer();
         if (lastBuffer.getChannels() == out.getChannels()) {
             out.add(lastBuffer);
@@ -47,24 +63,34 @@ void LocalInputGroup::mixGroupedInputs(SamplesBuffer &out)
 
 void LocalInputGroup::removeInput(LocalInputNode *input)
 {
-    if (!groupedInputs.removeOne(input))
+    auto newInputs = new Inputs(*groupedInputs.load());
+    auto it = std::find(newInputs->begin(), newInputs->end(), input);
+    if (it == newInputs->end()) {
         qCritical() << "the input track was not removed!";
+        delete newInputs;
+        return;
+    }
+
+    newInputs->erase(it);
+    publishInputs(newInputs);
 }
 
 int LocalInputGroup::getMaxInputChannelsForEncoding() const
 {
-    if (groupedInputs.size() > 1)
+    const Inputs &inputs = *groupedInputs.load();
+
+    if (inputs.size() > 1)
         return 2;    // stereo encoding
 
-    if (!groupedInputs.isEmpty()) {
+    if (!inputs.empty()) {
 
-        if (groupedInputs.first()->isMidi())
+        if (inputs.front()->isMidi())
             return 2;    // just one midi track, use stereo encoding
 
-        if (groupedInputs.first()->isAudio())
-            return groupedInputs.first()->getAudioInputRange().getChannels();
+        if (inputs.front()->isAudio())
+            return inputs.front()->getAudioInputRange().getChannels();
 
-        if (groupedInputs.first()->isNoInput())
+        if (inputs.front()->isNoInput())
             return 2;    // allow channels using noInput but processing some vst looper in stereo
     }
     return 0;    // no channels to encoding
@@ -3,16 +3,20 @@
 
 #include <QList>
 
+#include <atomic>
+#include <vector>
+
 namespace audio {
 
 class LocalInputNode;
 class SamplesBuffer;
+class RenderEpoch;
 
 class LocalInputGroup
 {
 
 public:
-    LocalInputGroup(int groupIndex, audio::LocalInputNode *firstInput);
+    LocalInputGroup(int groupIndex, audio::LocalInputNode *firstInput, RenderEpoch &renderEpoch);
     ~LocalInputGroup();
 
     bool isEmpty() const;
@@ -38,10 +42,15 @@ public:
     audio::LocalInputNode *getInputNode(quint8 index) const;
 
 private:
+    typedef std::vector<audio::LocalInputNode *> Inputs;
+
+    void publishInputs(const Inputs *newInputs); // the replaced list is retired, the audio thread can be mixing it
+
     int groupIndex;
-    QList<audio::LocalInputNode *> groupedInputs;
-    bool transmiting;
-    bool voiceChatActivated;
+    RenderEpoch &renderEpoch;
+    std::atomic<const Inputs *> groupedInputs; // immutable list, replaced when inputs are added or removed
+    std::atomic<bool> transmiting;
+    std::atomic<bool> voiceChatActivated;
 };
 
 inline bool LocalInputGroup::isTransmiting() const
@@ -56,7 +65,7 @@ inline int LocalInputGroup::getIndex() const
 
 inline bool LocalInputGroup::isEmpty() const
 {
-    return groupedInputs.empty();
+    return groupedInputs.load()->empty();
 }
 
 } //namespace
@@ -1,5 +1,6 @@
 #include "LocalInputNode.h"
 #include "audio/core/AudioNodeProcessor.h"
+#include "audio/core/ScratchArena.h"
 #include "midi/MidiMessage.h"
 #include "MainController.h"
 #include "NinjamController.h"
@@ -9,6 +10,7 @@
 using audio::LocalInputNode;
 using audio::Looper;
 using audio::SamplesBuffer;
+using audio::ScratchArena;
 
 LocalInputNode::MidiInput::MidiInput() :
     device(-1),
@@ -149,16 +151,16 @@ bool LocalInputNode::isAudio() const
 void LocalInputNode::setProcessorsSampleRate(int newSampleRate)
 {
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i])
-            processors[i]->setSampleRate(newSampleRate);
+        if (auto processor = processors[i].load())
+            processor->setSampleRate(newSampleRate);
     }
 }
 
 void LocalInputNode::closeProcessorsWindows()
 {
     for (int i = 0; i < MAX_PROCESSORS_PER_TRACK; ++i) {
-        if (processors[i])
-            processors[i]->closeEditor();
+        if (auto processor = processors[i].load())
+            processor->closeEditor();
     }
 }
 
@@ -238,7 +240,9 @@ void LocalInputNode::processReplacing(const SamplesBuffer &in, SamplesBuffer &ou
     *
     */
 
-    std::vector<midi::MidiMessage> filteredMidiBuffer(midiBuffer.size());
+    ScratchArena::Scope scratchScope(mainController->getScratchArena());
+    auto &filteredMidiBuffer = mainController->getScratchArena().takeMidiBuffer();
+
     internalInputBuffer.setFrameLenght(out.getFrameLenght());
     internalOutputBuffer.setFrameLenght(out.getFrameLenght());
     internalInputBuffer.zero();
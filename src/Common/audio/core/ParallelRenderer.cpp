@@ -0,0 +1,215 @@
+#include "ParallelRenderer.h"
+#include "AudioNode.h"
+#include "SamplesBuffer.h"
+#include "LatencyProbes.h"
+#include "log/Logging.h"
+
+#include <QThread>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+    #define JT_PAUSE() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+    #define JT_PAUSE() __asm__ __volatile__("yield")
+#else
+    #define JT_PAUSE()
+#endif
+
+using audio::ParallelRenderer;
+using audio::SamplesBuffer;
+using audio::AudioNode;
+using audio::LatencyProbes;
+
+class ParallelRenderer::Worker : public QThread
+{
+public:
+    explicit Worker(ParallelRenderer &renderer) :
+        renderer(renderer)
+    {
+
+    }
+
+protected:
+    void run() override
+    {
+        renderer.runWorker();
+        LatencyProbes::releaseThreadRing();
+    }
+
+private:
+    ParallelRenderer &renderer;
+};
+
+// -------------------------------------------------------------
+
+const uint ParallelRenderer::MAX_WORKERS;
+const uint ParallelRenderer::MAX_NODES;
+
+ParallelRenderer::ParallelRenderer(uint workersCount) :
+    nodes(nullptr),
+    buffers(nullptr),
+    input(nullptr),
+    channels(2),
+    frames(0),
+    sampleRate(44100),
+    claim(0),
+    renderedNodes(0),
+    sleepingWorkers(0),
+    stopRequested(false)
+{
+    workersCount = qMin(workersCount, MAX_WORKERS);
+
+    qCDebug(jtAudio) << "Starting" << workersCount << "render workers";
+
+    for (uint i = 0; i < workersCount; ++i) {
+        workers.emplace_back(new Worker(*this));
+        workers.back()->start(QThread::TimeCriticalPriority);
+    }
+}
+
+ParallelRenderer::~ParallelRenderer()
+{
+    stopRequested = true;
+
+    newBatchAvailable.signal(workers.size());
+
+    for (auto &worker : workers)
+        worker->wait();
+
+    qCDebug(jtAudio) << "Render workers stopped";
+}
+
+void ParallelRenderer::Buffers::prepare(uint maxNodes, uint maxFrames)
+{
+    while (outputs.size() < maxNodes) {
+        outputs.emplace_back(new SamplesBuffer(2, maxFrames));
+        midiBuffers.emplace_back();
+    }
+
+    for (auto &output : outputs) {
+        if (output->getCapacity() < maxFrames) {
+            output->setFrameLenght(maxFrames); // growing the samples block before the audio thread need it
+            output->setFrameLenght(0);
+        }
+    }
+
+    this->maxFrames = qMax(this->maxFrames, maxFrames);
+}
+
+void ParallelRenderer::pause()
+{
+    JT_PAUSE();
+}
+
+void ParallelRenderer::render(const std::vector<AudioNode *> &nodes, Buffers &buffers, const SamplesBuffer &in, uint channels, uint frames, int sampleRate)
+{
+    if (nodes.empty())
+        return;
+
+    Q_ASSERT(nodes.size() <= MAX_NODES);
+    Q_ASSERT(buffers.outputs.size() >= nodes.size() && frames <= buffers.maxFrames); // prepare() is mandatory, never allocating in audio thread
+
+    // the previous batch is finished, no worker is using the batch data
+    this->nodes = &nodes;
+    this->buffers = &buffers;
+    this->input = &in;
+    this->channels = channels;
+    this->frames = frames;
+    this->sampleRate = sampleRate;
+
+    renderedNodes = 0;
+
+    const quint32 batchGeneration = getGeneration(claim) + 1;
+    claim = (static_cast<quint64>(batchGeneration) << 32) | (static_cast<quint64>(nodes.size()) << 16); // publishing the new batch
+
+    const uint sleeping = sleepingWorkers;
+    if (sleeping > 0)
+        newBatchAvailable.signal(sleeping); // a worker waking up after the batch is finished just sleep again
+
+    try {
+        renderPendingNodes(batchGeneration); // audio thread is claiming nodes too
+    }
+    catch (...) {
+        waitRenderedNodes(nodes.size()); // workers are using the batch data, can't leave before they finish
+        throw;
+    }
+
+    waitRenderedNodes(nodes.size());
+}
+
+void ParallelRenderer::waitRenderedNodes(uint count)
+{
+    // only the nodes claimed by workers and not rendered yet are waited
+    while (renderedNodes < count)
+        pause();
+}
+
+void ParallelRenderer::renderPendingNodes(quint32 batchGeneration)
+{
+    while (true) {
+        quint64 current = claim;
+        if (getGeneration(current) != batchGeneration)
+            return; // a newer batch was published, the batch data is not this worker's batch anymore
+
+        const uint index = getNextNode(current);
+        if (index >= getNodesCount(current))
+            return;
+
+        if (!claim.compare_exchange_weak(current, current + 1))
+            continue;
+
+        // the batch data is stable after claiming a node, the audio thread is waiting the node
+        struct RenderedNode // counting the node even if processReplacing throws, the audio thread is waiting it
+        {
+            std::atomic<uint> &counter;
+            ~RenderedNode() { counter++; }
+        } rendered = { renderedNodes };
+
+        auto &output = *buffers->outputs[index];
+        output.setChannels(channels);
+        output.setFrameLenght(frames);
+        output.zero();
+
+        auto &midiBuffer = buffers->midiBuffers[index];
+        midiBuffer.clear();
+
+        LatencyProbes::Scope probe(LatencyProbes::NodeProcess);
+        (*nodes)[index]->processReplacing(*input, output, sampleRate, midiBuffer);
+    }
+}
+
+void ParallelRenderer::runWorker()
+{
+    quint32 lastGeneration = 0; // the first batch is generation 1, even if it is published before the worker start
+
+    while (true) {
+        int spins = 0;
+        while (getGeneration(claim) == lastGeneration && !stopRequested) {
+            if (++spins < SPIN_ITERATIONS) {
+                pause();
+                if (spins % 64 == 0)
+                    QThread::yieldCurrentThread();
+                continue;
+            }
+
+            // audio thread is idle, sleeping until the next batch. The batch is published before 'sleepingWorkers'
+            // is read in render(), so a worker missing the new generation here is always signaled
+            sleepingWorkers++;
+            if (getGeneration(claim) == lastGeneration && !stopRequested)
+                newBatchAvailable.wait();
+            sleepingWorkers--;
+        }
+
+        if (stopRequested)
+            return;
+
+        lastGeneration = getGeneration(claim);
+
+        try {
+            renderPendingNodes(lastGeneration);
+        }
+        catch (...) {
+            qCritical(jtAudio) << "Exception rendering node in worker thread";
+        }
+    }
+}
@@ -0,0 +1,113 @@
+#ifndef PARALLEL_RENDERER_H
+#define PARALLEL_RENDERER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+#include "midi/MidiMessage.h"
+#include "audio/atomicops.h"
+
+namespace audio {
+
+class AudioNode;
+class SamplesBuffer;
+
+/**
+ * Render independent nodes (remote Ninjam tracks) using a fixed pool of high priority worker threads.
+ *
+ * The audio thread publishes a batch of nodes and renders nodes too. Nodes are claimed one by one, each
+ * node is rendered in its own output buffer, so the caller can sum the outputs in a deterministic order.
+ * The batch is finished when all nodes are rendered, workers waking up late are not delaying the audio
+ * thread. Workers spin for a while waiting the next batch and sleep in a lightweight semaphore when the audio
+ * thread is idle, the audio thread never locks a mutex and there is no Qt event loop involved.
+ */
+
+class ParallelRenderer
+{
+
+public:
+    explicit ParallelRenderer(uint workersCount);
+    ~ParallelRenderer();
+
+    uint getWorkers() const;
+
+    // one output buffer for each node, preallocated by control thread
+    struct Buffers
+    {
+        std::vector<std::unique_ptr<SamplesBuffer>> outputs;
+        std::vector<std::vector<midi::MidiMessage>> midiBuffers; // empty, remote nodes are not using midi
+        uint maxFrames = 0;
+
+        void prepare(uint maxNodes, uint maxFrames); // not real time safe
+    };
+
+    // called from audio thread, return when all nodes are rendered in 'buffers.outputs'. The buffers must be prepared
+    void render(const std::vector<AudioNode *> &nodes, Buffers &buffers, const SamplesBuffer &in, uint channels, uint frames, int sampleRate);
+
+    static const uint MAX_WORKERS = 16;
+    static const uint MAX_NODES = 0xFFFF;
+
+private:
+    ParallelRenderer(const ParallelRenderer &other);
+    ParallelRenderer &operator=(const ParallelRenderer &other);
+
+    class Worker;
+
+    void renderPendingNodes(quint32 batchGeneration);
+    void waitRenderedNodes(uint count);
+    void runWorker();
+
+    static void pause(); // cpu hint used in spin loops
+
+    static quint32 getGeneration(quint64 claim);
+    static uint getNodesCount(quint64 claim);
+    static uint getNextNode(quint64 claim);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    // current batch, published when 'claim' is written with a new generation
+    const std::vector<AudioNode *> *nodes;
+    Buffers *buffers;
+    const SamplesBuffer *input;
+    uint channels;
+    uint frames;
+    int sampleRate;
+
+    // generation (32 bits), nodes count (16 bits) and next node index (16 bits). A worker waking up late
+    // can't claim a node in a newer batch, and the batch data is read only after claiming a node.
+    std::atomic<quint64> claim;
+    std::atomic<uint> renderedNodes;
+    std::atomic<uint> sleepingWorkers;
+    std::atomic<bool> stopRequested;
+
+    moodycamel::spsc_sema::LightweightSemaphore newBatchAvailable; // signaled when workers are sleeping
+
+    static const int SPIN_ITERATIONS = 20000; // spin before sleep, the next audio callback is probably close
+};
+
+inline uint ParallelRenderer::getWorkers() const
+{
+    return workers.size();
+}
+
+inline quint32 ParallelRenderer::getGeneration(quint64 claim)
+{
+    return static_cast<quint32>(claim >> 32);
+}
+
+inline uint ParallelRenderer::getNodesCount(quint64 claim)
+{
+    return static_cast<uint>((claim >> 16) & 0xFFFF);
+}
+
+inline uint ParallelRenderer::getNextNode(quint64 claim)
+{
+    return static_cast<uint>(claim & 0xFFFF);
+}
+
+} // namespace
+
+#endif // PARALLEL_RENDERER_H
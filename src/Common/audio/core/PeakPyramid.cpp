@@ -0,0 +1,120 @@
+#include "PeakPyramid.h"
+
+#include <algorithm>
+
+using audio::PeakPyramid;
+
+const PeakPyramid::Peak PeakPyramid::EMPTY_PEAK = { 0, 0, 0 };
+
+PeakPyramid::PeakPyramid()
+{
+
+}
+
+void PeakPyramid::resize(uint samples)
+{
+    uint buckets = (samples + BUCKET_SAMPLES - 1) / BUCKET_SAMPLES;
+    uint level = 0;
+    while (buckets > 0) {
+        if (level >= levels.size())
+            levels.push_back(std::vector<Peak>());
+
+        if (levels[level].size() < buckets)
+            levels[level].resize(buckets, EMPTY_PEAK);
+
+        if (buckets == 1)
+            break;
+
+        buckets = (buckets + 1) / 2;
+        level++;
+    }
+}
+
+void PeakPyramid::clear()
+{
+    for (auto &level : levels)
+        std::fill(level.begin(), level.end(), EMPTY_PEAK);
+}
+
+PeakPyramid::Peak PeakPyramid::merge(const Peak &a, const Peak &b)
+{
+    Peak peak;
+    peak.min = qMin(a.min, b.min);
+    peak.max = qMax(a.max, b.max);
+    peak.squares = a.squares + b.squares;
+    return peak;
+}
+
+void PeakPyramid::update(const float *left, const float *right, uint from, uint samples, uint availableSamples)
+{
+    if (!samples || levels.empty())
+        return;
+
+    auto &firstLevel = levels[0];
+    uint firstBucket = from / BUCKET_SAMPLES;
+    uint lastBucket = qMin(static_cast<uint>((from + samples - 1) / BUCKET_SAMPLES), static_cast<uint>(firstLevel.size() - 1));
+    if (firstBucket > lastBucket)
+        return;
+
+    for (uint b = firstBucket; b <= lastBucket; ++b) {
+        const uint begin = b * BUCKET_SAMPLES;
+        const uint end = qMin(begin + BUCKET_SAMPLES, availableSamples);
+
+        Peak peak = EMPTY_PEAK;
+        for (uint i = begin; i < end; ++i) {
+            peak.min = qMin(peak.min, qMin(left[i], right[i]));
+            peak.max = qMax(peak.max, qMax(left[i], right[i]));
+            peak.squares += (left[i] * left[i] + right[i] * right[i]) * 0.5f;
+        }
+        firstLevel[b] = peak;
+    }
+
+    // the changed buckets are merged in the next levels
+    for (size_t l = 1; l < levels.size(); ++l) {
+        const auto &children = levels[l - 1];
+        auto &level = levels[l];
+        firstBucket /= 2;
+        lastBucket /= 2;
+        for (uint b = firstBucket; b <= lastBucket && b < level.size(); ++b) {
+            const uint child = b * 2;
+            level[b] = (child + 1 < children.size()) ? merge(children[child], children[child + 1]) : children[child];
+        }
+    }
+}
+
+PeakPyramid::Peak PeakPyramid::getPeak(uint from, uint samples) const
+{
+    Peak peak = EMPTY_PEAK;
+    if (!samples || levels.empty())
+        return peak;
+
+    // bottom up range query, at most one bucket in each side of the range is merged in each level
+    uint lo = from / BUCKET_SAMPLES;
+    uint hi = qMin(static_cast<uint>((from + samples + BUCKET_SAMPLES - 1) / BUCKET_SAMPLES), static_cast<uint>(levels[0].size()));
+    for (size_t l = 0; l < levels.size() && lo < hi; ++l) {
+        const auto &level = levels[l];
+        if (lo & 1)
+            peak = merge(peak, level[lo++]);
+
+        if (hi & 1)
+            peak = merge(peak, level[--hi]);
+
+        lo /= 2;
+        hi /= 2;
+    }
+
+    return peak;
+}
+
+std::vector<float> PeakPyramid::getMaxPeaks(uint samplesPerPeak, uint availableSamples) const
+{
+    std::vector<float> peaks;
+    if (!samplesPerPeak)
+        return peaks;
+
+    peaks.reserve(availableSamples / samplesPerPeak + 1);
+    for (uint i = 0; i < availableSamples; i += samplesPerPeak)
+        peaks.push_back(getPeak(i, qMin(samplesPerPeak, availableSamples - i)).getMaxPeak());
+
+    return peaks;
+}
@@ -0,0 +1,58 @@
+#ifndef _AUDIO_PEAK_PYRAMID_
+#define _AUDIO_PEAK_PYRAMID_
+
+#include <QtGlobal>
+#include <vector>
+#include <cmath>
+
+namespace audio {
+
+/**
+ * Min/max/RMS summaries of a stereo sample buffer at power of two decimations (a mipmap). The first level
+ * summarizes every BUCKET_SAMPLES samples, each next level merges two buckets of the previous level.
+ *
+ * The summaries are updated incrementally when a range of samples change, and any range is queried merging
+ * at most two buckets in each level, so the peaks for any zoom or width are computed in O(pixels * levels)
+ * without reading the samples again. Ranges are rounded to BUCKET_SAMPLES.
+ */
+
+class PeakPyramid
+{
+public:
+    struct Peak
+    {
+        float min;
+        float max;
+        float squares; // sum of the squared samples, averaged in the two channels
+
+        float getMaxPeak() const { return qMax(-min, max); }
+        float getRms(uint samples) const { return samples ? std::sqrt(squares / samples) : 0.0f; }
+    };
+
+    PeakPyramid();
+
+    void resize(uint samples); // capacity, the summaries are kept
+    void clear();
+
+    // summarizes the changed samples, 'availableSamples' is the valid samples in the channels
+    void update(const float *left, const float *right, uint from, uint samples, uint availableSamples);
+
+    Peak getPeak(uint from, uint samples) const;
+
+    std::vector<float> getMaxPeaks(uint samplesPerPeak, uint availableSamples) const;
+
+    inline uint getLevels() const { return static_cast<uint>(levels.size()); }
+
+    static Peak merge(const Peak &a, const Peak &b);
+
+    static const uint BUCKET_SAMPLES = 64;
+
+private:
+    static const Peak EMPTY_PEAK;
+
+    std::vector<std::vector<Peak>> levels;
+};
+
+} // namespace
+
+#endif
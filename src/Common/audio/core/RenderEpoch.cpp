@@ -0,0 +1,68 @@
+#include "RenderEpoch.h"
+
+#include <QMutexLocker>
+#include <QThread>
+
+using audio::RenderEpoch;
+
+RenderEpoch::RenderEpoch() :
+    epoch(0)
+{
+
+}
+
+RenderEpoch::~RenderEpoch()
+{
+    for (auto &retiredObject : retiredObjects)
+        retiredObject.deleter();
+}
+
+void RenderEpoch::retire(std::function<void()> deleter)
+{
+    QMutexLocker locker(&retiredMutex);
+
+    retiredObjects.push_back({epoch, std::move(deleter)});
+}
+
+bool RenderEpoch::isQuiescentSince(quint64 retireEpoch) const
+{
+    // even epoch: the audio thread was outside the callback when the object was retired, and the next
+    // callbacks will load the new pointer. Odd epoch: wait until the running callback finish.
+    if (retireEpoch % 2 == 0)
+        return true;
+
+    return epoch > retireEpoch;
+}
+
+void RenderEpoch::reclaim()
+{
+    std::vector<std::function<void()>> deleters;
+
+    {
+        QMutexLocker locker(&retiredMutex);
+
+        auto it = retiredObjects.begin();
+        while (it != retiredObjects.end()) {
+            if (isQuiescentSince(it->epoch)) {
+                deleters.push_back(std::move(it->deleter));
+                it = retiredObjects.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    for (auto &deleter : deleters) // deleting outside the lock, deleters can retire other objects
+        deleter();
+}
+
+void RenderEpoch::synchronize()
+{
+    const quint64 current = epoch;
+    if (current % 2 == 0)
+        return; // outside the callback
+
+    while (epoch == current)
+        QThread::yieldCurrentThread();
+}
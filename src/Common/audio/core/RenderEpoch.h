@@ -0,0 +1,80 @@
+#ifndef RENDER_EPOCH_H
+#define RENDER_EPOCH_H
+
+#include <QtGlobal>
+#include <QMutex>
+
+#include <atomic>
+#include <functional>
+#include <vector>
+
+namespace audio {
+
+/**
+ * Deferred reclamation (RCU style) for objects read by the audio callback without locks.
+ *
+ * The audio thread wraps each callback in a Scope, the epoch is odd while the callback is running.
+ * Control threads publish new objects with an atomic pointer swap and retire the old ones. Retired
+ * objects are deleted by reclaim() (never in audio thread) when the audio thread can't be using them.
+ */
+
+class RenderEpoch
+{
+
+public:
+    RenderEpoch();
+    ~RenderEpoch(); // delete all retired objects, the audio thread must be stopped
+
+    class Scope
+    {
+    public:
+        explicit Scope(RenderEpoch &epoch);
+        ~Scope();
+
+    private:
+        RenderEpoch &epoch;
+    };
+
+    void retire(std::function<void()> deleter); // called after the old object is unpublished
+    void reclaim(); // run the deleters of objects the audio thread is not using anymore
+    void synchronize(); // wait until the running callback (if any) finish, the next callbacks see the unpublished objects as gone
+
+    quint64 getCurrent() const;
+
+private:
+    RenderEpoch(const RenderEpoch &other);
+    RenderEpoch &operator=(const RenderEpoch &other);
+
+    bool isQuiescentSince(quint64 retireEpoch) const;
+
+    struct RetiredObject
+    {
+        quint64 epoch;
+        std::function<void()> deleter;
+    };
+
+    std::atomic<quint64> epoch;
+
+    QMutex retiredMutex; // used by control threads only
+    std::vector<RetiredObject> retiredObjects;
+};
+
+inline RenderEpoch::Scope::Scope(RenderEpoch &epoch) :
+    epoch(epoch)
+{
+    epoch.epoch++; // odd, entering callback. Published pointers are loaded after this point
+}
+
+inline RenderEpoch::Scope::~Scope()
+{
+    epoch.epoch++; // even, leaving callback
+}
+
+inline quint64 RenderEpoch::getCurrent() const
+{
+    return epoch;
+}
+
+} // namespace
+
+#endif // RENDER_EPOCH_H
@@ -1,14 +1,56 @@
 #include "SamplesBuffer.h"
+#include "SamplesKernels.h"
 #include <QDebug>
 #include <cmath>
 #include <algorithm>
 #include <cstring>
+#include <cstdlib>
+#include <new>
+
+#if defined(Q_OS_WIN)
+    #include <malloc.h>
+#endif
 
 using audio::SamplesBuffer;
 using audio::AudioPeak;
 
 const SamplesBuffer SamplesBuffer::ZERO_BUFFER(1, 0);
 
+namespace {
+
+const unsigned int FRAMES_ALIGNMENT = SamplesBuffer::ALIGNMENT / sizeof(float); // every channel start is aligned
+
+unsigned int alignedFrames(unsigned int frames)
+{
+    return (frames + FRAMES_ALIGNMENT - 1) / FRAMES_ALIGNMENT * FRAMES_ALIGNMENT;
+}
+
+float *allocateSamples(size_t count)
+{
+    void *ptr = nullptr;
+#if defined(Q_OS_WIN)
+    ptr = _aligned_malloc(count * sizeof(float), SamplesBuffer::ALIGNMENT);
+#else
+    if (posix_memalign(&ptr, SamplesBuffer::ALIGNMENT, count * sizeof(float)) != 0)
+        ptr = nullptr;
+#endif
+    if (!ptr)
+        throw std::bad_alloc();
+
+    return static_cast<float *>(ptr);
+}
+
+void freeSamples(float *samples)
+{
+#if defined(Q_OS_WIN)
+    _aligned_free(samples);
+#else
+    std::free(samples);
+#endif
+}
+
+} // namespace
+
 SamplesBuffer::SamplesBuffer(unsigned int channels) :
     SamplesBuffer(channels, 0)
 {
@@ -17,26 +59,56 @@ SamplesBuffer::SamplesBuffer(unsigned int channels) :
 
 SamplesBuffer::SamplesBuffer(unsigned int channels, unsigned int frameLenght) :
     channels(channels),
-    frameLenght(frameLenght),
+    frameLenght(0),
     rmsRunningSum(0.0f),
     summedSamples(0),
-    rmsWindowSize(13230) // 300 ms in 44100 KHz
+    rmsWindowSize(13230), // 300 ms in 44100 KHz
+    data(nullptr),
+    stride(0),
+    capacity(0),
+    allocatedChannels(0),
+    startOffset(0),
+    initializedFrames(0),
+    ownsData(true)
 {
-    for (unsigned int c = 0; c < channels; ++c)
-        samples.emplace_back(frameLenght);
+    reallocate(channels, frameLenght);
+    setFrameLenght(frameLenght);
 
     squaredSums[0] = squaredSums[1] = 0.0f;
     lastRmsValues[0] = lastRmsValues[1] = 0.0f;
-    summedSamples = 0;
+}
+
+SamplesBuffer::SamplesBuffer(const SamplesBufferView &view) :
+    channels(view.getChannels()),
+    frameLenght(view.getFrameLenght()),
+    rmsRunningSum(0.0f),
+    summedSamples(0),
+    rmsWindowSize(13230),
+    data(view.getChannels() ? view.getSamplesArray(0) : nullptr),
+    stride(view.getStride()),
+    capacity(view.getFrameLenght()),
+    allocatedChannels(view.getChannels()),
+    startOffset(0),
+    initializedFrames(view.getFrameLenght()),
+    ownsData(false)
+{
+    squaredSums[0] = squaredSums[1] = 0.0f;
+    lastRmsValues[0] = lastRmsValues[1] = 0.0f;
 }
 
 SamplesBuffer::SamplesBuffer(const SamplesBuffer &other) :
-      channels(other.channels),
-      frameLenght(other.frameLenght),
-      rmsRunningSum(other.rmsRunningSum),
-      summedSamples(other.summedSamples),
-      rmsWindowSize(other.rmsWindowSize),
-      samples(other.samples)
+    channels(other.channels),
+    frameLenght(other.frameLenght),
+    rmsRunningSum(other.rmsRunningSum),
+    summedSamples(other.summedSamples),
+    rmsWindowSize(other.rmsWindowSize),
+    data(nullptr),
+    stride(0),
+    capacity(0),
+    allocatedChannels(0),
+    startOffset(0),
+    initializedFrames(0),
+    ownsData(true)
 {
     // qWarning() << "Samples Buffer copy constructor!";
     squaredSums[0] = other.squaredSums[0];
@@ -44,10 +116,24 @@ SamplesBuffer::SamplesBuffer(const SamplesBuffer &other) :
 
     lastRmsValues[0] = other.lastRmsValues[0];
     lastRmsValues[1] = other.lastRmsValues[1];
+
+    *this = other;
+}
+
+SamplesBuffer::SamplesBuffer(SamplesBuffer &&other) :
+    channels(0),
+    frameLenght(0),
+    data(nullptr),
+    ownsData(true)
+{
+    *this = std::move(other);
 }
 
 SamplesBuffer &SamplesBuffer::operator=(const SamplesBuffer &other)
 {
+    if (this == &other)
+        return *this;
+
     this->channels = other.channels;
     this->frameLenght = other.frameLenght;
     this->rmsRunningSum = other.rmsRunningSum;
@@ -60,12 +146,147 @@ SamplesBuffer &SamplesBuffer::operator=(const SamplesBuffer &other)
     lastRmsValues[0] = other.lastRmsValues[0];
     lastRmsValues[1] = other.lastRmsValues[1];
 
-    this->samples = other.samples;
+    // only the valid samples are copied, the frames after frameLenght are zeroed if the buffer grows again
+    const unsigned int framesToCopy = other.frameLenght;
+
+    // reusing the current block when it is big enough
+    unsigned int previouslyInitialized = 0;
+    if (!ownsData || allocatedChannels < other.channels || capacity < framesToCopy) {
+        release();
+        stride = alignedFrames(framesToCopy);
+        capacity = stride;
+        allocatedChannels = other.channels;
+        data = (allocatedChannels && stride) ? allocateSamples(allocatedChannels * stride) : nullptr;
+        ownsData = true;
+    } else {
+        previouslyInitialized = startOffset ? 0 : initializedFrames;
+    }
+
+    startOffset = 0;
+    initializedFrames = framesToCopy;
+
+    if (framesToCopy) {
+        for (unsigned int c = 0; c < other.channels; ++c)
+            std::memcpy(channelData(c), other.channelData(c), framesToCopy * sizeof(float));
+
+        // unused channels can be out of date, but they are initialized
+        if (previouslyInitialized < framesToCopy) {
+            for (unsigned int c = other.channels; c < allocatedChannels; ++c)
+                std::memset(channelData(c) + previouslyInitialized, 0, (framesToCopy - previouslyInitialized) * sizeof(float));
+        }
+    }
 
     return *this;
 }
 
-SamplesBuffer::~SamplesBuffer() = default;
+SamplesBuffer &SamplesBuffer::operator=(SamplesBuffer &&other)
+{
+    if (this == &other)
+        return *this;
+
+    release();
+
+    channels = other.channels;
+    frameLenght = other.frameLenght;
+    rmsRunningSum = other.rmsRunningSum;
+    rmsWindowSize = other.rmsWindowSize;
+    summedSamples = other.summedSamples;
+
+    squaredSums[0] = other.squaredSums[0];
+    squaredSums[1] = other.squaredSums[1];
+
+    lastRmsValues[0] = other.lastRmsValues[0];
+    lastRmsValues[1] = other.lastRmsValues[1];
+
+    data = other.data;
+    stride = other.stride;
+    capacity = other.capacity;
+    allocatedChannels = other.allocatedChannels;
+    startOffset = other.startOffset;
+    initializedFrames = other.initializedFrames;
+    ownsData = other.ownsData;
+
+    // the moved buffer is empty but still usable
+    other.data = nullptr;
+    other.stride = other.capacity = 0;
+    other.allocatedChannels = 0;
+    other.channels = 0;
+    other.frameLenght = 0;
+    other.startOffset = other.initializedFrames = 0;
+    other.ownsData = true;
+
+    return *this;
+}
+
+SamplesBuffer::~SamplesBuffer()
+{
+    release();
+}
+
+void SamplesBuffer::release()
+{
+    if (ownsData && data)
+        freeSamples(data);
+
+    data = nullptr;
+}
+
+void SamplesBuffer::reallocate(unsigned int newChannels, unsigned int newCapacity)
+{
+    const unsigned int newStride = alignedFrames(newCapacity);
+    float *newData = (newChannels && newStride) ? allocateSamples(newChannels * newStride) : nullptr;
+
+    const unsigned int framesToKeep = std::min(initializedFrames - startOffset, newStride);
+    if (framesToKeep) {
+        for (unsigned int c = 0; c < newChannels; ++c) {
+            float *dest = newData + c * newStride;
+            if (c < allocatedChannels)
+                std::memcpy(dest, channelData(c), framesToKeep * sizeof(float));
+            else
+                std::memset(dest, 0, framesToKeep * sizeof(float));
+        }
+    }
+
+    release();
+
+    data = newData;
+    stride = newStride;
+    capacity = newStride;
+    allocatedChannels = newChannels;
+    startOffset = 0;
+    initializedFrames = framesToKeep;
+    ownsData = true;
+}
+
+void SamplesBuffer::compact()
+{
+    Q_ASSERT(ownsData);
+
+    if (!startOffset)
+        return;
+
+    const unsigned int framesToMove = initializedFrames - startOffset;
+    if (framesToMove) {
+        for (unsigned int c = 0; c < allocatedChannels; ++c)
+            std::memmove(data + c * stride, channelData(c), framesToMove * sizeof(float));
+    }
+
+    initializedFrames = framesToMove;
+    startOffset = 0;
+}
+
+void SamplesBuffer::ensureInitialized(unsigned int frames)
+{
+    Q_ASSERT(frames <= capacity);
+
+    if (frames <= initializedFrames)
+        return;
+
+    for (unsigned int c = 0; c < allocatedChannels; ++c)
+        std::memset(data + c * stride + initializedFrames, 0, (frames - initializedFrames) * sizeof(float));
+
+    initializedFrames = frames;
+}
 
 void SamplesBuffer::setRmsWindowSize(int samples)
 {
@@ -77,18 +298,18 @@ void SamplesBuffer::invertStereo()
     if (channels != 2)
         return; // trying invert a non stereo buffer
 
-    std::iter_swap(samples.begin(), samples.begin() + 1); // swap first and second channels
+    std::swap_ranges(channelData(0), channelData(0) + frameLenght, channelData(1)); // swap first and second channels
 }
 
 void SamplesBuffer::discardFirstSamples(unsigned int samplesToDiscard)
 {
-    int toDiscard = std::min(frameLenght, samplesToDiscard);
-    int toCopy = frameLenght - toDiscard;
-    uint newFrameLenght = frameLenght - toDiscard;
-    for (uint c = 0; c < channels; ++c) {
-        std::copy_n(samples[c].begin() + toDiscard, toCopy, samples[c].begin());
-    }
-    setFrameLenght(newFrameLenght);
+    // samples are not moved, the next append() or setFrameLenght() will compact the buffer if necessary
+    const uint toDiscard = std::min(frameLenght, samplesToDiscard);
+    startOffset += toDiscard;
+    frameLenght -= toDiscard;
+
+    if (!frameLenght)
+        startOffset = 0; // all samples discarded, rewinding is cheap
 }
 
 void SamplesBuffer::append(const SamplesBuffer &other)
@@ -101,74 +322,91 @@ void SamplesBuffer::append(const SamplesBuffer &other)
 
 float *SamplesBuffer::getSamplesArray(unsigned int channel) const
 {
-    Q_ASSERT(channel < samples.size());
+    Q_ASSERT(channel < allocatedChannels);
 
-    return const_cast<float *>(&(samples[channel][0]));
+    return channelData(channel);
 }
 
 void SamplesBuffer::applyGain(float gainFactor, float boostFactor)
 {
     const float scaleFactor = gainFactor * boostFactor;
-    for (unsigned int c = 0; c < channels; ++c) {
-        for (unsigned int i = 0; i < frameLenght; ++i)
-            samples[c][i] *= scaleFactor;
-    }
+    const auto &kernels = audio::kernels::get();
+    for (unsigned int c = 0; c < channels; ++c)
+        kernels.scale(channelData(c), frameLenght, scaleFactor);
 }
 
 void SamplesBuffer::fadeOut(int fadeFrameLenght, float endGain)
 {
     uint lenght = std::min(fadeFrameLenght, (int)frameLenght);
+    if (!lenght)
+        return;
+
     float gainStep = (1 - endGain)/lenght;
-    for (unsigned int c = 0; c < channels; ++c) {
-        float gain = 1;
-        for (unsigned int s = 0; s < lenght; ++s) {
-            samples[c][s] *= gain;
-            gain -= gainStep;
-        }
-    }
+    const auto &kernels = audio::kernels::get();
+    for (unsigned int c = 0; c < channels; ++c)
+        kernels.ramp(channelData(c), lenght, 1.0f, -gainStep);
 }
 
 void SamplesBuffer::fadeIn(int fadeFrameLenght, float beginGain)
 {
     uint lenght = std::min(fadeFrameLenght, (int)frameLenght);
+    if (!lenght)
+        return;
+
     float gainStep = (1 - beginGain)/lenght;
-    for (unsigned int c = 0; c < channels; ++c) {
-        float gain = beginGain;
-        for (unsigned int s = 0; s < lenght; ++s) {
-            samples[c][s] *= gain;
-            gain += gainStep;
-        }
-    }
+    const auto &kernels = audio::kernels::get();
+    for (unsigned int c = 0; c < channels; ++c)
+        kernels.ramp(channelData(c), lenght, beginGain, gainStep);
 }
 
 void SamplesBuffer::fade(float beginGain, float endGain)
 {
+    if (!frameLenght)
+        return;
+
     float gainStep = (endGain - beginGain)/frameLenght;
-    for (unsigned int c = 0; c < channels; ++c) {
-        float gain = beginGain;
-        for (unsigned int s = 0; s < frameLenght; ++s) {
-            samples[c][s] *= gain;
-            gain += gainStep;
-        }
-    }
+    const auto &kernels = audio::kernels::get();
+    for (unsigned int c = 0; c < channels; ++c)
+        kernels.ramp(channelData(c), frameLenght, beginGain, gainStep);
 }
 
 void SamplesBuffer::applyGain(float gainFactor, float leftGain, float rightGain, float boostFactor)
 {
     if (!isMono()) {
         float commonGain = gainFactor * boostFactor;
-        float finalLeftGain = commonGain * leftGain;
-        float finalRightGain = commonGain * rightGain;
-        for (unsigned int i = 0; i < frameLenght; ++i) {
-            samples[0][i] *= finalLeftGain;
-            samples[1][i] *= finalRightGain;
-        }
+        const auto &kernels = audio::kernels::get();
+        kernels.scale(channelData(0), frameLenght, commonGain * leftGain);
+        kernels.scale(channelData(1), frameLenght, commonGain * rightGain);
     }
     else {
         applyGain(gainFactor, boostFactor);
     }
 }
 
+AudioPeak SamplesBuffer::applyGainAndComputePeak(float gainFactor, float leftGain, float rightGain, float boostFactor)
+{
+    if (channels == 0)
+        return AudioPeak();
+
+    const float commonGain = gainFactor * boostFactor;
+    const auto &kernels = audio::kernels::get();
+
+    float maxPeaks[2] = {0};
+    float squares[2] = {0};
+    if (!isMono()) {
+        maxPeaks[0] = kernels.scaleAndPeak(channelData(0), frameLenght, commonGain * leftGain, &squares[0]);
+        maxPeaks[1] = kernels.scaleAndPeak(channelData(1), frameLenght, commonGain * rightGain, &squares[1]);
+
+        for (unsigned int c = 2; c < channels; ++c) // extra channels are not metered
+            kernels.scale(channelData(c), frameLenght, commonGain);
+    }
+    else {
+        maxPeaks[0] = kernels.scaleAndPeak(channelData(0), frameLenght, commonGain, &squares[0]);
+    }
+
+    return updatePeaks(maxPeaks, squares);
+}
+
 void SamplesBuffer::zero()
 {
     if (!frameLenght)
@@ -176,33 +414,29 @@ void SamplesBuffer::zero()
 
     const uint bytesToProcess = frameLenght * sizeof(float);
     for (unsigned int c = 0; c < channels; ++c) {
-        Q_ASSERT(samples[c].size() >= frameLenght);
-        memset(&(samples[c][0]), 0, bytesToProcess);
+        memset(channelData(c), 0, bytesToProcess);
     }
 }
 
 AudioPeak SamplesBuffer::computePeak()
 {
-    float abs; // max peak absolute value
     float maxPeaks[2] = {0};// left and right peaks
-	unsigned maxChan = isMono() ? 1 : channels; // don't loop and mul/add twice if only one channel
+    float squares[2] = {0};
+    unsigned maxChan = isMono() ? 1 : 2; // don't loop and mul/add twice if only one channel, only the first 2 channels are metered
 
-    for (unsigned int c = 0; c < maxChan; ++c) {
-        float maxPeak = 0;
-		const std::vector<float>& chanSamples = samples[c]; // optimize costly stl vector access out of the inner loop
-        for (unsigned int i = 0; i < frameLenght; ++i) {
-            // max peak
-            abs = chanSamples[i]; // access inner std:svector array only once, use it for square value below
-			if(abs<0) abs = -abs; // std::fabs is very slow, just negate if needed
+    const auto &kernels = audio::kernels::get();
+    for (unsigned int c = 0; c < maxChan && c < channels; ++c)
+        maxPeaks[c] = kernels.peak(channelData(c), frameLenght, &squares[c]);
 
-            if (abs > maxPeak) maxPeak = abs;
+    return updatePeaks(maxPeaks, squares);
+}
 
-            // rms running squared sum
-            squaredSums[c] += abs * abs; // squaring every sample and summing
-        }
-		maxPeaks[c] = maxPeak;
-        summedSamples += frameLenght;
-    }
+AudioPeak SamplesBuffer::updatePeaks(float maxPeaks[2], const float squares[2])
+{
+    // rms running squared sum
+    squaredSums[0] += squares[0];
+    squaredSums[1] += squares[1];
+    summedSamples += isMono() ? frameLenght : frameLenght * 2;
 
     if (isMono()) {
         maxPeaks[1] = maxPeaks[0];
@@ -229,57 +463,48 @@ int SamplesBuffer::computeRmsWindowSize(int sampleRate, int windowTimeInMs)
 void SamplesBuffer::add(const SamplesBuffer &buffer, int internalWriteOffset)
 {
 	const uint framesToProcess = std::min(static_cast<uint>(frameLenght), buffer.getFrameLenght());
+    if (!framesToProcess)
+        return;
 
+    const auto &kernels = audio::kernels::get();
     if (buffer.channels >= channels) {
         for (unsigned int c = 0; c < channels; ++c) {
-	        auto& chanSamples = samples[c]; // save costly loop access to vector sub float array
-			const auto& bufChanSamples = buffer.samples[c]; // save costly loop access to vector sub float array
-
-            for (unsigned int s = 0; s < framesToProcess; ++s) {
-                Q_ASSERT(s + internalWriteOffset < chanSamples.size());
-                chanSamples[s + internalWriteOffset] += bufChanSamples[s];
-            }
+            Q_ASSERT(startOffset + internalWriteOffset + framesToProcess <= initializedFrames);
+            kernels.add(channelData(c) + internalWriteOffset, buffer.channelData(c), framesToProcess);
         }
     }
     else { // samples is stereo and buffer is mono
-	    auto& chanSamples0 = samples[0]; // save costly loop access to vector sub float array
-	    auto& chanSamples1 = samples[1]; // save costly loop access to vector sub float array
-		const auto& bufChanSamples0 = buffer.samples[0]; // save costly loop access to vector sub float array
-
-        for (unsigned int s = 0; s < framesToProcess; ++s) {
-            Q_ASSERT(s + internalWriteOffset < chanSamples0.size());
-            Q_ASSERT(s + internalWriteOffset < chanSamples1.size());
-	        const auto monoBufferSampleAtIndex  = bufChanSamples0[s];
-            chanSamples0[s + internalWriteOffset] += monoBufferSampleAtIndex;
-            chanSamples1[s + internalWriteOffset] += monoBufferSampleAtIndex;
-        }
+        Q_ASSERT(channels >= 2 && startOffset + internalWriteOffset + framesToProcess <= initializedFrames);
+        const float *monoSamples = buffer.channelData(0);
+        kernels.add(channelData(0) + internalWriteOffset, monoSamples, framesToProcess);
+        kernels.add(channelData(1) + internalWriteOffset, monoSamples, framesToProcess);
     }
 }
 
 void SamplesBuffer::add(uint channel, float *samples, uint samplesToAdd)
 {
-    Q_ASSERT(channel < channels && channels == this->samples.size());
-    Q_ASSERT(samplesToAdd <= frameLenght && samplesToAdd <= this->samples[channel].size());
+    Q_ASSERT(channel < channels);
+    Q_ASSERT(samplesToAdd <= frameLenght);
 
-    void *dest = &(this->samples[channel][0]);
+    void *dest = channelData(channel);
     const uint bytesToCopy = std::min(static_cast<uint>(frameLenght), samplesToAdd) * sizeof(float);
     memcpy(dest, samples, bytesToCopy);
 }
 
 void SamplesBuffer::add(uint channel, uint sampleIndex, float sampleValue)
 {
-    Q_ASSERT(channel < channels && channels == samples.size());
-    Q_ASSERT(sampleIndex < samples[channel].size());
+    Q_ASSERT(channel < channels);
+    Q_ASSERT(startOffset + sampleIndex < initializedFrames);
 
-    samples[channel][sampleIndex] += sampleValue;
+    channelData(channel)[sampleIndex] += sampleValue;
 }
 
 void SamplesBuffer::set(uint channel, uint sampleIndex, float sampleValue)
 {
-    Q_ASSERT(channel < channels && channels <= samples.size());
-    Q_ASSERT(sampleIndex < samples[channel].size());
+    Q_ASSERT(channel < channels);
+    Q_ASSERT(startOffset + sampleIndex < initializedFrames);
 
-    samples[channel][sampleIndex] = sampleValue;
+    channelData(channel)[sampleIndex] = sampleValue;
 }
 
 void SamplesBuffer::setToMono()
@@ -290,16 +515,16 @@ void SamplesBuffer::setToMono()
 
 void SamplesBuffer::setToStereo()
 {
-    if (this->samples.size() < 2) {
-        size_t channelsToAdd = 2 - this->samples.size();
-        for (uint c = 0; c < channelsToAdd; ++c)
-            samples.push_back(std::vector<float>(frameLenght));
-    }
+    setChannels(2);
+}
 
-    for (unsigned int c = 0; c < samples.size(); ++c)
-        samples[c].resize(frameLenght);
+void SamplesBuffer::setChannels(unsigned int newChannels)
+{
+    if (newChannels > allocatedChannels)
+        reallocate(newChannels, std::max(capacity, startOffset + frameLenght));
 
-    this->channels = 2;
+    // unused channels can be out of date, but they are initialized
+    this->channels = newChannels;
 }
 
 void SamplesBuffer::set(const SamplesBuffer &buffer)
@@ -310,9 +535,9 @@ void SamplesBuffer::set(const SamplesBuffer &buffer)
 float SamplesBuffer::get(uint channel, uint sampleIndex) const
 {
     Q_ASSERT(channel < channels);
-    Q_ASSERT(sampleIndex < samples[channel].capacity());
+    Q_ASSERT(startOffset + sampleIndex < initializedFrames);
 
-    return samples[channel][sampleIndex];
+    return channelData(channel)[sampleIndex];
 }
 
 void SamplesBuffer::setFrameLenght(unsigned int newFrameLenght)
@@ -320,10 +545,14 @@ void SamplesBuffer::setFrameLenght(unsigned int newFrameLenght)
     if (newFrameLenght == frameLenght)
         return;
 
-    if (newFrameLenght > frameLenght) {
-        for (unsigned int c = 0; c < channels; ++c)
-            samples[c].resize(newFrameLenght);
+    if (startOffset + newFrameLenght > capacity) {
+        if (ownsData && newFrameLenght <= capacity)
+            compact();
+        else
+            reallocate(allocatedChannels, std::max(newFrameLenght, capacity + capacity / 2)); // growing 50% to amortize appends
     }
+
+    ensureInitialized(startOffset + newFrameLenght); // samples after the old frame lenght are preserved
     this->frameLenght = newFrameLenght;
 }
 
@@ -353,8 +582,11 @@ void SamplesBuffer::set(const SamplesBuffer &buffer, uint bufferOffset, uint sam
     if (framesToProcess + bufferOffset > buffer.frameLenght) // fixing bug in some built-in metronome sounds
         return ;
 
+    if (internalOffset >= frameLenght)
+        return;
+
     if ((uint)(internalOffset + framesToProcess) > this->getFrameLenght())
-        framesToProcess = (internalOffset + framesToProcess) - this->getFrameLenght();
+        framesToProcess = frameLenght - internalOffset; // don't write after the last sample
 
     const uint bytesToProcess = framesToProcess * sizeof(float);
     if (!bytesToProcess)
@@ -362,7 +594,7 @@ void SamplesBuffer::set(const SamplesBuffer &buffer, uint bufferOffset, uint sam
 
     if (channels == buffer.channels) {// channels number are equal
         for (unsigned int c = 0; c < channels; ++c) {
-            std::memcpy(&(samples[c][internalOffset]), &(buffer.samples[c][bufferOffset]), bytesToProcess);
+            std::memcpy(channelData(c) + internalOffset, buffer.channelData(c) + bufferOffset, bytesToProcess);
         }
     }
     else { // different number of channels
@@ -370,21 +602,19 @@ void SamplesBuffer::set(const SamplesBuffer &buffer, uint bufferOffset, uint sam
             if (!buffer.isMono()) {
                 int channelsToCopy = qMin(channels, buffer.channels);
                 for (int c = 0; c < channelsToCopy; ++c) {
-                    Q_ASSERT(internalOffset < samples[c].size());
-                    Q_ASSERT(bufferOffset < buffer.samples[c].size());
-                    Q_ASSERT(bufferOffset + framesToProcess < buffer.samples[c].size());
-                    Q_ASSERT(internalOffset + framesToProcess < samples[c].size());
-                    std::memcpy(&(samples[c][internalOffset]), &(buffer.samples[c][bufferOffset]), bytesToProcess);
+                    Q_ASSERT(bufferOffset + framesToProcess <= buffer.frameLenght);
+                    Q_ASSERT(internalOffset + framesToProcess <= frameLenght);
+                    std::memcpy(channelData(c) + internalOffset, buffer.channelData(c) + bufferOffset, bytesToProcess);
                 }
             } else {
-                std::memcpy(&(samples[0][internalOffset]), &(buffer.samples[0][bufferOffset]), bytesToProcess);
-                std::memcpy(&(samples[1][internalOffset]), &(buffer.samples[0][bufferOffset]), bytesToProcess);
+                std::memcpy(channelData(0) + internalOffset, buffer.channelData(0) + bufferOffset, bytesToProcess);
+                std::memcpy(channelData(1) + internalOffset, buffer.channelData(0) + bufferOffset, bytesToProcess);
             }
         } else { // this buffer is mono, but the buffer in parameter is not! Mix down the stereo samples in one mono sample value.
             for (unsigned int s = 0; s < framesToProcess; ++s) {
                 const int index = s + bufferOffset;
-                float v = (buffer.samples[0][index] + buffer.samples[1][index])/2.0f;
-                samples[0][s + internalOffset] = v;
+                float v = (buffer.channelData(0)[index] + buffer.channelData(1)[index])/2.0f;
+                channelData(0)[s + internalOffset] = v;
             }
         }
     }
@@ -2,7 +2,7 @@
 #define SAMPLESBUFFER_H
 
 #include "AudioPeak.h"
-#include <vector>
+#include "SamplesBufferView.h"
 
 #include <QtGlobal>
 
@@ -23,13 +23,31 @@ private:
     int rmsWindowSize; // how many samples until have enough data to compute rms?
     float lastRmsValues[2];
 
-    std::vector<std::vector<float>> samples;
+    // all channels are stored in a single aligned block, channel 'c' starts at data + c * stride
+    float *data;
+    unsigned int stride;
+    unsigned int capacity; // frames available in each channel
+    unsigned int allocatedChannels;
+    unsigned int startOffset; // discarded samples are skipped moving this offset, the block is compacted only when needed
+    unsigned int initializedFrames; // frames (counting from the block start) written at least one time, the next frames are zeroed before use
+    bool ownsData; // false when wrapping a SamplesBufferView
+
+    audio::AudioPeak updatePeaks(float maxPeaks[2], const float squares[2]); // update rms running sums
+
+    float *channelData(unsigned int channel) const; // first valid sample in the channel
+    void reallocate(unsigned int newChannels, unsigned int newCapacity); // keep the valid samples, reset startOffset
+    void compact(); // move the valid samples to the block start
+    void ensureInitialized(unsigned int frames);
+    void release();
 
 public:
     explicit SamplesBuffer(unsigned int channels);
     explicit SamplesBuffer(unsigned int channels, unsigned int frameLenght);
+    explicit SamplesBuffer(const SamplesBufferView &view); // not owning, the samples are copied only if the buffer grows
     SamplesBuffer(const SamplesBuffer &other);
+    SamplesBuffer(SamplesBuffer &&other);
     SamplesBuffer &operator=(const SamplesBuffer &other);
+    SamplesBuffer &operator=(SamplesBuffer &&other);
     ~SamplesBuffer();
 
     void setRmsWindowSize(int samples);
@@ -41,6 +59,11 @@ public:
 
     float *getSamplesArray(unsigned int channel) const;
 
+    SamplesBufferView getView() const;
+    SamplesBufferView getView(unsigned int offset, unsigned int frames) const;
+
+    static const unsigned int ALIGNMENT = 64; // in bytes, enough for AVX and cache line size
+
     void discardFirstSamples(unsigned int samplesToDiscard); // discard N samples and set frame lenght to new size
     void append(const SamplesBuffer &other);
 
@@ -54,10 +77,15 @@ public:
     // panValue between [-1, 0, 1] => LEFT, CENTER, RIGHT
     void applyGain(float gainFactor, float leftGain, float rightGain, float boostFactor);
 
+    // applyGain() and computePeak() in a single pass, every sample is touched just one time. The pan gains are
+    // used in the first 2 channels, the extra channels (not metered) are scaled by gain and boost like in applyGain(gain, boost)
+    audio::AudioPeak applyGainAndComputePeak(float gainFactor, float leftGain, float rightGain, float boostFactor);
+
     void zero();
 
     void setToMono();
     void setToStereo();
+    void setChannels(unsigned int newChannels); // only allocates when growing beyond the channels used before
 
     void invertStereo();
 
@@ -80,6 +108,8 @@ public:
     unsigned int getFrameLenght() const;
     void setFrameLenght(unsigned int newFrameLenght);
 
+    unsigned int getCapacity() const; // frames available in each channel before allocate
+
     int getChannels() const;
 
     bool isEmpty() const;
@@ -111,6 +141,26 @@ inline unsigned int SamplesBuffer::getFrameLenght() const
     return frameLenght;
 }
 
+inline unsigned int SamplesBuffer::getCapacity() const
+{
+    return capacity - startOffset;
+}
+
+inline float *SamplesBuffer::channelData(unsigned int channel) const
+{
+    return data + channel * stride + startOffset;
+}
+
+inline SamplesBufferView SamplesBuffer::getView() const
+{
+    return SamplesBufferView(data ? channelData(0) : nullptr, channels, frameLenght, stride);
+}
+
+inline SamplesBufferView SamplesBuffer::getView(unsigned int offset, unsigned int frames) const
+{
+    return getView().subView(offset, frames);
+}
+
 } // namespace
 
 #endif // SAMPLESBUFFER_H
@@ -0,0 +1,94 @@
+#ifndef SAMPLES_BUFFER_VIEW_H
+#define SAMPLES_BUFFER_VIEW_H
+
+#include <QtGlobal>
+#include <algorithm>
+
+namespace audio {
+
+/**
+ * Non owning window over planar samples stored in a single block, channel 'c' starts at
+ * data + c * stride. Views are cheap to copy and are used to pass a range of a SamplesBuffer
+ * without copying the samples. The viewed buffer must outlive the view.
+ */
+
+class SamplesBufferView
+{
+
+public:
+    SamplesBufferView();
+    SamplesBufferView(float *data, uint channels, uint frameLenght, uint stride);
+
+    float *getSamplesArray(uint channel) const;
+
+    uint getChannels() const;
+    uint getFrameLenght() const;
+    uint getStride() const;
+
+    bool isEmpty() const;
+
+    SamplesBufferView subView(uint offset, uint frames) const; // clipped to the viewed range
+
+private:
+    float *data;
+    uint channels;
+    uint frameLenght;
+    uint stride;
+};
+
+inline SamplesBufferView::SamplesBufferView() :
+    data(nullptr),
+    channels(0),
+    frameLenght(0),
+    stride(0)
+{
+
+}
+
+inline SamplesBufferView::SamplesBufferView(float *data, uint channels, uint frameLenght, uint stride) :
+    data(data),
+    channels(channels),
+    frameLenght(frameLenght),
+    stride(stride)
+{
+    Q_ASSERT(channels <= 1 || frameLenght <= stride);
+}
+
+inline float *SamplesBufferView::getSamplesArray(uint channel) const
+{
+    Q_ASSERT(channel < channels);
+
+    return data + channel * stride;
+}
+
+inline uint SamplesBufferView::getChannels() const
+{
+    return channels;
+}
+
+inline uint SamplesBufferView::getFrameLenght() const
+{
+    return frameLenght;
+}
+
+inline uint SamplesBufferView::getStride() const
+{
+    return stride;
+}
+
+inline bool SamplesBufferView::isEmpty() const
+{
+    return frameLenght == 0;
+}
+
+inline SamplesBufferView SamplesBufferView::subView(uint offset, uint frames) const
+{
+    offset = std::min(offset, frameLenght);
+    frames = std::min(frames, frameLenght - offset);
+
+    return SamplesBufferView(data ? data + offset : nullptr, channels, frames, stride);
+}
+
+} // namespace
+
+#endif // SAMPLES_BUFFER_VIEW_H
@@ -0,0 +1,602 @@
+#include "SamplesKernels.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #define JT_KERNELS_X86
+    #include <immintrin.h>
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+        #define JT_TARGET_SSE2
+        #define JT_TARGET_AVX2
+    #else
+        #define JT_TARGET_SSE2 __attribute__((target("sse2")))
+        #define JT_TARGET_AVX2 __attribute__((target("avx2")))
+    #endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+    #define JT_KERNELS_NEON
+    #include <arm_neon.h>
+#endif
+
+using audio::kernels::Kernels;
+using audio::kernels::InstructionSet;
+
+namespace {
+
+// ++++++++++++++++++++ SCALAR (reference implementation) ++++++++++++++++++++
+
+void scaleScalar(float *samples, uint count, float gain)
+{
+    for (uint i = 0; i < count; ++i)
+        samples[i] *= gain;
+}
+
+void rampScalar(float *samples, uint count, float beginGain, float gainStep)
+{
+    float gain = beginGain;
+    for (uint i = 0; i < count; ++i) {
+        samples[i] *= gain;
+        gain += gainStep;
+    }
+}
+
+void addScalar(float *dest, const float *source, uint count)
+{
+    for (uint i = 0; i < count; ++i)
+        dest[i] += source[i];
+}
+
+void mixScalar(float *dest, const float *source, uint count, float gain)
+{
+    for (uint i = 0; i < count; ++i)
+        dest[i] += source[i] * gain;
+}
+
+float peakScalar(const float *samples, uint count, float *squaredSum)
+{
+    float maxPeak = 0;
+    float squares = 0;
+    for (uint i = 0; i < count; ++i) {
+        float abs = samples[i];
+        if (abs < 0) abs = -abs; // std::fabs is very slow, just negate if needed
+
+        if (abs > maxPeak) maxPeak = abs;
+
+        squares += abs * abs;
+    }
+
+    *squaredSum = squares;
+    return maxPeak;
+}
+
+float scaleAndPeakScalar(float *samples, uint count, float gain, float *squaredSum)
+{
+    float maxPeak = 0;
+    float squares = 0;
+    for (uint i = 0; i < count; ++i) {
+        const float value = samples[i] * gain;
+        samples[i] = value;
+
+        const float abs = value < 0 ? -value : value;
+        if (abs > maxPeak) maxPeak = abs;
+
+        squares += abs * abs;
+    }
+
+    *squaredSum = squares;
+    return maxPeak;
+}
+
+float dotScalar(const float *a, const float *b, uint count)
+{
+    float sum = 0;
+    for (uint i = 0; i < count; ++i)
+        sum += a[i] * b[i];
+
+    return sum;
+}
+
+const Kernels SCALAR_KERNELS = {
+    InstructionSet::Scalar,
+    scaleScalar,
+    rampScalar,
+    addScalar,
+    mixScalar,
+    peakScalar,
+    scaleAndPeakScalar,
+    dotScalar
+};
+
+#ifdef JT_KERNELS_X86
+
+// ++++++++++++++++++++ SSE2 ++++++++++++++++++++
+
+JT_TARGET_SSE2 float horizontalMaxSSE2(__m128 values)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, values);
+    float maxValue = lanes[0];
+    for (int i = 1; i < 4; ++i) {
+        if (lanes[i] > maxValue) maxValue = lanes[i];
+    }
+    return maxValue;
+}
+
+JT_TARGET_SSE2 float horizontalSumSSE2(__m128 values)
+{
+    float lanes[4];
+    _mm_storeu_ps(lanes, values);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+JT_TARGET_SSE2 void scaleSSE2(float *samples, uint count, float gain)
+{
+    const __m128 gains = _mm_set1_ps(gain);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gains));
+
+    scaleScalar(samples + i, count - i, gain);
+}
+
+JT_TARGET_SSE2 void rampSSE2(float *samples, uint count, float beginGain, float gainStep)
+{
+    __m128 gains = _mm_set_ps(beginGain + 3 * gainStep, beginGain + 2 * gainStep, beginGain + gainStep, beginGain);
+    const __m128 increment = _mm_set1_ps(4 * gainStep);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        _mm_storeu_ps(samples + i, _mm_mul_ps(_mm_loadu_ps(samples + i), gains));
+        gains = _mm_add_ps(gains, increment);
+    }
+
+    rampScalar(samples + i, count - i, beginGain + i * gainStep, gainStep);
+}
+
+JT_TARGET_SSE2 void addSSE2(float *dest, const float *source, uint count)
+{
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_loadu_ps(source + i)));
+
+    addScalar(dest + i, source + i, count - i);
+}
+
+JT_TARGET_SSE2 void mixSSE2(float *dest, const float *source, uint count, float gain)
+{
+    const __m128 gains = _mm_set1_ps(gain);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 scaled = _mm_mul_ps(_mm_loadu_ps(source + i), gains);
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), scaled));
+    }
+
+    mixScalar(dest + i, source + i, count - i, gain);
+}
+
+JT_TARGET_SSE2 float peakSSE2(const float *samples, uint count, float *squaredSum)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    __m128 maxPeaks = _mm_setzero_ps();
+    __m128 squares = _mm_setzero_ps();
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 abs = _mm_and_ps(_mm_loadu_ps(samples + i), absMask);
+        maxPeaks = _mm_max_ps(maxPeaks, abs);
+        squares = _mm_add_ps(squares, _mm_mul_ps(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxSSE2(maxPeaks), peakScalar(samples + i, count - i, &tailSquares));
+    *squaredSum = horizontalSumSSE2(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+JT_TARGET_SSE2 float scaleAndPeakSSE2(float *samples, uint count, float gain, float *squaredSum)
+{
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    const __m128 gains = _mm_set1_ps(gain);
+    __m128 maxPeaks = _mm_setzero_ps();
+    __m128 squares = _mm_setzero_ps();
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const __m128 values = _mm_mul_ps(_mm_loadu_ps(samples + i), gains);
+        _mm_storeu_ps(samples + i, values);
+
+        const __m128 abs = _mm_and_ps(values, absMask);
+        maxPeaks = _mm_max_ps(maxPeaks, abs);
+        squares = _mm_add_ps(squares, _mm_mul_ps(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxSSE2(maxPeaks), scaleAndPeakScalar(samples + i, count - i, gain, &tailSquares));
+    *squaredSum = horizontalSumSSE2(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+JT_TARGET_SSE2 float dotSSE2(const float *a, const float *b, uint count)
+{
+    __m128 sums = _mm_setzero_ps();
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        sums = _mm_add_ps(sums, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+
+    return horizontalSumSSE2(sums) + dotScalar(a + i, b + i, count - i);
+}
+
+const Kernels SSE2_KERNELS = {
+    InstructionSet::SSE2,
+    scaleSSE2,
+    rampSSE2,
+    addSSE2,
+    mixSSE2,
+    peakSSE2,
+    scaleAndPeakSSE2,
+    dotSSE2
+};
+
+// ++++++++++++++++++++ AVX2 ++++++++++++++++++++
+
+JT_TARGET_AVX2 float horizontalMaxAVX2(__m256 values)
+{
+    float lanes[8];
+    _mm256_storeu_ps(lanes, values);
+    float maxValue = lanes[0];
+    for (int i = 1; i < 8; ++i) {
+        if (lanes[i] > maxValue) maxValue = lanes[i];
+    }
+    return maxValue;
+}
+
+JT_TARGET_AVX2 float horizontalSumAVX2(__m256 values)
+{
+    float lanes[8];
+    _mm256_storeu_ps(lanes, values);
+    return ((lanes[0] + lanes[1]) + (lanes[2] + lanes[3])) + ((lanes[4] + lanes[5]) + (lanes[6] + lanes[7]));
+}
+
+JT_TARGET_AVX2 void scaleAVX2(float *samples, uint count, float gain)
+{
+    const __m256 gains = _mm256_set1_ps(gain);
+    uint i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains));
+
+    scaleScalar(samples + i, count - i, gain);
+}
+
+JT_TARGET_AVX2 void rampAVX2(float *samples, uint count, float beginGain, float gainStep)
+{
+    const __m256 steps = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256 gains = _mm256_add_ps(_mm256_set1_ps(beginGain), _mm256_mul_ps(steps, _mm256_set1_ps(gainStep)));
+    const __m256 increment = _mm256_set1_ps(8 * gainStep);
+    uint i = 0;
+    for (; i + 8 <= count; i += 8) {
+        _mm256_storeu_ps(samples + i, _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains));
+        gains = _mm256_add_ps(gains, increment);
+    }
+
+    rampScalar(samples + i, count - i, beginGain + i * gainStep, gainStep);
+}
+
+JT_TARGET_AVX2 void addAVX2(float *dest, const float *source, uint count)
+{
+    uint i = 0;
+    for (; i + 8 <= count; i += 8)
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), _mm256_loadu_ps(source + i)));
+
+    addScalar(dest + i, source + i, count - i);
+}
+
+JT_TARGET_AVX2 void mixAVX2(float *dest, const float *source, uint count, float gain)
+{
+    const __m256 gains = _mm256_set1_ps(gain);
+    uint i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 scaled = _mm256_mul_ps(_mm256_loadu_ps(source + i), gains);
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), scaled));
+    }
+
+    mixScalar(dest + i, source + i, count - i, gain);
+}
+
+JT_TARGET_AVX2 float peakAVX2(const float *samples, uint count, float *squaredSum)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    __m256 maxPeaks = _mm256_setzero_ps();
+    __m256 squares = _mm256_setzero_ps();
+    uint i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 abs = _mm256_and_ps(_mm256_loadu_ps(samples + i), absMask);
+        maxPeaks = _mm256_max_ps(maxPeaks, abs);
+        squares = _mm256_add_ps(squares, _mm256_mul_ps(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxAVX2(maxPeaks), peakScalar(samples + i, count - i, &tailSquares));
+    *squaredSum = horizontalSumAVX2(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+JT_TARGET_AVX2 float scaleAndPeakAVX2(float *samples, uint count, float gain, float *squaredSum)
+{
+    const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+    const __m256 gains = _mm256_set1_ps(gain);
+    __m256 maxPeaks = _mm256_setzero_ps();
+    __m256 squares = _mm256_setzero_ps();
+    uint i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m256 values = _mm256_mul_ps(_mm256_loadu_ps(samples + i), gains);
+        _mm256_storeu_ps(samples + i, values);
+
+        const __m256 abs = _mm256_and_ps(values, absMask);
+        maxPeaks = _mm256_max_ps(maxPeaks, abs);
+        squares = _mm256_add_ps(squares, _mm256_mul_ps(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxAVX2(maxPeaks), scaleAndPeakScalar(samples + i, count - i, gain, &tailSquares));
+    *squaredSum = horizontalSumAVX2(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+JT_TARGET_AVX2 float dotAVX2(const float *a, const float *b, uint count)
+{
+    __m256 sums = _mm256_setzero_ps();
+    uint i = 0;
+    for (; i + 8 <= count; i += 8)
+        sums = _mm256_add_ps(sums, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+
+    return horizontalSumAVX2(sums) + dotScalar(a + i, b + i, count - i);
+}
+
+const Kernels AVX2_KERNELS = {
+    InstructionSet::AVX2,
+    scaleAVX2,
+    rampAVX2,
+    addAVX2,
+    mixAVX2,
+    peakAVX2,
+    scaleAndPeakAVX2,
+    dotAVX2
+};
+
+// ++++++++++++++++++++ x86 CPU detection ++++++++++++++++++++
+
+bool cpuHasSSE2()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+    return true; // SSE2 is part of x86-64
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[3] & (1 << 26)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#endif
+}
+
+bool cpuHasAVX2()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    const bool osUsesXSave = (info[2] & (1 << 27)) != 0;
+    const bool cpuHasAVX = (info[2] & (1 << 28)) != 0;
+    if (!osUsesXSave || !cpuHasAVX)
+        return false;
+
+    if ((_xgetbv(0) & 0x6) != 0x6) // OS is saving the AVX registers?
+        return false;
+
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+#endif // JT_KERNELS_X86
+
+#ifdef JT_KERNELS_NEON
+
+// ++++++++++++++++++++ NEON ++++++++++++++++++++
+
+float horizontalMaxNEON(float32x4_t values)
+{
+    float lanes[4];
+    vst1q_f32(lanes, values);
+    return qMax(qMax(lanes[0], lanes[1]), qMax(lanes[2], lanes[3]));
+}
+
+float horizontalSumNEON(float32x4_t values)
+{
+    float lanes[4];
+    vst1q_f32(lanes, values);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+void scaleNEON(float *samples, uint count, float gain)
+{
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(samples + i, vmulq_n_f32(vld1q_f32(samples + i), gain));
+
+    scaleScalar(samples + i, count - i, gain);
+}
+
+void rampNEON(float *samples, uint count, float beginGain, float gainStep)
+{
+    const float initialGains[4] = {beginGain, beginGain + gainStep, beginGain + 2 * gainStep, beginGain + 3 * gainStep};
+    float32x4_t gains = vld1q_f32(initialGains);
+    const float32x4_t increment = vdupq_n_f32(4 * gainStep);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        vst1q_f32(samples + i, vmulq_f32(vld1q_f32(samples + i), gains));
+        gains = vaddq_f32(gains, increment);
+    }
+
+    rampScalar(samples + i, count - i, beginGain + i * gainStep, gainStep);
+}
+
+void addNEON(float *dest, const float *source, uint count)
+{
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), vld1q_f32(source + i)));
+
+    addScalar(dest + i, source + i, count - i);
+}
+
+void mixNEON(float *dest, const float *source, uint count, float gain)
+{
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t scaled = vmulq_n_f32(vld1q_f32(source + i), gain);
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), scaled));
+    }
+
+    mixScalar(dest + i, source + i, count - i, gain);
+}
+
+float peakNEON(const float *samples, uint count, float *squaredSum)
+{
+    float32x4_t maxPeaks = vdupq_n_f32(0);
+    float32x4_t squares = vdupq_n_f32(0);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t abs = vabsq_f32(vld1q_f32(samples + i));
+        maxPeaks = vmaxq_f32(maxPeaks, abs);
+        squares = vaddq_f32(squares, vmulq_f32(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxNEON(maxPeaks), peakScalar(samples + i, count - i, &tailSquares));
+    *squaredSum = horizontalSumNEON(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+float scaleAndPeakNEON(float *samples, uint count, float gain, float *squaredSum)
+{
+    float32x4_t maxPeaks = vdupq_n_f32(0);
+    float32x4_t squares = vdupq_n_f32(0);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const float32x4_t values = vmulq_n_f32(vld1q_f32(samples + i), gain);
+        vst1q_f32(samples + i, values);
+
+        const float32x4_t abs = vabsq_f32(values);
+        maxPeaks = vmaxq_f32(maxPeaks, abs);
+        squares = vaddq_f32(squares, vmulq_f32(abs, abs));
+    }
+
+    float tailSquares = 0;
+    float maxPeak = qMax(horizontalMaxNEON(maxPeaks), scaleAndPeakScalar(samples + i, count - i, gain, &tailSquares));
+    *squaredSum = horizontalSumNEON(squares) + tailSquares;
+
+    return maxPeak;
+}
+
+float dotNEON(const float *a, const float *b, uint count)
+{
+    float32x4_t sums = vdupq_n_f32(0);
+    uint i = 0;
+    for (; i + 4 <= count; i += 4)
+        sums = vaddq_f32(sums, vmulq_f32(vld1q_f32(a + i), vld1q_f32(b + i)));
+
+    return horizontalSumNEON(sums) + dotScalar(a + i, b + i, count - i);
+}
+
+const Kernels NEON_KERNELS = {
+    InstructionSet::NEON,
+    scaleNEON,
+    rampNEON,
+    addNEON,
+    mixNEON,
+    peakNEON,
+    scaleAndPeakNEON,
+    dotNEON
+};
+
+#endif // JT_KERNELS_NEON
+
+} // namespace
+
+bool audio::kernels::isSupported(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+    case InstructionSet::Scalar:
+        return true;
+#ifdef JT_KERNELS_X86
+    case InstructionSet::SSE2:
+        return cpuHasSSE2();
+    case InstructionSet::AVX2:
+        return cpuHasAVX2();
+#endif
+#ifdef JT_KERNELS_NEON
+    case InstructionSet::NEON:
+        return true; // NEON is always available when the compiler is generating NEON code
+#endif
+    default:
+        return false;
+    }
+}
+
+InstructionSet audio::kernels::detectBestInstructionSet()
+{
+    if (isSupported(InstructionSet::AVX2))
+        return InstructionSet::AVX2;
+
+    if (isSupported(InstructionSet::SSE2))
+        return InstructionSet::SSE2;
+
+    if (isSupported(InstructionSet::NEON))
+        return InstructionSet::NEON;
+
+    return InstructionSet::Scalar;
+}
+
+const Kernels &audio::kernels::get(InstructionSet instructionSet)
+{
+    if (!isSupported(instructionSet))
+        return SCALAR_KERNELS;
+
+    switch (instructionSet) {
+#ifdef JT_KERNELS_X86
+    case InstructionSet::SSE2:
+        return SSE2_KERNELS;
+    case InstructionSet::AVX2:
+        return AVX2_KERNELS;
+#endif
+#ifdef JT_KERNELS_NEON
+    case InstructionSet::NEON:
+        return NEON_KERNELS;
+#endif
+    default:
+        return SCALAR_KERNELS;
+    }
+}
+
+const Kernels &audio::kernels::get()
+{
+    static const Kernels &bestKernels = get(detectBestInstructionSet()); // CPU is checked only once
+    return bestKernels;
+}
+
+const char *audio::kernels::getName(InstructionSet instructionSet)
+{
+    switch (instructionSet) {
+    case InstructionSet::SSE2:
+        return "SSE2";
+    case InstructionSet::AVX2:
+        return "AVX2";
+    case InstructionSet::NEON:
+        return "NEON";
+    default:
+        return "Scalar";
+    }
+}
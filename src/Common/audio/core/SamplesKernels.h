@@ -0,0 +1,54 @@
+#ifndef SAMPLES_KERNELS_H
+#define SAMPLES_KERNELS_H
+
+#include <QtGlobal>
+
+namespace audio {
+
+/**
+ * Low level loops used by SamplesBuffer, LooperLayer and the resamplers to process float samples.
+ * Each instruction set has its own implementation, the best one supported by the running
+ * CPU is choosed at runtime (see kernels::get()). The scalar implementation is the reference.
+ */
+
+namespace kernels {
+
+enum class InstructionSet
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON
+};
+
+struct Kernels
+{
+    InstructionSet instructionSet;
+
+    void (*scale)(float *samples, uint count, float gain); // samples *= gain
+    void (*ramp)(float *samples, uint count, float beginGain, float gainStep); // samples[i] *= beginGain + i * gainStep
+    void (*add)(float *dest, const float *source, uint count); // dest += source
+    void (*mix)(float *dest, const float *source, uint count, float gain); // dest += source * gain
+
+    // return the max absolute value, and the sum of squared samples in 'squaredSum'
+    float (*peak)(const float *samples, uint count, float *squaredSum);
+
+    // fused 'scale' and 'peak', peak and squares are computed using the scaled samples
+    float (*scaleAndPeak)(float *samples, uint count, float gain, float *squaredSum);
+
+    float (*dot)(const float *a, const float *b, uint count); // sum of a[i] * b[i], used by FIR filters
+};
+
+const Kernels &get(); // best kernels for the running CPU
+const Kernels &get(InstructionSet instructionSet); // used by tests and benchmarks, fallback to scalar if not supported
+
+bool isSupported(InstructionSet instructionSet);
+InstructionSet detectBestInstructionSet();
+
+const char *getName(InstructionSet instructionSet);
+
+} // namespace kernels
+
+} // namespace audio
+
+#endif // SAMPLES_KERNELS_H
@@ -0,0 +1,88 @@
+#include "ScratchArena.h"
+
+#include <algorithm>
+
+using audio::ScratchArena;
+using audio::SamplesBuffer;
+
+ScratchArena::ScratchArena() :
+    usedBuffers(0),
+    usedMidiBuffers(0),
+    maxChannels(0),
+    maxFrames(0)
+{
+    prepare(DEFAULT_MAX_CHANNELS, DEFAULT_MAX_FRAMES);
+}
+
+void ScratchArena::prepare(uint maxChannels, uint maxFrames)
+{
+    Q_ASSERT(usedBuffers == 0 && usedMidiBuffers == 0); // can't prepare while the audio graph is using the arena
+
+    this->maxChannels = std::max(maxChannels, static_cast<uint>(DEFAULT_MAX_CHANNELS));
+    this->maxFrames = std::max(maxFrames, 1u);
+
+    buffers.clear();
+    buffers.reserve(PREALLOCATED_BUFFERS * 4); // room to grow without reallocating the pointers array
+    for (uint i = 0; i < PREALLOCATED_BUFFERS; ++i)
+        buffers.emplace_back(createBuffer());
+
+    midiBuffers.clear();
+    midiBuffers.reserve(PREALLOCATED_MIDI_BUFFERS * 4);
+    for (uint i = 0; i < PREALLOCATED_MIDI_BUFFERS; ++i)
+        midiBuffers.emplace_back(createMidiBuffer());
+}
+
+SamplesBuffer *ScratchArena::createBuffer() const
+{
+    auto buffer = new SamplesBuffer(maxChannels, maxFrames); // all channels are allocated with max capacity
+    buffer->setFrameLenght(0);
+    return buffer;
+}
+
+std::vector<midi::MidiMessage> *ScratchArena::createMidiBuffer() const
+{
+    auto midiBuffer = new std::vector<midi::MidiMessage>();
+    midiBuffer->reserve(MAX_MIDI_MESSAGES);
+    return midiBuffer;
+}
+
+SamplesBuffer &ScratchArena::takeBuffer(uint channels, uint frames)
+{
+    // buffers bigger than maxChannels/maxFrames still work, but the samples are allocated in the audio thread
+    if (usedBuffers >= buffers.size())
+        buffers.emplace_back(createBuffer()); // not enough pre allocated buffers, allocating in audio thread :(
+
+    auto &buffer = *buffers[usedBuffers++];
+    buffer.setChannels(channels);
+    buffer.setFrameLenght(frames);
+    buffer.zero();
+
+    return buffer;
+}
+
+std::vector<midi::MidiMessage> &ScratchArena::takeMidiBuffer()
+{
+    if (usedMidiBuffers >= midiBuffers.size())
+        midiBuffers.emplace_back(createMidiBuffer());
+
+    auto &midiBuffer = *midiBuffers[usedMidiBuffers++];
+    midiBuffer.clear(); // clear() is keeping the vector capacity
+
+    return midiBuffer;
+}
+
+// ------------------------------------------------------------------
+
+ScratchArena::Scope::Scope(ScratchArena &arena) :
+    arena(arena),
+    usedBuffers(arena.usedBuffers),
+    usedMidiBuffers(arena.usedMidiBuffers)
+{
+
+}
+
+ScratchArena::Scope::~Scope()
+{
+    arena.usedBuffers = usedBuffers;
+    arena.usedMidiBuffers = usedMidiBuffers;
+}
@@ -0,0 +1,80 @@
+#ifndef SCRATCH_ARENA_H
+#define SCRATCH_ARENA_H
+
+#include "SamplesBuffer.h"
+#include "midi/MidiMessage.h"
+
+#include <vector>
+#include <memory>
+
+namespace audio {
+
+/**
+ * Pre-sized scratch memory reused by the audio graph in every audio callback (MainController::process).
+ * Buffers are taken in a stack fashion and returned when the enclosing ScratchArena::Scope is destroyed,
+ * so nodes can ask for temporary buffers without allocating in the audio thread.
+ *
+ * prepare() must be called from a non real-time thread (when the audio driver is stopped).
+ */
+
+class ScratchArena
+{
+
+public:
+    ScratchArena();
+
+    void prepare(uint maxChannels, uint maxFrames);
+
+    SamplesBuffer &takeBuffer(uint channels, uint frames);
+    std::vector<midi::MidiMessage> &takeMidiBuffer(); // returned buffer is empty, but keeps the reserved capacity
+
+    uint getMaxFrames() const;
+
+    class Scope
+    {
+    public:
+        explicit Scope(ScratchArena &arena);
+        ~Scope();
+
+    private:
+        Scope(const Scope &other);
+        Scope &operator=(const Scope &other);
+
+        ScratchArena &arena;
+        const size_t usedBuffers;
+        const size_t usedMidiBuffers;
+    };
+
+    static const uint DEFAULT_MAX_FRAMES = 4096;
+    static const uint DEFAULT_MAX_CHANNELS = 2;
+    static const uint MAX_MIDI_MESSAGES = 256;
+
+private:
+    ScratchArena(const ScratchArena &other);
+    ScratchArena &operator=(const ScratchArena &other);
+
+    SamplesBuffer *createBuffer() const;
+    std::vector<midi::MidiMessage> *createMidiBuffer() const;
+
+    // pointers are stored, so references returned to the callers are still valid when the containers grow
+    std::vector<std::unique_ptr<SamplesBuffer>> buffers;
+    std::vector<std::unique_ptr<std::vector<midi::MidiMessage>>> midiBuffers;
+
+    size_t usedBuffers;
+    size_t usedMidiBuffers;
+
+    uint maxChannels;
+    uint maxFrames;
+
+    static const uint PREALLOCATED_BUFFERS = 8;
+    static const uint PREALLOCATED_MIDI_BUFFERS = 8;
+};
+
+inline uint ScratchArena::getMaxFrames() const
+{
+    return maxFrames;
+}
+
+} // namespace
+
+#endif // SCRATCH_ARENA_H
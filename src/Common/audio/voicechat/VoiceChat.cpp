@@ -0,0 +1,83 @@
+#include "VoiceChat.h"
+
+using voicechat::AdpcmState;
+
+namespace {
+
+const int INDEX_TABLE[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+const int STEP_TABLE[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442, 11487,
+    12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+} // namespace
+
+bool voicechat::isVoiceChatStream(const QByteArray &encodedData)
+{
+    return encodedData.startsWith(FOURCC);
+}
+
+AdpcmState::AdpcmState()
+{
+    reset();
+}
+
+void AdpcmState::reset(qint16 predictor, quint8 stepIndex)
+{
+    this->predictor = predictor;
+    this->stepIndex = qMin(static_cast<int>(stepIndex), 88);
+}
+
+quint8 AdpcmState::encode(qint16 sample)
+{
+    int diff = sample - predictor;
+    quint8 nibble = 0;
+    if (diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+
+    int step = STEP_TABLE[stepIndex];
+    if (diff >= step) {
+        nibble |= 4;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        nibble |= 2;
+        diff -= step;
+    }
+    step >>= 1;
+    if (diff >= step)
+        nibble |= 1;
+
+    decode(nibble); // the encoder predictor follows the decoder
+
+    return nibble;
+}
+
+qint16 AdpcmState::decode(quint8 nibble)
+{
+    const int step = STEP_TABLE[stepIndex];
+
+    int delta = step >> 3;
+    if (nibble & 4)
+        delta += step;
+    if (nibble & 2)
+        delta += step >> 1;
+    if (nibble & 1)
+        delta += step >> 2;
+
+    predictor = qBound(-32768, (nibble & 8) ? predictor - delta : predictor + delta, 32767);
+    stepIndex = qBound(0, stepIndex + INDEX_TABLE[nibble & 0x0f], 88);
+
+    return static_cast<qint16>(predictor);
+}
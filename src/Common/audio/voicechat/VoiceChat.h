@@ -0,0 +1,49 @@
+#ifndef _VOICE_CHAT_
+#define _VOICE_CHAT_
+
+#include <QByteArray>
+#include <QtGlobal>
+
+/**
+ * Low latency codec used in voice chat channels. The audio is mixed to mono, filtered and downsampled to half of the
+ * sample rate and encoded in small IMA ADPCM frames. Every frame can be decoded as soon as it is received,
+ * a vorbis stream is decoded only after the first 8 KB are downloaded.
+ *
+ * Stream layout (little endian):
+ *    header:  "JTVC", version (uint8), channels (uint8), frame size (uint16), sample rate (uint32)
+ *    frames:  frames (uint16), for each channel: predictor (int16) and step index (uint8), then
+ *             frames * channels 4 bits samples, interleaved, low nibble first.
+ *    a frame with zero samples is the end of the stream.
+ */
+
+namespace voicechat
+{
+
+    const char FOURCC[] = "JTVC"; // the stream magic, and the FourCC used in interval begin messages
+    const quint8 VERSION = 1;
+    const int HEADER_SIZE = 12;
+
+    const uint DEFAULT_FRAME_DURATION = 10; // milliseconds
+    const uint MAX_FRAME_DURATION = 60;
+
+    bool isVoiceChatStream(const QByteArray &encodedData);
+
+    class AdpcmState // IMA ADPCM predictor, one for each channel
+    {
+    public:
+        AdpcmState();
+        quint8 encode(qint16 sample);
+        qint16 decode(quint8 nibble);
+        void reset(qint16 predictor = 0, quint8 stepIndex = 0);
+
+        inline qint16 getPredictor() const { return static_cast<qint16>(predictor); }
+        inline quint8 getStepIndex() const { return static_cast<quint8>(stepIndex); }
+
+    private:
+        int predictor;
+        int stepIndex;
+    };
+
+} // namespace
+
+#endif
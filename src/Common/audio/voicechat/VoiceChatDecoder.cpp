@@ -0,0 +1,191 @@
+#include "VoiceChatDecoder.h"
+#include "audio/core/LatencyProbes.h"
+
+#include <QtEndian>
+#include <QDebug>
+#include <cstring>
+
+using voicechat::Decoder;
+
+Decoder::Decoder() :
+    internalBuffer(2, 4096),
+    inputOffset(0),
+    inputAvailable(0),
+    headerReceived(false),
+    channels(1),
+    frameSize(0),
+    sampleRate(44100),
+    frameOffset(0),
+    finished(false),
+    valid(true),
+    inputComplete(false)
+{
+
+}
+
+void Decoder::addInputData(const QByteArray &encodedData)
+{
+    if (encodedData.isEmpty())
+        return;
+
+    input.append(encodedData); // shared, not copied
+    inputAvailable += encodedData.size();
+}
+
+void Decoder::setInputData(const QByteArray &encodedData)
+{
+    input.clear();
+    inputOffset = 0;
+    inputAvailable = 0;
+
+    if (encodedData.isEmpty())
+        finished = true;
+    else
+        addInputData(encodedData);
+}
+
+const uchar *Decoder::peekInput(int bytes)
+{
+    if (inputAvailable < bytes)
+        return nullptr;
+
+    const QByteArray &first = input.first();
+    if (first.size() - inputOffset >= bytes)
+        return reinterpret_cast<const uchar *>(first.constData() + inputOffset);
+
+    splitBytes.resize(bytes); // the biggest frame is reserved when the header is read
+    int copied = 0;
+    int offset = inputOffset;
+    for (const QByteArray &chunk : input) {
+        const int len = qMin(bytes - copied, chunk.size() - offset);
+        memcpy(splitBytes.data() + copied, chunk.constData() + offset, static_cast<size_t>(len));
+        copied += len;
+        offset = 0;
+        if (copied == bytes)
+            break;
+    }
+
+    return reinterpret_cast<const uchar *>(splitBytes.constData());
+}
+
+void Decoder::skipInput(int bytes)
+{
+    inputAvailable -= bytes;
+    while (bytes > 0) {
+        const int len = qMin(bytes, input.first().size() - inputOffset);
+        inputOffset += len;
+        bytes -= len;
+
+        if (inputOffset >= input.first().size()) { // chunk fully consumed
+            input.removeFirst();
+            inputOffset = 0;
+        }
+    }
+}
+
+bool Decoder::readHeader()
+{
+    auto header = peekInput(HEADER_SIZE);
+    if (!header)
+        return false;
+
+    if (memcmp(header, FOURCC, 4) != 0 || header[4] != VERSION || header[5] < 1 || header[5] > 2) {
+        qWarning() << "Invalid voice chat stream header!";
+        valid = false;
+        return false;
+    }
+
+    channels = header[5];
+    frameSize = qFromLittleEndian<quint16>(header + 6);
+    sampleRate = static_cast<int>(qFromLittleEndian<quint32>(header + 8));
+    if (frameSize <= 0 || sampleRate <= 0) {
+        qWarning() << "Invalid voice chat stream, frame size:" << frameSize << "sample rate:" << sampleRate;
+        valid = false;
+        return false;
+    }
+
+    skipInput(HEADER_SIZE);
+    headerReceived = true;
+    splitBytes.reserve(2 + channels * 3 + (frameSize * channels + 1) / 2); // the biggest frame
+    frameSamples.reserve(frameSize * channels); // decodeNextFrame() is not allocating
+    return true;
+}
+
+bool Decoder::decodeNextFrame()
+{
+    auto data = peekInput(2);
+    if (!data)
+        return false;
+
+    const int frames = qFromLittleEndian<quint16>(data);
+    if (frames == 0) { // end of stream
+        skipInput(2);
+        finished = true;
+        return false;
+    }
+
+    if (frames > frameSize) {
+        qWarning() << "Invalid voice chat frame with" << frames << "samples";
+        valid = false;
+        return false;
+    }
+
+    const int samples = frames * channels;
+    const int frameBytes = 2 + channels * 3 + (samples + 1) / 2;
+    data = peekInput(frameBytes);
+    if (!data)
+        return false; // waiting for the remaining bytes
+
+    data += 2;
+    for (int c = 0; c < channels; ++c) {
+        adpcm[c].reset(qFromLittleEndian<qint16>(data), data[2]); // every frame can be decoded without the previous frames
+        data += 3;
+    }
+
+    frameSamples.resize(samples);
+    for (int i = 0; i < samples; ++i) {
+        const quint8 nibble = (i % 2) ? (data[i / 2] >> 4) : (data[i / 2] & 0x0f);
+        frameSamples[i] = adpcm[i % channels].decode(nibble) / 32768.0f;
+    }
+
+    skipInput(frameBytes);
+    frameOffset = 0;
+    return true;
+}
+
+const audio::SamplesBuffer &Decoder::decode(int maxSamplesToDecode)
+{
+    audio::LatencyProbes::Scope probe(audio::LatencyProbes::VorbisDecode);
+
+    if (!valid || (!headerReceived && !readHeader()))
+        return audio::SamplesBuffer::ZERO_BUFFER;
+
+    internalBuffer.setFrameLenght(static_cast<uint>(qMax(maxSamplesToDecode, 0)));
+    float *left = internalBuffer.getSamplesArray(0);
+    float *right = internalBuffer.getSamplesArray(1);
+
+    int decoded = 0;
+    while (decoded < maxSamplesToDecode) {
+        const int decodedFrames = frameSamples.size() / channels;
+        if (frameOffset >= decodedFrames && (finished || !decodeNextFrame())) {
+            finished = finished || (inputComplete && valid); // the end of stream frame was not received
+            break;
+        }
+
+        const int frames = qMin(frameSamples.size() / channels - frameOffset, maxSamplesToDecode - decoded);
+        const float *samples = frameSamples.constData() + frameOffset * channels;
+        for (int i = 0; i < frames; ++i) {
+            left[decoded + i] = samples[i * channels]; // internal buffer is always stereo
+            right[decoded + i] = samples[i * channels + channels - 1];
+        }
+
+        decoded += frames;
+        frameOffset += frames;
+    }
+
+    if (!decoded)
+        return audio::SamplesBuffer::ZERO_BUFFER;
+
+    internalBuffer.setFrameLenght(static_cast<uint>(decoded));
+    return internalBuffer;
+}
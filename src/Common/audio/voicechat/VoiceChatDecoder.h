@@ -0,0 +1,75 @@
+#ifndef VOICE_CHAT_DECODER_H
+#define VOICE_CHAT_DECODER_H
+
+#include "audio/core/SamplesBuffer.h"
+#include "audio/Decoder.h"
+#include "VoiceChat.h"
+
+#include <QByteArray>
+#include <QVector>
+#include <QList>
+
+namespace voicechat
+{
+
+class Decoder : public AudioDecoder
+{
+
+public:
+    Decoder();
+
+    const audio::SamplesBuffer &decode(int maxSamplesToDecode) override;
+
+    void addInputData(const QByteArray &encodedData) override;
+    void setInputData(const QByteArray &encodedData) override; // an empty input stops the decoding
+
+    int getSampleRate() const override;
+    bool isStereo() const override;
+    bool isFinished() const override { return finished; }
+    bool isValid() const override { return valid; }
+    void setInputComplete() override { inputComplete = true; } // truncated streams are finished when the input is consumed
+    qint64 getTotalFrames() const override { return -1; } // frames are counted while decoding
+
+    inline int getFrameSize() const { return frameSize; }
+
+private:
+    bool readHeader();
+    bool decodeNextFrame(); // false if the frame is not completely received
+
+    const uchar *peekInput(int bytes); // contiguous bytes, copied only when split in chunks. Null if not available
+    void skipInput(int bytes);
+
+    audio::SamplesBuffer internalBuffer;
+
+    QList<QByteArray> input; // received chunks are not joined
+    int inputOffset; // read cursor in the first chunk
+    int inputAvailable; // bytes not consumed in all chunks
+    QByteArray splitBytes; // a header or frame received in many chunks
+
+    bool headerReceived;
+    int channels;
+    int frameSize;
+    int sampleRate;
+
+    AdpcmState adpcm[2];
+    QVector<float> frameSamples; // the last decoded frame, interleaved
+    int frameOffset; // frames already returned by decode()
+
+    bool finished;
+    bool valid;
+    bool inputComplete;
+};
+
+inline int Decoder::getSampleRate() const
+{
+    return sampleRate;
+}
+
+inline bool Decoder::isStereo() const
+{
+    return channels == 2;
+}
+
+} // namespace
+
+#endif // VOICE_CHAT_DECODER_H
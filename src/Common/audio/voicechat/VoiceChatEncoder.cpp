@@ -0,0 +1,155 @@
+#include "VoiceChatEncoder.h"
+
+#include <QtEndian>
+#include <cstring>
+#include <cmath>
+
+using voicechat::Encoder;
+
+namespace {
+
+// windowed sinc (Blackman) half band filter, cutoff in the half of the output sample rate
+QVector<float> createHalfBandFilter(int taps)
+{
+    const double PI = 3.14159265358979323846;
+    const int center = taps / 2;
+
+    QVector<float> coefficients(taps);
+    double sum = 0;
+    for (int n = 0; n < taps; ++n) {
+        const int k = n - center;
+        const double sinc = k == 0 ? 0.5 : std::sin(PI * k / 2) / (PI * k); // zero in even k
+        const double window = 0.42 - 0.5 * std::cos(2 * PI * n / (taps - 1)) + 0.08 * std::cos(4 * PI * n / (taps - 1));
+        coefficients[n] = static_cast<float>(sinc * window);
+        sum += coefficients[n];
+    }
+
+    for (float &coefficient : coefficients)
+        coefficient = static_cast<float>(coefficient / sum); // unity gain in the passband
+
+    return coefficients;
+}
+
+const QVector<float> &getHalfBandFilter()
+{
+    static const QVector<float> filter = createHalfBandFilter(Encoder::HALF_BAND_TAPS);
+    return filter;
+}
+
+} // namespace
+
+Encoder::Encoder(uint channels, uint sampleRate, uint frameDuration) :
+    channels(channels),
+    sampleRate(sampleRate),
+    frameSize(qMax(sampleRate / DECIMATION * qBound(1u, frameDuration, MAX_FRAME_DURATION) / 1000, 1u)),
+    streamStarted(false),
+    filterInput(HALF_BAND_TAPS * 2, 0.0f),
+    filterPosition(0),
+    decimationCount(0)
+{
+    frameSamples.reserve(static_cast<int>(frameSize));
+}
+
+float Encoder::filter() const
+{
+    // the filter is symmetric and only the center and the odd taps are not zero
+    const QVector<float> &coefficients = getHalfBandFilter();
+    const float *samples = filterInput.constData() + filterPosition; // oldest to newest
+    const int center = HALF_BAND_TAPS / 2;
+
+    float output = samples[center] * coefficients[center];
+    for (int k = 1; k <= center; k += 2)
+        output += (samples[center - k] + samples[center + k]) * coefficients[center + k];
+
+    return output;
+}
+
+void Encoder::writeHeader(QByteArray &out) const
+{
+    char header[HEADER_SIZE];
+    memcpy(header, FOURCC, 4);
+    header[4] = static_cast<char>(VERSION);
+    header[5] = 1; // mono
+    qToLittleEndian<quint16>(static_cast<quint16>(frameSize), reinterpret_cast<uchar *>(header + 6));
+    qToLittleEndian<quint32>(sampleRate / DECIMATION, reinterpret_cast<uchar *>(header + 8));
+
+    out.append(header, HEADER_SIZE);
+}
+
+void Encoder::writeFrame(QByteArray &out)
+{
+    const int frames = frameSamples.size();
+
+    char frameHeader[5];
+    qToLittleEndian<quint16>(static_cast<quint16>(frames), reinterpret_cast<uchar *>(frameHeader));
+    qToLittleEndian<qint16>(adpcm.getPredictor(), reinterpret_cast<uchar *>(frameHeader + 2));
+    frameHeader[4] = static_cast<char>(adpcm.getStepIndex());
+    out.append(frameHeader, sizeof(frameHeader));
+
+    const int offset = out.size();
+    out.resize(offset + (frames + 1) / 2);
+    char *data = out.data() + offset;
+    for (int i = 0; i < frames; ++i) {
+        const quint8 nibble = adpcm.encode(frameSamples.at(i));
+        if (i % 2)
+            data[i / 2] = static_cast<char>(data[i / 2] | (nibble << 4));
+        else
+            data[i / 2] = static_cast<char>(nibble);
+    }
+
+    frameSamples.clear();
+}
+
+QByteArray Encoder::encode(const audio::SamplesBuffer &audioBuffer)
+{
+    QByteArray out;
+    if (!streamStarted) {
+        writeHeader(out);
+        streamStarted = true;
+    }
+
+    const int inputChannels = qMin(audioBuffer.getChannels(), 2);
+    const uint frames = audioBuffer.getFrameLenght();
+    if (inputChannels <= 0)
+        return out;
+
+    const float *left = audioBuffer.getSamplesArray(0);
+    const float *right = audioBuffer.getSamplesArray(static_cast<uint>(inputChannels - 1));
+    for (uint i = 0; i < frames; ++i) {
+        const float mono = (left[i] + right[i]) * 0.5f;
+        filterInput[filterPosition] = mono;
+        filterInput[filterPosition + HALF_BAND_TAPS] = mono;
+        filterPosition = (filterPosition + 1) % HALF_BAND_TAPS;
+
+        if (++decimationCount < DECIMATION)
+            continue; // the filter output is computed only for the kept samples
+
+        const float sample = qBound(-1.0f, filter(), 1.0f);
+        frameSamples.append(static_cast<qint16>(sample * 32767));
+        decimationCount = 0;
+
+        if (static_cast<uint>(frameSamples.size()) >= frameSize)
+            writeFrame(out);
+    }
+
+    return out;
+}
+
+QByteArray Encoder::finishIntervalEncoding()
+{
+    QByteArray out;
+    if (!streamStarted)
+        writeHeader(out); // an empty stream
+
+    if (!frameSamples.isEmpty())
+        writeFrame(out); // the last (shorter) frame
+
+    out.append(2, '\0'); // end of stream
+
+    // the next interval is a new stream
+    streamStarted = false;
+    adpcm.reset();
+    decimationCount = 0; // the filter input is kept, the audio is continuous between intervals
+
+    return out;
+}
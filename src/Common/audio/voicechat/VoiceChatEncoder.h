@@ -0,0 +1,64 @@
+#ifndef VOICE_CHAT_ENCODER_H
+#define VOICE_CHAT_ENCODER_H
+
+#include "audio/core/SamplesBuffer.h"
+#include "audio/Encoder.h"
+#include "VoiceChat.h"
+
+#include <QByteArray>
+#include <QVector>
+
+namespace voicechat
+{
+
+class Encoder : public AudioEncoder
+{
+
+public:
+    Encoder(uint channels, uint sampleRate, uint frameDuration = DEFAULT_FRAME_DURATION); // frame duration in milliseconds
+
+    QByteArray encode(const audio::SamplesBuffer &audioBuffer) override;
+    QByteArray finishIntervalEncoding() override;
+
+    int getChannels() const override; // the input channels, the encoded stream is mono
+    int getSampleRate() const override;
+
+    inline uint getFrameSize() const { return frameSize; } // samples in each encoded frame
+
+    static const int HALF_BAND_TAPS = 31; // downsampling low pass filter
+    static const int FILTER_DELAY = HALF_BAND_TAPS / 2; // in input samples
+
+private:
+    static const uint DECIMATION = 2;
+
+    float filter() const; // the half band filter output for the last input samples
+
+    void writeHeader(QByteArray &out) const;
+    void writeFrame(QByteArray &out);
+
+    uint channels;
+    uint sampleRate;
+    uint frameSize;
+
+    bool streamStarted; // the header is written in the first encoded part of each interval
+
+    AdpcmState adpcm;
+    QVector<qint16> frameSamples; // decimated samples waiting for a complete frame
+    QVector<float> filterInput; // the last mono input samples, stored twice to read them without wrapping
+    int filterPosition;
+    uint decimationCount;
+};
+
+inline int Encoder::getChannels() const
+{
+    return static_cast<int>(channels);
+}
+
+inline int Encoder::getSampleRate() const
+{
+    return static_cast<int>(sampleRate);
+}
+
+} // namespace
+
+#endif // VOICE_CHAT_ENCODER_H
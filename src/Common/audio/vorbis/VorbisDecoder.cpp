@@ -2,10 +2,12 @@
 #include <stdexcept>
 #include <cstring>
 #include <QByteArray>
+#include <QtEndian>
 #include <cmath>
 #include <QDebug>
 #include "audio/core/AudioDriver.h"
 #include "audio/core/SamplesBuffer.h"
+#include "audio/core/LatencyProbes.h"
 #include <vorbis/vorbisfile.h>
 #include <QThread>
 #include "log/Logging.h"
@@ -15,7 +17,8 @@ using vorbis::Decoder;
 Decoder::Decoder() :
       internalBuffer(2, 4096),
       initialized(false),
-      vorbisInput()
+      inputOffset(0),
+      inputAvailable(0)
 {
     vorbisFile.vi = nullptr;
 }
@@ -54,14 +57,26 @@ int Decoder::getSampleRate() const
 
 
 //+++++++++++++++++++++++++++++++++++++++++++
-size_t Decoder::consumeTo(void *oggOutBuffer, size_t bytesToConsume){
-    size_t len = qMin( bytesToConsume, (size_t)vorbisInput.size());
-    if (len > 0) {
-        memcpy(oggOutBuffer, vorbisInput.data(), len);
-        vorbisInput.remove(0, (uint)len);
+size_t Decoder::consumeTo(void *oggOutBuffer, size_t bytesToConsume)
+{
+    char *out = static_cast<char *>(oggOutBuffer);
+    size_t consumed = 0;
+    while (consumed < bytesToConsume && !vorbisInput.isEmpty()) {
+        const QByteArray &chunk = vorbisInput.first();
+        size_t len = qMin(bytesToConsume - consumed, static_cast<size_t>(chunk.size() - inputOffset));
+        memcpy(out + consumed, chunk.constData() + inputOffset, len);
+        consumed += len;
+        inputOffset += static_cast<int>(len);
+
+        if (inputOffset >= chunk.size()) { // chunk fully consumed
+            vorbisInput.removeFirst();
+            inputOffset = 0;
+        }
     }
 
-    return len;
+    inputAvailable -= consumed;
+
+    return consumed;
 }
 
 //vorbisfile read callback
@@ -75,6 +90,8 @@ const audio::SamplesBuffer &Decoder::decode(int maxSamplesToDecode)
 {
     //qDebug() << "decoding INITIALIZED:" << initialized;
 
+    audio::LatencyProbes::Scope probe(audio::LatencyProbes::VorbisDecode);
+
     if (finished || !valid) {
         //if (finished)
         //    qDebug() << "Finished, returning ZERO";
@@ -87,7 +104,7 @@ const audio::SamplesBuffer &Decoder::decode(int maxSamplesToDecode)
 
     static const int MIN_BUFFER_SIZE = 8192;
 
-    if (!initialized && vorbisInput.size() >= MIN_BUFFER_SIZE) {
+    if (!initialized && (inputAvailable >= MIN_BUFFER_SIZE || (inputComplete && inputAvailable > 0))) {
 
         initialize();
     }
@@ -123,7 +140,7 @@ const audio::SamplesBuffer &Decoder::decode(int maxSamplesToDecode)
     else {
         internalBuffer.zero();
         //qDebug() << "FINISHED EOF";
-        finished = true; // when ov_read_float return 0 is EOF
+        finished = inputComplete; // when ov_read_float return 0 is EOF, the decoding continues when more input is added
     }
 
     return internalBuffer;
@@ -132,13 +149,53 @@ const audio::SamplesBuffer &Decoder::decode(int maxSamplesToDecode)
 void Decoder::setInputData(const QByteArray &vorbisData)
 {
     vorbisInput.clear();
-    vorbisInput.append(vorbisData);
+    inputOffset = 0;
+    inputAvailable = 0;
+
+    addInputData(vorbisData);
     //qDebug() << "Input data setted to " << vorbisData.left(32);
 }
 
+void Decoder::setInputComplete()
+{
+    inputComplete = true;
+    totalFrames = readLastGranulePosition();
+}
+
+qint64 Decoder::readLastGranulePosition() const
+{
+    // the granule position in the last ogg page is the stream lenght, known before decoding
+    static const int PAGE_HEADER_SIZE = 27;
+
+    if (vorbisInput.isEmpty())
+        return -1;
+
+    const QByteArray &lastChunk = vorbisInput.last();
+    int index = lastChunk.lastIndexOf("OggS");
+    while (index >= 0) {
+        const auto header = reinterpret_cast<const uchar *>(lastChunk.constData() + index);
+        if (lastChunk.size() - index >= PAGE_HEADER_SIZE && header[4] == 0) { // stream structure version is zero
+            const qint64 granulePosition = qFromLittleEndian<qint64>(header + 6);
+            if (granulePosition >= 0)
+                return granulePosition; // -1 when no packet is finished in the page
+        }
+
+        if (index == 0)
+            break;
+
+        index = lastChunk.lastIndexOf("OggS", index - 1);
+    }
+
+    return -1;
+}
+
 void Decoder::addInputData(const QByteArray &vorbisData)
 {
+    if (vorbisData.isEmpty())
+        return;
+
     vorbisInput.append(vorbisData);
+    inputAvailable += vorbisData.size();
     //qDebug() << vorbisData.size() << " bytes appended";
 }
 
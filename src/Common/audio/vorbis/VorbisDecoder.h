@@ -3,50 +3,66 @@
 
 #include <vorbis/vorbisfile.h>
 #include "audio/core/SamplesBuffer.h"
+#include "audio/Decoder.h"
 #include <QByteArray>
+#include <QList>
 
 namespace vorbis {
 
-class Decoder
+class Decoder : public AudioDecoder
 {
 
 public:
 
     Decoder();
     ~Decoder();
-    const audio::SamplesBuffer &decode(int maxSamplesToDecode);
+    const audio::SamplesBuffer &decode(int maxSamplesToDecode) override;
 
-    bool isStereo() const;
+    bool isStereo() const override;
 
     bool isMono() const;
 
     int getChannels() const;
 
-    int getSampleRate() const;
+    int getSampleRate() const override;
 
     bool isInitialized() const;
 
-    void setInputData(const QByteArray &vorbisData);
+    void setInputData(const QByteArray &vorbisData) override;
 
-    void addInputData(const QByteArray &vorbisData);
+    void addInputData(const QByteArray &vorbisData) override;
 
     bool initialize();
 
-    bool isFinished() const { return finished; }
+    bool isFinished() const override { return finished; }
 
-    bool isValid() const { return valid; }
+    bool isValid() const override { return valid; }
+
+    void setInputComplete() override;
+
+    qint64 getTotalFrames() const override { return totalFrames; }
 
 private:
 
     audio::SamplesBuffer internalBuffer;
     OggVorbis_File vorbisFile;
     bool initialized;
-    QByteArray vorbisInput;
+
+    // downloaded data is appended as received (QByteArray is implicitly shared, no copy) and consumed
+    // using a read cursor, avoiding a front erase in each libvorbisfile read callback
+    QList<QByteArray> vorbisInput;
+    int inputOffset; // read cursor in the first chunk
+    qint64 inputAvailable; // bytes not consumed in all chunks
+
     static size_t readOgg(void *oggOutBuffer, size_t size, size_t nmemb, void *decoderInstance);
 
     size_t consumeTo(void *oggOutBuffer, size_t bytesToConsume);
 
+    qint64 readLastGranulePosition() const;
+
     bool finished = false; // all input was decoded
+    bool inputComplete = false; // vorbisfile reports EOF when the received input is consumed, waiting for more input until complete
+    qint64 totalFrames = -1;
     bool valid = true;// will be flagged as invalid when an error is detected
 };
 
@@ -17,11 +17,16 @@ void WaveFileWriter::write(const QString &filePath, const SamplesBuffer &buffer,
         return;
     }
 
-    const uint samples = buffer.getFrameLenght();
-    const uint dataChunkSize = buffer.getChannels() * buffer.getFrameLenght() * bitDepth/8;// bytes per sample
+    writeHeader(wavFile, buffer.getChannels(), buffer.getFrameLenght(), sampleRate, bitDepth);
+    writeSamples(wavFile, buffer, bitDepth);
+}
+
+void WaveFileWriter::writeHeader(QIODevice &device, int channels, uint frames, quint32 sampleRate, quint8 bitDepth)
+{
+    const uint dataChunkSize = channels * frames * bitDepth/8;// bytes per sample
     const uint fileSize = dataChunkSize + 44; // WAVE HEADER is 44 bytes
 
-    QDataStream out(&wavFile);
+    QDataStream out(&device);
     out.setByteOrder(QDataStream::LittleEndian);
 
     // RIFF chunk
@@ -34,20 +39,27 @@ void WaveFileWriter::write(const QString &filePath, const SamplesBuffer &buffer,
     out.writeRawData("fmt ", 4);
     out << quint32(16); // "fmt " chunk size (always 16 for PCM)
     out << quint16(bitDepth == 16 ? 1 : 3); // data format (1 => PCM, 3 => IEEE float) http://www-mmsp.ece.mcgill.ca/Documents/AudioFormats/WAVE/WAVE.html
-    out << quint16(buffer.getChannels());
+    out << quint16(channels);
     out << quint32(sampleRate);
-    out << quint32(sampleRate * buffer.getChannels() * sampleSize / 8 ); // bytes per second
-    out << quint16(buffer.getChannels() * sampleSize / 8); // Block align
+    out << quint32(sampleRate * channels * sampleSize / 8 ); // bytes per second
+    out << quint16(channels * sampleSize / 8); // Block align
     out << quint16(sampleSize); // Significant Bits Per Sample
 
     // Data chunk
     out.writeRawData("data", 4);
     out << quint32(dataChunkSize); // Placeholder for the data chunk size (filled by close())
+}
+
+void WaveFileWriter::writeSamples(QIODevice &device, const SamplesBuffer &buffer, quint8 bitDepth)
+{
+    QDataStream out(&device);
+    out.setByteOrder(QDataStream::LittleEndian);
 
     //write interleaved samples
     if (bitDepth == 32)
         out.setFloatingPointPrecision(QDataStream::SinglePrecision);
 
+    const uint samples = buffer.getFrameLenght();
     uint channels = buffer.getChannels();
     for (uint s = 0; s < samples; ++s) {
         for (uint c = 0; c < channels; ++c) {
@@ -3,6 +3,8 @@
 
 #include "FileReader.h"
 
+class QIODevice;
+
 namespace audio {
 
 class WaveFileWriter
@@ -11,6 +13,10 @@ class WaveFileWriter
 public:
     void write(const QString &filePath, const SamplesBuffer &buffer, quint32 sampleRate, quint8 bitDepth);
 
+    // big files are written in chunks, the header is using the total frames
+    static void writeHeader(QIODevice &device, int channels, uint frames, quint32 sampleRate, quint8 bitDepth);
+    static void writeSamples(QIODevice &device, const SamplesBuffer &buffer, quint8 bitDepth);
+
 };
 
 } // namespace
@@ -4,6 +4,7 @@
 #include <QImage>
 #include <QPushButton>
 #include <QDir>
+#include <QPainter>
 
 QList<QIcon> IconFactory::getInstrumentIcons()
 {
@@ -160,6 +161,28 @@ QIcon IconFactory::createLooperLoadIcon(const QColor &tintColor)
     return QIcon(QPixmap::fromImage(image));
 }
 
+QIcon IconFactory::createLoopThumbnailIcon(const QVector<float> &peaks, const QColor &tintColor)
+{
+    static const int width = 48;
+    static const int height = 16;
+
+    QPixmap pixmap(width, height);
+    pixmap.fill(Qt::transparent);
+
+    if (!peaks.isEmpty()) {
+        QPainter painter(&pixmap);
+        painter.setPen(tintColor);
+        const float center = height / 2.0f;
+        for (int x = 0; x < width; ++x) {
+            const float peak = qMin(peaks.at(x * peaks.size() / width), 1.0f);
+            const float peakHeight = qMax(peak * center, 0.5f);
+            painter.drawLine(QPointF(x, center - peakHeight), QPointF(x, center + peakHeight));
+        }
+    }
+
+    return QIcon(pixmap);
+}
+
 QIcon IconFactory::createLooperRecordIcon(const QColor &tintColor)
 {
     QImage image(":/images/rec.png");
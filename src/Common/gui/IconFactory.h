@@ -3,6 +3,7 @@
 
 #include <QIcon>
 #include <QColor>
+#include <QVector>
 
 class IconFactory {
 
@@ -30,6 +31,7 @@ public:
     static QIcon createLooperSaveIcon(const QColor &tintColor);
     static QIcon createLooperLoadIcon(const QColor &tintColor);
     static QIcon createLooperResetIcon(const QColor &tintColor);
+    static QIcon createLoopThumbnailIcon(const QVector<float> &peaks, const QColor &tintColor);
     static QPixmap createVoiceChatIcon();
 
     static QIcon getDefaultInstrumentIcon();
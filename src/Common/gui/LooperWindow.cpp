@@ -22,7 +22,6 @@
 using controller::MainController;
 using controller::NinjamController;
 using audio::LoopInfo;
-using audio::LoopLoader;
 using audio::SamplesBuffer;
 
 LooperWindow::LooperWindow(QWidget *parent, MainController *mainController) :
@@ -30,6 +29,9 @@ LooperWindow::LooperWindow(QWidget *parent, MainController *mainController) :
     ui(new Ui::LooperWindow),
     mainController(mainController),
     looper(nullptr),
+    loopSaver(nullptr),
+    loopLoader(nullptr),
+    loopLibrary(nullptr),
     currentBeat(-1)
 {
     setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint); // remove help/question marker
@@ -212,6 +214,7 @@ void LooperWindow::updateDrawings()
 void LooperWindow::detachCurrentLooper()
 {
     if (looper) {
+        deleteLoopTasks();
         disconnectLooperSignals();
         looper = nullptr;
         mainController = nullptr;
@@ -288,6 +291,7 @@ void LooperWindow::connectLooperSignals()
     connect(looper, &Looper::stateChanged, this, &LooperWindow::updateControls);
     connect(looper, &Looper::layerChanged, this, &LooperWindow::updateControls);
     connect(looper, &Looper::maxLayersChanged, this, &LooperWindow::handleNewMaxLayers);
+    connect(looper, &Looper::layerLoaded, this, &LooperWindow::handleLayerLoaded);
     connect(looper, &Looper::modeChanged, this, &LooperWindow::handleModeChanged);
     connect(looper, &Looper::currentLayerChanged, this, &LooperWindow::updateControls);
     connect(looper, &Looper::destroyed, this, &LooperWindow::close);
@@ -301,6 +305,7 @@ void LooperWindow::disconnectLooperSignals()
     disconnect(looper, &Looper::stateChanged, this, &LooperWindow::updateControls);
     disconnect(looper, &Looper::layerChanged, this, &LooperWindow::updateControls);
     disconnect(looper, &Looper::maxLayersChanged, this, &LooperWindow::handleNewMaxLayers);
+    disconnect(looper, &Looper::layerLoaded, this, &LooperWindow::handleLayerLoaded);
     disconnect(looper, &Looper::modeChanged, this, &LooperWindow::handleModeChanged);
     disconnect(looper, &Looper::currentLayerChanged, this, &LooperWindow::updateControls);
     disconnect(looper, &Looper::destroyed, this, &LooperWindow::close);
@@ -364,6 +369,14 @@ void LooperWindow::handleNewMaxLayers(quint8 newMaxLayers)
     mainController->storeLooperPreferredLayerCount(newMaxLayers);
 }
 
+void LooperWindow::handleLayerLoaded(quint8 layer)
+{
+    Q_UNUSED(layer)
+
+    updateLayersControls(); // loaded layers gain and pan
+    updateControls();
+}
+
 void LooperWindow::LayerControlsLayout::enableMuteButton(bool enabled)
 {
     muteButton->setEnabled(enabled);
@@ -491,8 +504,8 @@ void LooperWindow::updateControls()
 
         updateMaxLayersControls();
 
-        ui->saveButton->setEnabled(looper->canSave());
-        ui->loadButton->setEnabled(looper->isStopped());
+        ui->saveButton->setEnabled(looper->canSave() && !loopTasksAreRunning());
+        ui->loadButton->setEnabled(looper->isStopped() && !loopTasksAreRunning());
 
         ui->resetButton->setEnabled(looper->isStopped() || looper->isPlaying());
 
@@ -776,14 +789,68 @@ void LooperWindow::showSaveDialogs()
     uint bpi = ninjamController->getCurrentBpi();
     quint8 bitDepth = mainController->getLooperBitDepth();
 
-    LoopSaver loopSaver(savePath, looper);
-
     loopFileName = file::sanitizeFileName(loopFileName);
-    loopSaver.save(loopFileName, bpm, bpi, encodeInOggVorbis, vorbisQuality, sampleRate, bitDepth);
 
-    looper->setLoopName(loopFileName);
+    delete loopSaver;
+    loopSaver = new LoopSaver(savePath, looper, this);
+    connect(loopSaver, &LoopSaver::finished, this, &LooperWindow::handleLoopSaved);
+    showProgressDialog(tr("Saving %1 ...").arg(loopFileName), loopSaver);
+
+    loopSaver->save(loopFileName, bpm, bpi, encodeInOggVorbis, vorbisQuality, sampleRate, bitDepth); // layers are saved in background
+
+    updateControls();
+}
+
+void LooperWindow::handleLoopSaved(bool saved)
+{
+    if (saved && looper && loopSaver)
+        looper->setLoopName(loopSaver->getLoopFileName());
+
+    if (saved && loopLibrary)
+        loopLibrary->update(); // the saved loop is listed in the load menu
+
+    updateControls();
+}
+
+void LooperWindow::handleLoopLoaded(bool loaded)
+{
+    if (!loaded)
+        qWarning() << "Loop not loaded completely";
+
+    if (!looper)
+        return;
+
+    updateLayersControls(); // update layers pan and gain after loading a loop
+
+    ui->loopNameLabel->setText(looper->getLoopName());
 
     updateControls();
+
+    update();
+}
+
+void LooperWindow::deleteLoopTasks()
+{
+    delete loopSaver; // waiting the canceled tasks
+    loopSaver = nullptr;
+
+    delete loopLoader;
+    loopLoader = nullptr;
+}
+
+audio::LoopLibrary *LooperWindow::getLoopLibrary(const QString &loopsDir)
+{
+    if (!loopLibrary || loopLibrary->getLoopsDir() != loopsDir) {
+        delete loopLibrary;
+        loopLibrary = new audio::LoopLibrary(loopsDir, this);
+    }
+
+    return loopLibrary;
+}
+
+bool LooperWindow::loopTasksAreRunning() const
+{
+    return (loopSaver && loopSaver->isRunning()) || (loopLoader && loopLoader->isRunning());
 }
 
 QString LooperWindow::getOptionName(Looper::RecordingOption option)
@@ -879,7 +946,7 @@ void LooperWindow::showLoadMenu()
     quint16 currentBpm = ninjamController->getCurrentBpm();
 
     QString loopsDir = mainController->getSettings().getLooperSavePath();
-    QList<LoopInfo> loopsInfos = LoopLoader::loadLoopsInfo(loopsDir, currentBpm);
+    QList<LoopInfo> loopsInfos = getLoopLibrary(loopsDir)->getLoops(currentBpm); // not reading the loop files
 
     QString matchedMenuText = (!loopsInfos.isEmpty()) ? (tr("%1 BPM loops").arg(currentBpm)) : (tr("No loops for %1 BPM").arg(currentBpm));
     QMenu *bpmMatchedMenu = new QMenu(matchedMenuText);
@@ -887,6 +954,7 @@ void LooperWindow::showLoadMenu()
     for (const LoopInfo &loopInfo : loopsInfos) {
         QString loopString = loopInfo.toString();
         QAction *action = bpmMatchedMenu->addAction(loopString);
+        action->setIcon(IconFactory::createLoopThumbnailIcon(loopInfo.getThumbnailPeaks(), tintColor));
         connect(action, &QAction::triggered, [=](){
             loadLoopInfo(loopsDir, loopInfo);
         });
@@ -1003,18 +1071,18 @@ void LooperWindow::loadLoopInfo(const QString &loopDir, const LoopInfo &loopInfo
 
         ui->loopNameLabel->setText("");
 
-        LoopLoader loader(loopDir);
+        delete loopLoader;
+        loopLoader = new LoopLoader(loopDir, this);
+        connect(loopLoader, &LoopLoader::finished, this, &LooperWindow::handleLoopLoaded);
+        showProgressDialog(tr("Loading %1 ...").arg(loopInfo.getName()), loopLoader);
+
         uint currentSampleRate = mainController->getSampleRate();
         quint32 samplesPerInterval = mainController->getNinjamController()->getSamplesPerInterval();
-        loader.load(loopInfo, looper, currentSampleRate, samplesPerInterval);
-
-        updateLayersControls(); // update layers pan and gain after loading a loop
+        loopLoader->load(loopInfo, looper, currentSampleRate, samplesPerInterval); // layers are loaded in background
 
         updateModeComboBox();
 
-        ui->loopNameLabel->setText(loopInfo.getName());
-
-        update();
+        updateControls();
     }
     else {
         qCritical() << "Can't load loop " << loopInfo.getName() << " in " << loopDir;
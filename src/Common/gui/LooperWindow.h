@@ -9,9 +9,11 @@
 #include <QPushButton>
 #include <QLabel>
 #include <QTimer>
+#include <QProgressDialog>
 
 #include "looper/Looper.h"
 #include "looper/LooperPersistence.h"
+#include "looper/LoopLibrary.h"
 #include "looper/LooperLayer.h"
 #include "widgets/BlinkableButton.h"
 #include "widgets/Slider.h"
@@ -30,6 +32,7 @@ using audio::Looper;
 using audio::LooperLayer;
 using audio::LooperState;
 using audio::LoopSaver;
+using audio::LoopLoader;
 using audio::LoopLayerInfo;
 using audio::AudioPeak;
 using controller::MainController;
@@ -56,6 +59,7 @@ private slots:
     void updateBeatsPerInterval();
     void updateCurrentBeat(uint currentIntervalBeat);
     void handleNewMaxLayers(quint8 newMaxLayers);
+    void handleLayerLoaded(quint8 layer);
     void handleModeChanged();
     void updateControls();
     void showLoadMenu();
@@ -68,11 +72,34 @@ private slots:
     void resetAll();
 
     void showSaveDialogs();
+    void handleLoopSaved(bool saved);
+    void handleLoopLoaded(bool loaded);
 
 private:
     Ui::LooperWindow *ui;
     Looper *looper;
 
+    LoopSaver *loopSaver;
+    LoopLoader *loopLoader;
+    audio::LoopLibrary *loopLibrary;
+
+    audio::LoopLibrary *getLoopLibrary(const QString &loopsDir); // recreated when the looper folder is changed
+
+    void deleteLoopTasks(); // running tasks are canceled
+    bool loopTasksAreRunning() const;
+
+    template<class LoopTask>
+    void showProgressDialog(const QString &text, LoopTask *task)
+    {
+        QProgressDialog *dialog = new QProgressDialog(text, tr("Cancel"), 0, 100, this);
+        dialog->setMinimumDuration(500); // not showed when saving or loading small loops
+
+        connect(task, &LoopTask::progressChanged, dialog, &QProgressDialog::setValue);
+        connect(dialog, &QProgressDialog::canceled, task, &LoopTask::cancel);
+        connect(task, &LoopTask::finished, dialog, &QProgressDialog::deleteLater);
+        connect(task, &LoopTask::destroyed, dialog, &QProgressDialog::deleteLater);
+    }
+
     class LayerControlsLayout : public QHBoxLayout
     {
     public:
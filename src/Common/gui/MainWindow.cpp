@@ -29,6 +29,7 @@
 #include "log/Logging.h"
 #include "audio/core/LocalInputNode.h"
 #include "audio/RoomStreamerNode.h"
+#include "audio/core/LatencyProbes.h"
 #include "performance/PerformanceMonitor.h"
 #include "video/VideoFrameGrabber.h"
 #include "chat/NinjamChatMessageParser.h"
@@ -90,6 +91,7 @@ MainWindow::MainWindow(MainController *mainController, QWidget *parent) :
     buttonCollapseChat(nullptr),
     buttonCollapseBottomArea(nullptr),
     performanceMonitorLabel(nullptr),
+    latencyProbesLabel(nullptr),
     xmitInactivityDetector(nullptr),
     screensaverBlocker(new ScreensaverBlocker()),
     usersColorsPool(new UsersColorsPool()),
@@ -162,6 +164,10 @@ void MainWindow::setupMainTabCornerWidgets()
     performanceMonitorLabel->setVisible(false); // showing RAM monitor in windows only
 #endif
 
+    latencyProbesLabel = new QLabel();
+    latencyProbesLabel->setObjectName(QStringLiteral("labelLatencyProbes"));
+    latencyProbesLabel->setVisible(false);
+
     transmitTransferRateLabel = new QLabel(this);
     transmitTransferRateLabel->setObjectName(QStringLiteral("transmitTransferRateLabel"));
     transmitTransferRateLabel->setSizePolicy(QSizePolicy::Maximum, QSizePolicy::Preferred);
@@ -191,6 +197,7 @@ void MainWindow::setupMainTabCornerWidgets()
     frameLayout->addLayout(transferRateLayout);
     frameLayout->addSpacing(6);
     frameLayout->addWidget(performanceMonitorLabel);
+    frameLayout->addWidget(latencyProbesLabel);
     frameLayout->addSpacing(6);
     frameLayout->addWidget(buttonCollapseLocalChannels);
     frameLayout->addWidget(buttonCollapseBottomArea);
@@ -2191,6 +2198,17 @@ void MainWindow::timerEvent(QTimerEvent *)
 
                }
 
+        if (latencyProbesLabel) {
+            bool showLatencyProbes = audio::LatencyProbes::isEnabled();
+            if (showLatencyProbes) {
+                auto report = audio::LatencyProbes::collect();
+                const auto &callback = report.probes[audio::LatencyProbes::MainControllerProcess];
+                latencyProbesLabel->setText(QString("DSP: %1% p99: %2us").arg(report.dspLoad, 0, 'f', 0).arg(callback.p99, 0, 'f', 0));
+                latencyProbesLabel->setToolTip(audio::LatencyProbes::toString(report)); // all probes
+            }
+            latencyProbesLabel->setVisible(showLatencyProbes);
+        }
+
         lastPerformanceMonitorUpdate = now;
     }
 
@@ -2247,6 +2265,10 @@ void MainWindow::timerEvent(QTimerEvent *)
             QString transmitText = QString("%1 %2 Kbps")
                                             .arg(tr("Uploading"))
                                             .arg(transmitTransferRate);
+            auto ninjamController = mainController->getNinjamController();
+            const uint droppedUploads = ninjamController ? ninjamController->getEncodingDroppedChunks() : 0;
+            if (droppedUploads > 0)
+                transmitText += QString(" (%1: %2)").arg(tr("dropped audio blocks")).arg(droppedUploads);
             transmitTransferRateLabel->setToolTip(transmitText);
             transmitIcon->setToolTip(transmitTransferRateLabel->toolTip());
 
@@ -2255,8 +2277,11 @@ void MainWindow::timerEvent(QTimerEvent *)
             QString receiveText = QString("%1 %2 Kbps")
                                             .arg(tr("Downloading"))
                                             .arg(receiveTransferRate);
+            const quint64 droppedDownloads = mainController->getDroppedDownloads();
+            if (droppedDownloads > 0)
+                receiveText += QString(" (%1: %2)").arg(tr("dropped intervals")).arg(droppedDownloads);
             receiveTransferRateLabel->setToolTip(receiveText);
-            receiveIcon->setToolTip(transmitTransferRateLabel->toolTip());
+            receiveIcon->setToolTip(receiveTransferRateLabel->toolTip());
 
             lastNetworkTransferRateUpdate = now;
         }
@@ -2494,6 +2519,8 @@ void MainWindow::setupPreferencesDialogSignals(PreferencesDialog *dialog)
 
     connect(dialog, &PreferencesDialog::jamDateFormatChanged, this, &MainWindow::setJamDirectoryDateFormat);
 
+    connect(dialog, &PreferencesDialog::singleFilePerTrackRecordingChanged, mainController, &MainController::storeSingleFilePerTrackRecording);
+
     connect(dialog, &PreferencesDialog::builtInMetronomeSelected, this, &MainWindow::setBuiltInMetronome);
 
     connect(dialog, &PreferencesDialog::customMetronomeSelected, this, &MainWindow::setCustomMetronome);
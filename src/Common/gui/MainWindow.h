@@ -343,6 +343,7 @@ private:
     QPushButton *buttonCollapseBottomArea;
 
     QLabel *performanceMonitorLabel;
+    QLabel *latencyProbesLabel; // debug overlay, visible when audio latency probes are enabled
 
     InactivityDetector *xmitInactivityDetector;
 
@@ -301,6 +301,13 @@ void NinjamTrackView::updateGuiElements()
             toolTipText += QString(" (%1, %2 KHz)")
                     .arg(trackNode->isStereo() ? tr("Stereo") : tr("Mono"))
                     .arg(QString::number(trackNode->getSampleRate()/1000.0, 'f', 1));
+
+            const uint droppedIntervals = trackNode->getDroppedIntervals();
+            const uint lateIntervals = trackNode->getLateIntervals();
+            if (droppedIntervals > 0 || lateIntervals > 0)
+                toolTipText += QString("\n%1: %2, %3: %4")
+                        .arg(tr("Dropped intervals")).arg(droppedIntervals)
+                        .arg(tr("Late intervals")).arg(lateIntervals);
         }
 
         networkUsageLabel->setToolTip(toolTipText);
@@ -121,6 +121,7 @@ void PreferencesDialog::setupSignals()
 
     connect(ui->recordingCheckBox, SIGNAL(clicked(bool)), this, SLOT(toggleRecording(bool)));
     connect(ui->browseRecPathButton, SIGNAL(clicked(bool)), this, SLOT(openRecordingPathBrowser()));
+    connect(ui->singleFilePerTrackCheckBox, &QCheckBox::clicked, this, &PreferencesDialog::singleFilePerTrackRecordingChanged);
     for(const QRadioButton *rb : jamDateFormatRadioButtons.keys()) {
         connect(rb, &QRadioButton::toggled, [=]() {
             if (rb->isChecked()) {
@@ -325,6 +326,8 @@ void PreferencesDialog::populateMultiTrackRecordingTab()
         ((QRadioButton *)myRadioButton)->setChecked(QString::compare(recordingSettings.dirNameDateFormat, jamDateFormatRadioButtons[myRadioButton]) == 0);
     }
 
+    ui->singleFilePerTrackCheckBox->setChecked(settings->isSingleFilePerTrackRecording());
+
     QDir recordDir(recordingSettings.recordingPath);
     ui->recordPathLineEdit->setText(recordDir.absolutePath());
 }
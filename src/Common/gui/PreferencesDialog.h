@@ -41,6 +41,7 @@ signals:
     void jamRecorderStatusChanged(const QString &writerId, bool status);
     void recordingPathSelected(const QString &newRecordingPath);
     void jamDateFormatChanged(QString dateFormat);
+    void singleFilePerTrackRecordingChanged(bool singleFile);
     void encodingQualityChanged(float newEncodingQuality);
     void looperAudioEncodingFlagChanged(bool savingEncodedAudio);
     void looperWaveFilesBitDepthChanged(quint8 bitDepth);
@@ -229,8 +229,9 @@ void PrivateServerWindow::timerEvent(QTimerEvent *)
 
     quint64 download = server->getDownloadTransferRate() / 1024 * 8; // Kbps
     quint64 upload = server->getUploadTransferRate() / 1024 * 8;
+    quint64 saved = server->getSavedUploadTransferRate() / 1024 * 8; // intervals not sent to users not listening
     ui->labelDownloadValue->setText(QString::number(download));
-    ui->labelUploadValue->setText(QString::number(upload));
+    ui->labelUploadValue->setText(tr("%1 (%2 saved)").arg(upload).arg(saved));
 }
 
 void PrivateServerWindow::changeEvent(QEvent *ev)
@@ -0,0 +1,94 @@
+#ifndef _LOOP_INFO_H_
+#define _LOOP_INFO_H_
+
+#include <QString>
+#include <QList>
+#include <QVector>
+
+namespace audio {
+
+struct LoopLayerInfo
+{
+    float pan;
+    float gain;
+    bool locked;
+    QVector<float> peaks; // thumbnail, empty in loops saved by older versions
+};
+
+class LoopInfo
+{
+public:
+    LoopInfo(quint32 bpm, quint16 bpi, const QString &name, bool usingEncodedAudio, quint8 mode);
+    LoopInfo();
+
+    void addLayer(bool isLocked, float gain, float pan, const QVector<float> &peaks = QVector<float>());
+
+    bool isValid() const;
+
+    QString toString(bool showBpm = false) const;
+
+    quint8 getLayersCount() const;
+
+    bool audioIsEncoded() const;
+
+    QString getName() const;
+
+    QList<LoopLayerInfo> getLayersInfo() const;
+    QVector<float> getThumbnailPeaks() const; // the max peaks of all layers
+
+    quint8 getLooperMode() const;
+
+    quint16 getBpi() const;
+    quint32 getBpm() const;
+
+    static LoopInfo fromFile(const QString &loopFilePath); // invalid loop info if the json file can't be parsed
+
+    static const int THUMBNAIL_PEAKS; // peaks saved per layer
+
+private:
+    quint32 bpm;
+    quint16 bpi;
+    QString name;
+    bool usingEncodedAudio;
+    QList<LoopLayerInfo> layers;
+    quint8 looperMode;
+};
+
+inline quint16 LoopInfo::getBpi() const
+{
+    return bpi;
+}
+
+inline quint32 LoopInfo::getBpm() const
+{
+    return bpm;
+}
+
+inline quint8 LoopInfo::getLooperMode() const
+{
+    return looperMode;
+}
+
+inline quint8 LoopInfo::getLayersCount() const
+{
+    return layers.size();
+}
+
+inline bool LoopInfo::audioIsEncoded() const
+{
+    return usingEncodedAudio;
+}
+
+inline QString LoopInfo::getName() const
+{
+    return name;
+}
+
+inline QList<LoopLayerInfo> LoopInfo::getLayersInfo() const
+{
+    return layers;
+}
+
+} // namespace
+
+#endif
@@ -0,0 +1,228 @@
+#include "LoopLibrary.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QDateTime>
+#include <QSet>
+#include <QDebug>
+
+#include <algorithm>
+
+using audio::LoopLibrary;
+using audio::LoopInfo;
+using audio::LoopLayerInfo;
+
+const QString LoopLibrary::INDEX_FILE_NAME("loops.index");
+
+namespace {
+
+const quint32 MAGIC = 0x494C544A; // "JTLI"
+
+/**
+   - Revision 1: loop infos with the layers thumbnail peaks
+*/
+const quint32 REVISION = 1;
+
+const int UPDATE_DELAY = 300; // ms
+
+} // namespace
+
+LoopLibrary::LoopLibrary(const QString &loopsDir, QObject *parent) :
+    QObject(parent),
+    loopsDir(loopsDir)
+{
+    updateTimer.setSingleShot(true);
+    updateTimer.setInterval(UPDATE_DELAY);
+    connect(&updateTimer, &QTimer::timeout, this, &LoopLibrary::update);
+    connect(&watcher, &QFileSystemWatcher::directoryChanged, &updateTimer, static_cast<void (QTimer::*)()>(&QTimer::start));
+
+    loadIndex();
+    update(); // only the loops changed since the index was saved are parsed
+}
+
+QList<LoopInfo> LoopLibrary::getLoops(quint32 bpm) const
+{
+    QList<LoopInfo> loops;
+    for (const QString &fileName : loopsByBpm.value(bpm))
+        loops.append(entries[fileName].info);
+
+    return loops;
+}
+
+QList<LoopInfo> LoopLibrary::getLoops(quint32 minBpm, quint32 maxBpm) const
+{
+    QList<quint32> bpms; // only the BPMs with saved loops, less than 400 in the worst case
+    for (auto it = loopsByBpm.constBegin(); it != loopsByBpm.constEnd(); ++it) {
+        if (it.key() >= minBpm && it.key() <= maxBpm)
+            bpms.append(it.key());
+    }
+    std::sort(bpms.begin(), bpms.end());
+
+    QList<LoopInfo> loops;
+    for (quint32 bpm : bpms)
+        loops.append(getLoops(bpm));
+
+    return loops;
+}
+
+int LoopLibrary::getLoopsCount() const
+{
+    int count = 0;
+    for (const auto &fileNames : loopsByBpm)
+        count += fileNames.size();
+
+    return count;
+}
+
+void LoopLibrary::update()
+{
+    watchLoopsDir();
+
+    const QFileInfoList files = QDir(loopsDir).entryInfoList(QStringList("*.json"), QDir::NoDotAndDotDot | QDir::Files);
+
+    bool changed = false;
+    QSet<QString> existingFiles;
+    for (const QFileInfo &fileInfo : files) {
+        const QString fileName = fileInfo.fileName();
+        const qint64 lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+        existingFiles.insert(fileName);
+
+        auto it = entries.constFind(fileName);
+        if (it != entries.constEnd() && it->fileSize == fileInfo.size() && it->lastModified == lastModified)
+            continue; // not changed
+
+        Entry entry;
+        entry.info = LoopInfo::fromFile(fileInfo.absoluteFilePath());
+        entry.fileSize = fileInfo.size();
+        entry.lastModified = lastModified;
+
+        removeEntry(fileName);
+        addEntry(fileName, entry);
+        changed = true;
+    }
+
+    for (const QString &fileName : entries.keys()) {
+        if (!existingFiles.contains(fileName)) { // deleted loop
+            removeEntry(fileName);
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        saveIndex();
+        emit loopsChanged();
+    }
+}
+
+void LoopLibrary::addEntry(const QString &fileName, const Entry &entry)
+{
+    entries.insert(fileName, entry);
+
+    if (!entry.info.isValid())
+        return; // indexed to avoid parsing the file again, but not listed
+
+    QStringList &fileNames = loopsByBpm[entry.info.getBpm()];
+    fileNames.insert(std::lower_bound(fileNames.begin(), fileNames.end(), fileName), fileName);
+}
+
+void LoopLibrary::removeEntry(const QString &fileName)
+{
+    auto it = entries.find(fileName);
+    if (it == entries.end())
+        return;
+
+    const quint32 bpm = it->info.getBpm();
+    auto bpmIt = loopsByBpm.find(bpm);
+    if (bpmIt != loopsByBpm.end()) {
+        bpmIt->removeOne(fileName);
+        if (bpmIt->isEmpty())
+            loopsByBpm.erase(bpmIt);
+    }
+
+    entries.erase(it);
+}
+
+void LoopLibrary::watchLoopsDir()
+{
+    if (watcher.directories().isEmpty() && QDir(loopsDir).exists())
+        watcher.addPath(loopsDir); // the looper folder is created when the first loop is saved
+}
+
+bool LoopLibrary::loadIndex()
+{
+    QFile file(QDir(loopsDir).absoluteFilePath(INDEX_FILE_NAME));
+    if (!file.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    quint32 magic, revision, count;
+    stream >> magic >> revision >> count;
+    if (magic != MAGIC || revision != REVISION)
+        return false; // all loop files are parsed again
+
+    for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        QString fileName, name;
+        Entry entry;
+        quint32 bpm;
+        quint16 bpi;
+        bool encoded;
+        quint8 mode, layers;
+        stream >> fileName >> entry.fileSize >> entry.lastModified >> bpm >> bpi >> name >> encoded >> mode >> layers;
+
+        entry.info = LoopInfo(bpm, bpi, name, encoded, mode);
+        for (quint8 l = 0; l < layers; ++l) {
+            bool locked;
+            float gain, pan;
+            QVector<float> peaks;
+            stream >> locked >> gain >> pan >> peaks;
+            entry.info.addLayer(locked, gain, pan, peaks);
+        }
+
+        if (stream.status() == QDataStream::Ok)
+            addEntry(fileName, entry);
+    }
+
+    if (stream.status() != QDataStream::Ok) {
+        qWarning() << "Discarding the corrupted loops index" << file.fileName();
+        entries.clear();
+        loopsByBpm.clear();
+        return false;
+    }
+
+    return true;
+}
+
+void LoopLibrary::saveIndex() const
+{
+    if (!QDir(loopsDir).exists())
+        return;
+
+    QSaveFile file(QDir(loopsDir).absoluteFilePath(INDEX_FILE_NAME));
+    if (!file.open(QFile::WriteOnly)) {
+        qCritical() << "Can't write the loops index" << file.fileName() << file.errorString();
+        return;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_2);
+    stream.setFloatingPointPrecision(QDataStream::SinglePrecision);
+
+    stream << MAGIC << REVISION << static_cast<quint32>(entries.size());
+    for (auto it = entries.constBegin(); it != entries.constEnd(); ++it) {
+        const LoopInfo &info = it->info;
+        stream << it.key() << it->fileSize << it->lastModified << info.getBpm() << info.getBpi() << info.getName()
+               << info.audioIsEncoded() << info.getLooperMode() << info.getLayersCount();
+
+        for (const LoopLayerInfo &layer : info.getLayersInfo())
+            stream << layer.locked << layer.gain << layer.pan << layer.peaks;
+    }
+
+    if (!file.commit())
+        qCritical() << "Can't write the loops index" << file.fileName() << file.errorString();
+}
@@ -0,0 +1,77 @@
+#ifndef _LOOP_LIBRARY_H_
+#define _LOOP_LIBRARY_H_
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QList>
+#include <QTimer>
+#include <QFileSystemWatcher>
+
+#include "LoopInfo.h"
+
+namespace audio {
+
+/**
+ * Index of the loops saved in the looper folder. The loop json files are parsed only once: the
+ * parsed infos (and the layers thumbnail peaks) are stored in an index file in the same folder, and
+ * only the json files added or changed since the last scan (using the size and modification time)
+ * are parsed again. The folder is watched, so loops saved or deleted outside JamTaba are indexed too.
+ *
+ * Loops are grouped by BPM, the looper load menu is listing the loops without touching the disk.
+ */
+
+class LoopLibrary : public QObject
+{
+    Q_OBJECT
+
+public:
+    explicit LoopLibrary(const QString &loopsDir, QObject *parent = nullptr);
+
+    QString getLoopsDir() const;
+
+    QList<LoopInfo> getLoops(quint32 bpm) const; // sorted by name
+    QList<LoopInfo> getLoops(quint32 minBpm, quint32 maxBpm) const;
+    int getLoopsCount() const;
+
+    static const QString INDEX_FILE_NAME;
+
+public slots:
+    void update(); // scan the folder, only new and changed loop files are parsed
+
+signals:
+    void loopsChanged();
+
+private:
+    struct Entry
+    {
+        LoopInfo info;
+        qint64 fileSize;
+        qint64 lastModified; // msecs since epoch
+    };
+
+    void addEntry(const QString &fileName, const Entry &entry);
+    void removeEntry(const QString &fileName);
+
+    bool loadIndex();
+    void saveIndex() const;
+
+    void watchLoopsDir();
+
+    QString loopsDir;
+    QHash<QString, Entry> entries; // by json file name, invalid loop files are indexed too
+    QHash<quint32, QStringList> loopsByBpm; // valid loops file names, sorted
+
+    QFileSystemWatcher watcher;
+    QTimer updateTimer; // many changes are reported when a loop is saved
+};
+
+inline QString LoopLibrary::getLoopsDir() const
+{
+    return loopsDir;
+}
+
+} // namespace
+
+#endif
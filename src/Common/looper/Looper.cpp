@@ -8,11 +8,13 @@
 #include <cstring>
 #include <vector>
 #include <QThread>
+#include <QMutexLocker>
 
 using audio::Looper;
 using audio::AudioPeak;
 using audio::SamplesBuffer;
 using audio::LooperState;
+using audio::LooperLayer;
 
 Looper::Looper()
     : Looper(Mode::Sequence, 4) // calling overloaded constructor
@@ -27,6 +29,11 @@ Looper::Looper(Looper::Mode initialMode, quint8 maxLayers) :
     loading(false),
     waitingToStop(false),
     activated(true),
+    reservedSamples(0),
+    armed(false),
+    requiredSamples(0),
+    truncatedRecordings(0),
+    reportedTruncatedRecordings(0),
     currentLayerIndex(0),
     focusedLayerIndex(0),
     maxLayers(maxLayers),
@@ -37,10 +44,14 @@ Looper::Looper(Looper::Mode initialMode, quint8 maxLayers) :
     mode(initialMode)
 {
     // initialize
-    for (int l = 0; l < MAX_LOOP_LAYERS; ++l) { // create all possible layers
+    for (int l = 0; l < MAX_LOOP_LAYERS; ++l) { // all possible layers, the memory is allocated in reserve()
         layers[l] = new LooperLayer();
+        loadedLayers[l] = nullptr;
     }
 
+    for (auto &retired : retiredLayers)
+        retired = nullptr;
+
     Looper::Mode modes[] = {Looper::Sequence, Looper::AllLayers, Looper::SelectedLayer};
     for (Looper::Mode mode : modes) {
         modeOptions[mode].recordingOptions = getDefaultSupportedRecordingOptions(mode);
@@ -59,7 +70,7 @@ void Looper::nextMuteState(quint8 layer) // called when 'mute button' is clicked
 {
     bool canMute = layer < maxLayers && mode == Looper::AllLayers;
     if (canMute) {
-        const LooperLayer::MuteState currentState = layers[layer]->getMuteState();
+        const LooperLayer::MuteState currentState = getActiveLayer(layer)->getMuteState();
         LooperLayer::MuteState newMuteState = currentState;
 
         switch (currentState) {
@@ -77,7 +88,7 @@ void Looper::nextMuteState(quint8 layer) // called when 'mute button' is clicked
             break;
         }
 
-        layers[layer]->setMuteState(newMuteState);
+        getActiveLayer(layer)->setMuteState(newMuteState);
         emit layerMuteStateChanged(layer, static_cast<quint8>(newMuteState));
     }
 }
@@ -90,7 +101,7 @@ void Looper::setMainGain(float gain)
 float Looper::getLayerGain(quint8 layer) const
 {
     if (layer < maxLayers)
-        return layers[layer]->getGain();
+        return getLatestLayer(layer)->getGain();
 
     return 1.0;
 }
@@ -98,7 +109,7 @@ float Looper::getLayerGain(quint8 layer) const
 float Looper::getLayerPan(quint8 layer) const
 {
     if (layer < maxLayers)
-        return layers[layer]->getPan();
+        return getLatestLayer(layer)->getPan();
 
     return 0.0;
 }
@@ -144,18 +155,129 @@ void Looper::resetLayersContent()
 
 Looper::~Looper()
 {
+    armed = false; // the deleted layers are not grown in reclaimMemory()
+
     for (int l = 0; l < MAX_LOOP_LAYERS; ++l) {
-        if (layers[l])
-            delete layers[l];
+        delete layers[l].exchange(nullptr);
+        delete loadedLayers[l].exchange(nullptr);
+    }
+
+    reclaimMemory();
+}
+
+void Looper::reserve(uint samplesPerInterval)
+{
+    QMutexLocker locker(&reserveMutex);
+
+    reservedSamples = qMax(reservedSamples, samplesPerInterval);
+
+    if (armed)
+        growLayers(maxLayers, reservedSamples);
+}
+
+void Looper::arm()
+{
+    QMutexLocker locker(&reserveMutex);
+
+    armed = true;
+
+    growLayers(qMax(maxLayers, newMaxLayersRequested), qMax(reservedSamples, requiredSamples.load()));
+}
+
+void Looper::growLayers(quint8 layersCount, uint samples)
+{
+    samples = qMax(samples, LooperLayer::SEGMENT_SAMPLES); // short recordings before the first interval lenght is known
+
+    // the layers are not deleted while reserveMutex is locked, the audio thread is only retiring them
+    for (quint8 l = 0; l < qMin(layersCount, static_cast<quint8>(MAX_LOOP_LAYERS)); ++l) {
+        getActiveLayer(l)->reserve(samples);
+
+        auto loadedLayer = loadedLayers[l].load();
+        if (loadedLayer)
+            loadedLayer->reserve(samples);
+    }
+}
+
+void Looper::reclaimMemory()
+{
+    QMutexLocker locker(&reserveMutex);
+
+    for (auto &retired : retiredLayers)
+        delete retired.exchange(nullptr);
+
+    for (auto layer : discardedLayers)
+        delete layer;
+
+    discardedLayers.clear();
+
+    const uint truncated = truncatedRecordings.load();
+    if (truncated != reportedTruncatedRecordings) {
+        qWarning() << "Looper memory is shorter than the interval," << (truncated - reportedTruncatedRecordings) << "recorded cycles were truncated";
+        reportedTruncatedRecordings = truncated;
+    }
+
+    if (armed)
+        growLayers(maxLayers, qMax(reservedSamples, requiredSamples.load()));
+}
+
+int Looper::getFreeRetiredSlots() const
+{
+    int freeSlots = 0;
+    for (const auto &retired : retiredLayers) {
+        if (!retired.load())
+            freeSlots++;
+    }
+
+    return freeSlots;
+}
 
-        layers[l] = nullptr;
+void Looper::retire(LooperLayer *layer)
+{
+    // only the audio thread store retired layers, the slots checked in getFreeRetiredSlots() are still free
+    for (auto &retired : retiredLayers) {
+        if (!retired.load()) {
+            retired.store(layer);
+            return;
+        }
+    }
+
+    Q_ASSERT(false);
+}
+
+void Looper::adoptLoadedLayers()
+{
+    for (quint8 l = 0; l < MAX_LOOP_LAYERS; ++l) {
+        if (!loadedLayers[l].load())
+            continue;
+
+        if (getFreeRetiredSlots() == 0)
+            return; // the retired layers were not reclaimed yet, trying again in the next processed buffer
+
+        // just swapping pointers, the loaded layer was built and the memory was allocated by control threads
+        auto loadedLayer = loadedLayers[l].exchange(nullptr);
+        if (!loadedLayer)
+            continue;
+
+        retire(layers[l].exchange(loadedLayer));
+
+        emit layerLoaded(l);
     }
 }
 
+template <typename Function>
+void Looper::updateLayer(quint8 index, Function function)
+{
+    function(getActiveLayer(index));
+
+    auto loadedLayer = loadedLayers[index].load();
+    if (loadedLayer)
+        function(loadedLayer);
+}
+
 void Looper::setLayerGain(quint8 layerIndex, float gain)
 {
     if (layerIndex < maxLayers) {
-        layers[layerIndex]->setGain(gain);
+        updateLayer(layerIndex, [gain](LooperLayer *layer) { layer->setGain(gain); });
         setChanged(true);
         emit layerChanged(layerIndex);
     }
@@ -164,7 +286,7 @@ void Looper::setLayerGain(quint8 layerIndex, float gain)
 void Looper::setLayerPan(quint8 layerIndex, float pan)
 {
     if (layerIndex < maxLayers) {
-        layers[layerIndex]->setPan(pan);
+        updateLayer(layerIndex, [pan](LooperLayer *layer) { layer->setPan(pan); });
         setChanged(true);
         emit layerChanged(layerIndex);
     }
@@ -174,7 +296,7 @@ uint Looper::getLockedLayers() const
 {
     uint lockedLayers = 0;
     for (int l = 0; l < maxLayers; ++l) {
-        if (layers[l]->isLocked())
+        if (getActiveLayer(l)->isLocked())
             lockedLayers++;
     }
     return lockedLayers;
@@ -218,13 +340,13 @@ void Looper::incrementCurrentLayer()
 
 void Looper::appendInCurrentLayer(const SamplesBuffer &samples, uint samplesToAppend)
 {
-     layers[currentLayerIndex]->append(samples, samplesToAppend, intervalPosition);
+     getActiveLayer(currentLayerIndex)->append(samples, samplesToAppend, intervalPosition);
      setChanged(true);
 }
 
 void Looper::overdubInCurrentLayer(const SamplesBuffer &samples, uint samplesToMix)
 {
-    layers[currentLayerIndex]->overdub(samples, samplesToMix, intervalPosition);
+    getActiveLayer(currentLayerIndex)->overdub(samples, samplesToMix, intervalPosition);
     setChanged(true);
 }
 
@@ -235,12 +357,12 @@ void Looper::mixCurrentLayerTo(SamplesBuffer &samples, uint samplesToMix)
 
 bool Looper::currentLayerIsLocked() const
 {
-    return layers[currentLayerIndex]->isLocked();
+    return getActiveLayer(currentLayerIndex)->isLocked();
 }
 
 void Looper::toggleLayerLockedState(quint8 layerIndex)
 {
-    setLayerLockedState(layerIndex, !(layers[layerIndex]->isLocked()));
+    setLayerLockedState(layerIndex, !(getLatestLayer(layerIndex)->isLocked()));
 }
 
 bool Looper::canLockLayer(quint8 layer) const
@@ -254,7 +376,7 @@ bool Looper::canLockLayer(quint8 layer) const
 void Looper::setLayerLockedState(quint8 layerIndex, bool locked)
 {
     if (canLockLayer(layerIndex)) {
-        layers[layerIndex]->setLocked(locked);
+        updateLayer(layerIndex, [locked](LooperLayer *layer) { layer->setLocked(locked); });
 
         if (locked && focusedLayerIndex == layerIndex)
             focusedLayerIndex = -1; // clear focused layer when locking
@@ -268,7 +390,7 @@ void Looper::setLayerLockedState(quint8 layerIndex, bool locked)
 bool Looper::layerIsLocked(quint8 layerIndex) const
 {
     if (layerIndex < maxLayers)
-        return layers[layerIndex]->isLocked();
+        return getActiveLayer(layerIndex)->isLocked(); // the loaded layers are using the same locked state
 
     return false;
 }
@@ -276,7 +398,7 @@ bool Looper::layerIsLocked(quint8 layerIndex) const
 bool Looper::layerIsValid(quint8 layerIndex) const
 {
     if (layerIndex < maxLayers)
-        return layers[layerIndex]->isValid();
+        return getLatestLayer(layerIndex)->isValid();
 
     return false;
 }
@@ -291,7 +413,7 @@ void Looper::startRecording()
 
         bool isOverdubbing = getOption(Looper::Overdub);
         if (!isOverdubbing) // avoid discard layer content if is overdubbing
-            layers[currentLayerIndex]->zero();
+            getActiveLayer(currentLayerIndex)->zero();
 
         setState(new RecordingState(this, firstRecordingLayer));
     }
@@ -306,6 +428,7 @@ void Looper::toggleRecording()
         quint8 startFrom = (focusedLayerIndex >= 0) ? focusedLayerIndex : currentLayerIndex;
         int firstRecordingLayer = getFirstUnlockedLayerIndex(startFrom);
         if (firstRecordingLayer >= 0) {
+            arm(); // the layers memory is allocated before the first recorded buffer
             setState(new WaitingToRecordState(this));
             setCurrentLayer(firstRecordingLayer);
         }
@@ -354,7 +477,7 @@ bool Looper::canClearLayer(quint8 layer) const
 void Looper::clearLayer(quint8 layer)
 {
     if (canClearLayer(layer)) {
-        layers[layer]->zero();
+        updateLayer(layer, [](LooperLayer *layer) { layer->zero(); });
         setChanged(true);
         emit layerChanged(layer);
     }
@@ -422,6 +545,12 @@ void Looper::setLayers(quint8 maxLayers, bool processChangeRequestNow)
 
     newMaxLayersRequested = maxLayers; // schedule the max layer change to next process
 
+    {
+        QMutexLocker locker(&reserveMutex);
+        if (armed)
+            growLayers(maxLayers, qMax(reservedSamples, requiredSamples.load()));
+    }
+
     if (processChangeRequestNow)
         processChangeRequests();
 }
@@ -432,7 +561,7 @@ int Looper::getFirstLockedLayerIndex(quint8 startingFrom) const
     quint8 layer = startingFrom % maxLayers;
 
     while (testedLayers < maxLayers) {
-        if (layers[layer]->isLocked())
+        if (getActiveLayer(layer)->isLocked())
             return layer;
 
         layer = (layer + 1) % maxLayers;
@@ -448,7 +577,7 @@ int Looper::getFirstUnlockedLayerIndex(quint8 startingFrom) const
     quint8 layer = startingFrom % maxLayers;
 
     while (testedLayers < maxLayers) {
-        if (!layers[layer]->isLocked())
+        if (!getActiveLayer(layer)->isLocked())
             return layer;
 
         layer = (layer + 1) % maxLayers;
@@ -481,6 +610,9 @@ void Looper::addBuffer(const SamplesBuffer &samples)
     if (!activated)
         return;
 
+    if (!resetRequested)
+        adoptLoadedLayers(); // the layers loaded by control threads are used in this buffer
+
     uint samplesToProcess = qMin(samples.getFrameLenght(), intervalLenght - intervalPosition);
     state->addBuffer(samples, samplesToProcess);
 }
@@ -490,6 +622,9 @@ void Looper::mixToBuffer(SamplesBuffer &samples)
     if (!activated)
         return;
 
+    if (!resetRequested)
+        adoptLoadedLayers();
+
     uint samplesToProcess = qMin(samples.getFrameLenght(), intervalLenght - intervalPosition);
     AudioPeak peakBeforeMix = samples.computePeak();
     state->mixTo(samples, samplesToProcess);
@@ -510,13 +645,15 @@ void Looper::processChangeRequests()
     // reset requested in last process cycle?
     if (resetRequested && !isRecording()) {
         for (uint l = 0; l < maxLayers; ++l) {
-            layers[l]->reset();
+            getActiveLayer(l)->reset();
         }
         resetRequested = false;
         setChanged(true);
         emit layersContentErased();
     }
 
+    adoptLoadedLayers();
+
     // max layers change requested?
     if (newMaxLayersRequested && newMaxLayersRequested != maxLayers) {
         this->maxLayers = newMaxLayersRequested;
@@ -551,19 +688,27 @@ void Looper::startNewCycle(uint samplesInCycle)
 
     intervalPosition = 0;
 
+    if (!resetRequested)
+        adoptLoadedLayers();
+
+    requiredSamples.store(samplesInCycle); // control threads grow the layers when the reserved memory is shorter
+
     bool isOverdubbing = getOption(Looper::Overdub);
     for (quint8 l = 0; l < MAX_LOOP_LAYERS; ++l) {
-        layers[l]->prepareForNewCycle(samplesInCycle, isOverdubbing);
+        getActiveLayer(l)->prepareForNewCycle(samplesInCycle, isOverdubbing);
 
         bool canMute = l < maxLayers && mode == Looper::AllLayers;
         if (canMute) {
-            LooperLayer::MuteState currentMuteState = layers[l]->getMuteState();
+            LooperLayer::MuteState currentMuteState = getActiveLayer(l)->getMuteState();
             if (currentMuteState == LooperLayer::WaitingToMute || currentMuteState == LooperLayer::WaitingToUnmute)
                 nextMuteState(l);
         }
     }
 
     state->handleNewCycle(samplesInCycle);
+
+    if (isRecording() && getActiveLayer(currentLayerIndex)->getCapacity() < samplesInCycle)
+        truncatedRecordings++; // reported by control threads in reclaimMemory()
 }
 
 void Looper::setState(LooperState *newState)
@@ -583,13 +728,13 @@ bool Looper::canRecord() const
     if (mode != Looper::SelectedLayer)
         return getFirstUnlockedLayerIndex() >= 0;
 
-    return !layers[currentLayerIndex]->isLocked(); // in SELECTED_LAYER_ONLY mode we can't allow recording in selected layer if this layer is locked
+    return !getActiveLayer(currentLayerIndex)->isLocked(); // in SELECTED_LAYER_ONLY mode we can't allow recording in selected layer if this layer is locked
 }
 
 const std::vector<float> Looper::getLayerPeaks(quint8 layerIndex, uint samplesPerPeak) const
 {
     if (layerIndex < maxLayers) {
-        LooperLayer *layer = layers[layerIndex];
+        LooperLayer *layer = getLatestLayer(layerIndex);
         return layer->getSamplesPeaks(samplesPerPeak);
     }
 
@@ -602,7 +747,7 @@ void Looper::setMode(Mode mode)
         this->mode = mode;
 
         for (quint8 l = 0; l < maxLayers; ++l)  // reset mute state in all layers when mode is changed
-            layers[l]->setMuteState(LooperLayer::Unmuted);
+            getActiveLayer(l)->setMuteState(LooperLayer::Unmuted);
 
         setChanged(true);
         emit modeChanged();
@@ -614,8 +759,12 @@ void Looper::mixLayer(quint8 layerIndex, SamplesBuffer &samples, uint samplesToM
     if (layerIndex >= maxLayers)
         return;
 
-    LooperLayer *loopLayer = layers[layerIndex];
-    samplesToMix = qMin(samplesToMix, loopLayer->getAvailableSamples());
+    LooperLayer *loopLayer = getActiveLayer(layerIndex);
+    const uint availableSamples = loopLayer->getAvailableSamples();
+    if (intervalPosition >= availableSamples)
+        return; // the layer is shorter than the interval
+
+    samplesToMix = qMin(samplesToMix, availableSamples - intervalPosition);
     if (samplesToMix) {
         loopLayer->mixTo(samples, samplesToMix, intervalPosition, mainGain); // mix buffered samples
     }
@@ -638,9 +787,10 @@ void Looper::mixLockedLayers(SamplesBuffer &samples, uint samplesToMix)
 
 void Looper::processBufferUsingCurrentLayerSettings(SamplesBuffer &buffer)
 {
-    float layerGain = layers[currentLayerIndex]->getGain();
-    float leftGain = layers[currentLayerIndex]->getLeftGain();
-    float rightGain = layers[currentLayerIndex]->getRightGain();
+    const LooperLayer *currentLayer = getActiveLayer(currentLayerIndex);
+    float layerGain = currentLayer->getGain();
+    float leftGain = currentLayer->getLeftGain();
+    float rightGain = currentLayer->getRightGain();
     buffer.applyGain(layerGain * mainGain, leftGain, rightGain, 1.0);
 }
 
@@ -721,7 +871,7 @@ QList<SamplesBuffer> Looper::getLayersSamples() const
     QList<SamplesBuffer> layersList;
     for (uint layer = 0; layer < maxLayers; ++layer) {
         if (layerIsValid(layer)) { // not empty?
-            layersList.append(layers[layer]->getAllSamples());
+            layersList.append(getLatestLayer(layer)->getAllSamples());
         }
     }
 
@@ -741,7 +891,7 @@ bool Looper::canSave() const
         return false;
 
     for (int l = 0; l < maxLayers; ++l) {
-        if (layers[l]->isValid())
+        if (getLatestLayer(l)->isValid())
             return true;
     }
 
@@ -750,7 +900,38 @@ bool Looper::canSave() const
 
 void Looper::setLayerSamples(quint8 layer, const SamplesBuffer &samples)
 {
-    if (layer < maxLayers) {
-        layers[layer]->setSamples(samples);
+    if (layer >= MAX_LOOP_LAYERS)
+        return;
+
+    const LooperLayer *currentLayer = getLatestLayer(layer); // the loaded samples are using the current layer settings
+    loadLayer(layer, samples, currentLayer->isLocked(), currentLayer->getGain(), currentLayer->getPan());
+}
+
+void Looper::loadLayer(quint8 layer, const SamplesBuffer &samples, bool locked, float gain, float pan)
+{
+    if (layer >= MAX_LOOP_LAYERS)
+        return;
+
+    arm();
+
+    const uint cycleLenght = intervalLenght ? intervalLenght : samples.getFrameLenght(); // all samples are used before the first cycle
+    uint capacity = cycleLenght;
+    {
+        QMutexLocker locker(&reserveMutex);
+        capacity = qMax(capacity, reservedSamples);
     }
+
+    // the loaded layer is built in this thread, the audio thread is just swapping a pointer
+    auto loadedLayer = new LooperLayer();
+    loadedLayer->reserve(capacity);
+    loadedLayer->prepareForNewCycle(cycleLenght, false);
+    loadedLayer->setSamples(samples);
+    loadedLayer->setLocked(locked);
+    loadedLayer->setGain(gain);
+    loadedLayer->setPan(pan);
+
+    QMutexLocker locker(&reserveMutex);
+    auto replacedLayer = loadedLayers[layer].exchange(loadedLayer);
+    if (replacedLayer)
+        discardedLayers.push_back(replacedLayer); // not swapped yet, but the GUI thread can be reading it
 }
@@ -12,6 +12,9 @@
 #include <QMap>
 #include <QMutex>
 
+#include <atomic>
+#include <vector>
+
 #define MAX_LOOP_LAYERS 8
 
 namespace audio {
@@ -52,7 +55,18 @@ public:
 
     AudioPeak getLastPeak() const;
 
+    // loaded layers are built in the calling thread and swapped by the audio thread in the next processed buffer,
+    // the layers getters and setters are using the loaded layer before the swap
     void setLayerSamples(quint8 layer, const SamplesBuffer &samples);
+    void loadLayer(quint8 layer, const SamplesBuffer &samples, bool locked, float gain, float pan);
+
+    // called by control threads before the intervals grow, the audio thread never allocates layers memory.
+    // The memory of the used layers is allocated when the looper is armed (recording or loading layers)
+    void reserve(uint samplesPerInterval);
+
+    // called periodically by control threads, delete the layers released by the audio thread and grow
+    // the layers when the audio thread is using intervals longer than the reserved memory
+    void reclaimMemory();
 
     void startNewCycle(uint samplesInCycle);
 
@@ -158,6 +172,7 @@ signals:
     void maxLayersChanged(quint8 newMaxLayers);
     void currentLayerChanged(quint8 currentLayer);
     void layerChanged(quint8 layer); // layer pan, gain, locked or content changed
+    void layerLoaded(quint8 layer); // emitted by the audio thread when a loaded layer is swapped in
     void layerMuteStateChanged(quint8 layer, quint8 state);
     void layersContentErased();
     void currentLoopNameChanged(const QString &loopName);
@@ -172,7 +187,33 @@ private:
 
     bool activated;
 
-    LooperLayer *layers[MAX_LOOP_LAYERS];
+    std::atomic<LooperLayer *> layers[MAX_LOOP_LAYERS]; // replaced only in the audio thread
+    std::atomic<LooperLayer *> loadedLayers[MAX_LOOP_LAYERS]; // published by loadLayer(), swapped in the next processed buffer
+
+    static const int RETIRED_LAYERS = 2 * MAX_LOOP_LAYERS;
+    std::atomic<LooperLayer *> retiredLayers[RETIRED_LAYERS]; // released by the audio thread, deleted in reclaimMemory()
+    std::vector<LooperLayer *> discardedLayers; // loaded layers replaced before the swap, deleted in reclaimMemory()
+
+    QMutex reserveMutex; // used by control threads only
+    uint reservedSamples;
+    bool armed; // the layers memory is allocated after the first recording or loaded layer
+
+    std::atomic<uint> requiredSamples; // the last cycle lenght used by the audio thread
+    std::atomic<uint> truncatedRecordings; // recorded cycles longer than the layers memory
+    uint reportedTruncatedRecordings;
+
+    LooperLayer *getActiveLayer(quint8 index) const; // the layer used by the audio thread
+    LooperLayer *getLatestLayer(quint8 index) const; // the loaded layer not swapped yet, or the active layer
+
+    template <typename Function>
+    void updateLayer(quint8 index, Function function); // applied in the active and in the loaded layer
+
+    void arm();
+    void growLayers(quint8 layersCount, uint samples); // reserveMutex is locked
+    void adoptLoadedLayers();
+    int getFreeRetiredSlots() const;
+    void retire(LooperLayer *layer);
+
     quint8 currentLayerIndex; // current played layer
     int focusedLayerIndex; // layer clicked by user, used to choose recording layer. Sometimes focused layer will be equal to currentLayerIndex.
     quint8 maxLayers;
@@ -330,6 +371,17 @@ inline quint8 Looper::getFocusedLayerIndex() const
     return focusedLayerIndex;
 }
 
+inline LooperLayer *Looper::getActiveLayer(quint8 index) const
+{
+    return layers[index].load();
+}
+
+inline LooperLayer *Looper::getLatestLayer(quint8 index) const
+{
+    auto loadedLayer = loadedLayers[index].load();
+    return loadedLayer ? loadedLayer : layers[index].load();
+}
+
 } // namespace
 
 
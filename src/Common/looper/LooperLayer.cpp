@@ -1,19 +1,30 @@
 #include "LooperLayer.h"
 #include "audio/core/SamplesBuffer.h"
+#include "audio/core/SamplesKernels.h"
 
 #include <cstring>
 #include <cmath>
 #include <QDebug>
 
-#include <QDebug>
-
 using audio::LooperLayer;
 using audio::SamplesBuffer;
+using audio::PeakPyramid;
+
+const uint LooperLayer::SEGMENT_SAMPLES;
+const uint LooperLayer::MAX_SEGMENTS;
+
+LooperLayer::Segment::Segment()
+{
+    std::fill(leftChannel, leftChannel + SEGMENT_SAMPLES, 0.0f);
+    std::fill(rightChannel, rightChannel + SEGMENT_SAMPLES, 0.0f);
+
+    peaks.resize(SEGMENT_SAMPLES);
+}
 
 LooperLayer::LooperLayer() :
-    lastSamplesPerPeak(0),
+    segmentsCount(0),
     availableSamples(0),
-    lastCacheComputationSample(0),
+    writtenSamples(0),
     lastCycleLenght(0),
     locked(false),
     gain(1.0),
@@ -23,11 +34,40 @@ LooperLayer::LooperLayer() :
     muteState(MuteState::Unmuted)
 {
     setPan(0); // center
+
+    std::fill(segments, segments + MAX_SEGMENTS, nullptr);
 }
 
 LooperLayer::~LooperLayer()
 {
+    for (auto segment : segments)
+        delete segment;
+}
+
+void LooperLayer::reserve(uint samples)
+{
+    const uint requiredSegments = qMin((samples + SEGMENT_SAMPLES - 1) / SEGMENT_SAMPLES, MAX_SEGMENTS);
+    const uint currentSegments = segmentsCount.load(std::memory_order_relaxed);
+    if (requiredSegments <= currentSegments)
+        return;
 
+    for (uint s = currentSegments; s < requiredSegments; ++s)
+        segments[s] = new Segment(); // not visible to the audio thread until the new count is published
+
+    segmentsCount.store(requiredSegments, std::memory_order_release);
+}
+
+template <typename Function>
+void LooperLayer::forEachSegment(uint from, uint samples, Function function) const
+{
+    uint rangeOffset = 0;
+    while (rangeOffset < samples) {
+        const uint position = from + rangeOffset;
+        const uint segmentOffset = position % SEGMENT_SAMPLES;
+        const uint segmentSamples = qMin(samples - rangeOffset, SEGMENT_SAMPLES - segmentOffset);
+        function(segments[position / SEGMENT_SAMPLES], segmentOffset, segmentSamples, rangeOffset);
+        rangeOffset += segmentSamples;
+    }
 }
 
 void LooperLayer::reset()
@@ -44,49 +84,36 @@ void LooperLayer::reset()
 
 void LooperLayer::zero()
 {
-    std::fill(leftChannel.begin(), leftChannel.end(), static_cast<float>(0));
-    std::fill(rightChannel.begin(), rightChannel.end(), static_cast<float>(0));
+    forEachSegment(0, qMin(writtenSamples, getCapacity()), [](Segment *segment, uint offset, uint count, uint) {
+        std::fill(segment->leftChannel + offset, segment->leftChannel + offset + count, 0.0f);
+        std::fill(segment->rightChannel + offset, segment->rightChannel + offset + count, 0.0f);
+        segment->peaks.clear();
+    });
 
     availableSamples = 0;
-    lastSamplesPerPeak = 0;
-    lastCacheComputationSample = 0;
-    peaksCache.clear();
+    writtenSamples = 0;
 }
 
 void LooperLayer::setSamples(const SamplesBuffer &samples)
 {
     zero();
 
-    uint samplesToCopy = qMin(samples.getFrameLenght(), lastCycleLenght);
+    uint samplesToCopy = qMin(qMin(samples.getFrameLenght(), lastCycleLenght), getCapacity());
     if (!samplesToCopy) {
         return;
     }
 
-    uint bytesToCopy =  samplesToCopy * sizeof(float);
-
-    Q_ASSERT(leftChannel.capacity() >= samplesToCopy);
-    Q_ASSERT(rightChannel.capacity() >= samplesToCopy);
-
-    std::memcpy(&(leftChannel[0]), samples.getSamplesArray(0), bytesToCopy);
-    if (samples.isMono())
-        std::memcpy(&(rightChannel[0]), samples.getSamplesArray(0), bytesToCopy);
-    else
-        std::memcpy(&(rightChannel[0]), samples.getSamplesArray(1), bytesToCopy);
+    const float *left = samples.getSamplesArray(0);
+    const float *right = samples.isMono() ? left : samples.getSamplesArray(1);
+    forEachSegment(0, samplesToCopy, [=](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        std::memcpy(segment->leftChannel + offset, left + rangeOffset, count * sizeof(float));
+        std::memcpy(segment->rightChannel + offset, right + rangeOffset, count * sizeof(float));
+    });
 
     availableSamples = samplesToCopy;
+    writtenSamples = samplesToCopy;
 
-
-    // rebuild peaks cache
-    lastCacheComputationSample = 0;
-    peaksCache.clear();
-
-    if (lastSamplesPerPeak) {
-        while (availableSamples - lastCacheComputationSample >= lastSamplesPerPeak) { // enough samples to cache a new max peak?
-            peaksCache.push_back(computeMaxPeak(lastCacheComputationSample, lastSamplesPerPeak));
-            lastCacheComputationSample += lastSamplesPerPeak;
-        }
-    }
-
+    updatePeaks(0, availableSamples);
 }
 
 void LooperLayer::setPan(float pan)
@@ -118,171 +145,167 @@ void LooperLayer::prepareForNewCycle(uint samplesInNewCycle, bool isOverdubbing)
     if (samplesInNewCycle > lastCycleLenght)
         resize(samplesInNewCycle);
 
-    if (isOverdubbing)
-        lastCacheComputationSample = 0; // reset max peak cache position to compute overdub peaks correctly
+    Q_UNUSED(isOverdubbing) // overdubbed peaks are updated in each overdub() call
 
     lastCycleLenght = samplesInNewCycle;
 }
 
 void LooperLayer::overdub(const SamplesBuffer &samples, uint samplesToMix, uint startPosition)
 {
-    if (!samples.isMono()) {
-        float *internalChannels[] = {&(leftChannel[startPosition]), &(rightChannel[startPosition])};
-        float *samplesArray[] = {samples.getSamplesArray(0), samples.getSamplesArray(1)};
-        for (uint s = 0; s < samplesToMix; ++s) {
-            internalChannels[0][s] += samplesArray[0][s]; // left channel
-            internalChannels[1][s] += samplesArray[1][s]; // right channel
-        }
-    }
-    else {
-        float *internalChannels[] = {&(leftChannel[startPosition]), &(rightChannel[startPosition])};
-        float *samplesArray = samples.getSamplesArray(0);
-        for (uint s = 0; s < samplesToMix; ++s) {
-            internalChannels[0][s] += samplesArray[s];
-        }
-    }
+    const uint capacity = getCapacity();
+    if (startPosition >= capacity)
+        return;
+
+    samplesToMix = qMin(samplesToMix, capacity - startPosition);
+
+    const auto &kernels = audio::kernels::get();
+    const bool stereo = !samples.isMono();
+    const float *left = samples.getSamplesArray(0);
+    const float *right = stereo ? samples.getSamplesArray(1) : nullptr;
+    forEachSegment(startPosition, samplesToMix, [&](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        kernels.add(segment->leftChannel + offset, left + rangeOffset, count);
+        if (stereo)
+            kernels.add(segment->rightChannel + offset, right + rangeOffset, count);
+    });
 
     if (availableSamples < startPosition + samplesToMix)
         availableSamples = startPosition + samplesToMix;
 
-    // build peaks cache when overdubbing
-    if (lastSamplesPerPeak) {
-        const uint position = startPosition + samplesToMix;
-        while (position - lastCacheComputationSample >= lastSamplesPerPeak) { // enough samples to cache a new max peak?
-            const int peakIndex = (position/lastSamplesPerPeak) - 1;
-            float lastPeak = computeMaxPeak(lastCacheComputationSample, lastSamplesPerPeak);
-            if (peakIndex >= 0 && static_cast<uint>(peakIndex) < peaksCache.size())
-                peaksCache[peakIndex] = lastPeak;
-            else
-                peaksCache.push_back(lastPeak);
-
-            lastCacheComputationSample += lastSamplesPerPeak;
-        }
-    }
+    writtenSamples = qMax(writtenSamples, startPosition + samplesToMix);
+
+    updatePeaks(startPosition, samplesToMix);
 }
 
 void LooperLayer::mixTo(SamplesBuffer &outBuffer, uint samplesToMix, uint intervalPosition, float looperMainGain)
 {
+    samplesToMix = qMin(samplesToMix, availableSamples > intervalPosition ? availableSamples - intervalPosition : 0);
+
     bool canMix = samplesToMix > 0 && (muteState == LooperLayer::Unmuted || muteState == LooperLayer::WaitingToMute);
     if (canMix) {
-        float *internalChannels[] = {&(leftChannel[0]), &(rightChannel[0])};
         const uint secondChannelIndex = (outBuffer.isMono()) ? 0 : 1;
         float *bufferChannels[] = {outBuffer.getSamplesArray(0), outBuffer.getSamplesArray(secondChannelIndex)};
-        uint channels = outBuffer.getChannels();
+        uint channels = qMin(outBuffer.getChannels(), 2); // layers are stereo
 
         const float mainGain = looperMainGain * gain;
         const float finalLeftGain = mainGain * leftGain;
         const float finalRightGain = mainGain * rightGain;
         float gains[] = {finalLeftGain, finalRightGain};
-        for (uint c = 0; c < channels; ++c) {
-            for (uint s = 0; s < samplesToMix; ++s) {
-                const uint offset = s + intervalPosition;
-                bufferChannels[c][s] += internalChannels[c][offset] * gains[c];
-            }
-        }
+        const auto &kernels = audio::kernels::get();
+        forEachSegment(intervalPosition, samplesToMix, [&](Segment *segment, uint offset, uint count, uint rangeOffset) {
+            const float *internalChannels[] = {segment->leftChannel + offset, segment->rightChannel + offset};
+            for (uint c = 0; c < channels; ++c)
+                kernels.mix(bufferChannels[c] + rangeOffset, internalChannels[c], count, gains[c]);
+        });
     }
 }
 
 void LooperLayer::append(const SamplesBuffer &samples, uint samplesToAppend, uint startPosition)
 {
-    int toAppend = qMin(static_cast<uint>(leftChannel.capacity() - startPosition), samplesToAppend);
+    const uint capacity = getCapacity();
+    if (startPosition >= capacity)
+        return; // the interval is longer than the reserved memory
 
-    if (!toAppend) {
-        qCritical() << "toAppend:" << toAppend;
+    const uint toAppend = qMin(capacity - startPosition, samplesToAppend);
+    if (!toAppend)
         return;
-    }
-
-    const uint sizeInBytes = toAppend * sizeof(float);
 
     const int secondChannelIndex = samples.isMono() ? 0 : 1;
-    std::memcpy(&(leftChannel[0]) + startPosition, samples.getSamplesArray(0), sizeInBytes);
-    std::memcpy(&(rightChannel[0]) + startPosition, samples.getSamplesArray(secondChannelIndex), sizeInBytes);
+    const float *left = samples.getSamplesArray(0);
+    const float *right = samples.getSamplesArray(secondChannelIndex);
+    forEachSegment(startPosition, toAppend, [=](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        std::memcpy(segment->leftChannel + offset, left + rangeOffset, count * sizeof(float));
+        std::memcpy(segment->rightChannel + offset, right + rangeOffset, count * sizeof(float));
+    });
 
     availableSamples += toAppend;
+    writtenSamples = qMax(writtenSamples, startPosition + toAppend);
 
-    //Q_ASSERT(availableSamples <= leftChannel.capacity());
-
-    // build peaks cache
-    if (lastSamplesPerPeak) {
-        if (lastCacheComputationSample < startPosition - lastSamplesPerPeak)
-            lastCacheComputationSample = startPosition;
+    updatePeaks(startPosition, toAppend);
+}
 
-        while ((startPosition + samplesToAppend) - lastCacheComputationSample >= lastSamplesPerPeak && lastCacheComputationSample  < leftChannel.size()) { // enough samples to cache a new max peak?
-            peaksCache.push_back(computeMaxPeak(lastCacheComputationSample, lastSamplesPerPeak));
-            lastCacheComputationSample += lastSamplesPerPeak;
-        }
-    }
+void LooperLayer::updatePeaks(uint from, uint samples)
+{
+    forEachSegment(from, samples, [this, from](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        const uint segmentStart = from + rangeOffset - offset;
+        const uint segmentAvailableSamples = availableSamples > segmentStart ? qMin(availableSamples - segmentStart, SEGMENT_SAMPLES) : 0;
+        segment->peaks.update(segment->leftChannel, segment->rightChannel, offset, count, segmentAvailableSamples);
+    });
 }
 
 float LooperLayer::computeMaxPeak(uint from, uint samplesPerPeak) const
 {
-    float maxPeak = 0;
-    uint limit = qMin(samplesPerPeak, availableSamples - from);
-    for (uint i = 0; i < limit; ++i) {
-        const uint offset = from + i;
-        if (offset < leftChannel.size()) {
-            float peak = qMax(qAbs(leftChannel[offset]), qAbs(rightChannel[offset]));
-            if (peak > maxPeak) {
-                maxPeak = peak;
-            }
-        }
-    }
+    return getPeak(from, samplesPerPeak).getMaxPeak();
+}
+
+PeakPyramid::Peak LooperLayer::getPeak(uint from, uint samples) const
+{
+    PeakPyramid::Peak peak = PeakPyramid::Peak();
+    if (from >= availableSamples)
+        return peak;
 
-    return maxPeak;
+    // whole segments are served from the top of each segment pyramid
+    forEachSegment(from, qMin(samples, availableSamples - from), [&peak](Segment *segment, uint offset, uint count, uint) {
+        peak = PeakPyramid::merge(peak, segment->peaks.getPeak(offset, count));
+    });
+
+    return peak;
 }
 
-std::vector<float> LooperLayer::getSamplesPeaks(uint samplesPerPeak)
+std::vector<float> LooperLayer::getSamplesPeaks(uint samplesPerPeak) const
 {
-    if (lastSamplesPerPeak == samplesPerPeak && !peaksCache.empty()) { // cache hit?
-        return peaksCache;
-    }
+    std::vector<float> peaks;
+    if (!samplesPerPeak)
+        return peaks;
 
-    // compute all peaks
-    peaksCache.clear();
-    if (samplesPerPeak) {
-        for (uint i = 0; i < availableSamples; i += samplesPerPeak) {
-            float maxPeak = computeMaxPeak(i, samplesPerPeak);
-            peaksCache.push_back(maxPeak);
-        }
-        lastSamplesPerPeak = samplesPerPeak;
-    }
+    peaks.reserve(availableSamples / samplesPerPeak + 1);
+    for (uint i = 0; i < availableSamples; i += samplesPerPeak)
+        peaks.push_back(computeMaxPeak(i, qMin(samplesPerPeak, availableSamples - i)));
 
-    return peaksCache;
+    return peaks;
 }
 
-void LooperLayer::resize(quint32 samplesPerCycle)
+void LooperLayer::copySamples(uint from, uint to, uint samples)
 {
-    if (samplesPerCycle > leftChannel.capacity())
-        leftChannel.resize(samplesPerCycle);
+    forEachSegment(to, samples, [this, from](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        forEachSegment(from + rangeOffset, count, [=](Segment *source, uint sourceOffset, uint sourceSamples, uint sourceRangeOffset) {
+            const size_t bytesToCopy = sourceSamples * sizeof(float);
+            std::memcpy(segment->leftChannel + offset + sourceRangeOffset, source->leftChannel + sourceOffset, bytesToCopy);
+            std::memcpy(segment->rightChannel + offset + sourceRangeOffset, source->rightChannel + sourceOffset, bytesToCopy);
+        });
+    });
+}
 
-    if (samplesPerCycle > rightChannel.capacity())
-        rightChannel.resize(samplesPerCycle);
+void LooperLayer::resize(quint32 samplesPerCycle)
+{
+    samplesPerCycle = qMin(samplesPerCycle, getCapacity()); // the memory is reserved by control threads, never allocated here
 
     if (availableSamples && samplesPerCycle > availableSamples) { // need copy samples?
         uint initialAvailableSamples = availableSamples;
         uint totalSamplesToCopy = samplesPerCycle - initialAvailableSamples;
         while (totalSamplesToCopy > 0){
             const uint samplesToCopy = qMin(totalSamplesToCopy, initialAvailableSamples);
-            const uint bytesToCopy = samplesToCopy * sizeof(float);
-            std::memcpy(&(leftChannel[availableSamples]), &(leftChannel[0]), bytesToCopy);
-            std::memcpy(&(rightChannel[availableSamples]), &(rightChannel[0]), bytesToCopy);
+            copySamples(0, availableSamples, samplesToCopy);
             availableSamples += samplesToCopy;
             totalSamplesToCopy -= samplesToCopy;
         }
 
         Q_ASSERT(availableSamples == samplesPerCycle);
 
-        peaksCache.clear(); // invalidate peaks cache
+        writtenSamples = qMax(writtenSamples, availableSamples);
+
+        updatePeaks(initialAvailableSamples, availableSamples - initialAvailableSamples);
     }
 }
 
 SamplesBuffer LooperLayer::getAllSamples() const
 {
     SamplesBuffer buffer(2, availableSamples);
-    uint bytesToCopy = availableSamples * sizeof(float);
-    std::memcpy(buffer.getSamplesArray(0), &(leftChannel[0]), bytesToCopy);
-    std::memcpy(buffer.getSamplesArray(1), &(rightChannel[0]), bytesToCopy);
+    float *left = buffer.getSamplesArray(0);
+    float *right = buffer.getSamplesArray(1);
+    forEachSegment(0, availableSamples, [=](Segment *segment, uint offset, uint count, uint rangeOffset) {
+        std::memcpy(left + rangeOffset, segment->leftChannel + offset, count * sizeof(float));
+        std::memcpy(right + rangeOffset, segment->rightChannel + offset, count * sizeof(float));
+    });
 
     return buffer;
 }
-
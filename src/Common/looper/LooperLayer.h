@@ -2,19 +2,29 @@
 #define _AUDIO_LOOPER_LAYER_
 
 #include <vector>
+#include <atomic>
 #include <QtGlobal>
 
+#include "audio/core/PeakPyramid.h"
+
 namespace audio {
 
 class SamplesBuffer;
 
+/**
+ * The layer samples are stored in fixed size segments. Control threads grow the layer appending new
+ * segments in reserve(), the recorded samples are never moved and the audio thread never allocates.
+ */
+
 class LooperLayer
 {
 public:
 
-    LooperLayer();
+    LooperLayer(); // no memory is allocated until reserve() is called
     virtual ~LooperLayer();
 
+    void reserve(uint samples); // called by control threads, the new capacity is published after the segments are allocated
+
     void setGain(float gain);
     void setPan(float pan);
 
@@ -36,8 +46,9 @@ public:
     void prepareForNewCycle(uint samplesInNewCycle, bool isOverdubbing);
 
     float computeMaxPeak(uint from, uint samplesPerPeak) const;
+    PeakPyramid::Peak getPeak(uint from, uint samples) const; // min, max and RMS of any range, served from the peaks pyramid
 
-    std::vector<float> getSamplesPeaks(uint samplesPerPeak);
+    std::vector<float> getSamplesPeaks(uint samplesPerPeak) const;
 
     SamplesBuffer getAllSamples() const;
 
@@ -60,15 +71,34 @@ public:
     MuteState getMuteState() const;
 
     uint getAvailableSamples() const;
+    uint getCapacity() const;
+
+    static const uint SEGMENT_SAMPLES = 1 << 15; // multiple of PeakPyramid::BUCKET_SAMPLES
+    static const uint MAX_SEGMENTS = 1024;
 
 private:
-    std::vector<float> leftChannel;
-    std::vector<float> rightChannel;
+    LooperLayer(const LooperLayer &other);
+    LooperLayer &operator=(const LooperLayer &other);
+
+    struct Segment
+    {
+        Segment();
+
+        float leftChannel[SEGMENT_SAMPLES];
+        float rightChannel[SEGMENT_SAMPLES];
+        PeakPyramid peaks; // updated when samples are appended or overdubbed, any zoom level is computed without reading the samples
+    };
+
+    Segment *segments[MAX_SEGMENTS]; // allocated by control threads, the first 'segmentsCount' are used by the audio thread
+    std::atomic<uint> segmentsCount;
+
+    template <typename Function>
+    void forEachSegment(uint from, uint samples, Function function) const; // function(segment, segmentOffset, samples, rangeOffset)
+
+    void copySamples(uint from, uint to, uint samples);
 
-    std::vector<float> peaksCache;
-    uint lastSamplesPerPeak;
     uint availableSamples;
-    uint lastCacheComputationSample;
+    uint writtenSamples; // the samples after this position are zero
     uint lastCycleLenght;
     bool locked;
 
@@ -81,6 +111,7 @@ private:
     MuteState muteState;
 
     void resize(quint32 samplesPerCycle);
+    void updatePeaks(uint from, uint samples);
 
 };
 
@@ -124,6 +155,11 @@ inline uint LooperLayer::getAvailableSamples() const
     return availableSamples;
 }
 
+inline uint LooperLayer::getCapacity() const
+{
+    return segmentsCount.load(std::memory_order_acquire) * SEGMENT_SAMPLES;
+}
+
 inline bool LooperLayer::isValid() const
 {
     return availableSamples > 0;
@@ -2,13 +2,13 @@
 #include "Looper.h"
 #include "file/WaveFileWriter.h"
 #include "audio/vorbis/VorbisEncoder.h"
-#include "file/FileReaderFactory.h"
-#include "audio/SamplesBufferResampler.h"
+#include "persistence/ResampledAudioCache.h"
 #include "Utils.h"
 
 #include <QtConcurrent/QtConcurrent>
 #include <QJsonDocument>
 #include <QFileInfo>
+#include <QSaveFile>
 
 using audio::LoopInfo;
 using audio::LoopSaver;
@@ -16,59 +16,35 @@ using audio::LoopLoader;
 using audio::Looper;
 using audio::SamplesBuffer;
 
-LoopInfo::LoopInfo(quint32 bpm, quint16 bpi, const QString &name, bool audioIsEncoded, quint8 mode) :
-    bpm(bpm),
-    bpi(bpi),
-    name(name),
-    usingEncodedAudio(audioIsEncoded),
-    looperMode(mode)
-{
-    //
-}
+const uint LoopSaver::CHUNK_FRAMES = 16384;
 
-LoopInfo::LoopInfo()
-    : LoopInfo(0, 0, QString(), false, 0) // calling overloaded constructor
+LoopSaver::LoopSaver(const QString &savePath, Looper *looper, QObject *parent) :
+    QObject(parent),
+    savePath(savePath),
+    looper(looper),
+    runningTasks(0),
+    canceled(false),
+    savedFrames(0),
+    totalFrames(0)
 {
-    //
-}
 
-bool LoopInfo::isValid() const
-{
-    return !name.isEmpty() && bpm > 0 && bpi > 0 && layers.size() > 0;
 }
 
-QString LoopInfo::toString(bool showBpm) const
+LoopSaver::~LoopSaver()
 {
-    QString text = name;
-    text += " (";
-
-    if (showBpm)
-        text += QString::number(bpm) + " BPM, ";
-
-    text += QString::number(bpi) + " BPI, ";
-    text += QString::number(layers.size()) + " layers";
-
-    text += ")";
-
-    return text;
+    cancel();
+    for (auto &task : tasks)
+        task.waitForFinished();
 }
 
-void LoopInfo::addLayer(bool isLocked, float gain, float pan)
+bool LoopSaver::isRunning() const
 {
-    LoopLayerInfo layerInfo;
-    layerInfo.locked = isLocked;
-    layerInfo.gain = gain;
-    layerInfo.pan = pan;
-    layers.append(layerInfo);
+    return runningTasks > 0;
 }
 
-// -------------------------------------------------------------------
-
-LoopSaver::LoopSaver(const QString &savePath, Looper *looper) :
-    savePath(savePath),
-    looper(looper)
+void LoopSaver::cancel()
 {
-
+    canceled = true;
 }
 
 QList<quint8> LoopSaver::getLockedLayers(Looper *looper)
@@ -83,6 +59,11 @@ QList<quint8> LoopSaver::getLockedLayers(Looper *looper)
 
 void LoopSaver::save(const QString &loopFileName, uint bpm, uint bpi, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth)
 {
+    if (isRunning()) {
+        qCritical() << "Can't save" << loopFileName << "while saving" << this->loopFileName;
+        return;
+    }
+
     QDir loopDir(QDir(savePath).absoluteFilePath(loopFileName));
     if (!loopDir.exists()) {
         if (!loopDir.mkpath(".")) {
@@ -90,109 +71,298 @@ void LoopSaver::save(const QString &loopFileName, uint bpm, uint bpi, bool encod
         }
     }
 
-    QList<SamplesBuffer> layersSamples = looper->getLayersSamples();
+    QJsonObject root;
+    root["bpm"] = static_cast<int>(bpm);
+    root["bpi"] = static_cast<int>(bpi);
+    root["loopLenght"] = static_cast<int>(looper->getIntervalLenght());
+    root["audioFormat"] = encodeInOggVorbis ? "ogg" : "wave";
+    root["looperMode"] = static_cast<int>(looper->getMode());
+
+    const uint samplesPerPeak = qMax(looper->getIntervalLenght() / LoopInfo::THUMBNAIL_PEAKS, 1u);
+
+    QJsonArray layers;
+    for (quint8 l = 0; l < looper->getLayers(); ++l) {
+        QJsonObject layer;
+        layer["locked"] = looper->layerIsLocked(l);
+        layer["gain"] = Utils::poweredGainToLinear(looper->getLayerGain(l));
+        layer["pan"] = looper->getLayerPan(l);
+
+        QJsonArray peaks; // used in the loops library thumbnails
+        for (float peak : looper->getLayerPeaks(l, samplesPerPeak))
+            peaks.append(peak);
+        layer["peaks"] = peaks;
+
+        layers.append(layer);
+    }
+    root["layers"] = layers;
+
+    this->loopFileName = loopFileName;
+    loopJson = QJsonDocument(root).toJson();
+
+    const QList<SamplesBuffer> layersSamples = looper->getLayersSamples(); // copied in this thread, the looper keeps playing
+    if (layersSamples.isEmpty()) {
+        emit finished(false);
+        return;
+    }
+
+    tasks.clear();
+    canceled = false;
+    savedFrames = 0;
+    totalFrames = 0;
+    for (const auto &samples : layersSamples)
+        totalFrames += samples.getFrameLenght();
+
+    layerFiles.clear();
     for (int layer = 0; layer < layersSamples.size(); ++layer) {
-        LoopSaver::saveSamplesToDisk(savePath,
-                                     loopFileName,
-                                     layersSamples.at(layer),
-                                     layer,
-                                     encodeInOggVorbis,
-                                     vorbisQuality,
-                                     sampleRate,
-                                     bitDepth);
+        const QString fileName = loopFileName + "/layer_" + QString::number(layer) + (encodeInOggVorbis ? ".ogg" : ".wav");
+        layerFiles << QDir(savePath).absoluteFilePath(fileName);
     }
 
-    QFile jsonFile(QDir(savePath).absoluteFilePath(loopFileName) + ".json");
-    if (jsonFile.open(QIODevice::WriteOnly)) {
-        QJsonObject root;
-        root["bpm"] = static_cast<int>(bpm);
-        root["bpi"] = static_cast<int>(bpi);
-        root["loopLenght"] = static_cast<int>(looper->getIntervalLenght());
-        root["audioFormat"] = encodeInOggVorbis ? "ogg" : "wave";
-        root["looperMode"] = static_cast<int>(looper->getMode());
-
-        QJsonArray layers;
-        for (quint8 l = 0; l < looper->getLayers(); ++l) {
-            QJsonObject layer;
-            layer["locked"] = looper->layerIsLocked(l);
-            layer["gain"] = Utils::poweredGainToLinear(looper->getLayerGain(l));
-            layer["pan"] = looper->getLayerPan(l);
-            layers.append(layer);
-        }
-        root["layers"] = layers;
+    runningTasks = layersSamples.size();
+    for (int layer = 0; layer < layersSamples.size(); ++layer) {
+        const QString filePath = getTemporaryFilePath(layerFiles.at(layer));
+        tasks.append(QtConcurrent::run([=]() {
+            bool saved = LoopSaver::saveSamplesToDisk(filePath, layersSamples.at(layer), encodeInOggVorbis,
+                                                      vorbisQuality, sampleRate, bitDepth, [this](uint frames) {
+                savedFrames += frames;
+                QMetaObject::invokeMethod(this, "updateProgress", Qt::QueuedConnection);
+                return !canceled;
+            });
+
+            QMetaObject::invokeMethod(this, "finishTask", Qt::QueuedConnection);
+            return saved;
+        }));
+    }
+}
 
-        QJsonDocument doc(root);
-        jsonFile.write(doc.toJson());
-    } else {
+void LoopSaver::updateProgress()
+{
+    if (totalFrames > 0)
+        emit progressChanged(static_cast<int>(savedFrames * 100 / totalFrames));
+}
+
+void LoopSaver::finishTask()
+{
+    if (--runningTasks > 0)
+        return;
+
+    bool saved = !canceled;
+    for (const auto &task : tasks)
+        saved = saved && task.result();
+
+    tasks.clear();
+
+    if (saved)
+        saved = commitLayerFiles(); // the previous layer files are replaced only when all layers are saved
+    else
+        discardLayerFiles();
+
+    if (saved)
+        saved = saveJsonFile(); // the loop is listed only when all layers are saved
+
+    if (saved)
+        looper->setChanged(false);
+
+    emit finished(saved);
+}
+
+bool LoopSaver::saveJsonFile()
+{
+    QSaveFile jsonFile(QDir(savePath).absoluteFilePath(loopFileName) + ".json");
+    if (!jsonFile.open(QIODevice::WriteOnly)) {
         qCritical() << jsonFile.errorString();
+        return false;
     }
 
-    looper->setChanged(false);
+    jsonFile.write(loopJson);
+    if (!jsonFile.commit()) {
+        qCritical() << jsonFile.errorString();
+        return false;
+    }
+
+    return true;
 }
 
-void LoopSaver::saveSamplesToDisk(const QString &savePath, const QString &loopFileName, const SamplesBuffer &buffer, quint8 layerIndex, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth)
+QString LoopSaver::getTemporaryFilePath(const QString &filePath)
 {
-    Q_ASSERT(!loopFileName.isEmpty() && !loopFileName.isNull());
-    Q_ASSERT(layerIndex < MAX_LOOP_LAYERS);
-    Q_ASSERT(!savePath.isEmpty());
-
-    if (!encodeInOggVorbis) {
-        WaveFileWriter waveFileWriter;
-        QString filePath = QDir(savePath).absoluteFilePath(loopFileName +"/layer_" + QString::number(layerIndex) + ".wav");
-        waveFileWriter.write(filePath, buffer, sampleRate, bitDepth);
-    }
-    else {
-        vorbis::Encoder encoder(2, sampleRate, vorbisQuality);
-        QByteArray encodedData = encoder.encode(buffer);
-        encodedData.append(encoder.finishIntervalEncoding());
-        QString filePath = QDir(savePath).absoluteFilePath(loopFileName +"/layer_" + QString::number(layerIndex) + ".ogg");
-        QFile oggFile(filePath);
-        if (oggFile.open(QFile::WriteOnly)) {
-            oggFile.write(encodedData);
+    return filePath + ".part";
+}
+
+bool LoopSaver::commitLayerFiles()
+{
+    for (const QString &filePath : layerFiles) {
+        if (QFile::exists(filePath) && !QFile::remove(filePath)) {
+            qCritical() << "Can't replace the file " << filePath;
+            discardLayerFiles();
+            return false;
         }
-        else {
+
+        if (!QFile::rename(getTemporaryFilePath(filePath), filePath)) {
             qCritical() << "Can't write in the file " << filePath;
+            discardLayerFiles();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void LoopSaver::discardLayerFiles()
+{
+    for (const QString &filePath : layerFiles)
+        QFile::remove(getTemporaryFilePath(filePath)); // not existing if the task failed
+}
+
+bool LoopSaver::saveSamplesToDisk(const QString &filePath, const SamplesBuffer &buffer, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth, const std::function<bool(uint)> &chunkSaved)
+{
+    Q_ASSERT(!filePath.isEmpty());
+
+    if (!chunkSaved(0))
+        return false; // canceled before writing
+
+    QFile file(filePath); // a temporary file, renamed when all layers are saved
+    if (!file.open(QFile::WriteOnly)) {
+        qCritical() << "Can't write in the file " << filePath << file.errorString();
+        return false;
+    }
+
+    QScopedPointer<vorbis::Encoder> encoder;
+    if (encodeInOggVorbis)
+        encoder.reset(new vorbis::Encoder(2, sampleRate, vorbisQuality));
+    else
+        WaveFileWriter::writeHeader(file, buffer.getChannels(), buffer.getFrameLenght(), sampleRate, bitDepth);
+
+    const uint frames = buffer.getFrameLenght();
+    for (uint offset = 0; offset < frames; offset += CHUNK_FRAMES) {
+        const uint chunkFrames = qMin(CHUNK_FRAMES, frames - offset);
+        const SamplesBuffer chunk(buffer.getView(offset, chunkFrames)); // not copied
+        if (encoder)
+            file.write(encoder->encode(chunk));
+        else
+            WaveFileWriter::writeSamples(file, chunk, bitDepth);
+
+        if (!chunkSaved(chunkFrames)) {
+            file.remove(); // canceled
+            return false;
         }
     }
+
+    if (encoder)
+        file.write(encoder->finishIntervalEncoding());
+
+    file.close();
+    if (file.error() != QFile::NoError) {
+        qCritical() << "Can't write in the file " << filePath << file.errorString();
+        file.remove();
+        return false;
+    }
+
+    return true;
 }
 
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
-LoopLoader::LoopLoader(const QString &loadPath) :
-    loadPath(loadPath)
+LoopLoader::LoopLoader(const QString &loadPath, QObject *parent) :
+    QObject(parent),
+    loadPath(loadPath),
+    looper(nullptr),
+    runningTasks(0),
+    canceled(false),
+    loadedLayers(0),
+    totalLayers(0)
 {
 
 }
 
+LoopLoader::~LoopLoader()
+{
+    cancel();
+    for (auto &task : tasks)
+        task.waitForFinished();
+
+    if (looper && isRunning())
+        looper->setLoading(false); // finishTask() will not be called
+}
+
+bool LoopLoader::isRunning() const
+{
+    return runningTasks > 0;
+}
+
+void LoopLoader::cancel()
+{
+    canceled = true;
+}
+
 void LoopLoader::load(LoopInfo loopInfo, Looper *looper, uint currentSampleRate, quint32 samplesPerInterval)
 {
-    if (!loopInfo.isValid())
+    if (!loopInfo.isValid() || isRunning())
         return;
 
+    this->looper = looper;
+    loopName = loopInfo.getName();
+
     looper->setChanged(false);
     looper->setLoading(true);
 
     looper->stop();
     looper->setMode(static_cast<Looper::Mode>(loopInfo.getLooperMode()));
     looper->setLayers(loopInfo.getLayersCount());
+    looper->reserve(samplesPerInterval);
+
+    tasks.clear();
+    canceled = false;
+    loadedLayers = 0;
 
-    bool audioIsEncoded = loopInfo.audioIsEncoded();
-    QList<LoopLayerInfo> layersInfo = loopInfo.getLayersInfo();
+    const bool audioIsEncoded = loopInfo.audioIsEncoded();
+    const QList<LoopLayerInfo> layersInfo = loopInfo.getLayersInfo();
+    const QString path = loadPath;
+    totalLayers = layersInfo.size();
+    runningTasks = layersInfo.size();
     for (quint8 layer = 0; layer < layersInfo.size(); ++layer) {
-        SamplesBuffer samples(2, samplesPerInterval);
-        bool loadResult = LoopLoader::loadLoopLayerSamples(loadPath, loopInfo.getName(), layer, audioIsEncoded, currentSampleRate, samples);
-        if (loadResult) {
-            looper->setLayerSamples(layer, samples);
-            bool layerIsLocked = layersInfo.at(layer).locked;
-            looper->setLayerLockedState(layer, layerIsLocked);
-            looper->setLayerGain(layer, Utils::linearGainToPower(layersInfo.at(layer).gain));
-            looper->setLayerPan(layer, layersInfo.at(layer).pan);
-        }
+        tasks.append(QtConcurrent::run([=]() {
+            bool loaded = false;
+            if (!canceled) {
+                SamplesBuffer samples(2, samplesPerInterval);
+                if (LoopLoader::loadLoopLayerSamples(path, loopName, layer, audioIsEncoded, currentSampleRate, samples) && !canceled) {
+                    const auto &layerInfo = layersInfo.at(layer);
+                    looper->loadLayer(layer, samples, layerInfo.locked, Utils::linearGainToPower(layerInfo.gain), layerInfo.pan); // swapped in the audio thread
+                    loadedLayers++;
+                    loaded = true;
+                    QMetaObject::invokeMethod(this, "updateProgress", Qt::QueuedConnection);
+                }
+            }
+
+            QMetaObject::invokeMethod(this, "finishTask", Qt::QueuedConnection);
+            return loaded;
+        }));
     }
+}
 
-    looper->setLoading(false);
-    looper->setLoopName(loopInfo.getName());
+void LoopLoader::updateProgress()
+{
+    if (totalLayers > 0)
+        emit progressChanged(loadedLayers * 100 / totalLayers);
+}
+
+void LoopLoader::finishTask()
+{
+    if (--runningTasks > 0)
+        return;
+
+    bool loaded = !canceled;
+    for (const auto &task : tasks)
+        loaded = loaded && task.result();
+
+    tasks.clear();
+
+    if (looper) {
+        looper->setLoading(false);
+        looper->setLoopName(loaded ? loopName : QString()); // a partially loaded loop is saved as a new loop
+    }
+
+    emit finished(loaded);
 }
 
 bool LoopLoader::loadAudioFile(const QString &filePath, uint currentSampleRate, SamplesBuffer &out)
@@ -204,21 +374,10 @@ bool LoopLoader::loadAudioFile(const QString &filePath, uint currentSampleRate,
         return false;
     }
 
-    auto fileReader = FileReaderFactory::createFileReader(filePath);
-    quint32 audioFileSampleRate = 0;
-    if (!fileReader->read(filePath, out, audioFileSampleRate))
-        return false;
+    audioFile.close();
 
-    bool needResample = audioFileSampleRate > 0 && currentSampleRate != audioFileSampleRate;
-    if (needResample) {
-        SamplesBufferResampler resampler;
-        uint desiredLenght = currentSampleRate/static_cast<float>(audioFileSampleRate) * out.getFrameLenght();
-        const SamplesBuffer resampledBuffer = resampler.resample(out, desiredLenght);
-        out.setFrameLenght(desiredLenght);
-        out.set(resampledBuffer);
-    }
-
-    return true;
+    // decoded and resampled samples are cached, loading the same file again is cheap
+    return persistence::ResampledAudioCache::getInstance().load(filePath, currentSampleRate, out);
 }
 
 bool LoopLoader::loadLoopLayerSamples(const QString &loadPath, const QString &loopName, quint8 layerIndex, bool audioIsEncoded, uint currentSampleRate, SamplesBuffer &out)
@@ -236,65 +395,7 @@ bool LoopLoader::loadLoopLayerSamples(const QString &loadPath, const QString &lo
     return LoopLoader::loadAudioFile(audioFilePath, currentSampleRate, out);
 }
 
-QList<LoopInfo> LoopLoader::loadLoopsInfo(const QString &loadPath, quint32 bpmToMatch)
-{
-    QList<LoopInfo> allInfos;
-
-    QDir loadDir(loadPath);
-    QDir::Filters filters = QDir::NoDotAndDotDot | QDir::Files;
-    QFileInfoList fileInfoList = loadDir.entryInfoList(QStringList("*.json"), filters);
-    for (const QFileInfo &fileInfo : fileInfoList) {
-        QString loopFilePath = fileInfo.absoluteFilePath();
-        LoopInfo loopInfo = LoopLoader::loadLoopInfo(loopFilePath);
-        if (loopInfo.isValid() && loopInfo.getBpm() == bpmToMatch)
-            allInfos.append(loopInfo);
-    }
-
-    return allInfos;
-}
-
 LoopInfo LoopLoader::loadLoopInfo(const QString &loopFilePath)
 {
-    QFile file(loopFilePath);
-    if (!file.open(QFile::ReadOnly)) {
-        qCritical() << "Error loading loop metada:" << file.errorString();
-        return LoopInfo();
-    }
-
-    if (QFileInfo(file).suffix() != "json") {
-        qCritical() << "Error loading loop metada, not a json file" << loopFilePath;
-        return LoopInfo();
-    }
-
-    QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
-    QJsonObject root = doc.object();
-
-    quint32 bpm = (root.contains("bpm") ? (root["bpm"].toInt()) : 0);
-    quint16 bpi = (root.contains("bpi") ? (root["bpi"].toInt()) : 0);
-    bool audioIsEncoded = root.contains("audioFormat") && root["audioFormat"].toString() == "ogg";
-    QString loopName = QFileInfo(file).baseName();
-    quint8 looperMode = root.contains("looperMode") ? root["looperMode"].toInt() : 0;
-
-    LoopInfo loopInfo(bpm, bpi, loopName, audioIsEncoded, looperMode);
-
-    if (root.contains("layers")) {
-        if (root["layers"].isArray()) { // new loop file format
-            QJsonArray layers = root["layers"].toArray();
-            for (int i = 0; i < layers.size(); ++i) {
-                QJsonObject layer = layers.at(i).toObject();
-                bool isLocked = layer.contains("locked") ? layer["locked"].toBool() : false;
-                float gain = layer.contains("gain") ? layer["gain"].toDouble() : 1.0;
-                float pan = layer.contains("pan") ? layer["pan"].toDouble() : 0.0;
-                loopInfo.addLayer(isLocked, gain, pan);
-            }
-        }
-        else { // using old loop file format
-            int layers = root["layers"].toInt(0);
-            for (int l = 0; l < layers; ++l) {
-                loopInfo.addLayer(false, 1.0, 0.0);
-            }
-        }
-    }
-
-    return loopInfo;
+    return LoopInfo::fromFile(loopFilePath);
 }
@@ -1,129 +1,121 @@
 #ifndef _LOOPER_PERSISTENCE_H_
 #define _LOOPER_PERSISTENCE_H_
 
+#include <QObject>
+#include <QPointer>
 #include <QString>
 #include <QSet>
 #include <QList>
+#include <QStringList>
+#include <QFuture>
+#include <QByteArray>
+
+#include <atomic>
+#include <functional>
+
+#include "LoopInfo.h"
 
 namespace audio {
 
 class Looper;
 class SamplesBuffer;
 
-class LoopSaver
-{
-
-public:
-
-    LoopSaver(const QString &savePath, Looper *looper);
-    void save(const QString &loopFileName, uint bpm, uint bpi, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth);
-
-private:
-    QString savePath;
-    Looper *looper;
-
-    static QList<quint8> getLockedLayers(Looper *looper);
-    static void saveSamplesToDisk(const QString &savePath, const QString &loopFileName, const SamplesBuffer &buffer, quint8 layerIndex, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth);
-
-    void saveJsonFile(const QString &loopFileName);
-
-};
-
-// +++++++++++++++++++++++++++++++++++++++++++++++++++++=
+/**
+ * Loops are saved and loaded in the global thread pool, one task per layer. The saver encodes each
+ * layer in chunks, so progress is reported and a cancellation is handled while a layer is encoded.
+ * Layers are written in temporary files, renamed only when all layers are saved.
+ * The loader sends each decoded layer to the looper as soon as it is ready (the layers are swapped
+ * in the audio thread), so the first layers are playing while the others are decoded.
+ */
 
-struct LoopLayerInfo
+class LoopSaver : public QObject
 {
-    float pan;
-    float gain;
-    bool locked;
-};
+    Q_OBJECT
 
-class LoopInfo
-{
 public:
-    LoopInfo(quint32 bpm, quint16 bpi, const QString &name, bool usingEncodedAudio, quint8 mode);
-    LoopInfo();
-
-    void addLayer(bool isLocked, float gain, float pan);
 
-    bool isValid() const;
+    LoopSaver(const QString &savePath, Looper *looper, QObject *parent = nullptr);
+    ~LoopSaver(); // cancel and wait the running tasks
 
-    QString toString(bool showBpm = false) const;
-
-    quint8 getLayersCount() const;
-
-    bool audioIsEncoded() const;
+    void save(const QString &loopFileName, uint bpm, uint bpi, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth);
+    void cancel(); // the loop files are not changed, all written layers are discarded
 
-    QString getName() const;
+    bool isRunning() const;
+    inline QString getLoopFileName() const { return loopFileName; }
 
-    QList<LoopLayerInfo> getLayersInfo() const;
+    static const uint CHUNK_FRAMES; // frames encoded between progress updates and cancellation checks
 
-    quint8 getLooperMode() const;
+signals:
+    void progressChanged(int percent);
+    void finished(bool saved); // false when canceled or failed
 
-    quint16 getBpi() const;
-    quint32 getBpm() const;
+private slots:
+    void updateProgress();
+    void finishTask();
 
 private:
-    quint32 bpm;
-    quint16 bpi;
-    QString name;
-    bool usingEncodedAudio;
-    QList<LoopLayerInfo> layers;
-    quint8 looperMode;
-};
-
-inline quint16 LoopInfo::getBpi() const
-{
-    return bpi;
-}
+    QString savePath;
+    Looper *looper;
 
-inline quint32 LoopInfo::getBpm() const
-{
-    return bpm;
-}
+    QString loopFileName;
+    QByteArray loopJson; // created when saving is started, written after all layers
 
-inline quint8 LoopInfo::getLooperMode() const
-{
-    return looperMode;
-}
+    QList<QFuture<bool>> tasks;
+    int runningTasks;
+    std::atomic<bool> canceled;
+    std::atomic<qint64> savedFrames;
+    qint64 totalFrames;
 
-inline quint8 LoopInfo::getLayersCount() const
-{
-    return layers.size();
-}
+    QStringList layerFiles; // the saved layers, written in temporary files
 
-inline bool LoopInfo::audioIsEncoded() const
-{
-    return usingEncodedAudio;
-}
+    static QList<quint8> getLockedLayers(Looper *looper);
+    static bool saveSamplesToDisk(const QString &filePath, const SamplesBuffer &buffer, bool encodeInOggVorbis, float vorbisQuality, uint sampleRate, quint8 bitDepth, const std::function<bool(uint)> &chunkSaved);
+    static QString getTemporaryFilePath(const QString &filePath);
 
-inline QString LoopInfo::getName() const
-{
-    return name;
-}
+    bool commitLayerFiles();
+    void discardLayerFiles();
+    bool saveJsonFile();
 
-inline QList<LoopLayerInfo> LoopInfo::getLayersInfo() const
-{
-    return layers;
-}
+};
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++=
 
-class LoopLoader
+class LoopLoader : public QObject
 {
+    Q_OBJECT
 
 public:
-    explicit LoopLoader(const QString &loadPath);
+    explicit LoopLoader(const QString &loadPath, QObject *parent = nullptr);
+    ~LoopLoader(); // cancel and wait the running tasks
+
     void load(LoopInfo loopInfo, Looper *looper, uint currentSampleRate, quint32 samplesPerInterval);
+    void cancel(); // layers already loaded are kept
+
+    bool isRunning() const;
 
     static LoopInfo loadLoopInfo(const QString &loopFilePath);
-    static QList<LoopInfo> loadLoopsInfo(const QString &loadPath, quint32 bpmToMatch);
     static bool loadAudioFile(const QString &filePath, uint currentSampleRate, SamplesBuffer &out);
 
     static bool loadLoopLayerSamples(const QString &loadPath, const QString &loopName, quint8 layerIndex, bool audioIsEncoded, uint currentSampleRate, SamplesBuffer &out);
 
+signals:
+    void progressChanged(int percent);
+    void finished(bool loaded); // false when canceled or some layer was not loaded
+
+private slots:
+    void updateProgress();
+    void finishTask();
+
 private:
     QString loadPath;
+    QPointer<Looper> looper;
+    QString loopName;
+
+    QList<QFuture<bool>> tasks;
+    int runningTasks;
+    std::atomic<bool> canceled;
+    std::atomic<int> loadedLayers;
+    int totalLayers;
 
 };
 
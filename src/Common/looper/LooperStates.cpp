@@ -115,7 +115,7 @@ void RecordingState::handleNewCycle(uint samplesInCycle)
                 looper->play();
             }
             else {
-                looper->layers[nextLayer]->zero(); // zero current layer if keep recording
+                looper->getActiveLayer(nextLayer)->zero(); // zero current layer if keep recording
             }
         }
     }
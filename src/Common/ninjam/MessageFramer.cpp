@@ -0,0 +1,143 @@
+#include "MessageFramer.h"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+using ninjam::MessageFramer;
+using ninjam::MessageHeader;
+using ninjam::PayloadReader;
+
+const quint32 MessageFramer::DEFAULT_CAPACITY;
+const quint32 MessageFramer::MAX_PAYLOAD;
+const quint32 MessageFramer::HEADER_SIZE;
+
+MessageFramer::MessageFramer(quint32 capacity) :
+    ring(qMax(capacity, HEADER_SIZE)),
+    head(0),
+    count(0),
+    error(false)
+{
+
+}
+
+void MessageFramer::clear()
+{
+    head = count = 0;
+    error = false;
+}
+
+quint32 MessageFramer::getWriteIndex() const
+{
+    return static_cast<quint32>((static_cast<quint64>(head) + count) % ring.size());
+}
+
+qint64 MessageFramer::readFrom(QIODevice *device)
+{
+    Q_ASSERT(device);
+
+    const quint32 capacity = getCapacity();
+
+    qint64 totalBytes = 0;
+    while (count < capacity) {
+        const quint32 tail = getWriteIndex();
+        const quint32 contiguous = (tail < head) ? head - tail : capacity - tail;
+
+        const qint64 bytes = device->read(ring.data() + tail, contiguous);
+        if (bytes <= 0)
+            break;
+
+        count += static_cast<quint32>(bytes);
+        totalBytes += bytes;
+
+        if (bytes < contiguous) // device is empty
+            break;
+    }
+
+    return totalBytes;
+}
+
+void MessageFramer::append(const char *bytes, quint32 size)
+{
+    if (count + size > getCapacity())
+        grow(count + size);
+
+    const quint32 capacity = getCapacity();
+    while (size > 0) {
+        const quint32 tail = getWriteIndex();
+        const quint32 contiguous = std::min((tail < head) ? head - tail : capacity - tail, size);
+        std::memcpy(ring.data() + tail, bytes, contiguous);
+        bytes += contiguous;
+        size -= contiguous;
+        count += contiguous;
+    }
+}
+
+void MessageFramer::peek(quint32 offset, char *out, quint32 size) const
+{
+    const quint32 capacity = getCapacity();
+    const quint32 start = static_cast<quint32>((static_cast<quint64>(head) + offset) % capacity);
+    const quint32 firstPart = std::min(size, capacity - start);
+
+    std::memcpy(out, ring.data() + start, firstPart);
+    std::memcpy(out + firstPart, ring.data(), size - firstPart);
+}
+
+void MessageFramer::grow(quint32 minCapacity)
+{
+    quint32 newCapacity = getCapacity();
+    while (newCapacity < minCapacity)
+        newCapacity *= 2;
+
+    std::vector<char> newRing(newCapacity);
+    peek(0, newRing.data(), count); // buffered bytes are linearized in the new ring
+
+    ring.swap(newRing);
+    head = 0;
+}
+
+bool MessageFramer::nextMessage(MessageHeader &header, PayloadReader &payload)
+{
+    if (error || count < HEADER_SIZE)
+        return false;
+
+    uchar headerBytes[HEADER_SIZE];
+    peek(0, reinterpret_cast<char *>(headerBytes), HEADER_SIZE);
+
+    const quint8 type = headerBytes[0];
+    const quint32 payloadSize = static_cast<quint32>(headerBytes[1]) | (static_cast<quint32>(headerBytes[2]) << 8)
+            | (static_cast<quint32>(headerBytes[3]) << 16) | (static_cast<quint32>(headerBytes[4]) << 24);
+
+    if (payloadSize > MAX_PAYLOAD) {
+        qCritical() << "Invalid ninjam message, payload:" << payloadSize << "type:" << type;
+        error = true;
+        return false;
+    }
+
+    const quint32 messageSize = HEADER_SIZE + payloadSize;
+    if (count < messageSize) {
+        if (messageSize > getCapacity())
+            grow(messageSize); // making room to receive the entire message
+        return false;
+    }
+
+    const quint32 capacity = getCapacity();
+    const quint32 payloadStart = static_cast<quint32>((static_cast<quint64>(head) + HEADER_SIZE) % capacity);
+    const char *payloadBytes = ring.data() + payloadStart;
+    if (payloadStart + payloadSize > capacity) { // crossing the ring end
+        if (linear.size() < payloadSize)
+            linear.resize(payloadSize);
+        peek(HEADER_SIZE, linear.data(), payloadSize);
+        payloadBytes = linear.data();
+    }
+
+    header = MessageHeader(type, payloadSize);
+    payload = PayloadReader(payloadBytes, payloadSize);
+
+    // consumed bytes are not overwritten until the next read
+    count -= messageSize;
+    head = count ? static_cast<quint32>((static_cast<quint64>(head) + messageSize) % capacity) : 0;
+
+    return true;
+}
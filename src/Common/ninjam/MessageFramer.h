@@ -0,0 +1,58 @@
+#ifndef NINJAM_MESSAGE_FRAMER_H
+#define NINJAM_MESSAGE_FRAMER_H
+
+#include "Ninjam.h"
+
+#include <QIODevice>
+
+#include <vector>
+
+namespace ninjam {
+
+/**
+ * Split the received bytes in Ninjam messages (5 bytes header + payload). Socket bytes are read in
+ * big chunks into a ring buffer reused for the whole connection, and complete messages are parsed
+ * in place: the payload is handed out as a PayloadReader pointing to the buffer. A payload crossing
+ * the ring end is copied to a reused linear buffer, so payloads are always contiguous.
+ *
+ * The ring grows only when a single message is bigger than the current capacity.
+ */
+
+class MessageFramer
+{
+
+public:
+    explicit MessageFramer(quint32 capacity = DEFAULT_CAPACITY);
+
+    qint64 readFrom(QIODevice *device); // read until the device is empty or the buffer is full
+    void append(const char *bytes, quint32 size); // buffer bytes not read from a device, growing if necessary
+
+    /** Return false when a complete message is not buffered. The payload is valid until the next
+        call to nextMessage(), readFrom() or append(). */
+    bool nextMessage(MessageHeader &header, PayloadReader &payload);
+
+    inline bool hasError() const { return error; } // invalid header, the stream can't be framed anymore
+    inline quint32 getBufferedBytes() const { return count; }
+    inline quint32 getCapacity() const { return static_cast<quint32>(ring.size()); }
+
+    void clear();
+
+    static const quint32 DEFAULT_CAPACITY = 64 * 1024;
+    static const quint32 MAX_PAYLOAD = 16 * 1024 * 1024; // bigger payloads are considered corrupted data
+    static const quint32 HEADER_SIZE = 5;
+
+private:
+    void grow(quint32 minCapacity);
+    void peek(quint32 offset, char *out, quint32 size) const;
+    quint32 getWriteIndex() const;
+
+    std::vector<char> ring;
+    std::vector<char> linear; // payloads crossing the ring end
+    quint32 head; // read index
+    quint32 count; // buffered bytes
+    bool error;
+};
+
+} // namespace
+
+#endif // NINJAM_MESSAGE_FRAMER_H
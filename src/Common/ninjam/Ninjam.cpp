@@ -2,6 +2,8 @@
 
 #include <QDateTime>
 
+#include <cstring>
+
 namespace ninjam {
 
 NetworkUsageMeasurer::NetworkUsageMeasurer() :
@@ -63,6 +65,105 @@ MessageHeader MessageHeader::from(QIODevice *device)
     return MessageHeader(type, payload);
 }
 
+// ---------------------------------------------------------------
+
+PayloadReader::PayloadReader() :
+    PayloadReader(nullptr, 0)
+{
+
+}
+
+PayloadReader::PayloadReader(const char *data, quint32 size) :
+    data(data),
+    size(size),
+    position(0),
+    overflowed(false)
+{
+
+}
+
+PayloadReader::PayloadReader(const QByteArray &payload) :
+    PayloadReader(payload.constData(), static_cast<quint32>(payload.size()))
+{
+
+}
+
+const char *PayloadReader::take(quint32 count)
+{
+    if (count > size - position) {
+        position = size;
+        overflowed = true;
+        return nullptr;
+    }
+
+    const char *bytes = data + position;
+    position += count;
+    return bytes;
+}
+
+quint8 PayloadReader::readUInt8()
+{
+    auto bytes = reinterpret_cast<const uchar *>(take(1));
+    return bytes ? bytes[0] : 0;
+}
+
+quint16 PayloadReader::readUInt16()
+{
+    auto bytes = reinterpret_cast<const uchar *>(take(2));
+    return bytes ? static_cast<quint16>(bytes[0] | (bytes[1] << 8)) : 0;
+}
+
+quint32 PayloadReader::readUInt32()
+{
+    auto bytes = reinterpret_cast<const uchar *>(take(4));
+    if (!bytes)
+        return 0;
+
+    return static_cast<quint32>(bytes[0]) | (static_cast<quint32>(bytes[1]) << 8)
+            | (static_cast<quint32>(bytes[2]) << 16) | (static_cast<quint32>(bytes[3]) << 24);
+}
+
+QByteArray PayloadReader::readBytes(quint32 count)
+{
+    auto bytes = take(count);
+    return bytes ? QByteArray(bytes, static_cast<int>(count)) : QByteArray();
+}
+
+QByteArray PayloadReader::viewBytes(quint32 count)
+{
+    auto bytes = take(count);
+    return bytes ? QByteArray::fromRawData(bytes, static_cast<int>(count)) : QByteArray();
+}
+
+void PayloadReader::skip(quint32 count)
+{
+    take(count);
+}
+
+QString PayloadReader::readString()
+{
+    const char *start = data + position;
+    const quint32 available = size - position;
+    auto end = static_cast<const char *>(std::memchr(start, '\0', available));
+    if (!end) { // not terminated, using all remaining bytes
+        position = size;
+        return QString::fromUtf8(start, static_cast<int>(available));
+    }
+
+    const quint32 length = static_cast<quint32>(end - start);
+    position += length + 1; // skipping NUL
+    return QString::fromUtf8(start, static_cast<int>(length));
+}
+
+QString PayloadReader::readString(quint32 stringSize)
+{
+    stringSize = qMin(stringSize, getRemaining());
+    auto bytes = take(stringSize);
+    return QString::fromUtf8(bytes, static_cast<int>(qstrnlen(bytes, stringSize))); // fixed size strings can include the NUL
+}
+
+// ---------------------------------------------------------------
+
 void serializeString(const QString &string, QDataStream &stream)
 {
     QByteArray dataArray = string.toUtf8();
@@ -78,6 +179,23 @@ void serializeByteArray(const QByteArray &array, QDataStream &stream)
     }
 }
 
+QByteArray joinChunks(const QList<QByteArray> &chunks)
+{
+    if (chunks.size() == 1)
+        return chunks.first(); // shared, not copied
+
+    int size = 0;
+    for (const auto &chunk : chunks)
+        size += chunk.size();
+
+    QByteArray data;
+    data.reserve(size);
+    for (const auto &chunk : chunks)
+        data.append(chunk);
+
+    return data;
+}
+
 QString extractString(QDataStream &stream)
 {
     quint8 byte;
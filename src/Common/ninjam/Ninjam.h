@@ -3,6 +3,7 @@
 
 #include <QString>
 #include <QDataStream>
+#include <QList>
 
 namespace ninjam {
 
@@ -39,6 +40,8 @@ enum class MessageType : quint8
 
 class MessageHeader
 {
+    friend class MessageFramer;
+
 public:
     MessageHeader(); // invalid/incomplete message header
 
@@ -67,9 +70,49 @@ private:
     quint32 payload = 0;
 };
 
+/**
+ * Little endian reader over a complete message payload. The payload bytes are not copied,
+ * the reader is a view and is valid while the payload bytes are (see MessageFramer).
+ * Reading past the payload end returns zeros and flags the reader as overflowed.
+ */
+
+class PayloadReader
+{
+public:
+    PayloadReader();
+    PayloadReader(const char *data, quint32 size);
+    explicit PayloadReader(const QByteArray &payload);
+
+    quint8 readUInt8();
+    quint16 readUInt16();
+    quint32 readUInt32();
+
+    QByteArray readBytes(quint32 count); // owning copy
+    QByteArray viewBytes(quint32 count); // not owning, valid while the payload bytes are valid
+    void skip(quint32 count);
+
+    QString readString(); // NUL terminated
+    QString readString(quint32 size);
+
+    inline quint32 getSize() const { return size; }
+    inline quint32 getRemaining() const { return size - position; }
+    inline bool atEnd() const { return position >= size; }
+    inline bool hasOverflowed() const { return overflowed; }
+
+private:
+    const char *take(quint32 count); // nullptr if there are no 'count' bytes
+
+    const char *data;
+    quint32 size;
+    quint32 position;
+    bool overflowed;
+};
+
 void serializeString(const QString &string, QDataStream &stream);
 void serializeByteArray(const QByteArray &array, QDataStream &stream);
 
+QByteArray joinChunks(const QList<QByteArray> &chunks); // join received interval chunks in a single array
+
 QString extractString(QDataStream &stream);         // ninjam strings are NUL(\0) terminated
 QString extractString(QDataStream &stream, quint32 size);
 
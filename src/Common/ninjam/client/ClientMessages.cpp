@@ -10,6 +10,8 @@
 #include <QDataStream>
 #include <QString>
 
+#include <cstring>
+
 using ninjam::client::ClientMessage;
 using ninjam::client::ClientAuthUserMessage;
 using ninjam::client::UploadIntervalWrite;
@@ -19,6 +21,7 @@ using ninjam::client::ClientSetUserMask;
 using ninjam::client::UploadIntervalBegin;
 using ninjam::client::ClientToServerChatMessage;
 using ninjam::client::UserChannel;
+using ninjam::PayloadReader;
 using ninjam::MessageType;
 
 ClientMessage::ClientMessage(MessageType type, quint32 payload) :
@@ -79,26 +82,23 @@ ClientAuthUserMessage::ClientAuthUserMessage(const QString &userName, const QByt
 
 ClientAuthUserMessage ClientAuthUserMessage::unserializeFrom(QIODevice *device, quint32 payload)
 {
-    Q_UNUSED(payload)
-
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return unserializeFrom(reader);
+}
 
-    QByteArray passwordHash(20, Qt::Uninitialized);
-    int readed = stream.readRawData(passwordHash.data(), passwordHash.size());
-    Q_ASSERT(readed = passwordHash.size());
+ClientAuthUserMessage ClientAuthUserMessage::unserializeFrom(PayloadReader &payload)
+{
+    QByteArray passwordHash = payload.readBytes(20);
 
-    QString userName = ninjam::extractString(stream);
+    QString userName = payload.readString();
 
-    QByteArray challenge(8, Qt::Uninitialized);
-    readed = stream.readRawData(challenge.data(), challenge.size());
-    Q_ASSERT(readed = challenge.size());
+    QByteArray challenge = payload.readBytes(8);
 
-    quint32 clientCapabilites;
-    quint32 protocolVersion;
+    quint32 clientCapabilites = payload.readUInt32();
+    Q_UNUSED(clientCapabilites)
 
-    stream >> clientCapabilites;
-    stream >> protocolVersion;
+    quint32 protocolVersion = payload.readUInt32();
 
     return ClientAuthUserMessage(userName, challenge, protocolVersion, QString(passwordHash));
 }
@@ -134,11 +134,19 @@ ClientSetChannel::ClientSetChannel(const QList<ninjam::client::ChannelMetadata>
     ClientSetChannel()
 {
     for (auto channel : channels) {
-        quint8 flags = channel.voiceChatActivated ? 2 : 0;  //Possible values: 0 - ninjam interval based , 2 - voice chat, 4 - session mode
-        addChannel(channel.name, flags);
+        addChannel(channel.name, toFlags(channel.voiceChatActivated));
     }
 }
 
+quint8 ClientSetChannel::toFlags(bool voiceChatActivated)
+{
+    //Possible values: 0 - ninjam interval based , 2 - voice chat, 4 - session mode
+    if (voiceChatActivated)
+        return 2;
+
+    return UserChannel::VOICE_CHAT_CODEC_FLAG; // intervalic, advertising the voice chat codec support
+}
+
 void ClientSetChannel::addChannel(const QString &channelName, quint8 flags, bool active)
 {
     payload += (channelName.toUtf8().size() + 1) + 2 + 1 + 1; // NUL + volume(short) + pan(byte) + flags(byte)
@@ -148,33 +156,31 @@ void ClientSetChannel::addChannel(const QString &channelName, quint8 flags, bool
 
 ClientSetChannel ClientSetChannel::unserializeFrom(QIODevice *device, quint32 payload)
 {
-    if (payload <= 0)
-        return ClientSetChannel(); // no channels
-
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return unserializeFrom(reader);
+}
 
-    quint16 channelParameterSize; // ??
-    stream >> channelParameterSize;
+ClientSetChannel ClientSetChannel::unserializeFrom(PayloadReader &payload)
+{
+    if (payload.atEnd())
+        return ClientSetChannel(); // no channels
 
-    quint32 bytesConsumed = sizeof(quint16);
+    quint16 channelParameterSize = payload.readUInt16(); // ??
+    Q_UNUSED(channelParameterSize)
 
     ClientSetChannel  msg;
 
-    while (bytesConsumed < payload && !stream.atEnd()) {
-
-        quint16 volume;
-        quint8 pan;
-        quint8 flags;
+    while (!payload.atEnd()) {
 
-        QString channelName = ninjam::extractString(stream);
+        QString channelName = payload.readString();
 
-        stream >> volume;
-        stream >> pan;
-        stream >> flags;
+        quint16 volume = payload.readUInt16();
+        quint8 pan = payload.readUInt8();
+        quint8 flags = payload.readUInt8();
 
-        bytesConsumed += channelName.toUtf8().size() + 1;
-        bytesConsumed += sizeof(volume) + sizeof(pan) + sizeof(flags);
+        Q_UNUSED(volume)
+        Q_UNUSED(pan)
 
         bool active = true;// flags == 0;
 
@@ -258,15 +264,15 @@ ClientSetUserMask::ClientSetUserMask(const QString &userName, quint32 channelsMa
 
 ClientSetUserMask ClientSetUserMask::from(QIODevice *device, quint32 payload)
 {
-    Q_UNUSED(payload)
-
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    QString userName(ninjam::extractString(stream));
-    quint32 channelsMask;
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    stream >> channelsMask;
+ClientSetUserMask ClientSetUserMask::from(PayloadReader &payload)
+{
+    QString userName(payload.readString());
+    quint32 channelsMask = payload.readUInt32();
 
     return ClientSetUserMask(userName, channelsMask);
 }
@@ -394,28 +400,20 @@ bool ClientToServerChatMessage::isAdminMessage() const
 
 ClientToServerChatMessage ClientToServerChatMessage::from(QIODevice *device, quint32 payload)
 {
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    QByteArray byteArray(payload, Qt::Uninitialized);
-
-    int readed = stream.readRawData(byteArray.data(), payload);
-
-    Q_ASSERT(readed == payload);
-
-    auto arrays = byteArray.split('\0');
-
-    Q_ASSERT(arrays.size() > 1);
-
-    QString command(arrays.at(0));
-    QString arg1 = QString::fromUtf8(arrays.at(1));
-
-    QString arg2 = (arrays.size() >= 3) ? QString::fromUtf8(arrays.at(2)) : QString();
-    QString arg3 = (arrays.size() >= 4) ? QString::fromUtf8(arrays.at(3)) : QString();
-    QString arg4 = (arrays.size() >= 5) ? QString::fromUtf8(arrays.at(4)) : QString();
+ClientToServerChatMessage ClientToServerChatMessage::from(PayloadReader &payload)
+{
+    QString command = payload.readString();
+    QString arg1 = payload.readString();
+    QString arg2 = payload.readString();
+    QString arg3 = payload.readString();
+    QString arg4 = payload.readString();
 
-    return ClientToServerChatMessage(command, arg1, arg2, arg3,arg4);
+    return ClientToServerChatMessage(command, arg1, arg2, arg3, arg4);
 }
 
 void ClientToServerChatMessage::serializeTo(QIODevice *device) const
@@ -471,28 +469,39 @@ UploadIntervalBegin::UploadIntervalBegin(const QByteArray &GUID, quint8 channelI
     }
 }
 
-UploadIntervalBegin UploadIntervalBegin::from(QIODevice *device, quint32 payload)
+UploadIntervalBegin::UploadIntervalBegin(const QByteArray &GUID, quint8 channelIndex, const QByteArray &fourCC) :
+    ClientMessage(MessageType::UploadIntervalBegin, 16 + 4 + 4 + 1),
+    GUID(GUID),
+    estimatedSize(0),
+    channelIndex(channelIndex)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    Q_ASSERT(fourCC.size() == 4);
 
-    QByteArray GUID(16, Qt::Uninitialized);
-    quint32 estimatedSize;
+    std::memcpy(this->fourCC, fourCC.constData(), 4);
+}
 
-    stream.readRawData(GUID.data(), GUID.size());
-    stream >> estimatedSize;
+UploadIntervalBegin UploadIntervalBegin::from(QIODevice *device, quint32 payload)
+{
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QByteArray fourCC(4, Qt::Uninitialized);
-    stream.readRawData(fourCC.data(), fourCC.size());
+UploadIntervalBegin UploadIntervalBegin::from(PayloadReader &payload)
+{
+    QByteArray GUID = payload.readBytes(16);
+    quint32 estimatedSize = payload.readUInt32();
+    Q_UNUSED(estimatedSize)
 
-    quint8 channelIndex;
-    stream >> channelIndex;
+    QByteArray fourCC = payload.readBytes(4);
 
-    // reading and discarding another bytes, old jamtaba versions are wrongly sending user name in this message
-    ninjam::extractString(stream, payload - 16 - 4 - 4 - 1);
+    quint8 channelIndex = payload.readUInt8();
 
-    bool isAudioInterval = fourCC[0] == 'O' && fourCC[1] == 'G' && fourCC[2] == 'G' && fourCC[3] == 'v';
-    return UploadIntervalBegin(GUID, channelIndex, isAudioInterval);
+    // discarding another bytes, old jamtaba versions are wrongly sending user name in this message
+    payload.skip(payload.getRemaining());
+
+    // forwarded untouched, the server don't need to know the codecs
+    return UploadIntervalBegin(GUID, channelIndex, fourCC.leftJustified(4, '\0', true));
 }
 
 void UploadIntervalBegin::serializeTo(QIODevice *device) const
@@ -535,20 +544,20 @@ UploadIntervalWrite::UploadIntervalWrite(const QByteArray &GUID, const QByteArra
 
 UploadIntervalWrite UploadIntervalWrite::from(QIODevice *device, quint32 payload)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QByteArray GUID(16, Qt::Uninitialized);
-    stream.readRawData(GUID.data(), GUID.size());
+UploadIntervalWrite UploadIntervalWrite::from(PayloadReader &payload)
+{
+    QByteArray GUID = payload.readBytes(16);
 
-    quint8 lastPart;
-    stream >> lastPart;
+    quint8 lastPart = payload.readUInt8();
 
     bool isLastPart = lastPart == 1;
 
-    QByteArray encodedData(payload - 16 - 1, Qt::Uninitialized);
-
-    stream.readRawData(encodedData.data(), encodedData.size());
+    QByteArray encodedData = payload.readBytes(payload.getRemaining());
 
     return UploadIntervalWrite(GUID, encodedData, isLastPart);
 }
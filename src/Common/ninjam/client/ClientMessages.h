@@ -53,6 +53,7 @@ public:
                           quint32 protocolVersion, const QString &password);
 
     static ClientAuthUserMessage unserializeFrom(QIODevice *device, quint32 payload);
+    static ClientAuthUserMessage unserializeFrom(PayloadReader &payload);
     void serializeTo(QIODevice *device) const override;
     void printDebug(QDebug &dbg) const override;
 
@@ -77,6 +78,7 @@ public:
     ClientSetChannel();
     explicit ClientSetChannel(const QList<ChannelMetadata> &channels);
     static ClientSetChannel unserializeFrom(QIODevice *device, quint32 payload);
+    static ClientSetChannel unserializeFrom(PayloadReader &payload);
 
     void addChannel(const QString &channelName, quint8 flags, bool active = true);
 
@@ -88,10 +90,7 @@ public:
         return channels;
     }
 
-    static quint8 toFlags(bool voiceChatActivated) {
-         //Possible values: 0 - ninjam interval based , 2 - voice chat, 4 - session mode
-        return voiceChatActivated ? 2 : 0;
-    }
+    static quint8 toFlags(bool voiceChatActivated);
 private:
     QList<UserChannel> channels;
 };
@@ -115,10 +114,21 @@ public:
     explicit ClientSetUserMask(const QString &userName, quint32 channelsMask);
 
     static ClientSetUserMask from(QIODevice *device, quint32 payload);
+    static ClientSetUserMask from(PayloadReader &payload); // read one user mask, the payload can contain many
 
     void serializeTo(QIODevice *device) const override;
     void printDebug(QDebug &dbg) const override;
 
+    inline QString getUserName() const
+    {
+        return userName;
+    }
+
+    inline quint32 getChannelsMask() const
+    {
+        return channelsMask;
+    }
+
 private:
     QString userName;
     quint32 channelsMask;
@@ -135,6 +145,7 @@ public:
     static ClientToServerChatMessage buildAdminMessage(const QString &message);
 
     static ClientToServerChatMessage from(QIODevice *device, quint32 payload);
+    static ClientToServerChatMessage from(PayloadReader &payload);
 
     inline QString getCommand() const
     {
@@ -181,8 +192,10 @@ class UploadIntervalBegin : public ClientMessage
 {
 public:
     UploadIntervalBegin(const QByteArray &GUID, quint8 channelIndex, bool isAudioInterval);
+    UploadIntervalBegin(const QByteArray &GUID, quint8 channelIndex, const QByteArray &fourCC);
 
     static UploadIntervalBegin from(QIODevice *device, quint32 payload);
+    static UploadIntervalBegin from(PayloadReader &payload);
 
     void serializeTo(QIODevice *device) const override;
     void printDebug(QDebug &dbg) const override;
@@ -224,6 +237,7 @@ public:
     UploadIntervalWrite(const QByteArray &GUID, const QByteArray &encodedData, bool lastPart);
 
     static UploadIntervalWrite from(QIODevice *device, quint32 payload);
+    static UploadIntervalWrite from(PayloadReader &payload);
 
     void serializeTo(QIODevice *device) const override;
     void printDebug(QDebug &dbg) const override;
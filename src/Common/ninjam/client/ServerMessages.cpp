@@ -29,6 +29,7 @@ using ninjam::client::ChatCommandType;
 using ninjam::client::User;
 using ninjam::client::UserChannel;
 using ninjam::MessageType;
+using ninjam::PayloadReader;
 
 ServerMessage::ServerMessage(MessageType messageType) :
     messageType(messageType)
@@ -67,28 +68,28 @@ void AuthChallengeMessage::to(QIODevice *device) const
     ninjam::serializeString(licenceAgreement, stream);
 }
 
-AuthChallengeMessage AuthChallengeMessage::from(QIODevice *device, quint32)
+AuthChallengeMessage AuthChallengeMessage::from(QIODevice *device, quint32 payload)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QByteArray challenge(8, Qt::Uninitialized);
-    int readed = stream.readRawData(challenge.data(), challenge.capacity());
-    Q_ASSERT(readed = 8);
+AuthChallengeMessage AuthChallengeMessage::from(PayloadReader &payload)
+{
+    QByteArray challenge = payload.readBytes(8);
 
-    quint32 serverCapabilities;
-    stream >> serverCapabilities;
+    quint32 serverCapabilities = payload.readUInt32();
 
     // If the Server Capabilities field has bit 0 set then the License Agreement is present.
     bool serverHasLicenceAgreement = serverCapabilities & 0xFFFFFFFF;
 
-    quint32 protocolVersion;
-    stream >> protocolVersion;
+    quint32 protocolVersion = payload.readUInt32();
     //Q_ASSERT(protocolVersion == 0x00020000);
 
     QString licence;
     if (serverHasLicenceAgreement)
-        licence = ninjam::extractString(stream);
+        licence = payload.readString();
 
     return AuthChallengeMessage(challenge, licence, serverCapabilities, protocolVersion);
 }
@@ -141,18 +142,19 @@ void AuthReplyMessage::to(QIODevice *device) const
 
 AuthReplyMessage AuthReplyMessage::from(QIODevice *device, quint32 payload)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    quint8 flag;
-    quint8 maxChannels;
-    QString message;
+AuthReplyMessage AuthReplyMessage::from(PayloadReader &payload)
+{
+    quint8 flag = payload.readUInt8();
 
-    stream >> flag;
-    quint32 stringSize = payload - sizeof(flag) - sizeof(maxChannels);
-    message = ninjam::extractString(stream, stringSize);
+    quint32 stringSize = payload.getRemaining() > 0 ? payload.getRemaining() - sizeof(quint8) : 0; // max channels is the last byte
+    QString message = payload.readString(stringSize);
 
-    stream >> maxChannels;
+    quint8 maxChannels = payload.readUInt8();
 
     return AuthReplyMessage(flag, message, maxChannels);
 }
@@ -180,6 +182,11 @@ ServerKeepAliveMessage ServerKeepAliveMessage::from(QIODevice *, quint32)
     return ServerKeepAliveMessage();
 }
 
+ServerKeepAliveMessage ServerKeepAliveMessage::from(PayloadReader &)
+{
+    return ServerKeepAliveMessage();
+}
+
 void ServerKeepAliveMessage::printDebug(QDebug &dbg) const
 {
     dbg << "RECEIVED ServerKeepAlive{ }";
@@ -208,16 +215,17 @@ void ConfigChangeNotifyMessage::to(QIODevice *device) const
     stream << bpi;
 }
 
-ConfigChangeNotifyMessage ConfigChangeNotifyMessage::from(QIODevice *device, quint32)
+ConfigChangeNotifyMessage ConfigChangeNotifyMessage::from(QIODevice *device, quint32 payload)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    quint16 bpm;
-    quint16 bpi;
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    stream >> bpm;
-    stream >> bpi;
+ConfigChangeNotifyMessage ConfigChangeNotifyMessage::from(PayloadReader &payload)
+{
+    quint16 bpm = payload.readUInt16();
+    quint16 bpi = payload.readUInt16();
 
     return ConfigChangeNotifyMessage(bpm, bpi);
 }
@@ -298,30 +306,30 @@ void UserInfoChangeNotifyMessage::to(QIODevice *device) const
 
 UserInfoChangeNotifyMessage UserInfoChangeNotifyMessage::from(QIODevice *device, quint32 payload)
 {
-    UserInfoChangeNotifyMessage message;
-
-    if (payload <= 0)  // payload is zero when server return no users
-        return message; // will use empy user list;
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+UserInfoChangeNotifyMessage UserInfoChangeNotifyMessage::from(PayloadReader &payload)
+{
+    UserInfoChangeNotifyMessage message; // payload is zero when server return no users
 
-    unsigned int bytesConsumed = 0;
-    while (bytesConsumed < payload) {
-        quint8 active;
-        quint8 channelIndex;
-        quint16 volume;
-        quint8 pan;
-        quint8 flags;
+    while (!payload.atEnd()) {
+        quint8 active = payload.readUInt8();
+        quint8 channelIndex = payload.readUInt8();
+        quint16 volume = payload.readUInt16();
+        quint8 pan = payload.readUInt8();
+        quint8 flags = payload.readUInt8();
 
-        stream >> active >> channelIndex >> volume >> pan >> flags;
+        QString userFullName = payload.readString();
+        QString channelName = payload.readString();
 
-        bytesConsumed += 6;
+        if (payload.hasOverflowed()) {
+            qCritical() << "Incomplete user info in UserInfoChangeNotify message";
+            break;
+        }
 
-        QString userFullName = ninjam::extractString(stream);
-        bytesConsumed += userFullName.toUtf8().size() + 1;
-        QString channelName = ninjam::extractString(stream);
-        bytesConsumed += channelName.toUtf8().size() + 1;
         bool channelIsActive = active > 0 ? true : false;
 
         message.addUserChannel(userFullName, UserChannel(channelName, channelIndex, flags, channelIsActive, volume, pan));
@@ -421,6 +429,13 @@ void ServerToClientChatMessage::to(QIODevice *device) const
 }
 
 ServerToClientChatMessage ServerToClientChatMessage::from(QIODevice *device, quint32 payload)
+{
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
+
+ServerToClientChatMessage ServerToClientChatMessage::from(PayloadReader &payload)
 {
     /*
      Offset Type Field
@@ -439,25 +454,13 @@ ServerToClientChatMessage ServerToClientChatMessage::from(QIODevice *device, qui
      USERCOUNT <users> <maxusers> -- server status
      */
 
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    QByteArray byteArray(payload, Qt::Uninitialized);
-
-    int readed = stream.readRawData(byteArray.data(), payload);
-
-    Q_ASSERT(readed == payload);
-
-    auto arrays = byteArray.split('\0');
-    Q_ASSERT(arrays.size() >= 5);
-
-    QString command(arrays.at(0));
-    QString arg1 = QString::fromUtf8(arrays.at(1));
-    QString arg2 = QString::fromUtf8(arrays.at(2));
-    QString arg3 = QString::fromUtf8(arrays.at(3));
-    QString arg4 = QString::fromUtf8(arrays.at(4));
+    QString command = payload.readString();
+    QString arg1 = payload.readString();
+    QString arg2 = payload.readString();
+    QString arg3 = payload.readString();
+    QString arg4 = payload.readString();
 
-    return ServerToClientChatMessage(command, arg1, arg2, arg3,arg4);
+    return ServerToClientChatMessage(command, arg1, arg2, arg3, arg4);
 }
 
 ChatCommandType ServerToClientChatMessage::commandTypeFromString(const QString &string)
@@ -532,32 +535,37 @@ DownloadIntervalBegin DownloadIntervalBegin::from(const UploadIntervalBegin &msg
 
 DownloadIntervalBegin DownloadIntervalBegin::from(QIODevice *device, quint32 payload)
 {
-    Q_UNUSED(payload)
-
-    QByteArray GUID(16, Qt::Uninitialized);
-    QByteArray fourCC(4, Qt::Uninitialized);
-
-    quint32 estimatedSize;
-    quint8 channelIndex;
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
+DownloadIntervalBegin DownloadIntervalBegin::from(PayloadReader &payload)
+{
+    QByteArray GUID = payload.readBytes(16);
 
-    stream.readRawData(GUID.data(), GUID.size()); // 16 bytes
+    quint32 estimatedSize = payload.readUInt32();
 
-    stream >> estimatedSize;
+    QByteArray fourCC = payload.readBytes(4);
 
-    stream.readRawData(fourCC.data(), fourCC.size()); // 4 bytes
+    quint8 channelIndex = payload.readUInt8();
 
-    stream >> channelIndex;
+    QString userName(payload.readString(payload.getRemaining()));
 
-    quint32 stringSize = payload - 16 - 4 - 4 - 1;
-    QString userName(ninjam::extractString(stream, stringSize));
+    if (payload.hasOverflowed()) { // keeping the constructor invariants
+        GUID.resize(16);
+        fourCC.resize(4);
+    }
 
     return DownloadIntervalBegin(GUID, estimatedSize, fourCC, channelIndex, userName);
 }
 
 bool DownloadIntervalBegin::isAudio() const
+{
+   return  isVorbisAudio() || isVoiceChatAudio();
+}
+
+bool DownloadIntervalBegin::isVorbisAudio() const
 {
    return  fourCC[0] == 'O' &&
            fourCC[1] == 'G' &&
@@ -565,6 +573,15 @@ bool DownloadIntervalBegin::isAudio() const
            fourCC[3] == 'v';
 }
 
+bool DownloadIntervalBegin::isVoiceChatAudio() const
+{
+   // Jamtaba low latency voice chat codec, sent only when all users are advertising the codec support
+   return  fourCC[0] == 'J' &&
+           fourCC[1] == 'T' &&
+           fourCC[2] == 'V' &&
+           fourCC[3] == 'C';
+}
+
 bool DownloadIntervalBegin::isVideo() const
 {
    return !isAudio();
@@ -628,20 +645,18 @@ void DownloadIntervalWrite::to(QIODevice *device) const
 
 DownloadIntervalWrite DownloadIntervalWrite::from(QIODevice *device, quint32 payload)
 {
-    QDataStream stream(device);
-    stream.setByteOrder(QDataStream::LittleEndian);
-
-    QByteArray GUID(16, Qt::Uninitialized);
-
-    stream.readRawData(GUID.data(), GUID.size()); // 16 bytes
+    const QByteArray bytes = device->read(payload);
+    PayloadReader reader(bytes);
+    return from(reader);
+}
 
-    quint8 flags;
-    stream >> flags;
+DownloadIntervalWrite DownloadIntervalWrite::from(PayloadReader &payload)
+{
+    QByteArray GUID = payload.readBytes(16);
 
-    QByteArray encodedData(payload - 17, Qt::Uninitialized);
-    int bytesReaded = stream.readRawData(encodedData.data(), encodedData.size());
+    quint8 flags = payload.readUInt8();
 
-    Q_ASSERT(bytesReaded == encodedData.size());
+    QByteArray encodedData = payload.readBytes(payload.getRemaining()); // the only copy, the receive buffer is reused
 
     return DownloadIntervalWrite(GUID, flags, encodedData);
 }
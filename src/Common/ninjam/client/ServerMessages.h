@@ -58,6 +58,7 @@ public:
     AuthChallengeMessage(const QByteArray &challenge, const QString &licence, quint32 serverCapabilities, quint32 protocolVersion);
 
     static AuthChallengeMessage from(QIODevice *device, quint32 payload);
+    static AuthChallengeMessage from(PayloadReader &payload);
     void to(QIODevice *stream) const;
 
     void printDebug(QDebug &dbg) const override;
@@ -104,6 +105,7 @@ public:
     void to(QIODevice *device) const;
 
     static AuthReplyMessage from(QIODevice *stream, quint32 payload);
+    static AuthReplyMessage from(PayloadReader &payload);
 
     void printDebug(QDebug &debug) const override;
 
@@ -143,6 +145,7 @@ class ServerKeepAliveMessage : public ServerMessage
 public:
     void printDebug(QDebug &dbg) const override;
     static ServerKeepAliveMessage from(QIODevice *stream, quint32 payload);
+    static ServerKeepAliveMessage from(PayloadReader &payload);
 private:
     ServerKeepAliveMessage();
 };
@@ -154,6 +157,7 @@ class ConfigChangeNotifyMessage : public ServerMessage
 public:
     ConfigChangeNotifyMessage(quint16 bpm, quint16 bpi);
     static ConfigChangeNotifyMessage from(QIODevice *device, quint32 payload);
+    static ConfigChangeNotifyMessage from(PayloadReader &payload);
     void to(QIODevice *device) const;
     void printDebug(QDebug &dbg) const override;
 
@@ -185,6 +189,7 @@ public:
     void addUserChannel(const QString &userFullName, const UserChannel &channel);
     void to(QIODevice *device) const;
     static UserInfoChangeNotifyMessage from(QIODevice *stream, quint32 payload);
+    static UserInfoChangeNotifyMessage from(PayloadReader &payload);
     static UserInfoChangeNotifyMessage buildDeactivationMessage(const User &user);
 
     void printDebug(QDebug &dbg) const override;
@@ -234,6 +239,7 @@ public:
     static ServerToClientChatMessage buildVoteSystemMessage(const QString&message);
 
     static ServerToClientChatMessage from(QIODevice *stream, quint32 payload);
+    static ServerToClientChatMessage from(PayloadReader &payload);
 
     void printDebug(QDebug &dbg) const override;
 
@@ -281,6 +287,7 @@ public:
     virtual ~DownloadIntervalBegin() {}
 
     static DownloadIntervalBegin from(QIODevice *stream, quint32 payload);
+    static DownloadIntervalBegin from(PayloadReader &payload);
     static DownloadIntervalBegin from(const UploadIntervalBegin &msg, const QString &userName);
     virtual void to(QIODevice *device) const;
 
@@ -308,6 +315,10 @@ public:
 
     bool isAudio() const;
 
+    bool isVorbisAudio() const;
+
+    bool isVoiceChatAudio() const;
+
     bool isVideo() const;
 
     inline bool shouldBeStopped() const
@@ -344,6 +355,7 @@ class DownloadIntervalWrite : public ServerMessage
 {
 public:
     static DownloadIntervalWrite from(QIODevice *stream, quint32 payload);
+    static DownloadIntervalWrite from(PayloadReader &payload);
     static DownloadIntervalWrite from(const UploadIntervalWrite &msg);
 
     void to(QIODevice *device) const;
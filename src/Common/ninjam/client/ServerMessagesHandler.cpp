@@ -21,46 +21,59 @@ void ServerMessagesHandler::initialize(QIODevice *device)
     Q_ASSERT(device);
     this->device = device;
     currentHeader = MessageHeader();
+    framer.clear();
 }
 
 void ServerMessagesHandler::handleAllMessages()
 {
     Q_ASSERT(device);
-    while (device->bytesAvailable() >= 5) { // consume all messages. Every ninjam message contains a 5 bytes header.
-        if (!currentHeader.isValid())
-            currentHeader = MessageHeader::from(device);
 
-        bool successfullyProcessed = executeMessageHandler(currentHeader);
-        if (successfullyProcessed)
-            currentHeader = MessageHeader(); // invalidate the current message header, a new header will be readed from socket in the next loop iteration
-        else
-            break; // an incomplete message was founded, break and wait until receive more bytes. The currentHeader will be used in the next iteration.
-    }
+    PayloadReader payload;
+    do {
+        framer.readFrom(device); // reading big chunks, messages are parsed from the framer buffer
+
+        while (framer.nextMessage(currentHeader, payload))
+            executeMessageHandler(currentHeader, payload);
+
+    } while (device->bytesAvailable() > 0 && !framer.hasError()); // the framer buffer was full
+
+    currentHeader = MessageHeader();
+
+    if (framer.hasError() && service)
+        service->disconnectFromServer(true); // can't find the next message in the stream
 }
 
-bool ServerMessagesHandler::executeMessageHandler(const MessageHeader &header)
+bool ServerMessagesHandler::executeMessageHandler(const MessageHeader &header, PayloadReader &payload)
 {
     Q_ASSERT(header.isValid());
 
     switch (header.getMessageType()) {
     case MessageType::AuthChallenge:
-        return handleMessage<AuthChallengeMessage>(header.getPayload());
+        handleMessage<AuthChallengeMessage>(payload);
+        return true;
     case MessageType::AuthReply:
-        return handleMessage<AuthReplyMessage>(header.getPayload());
+        handleMessage<AuthReplyMessage>(payload);
+        return true;
     case MessageType::ServerConfigChangeNotify:
-        return handleMessage<ConfigChangeNotifyMessage>(header.getPayload());
+        handleMessage<ConfigChangeNotifyMessage>(payload);
+        return true;
     case MessageType::UserInfoChangeNorify:
-        return handleMessage<UserInfoChangeNotifyMessage>(header.getPayload());
+        handleMessage<UserInfoChangeNotifyMessage>(payload);
+        return true;
     case MessageType::KeepAlive:
-        return handleMessage<ServerKeepAliveMessage>(header.getPayload());
+        handleMessage<ServerKeepAliveMessage>(payload);
+        return true;
     case MessageType::ChatMessage:
-        return handleMessage<ServerToClientChatMessage>(header.getPayload());
+        handleMessage<ServerToClientChatMessage>(payload);
+        return true;
     case MessageType::DownloadIntervalBegin:
-        return handleMessage<DownloadIntervalBegin>(header.getPayload());
+        handleMessage<DownloadIntervalBegin>(payload);
+        return true;
     case MessageType::DownloadIntervalWrite:
-        return handleMessage<DownloadIntervalWrite>(header.getPayload());
+        handleMessage<DownloadIntervalWrite>(payload);
+        return true;
     default:
-        qCritical() << "Can't handle the message code " << static_cast<quint8>(header.getMessageType());
+        qCritical() << "Can't handle the message code " << static_cast<quint8>(header.getMessageType()); // the payload is skipped
     }
     return false;
 }
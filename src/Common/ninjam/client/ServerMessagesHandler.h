@@ -6,6 +6,7 @@
 #include "log/Logging.h"
 #include "Service.h"
 #include "ninjam/Ninjam.h"
+#include "ninjam/MessageFramer.h"
 
 namespace ninjam
 {
@@ -27,22 +28,17 @@ namespace client
         QIODevice *device;
         Service *service;
         MessageHeader currentHeader; // the last messageHeader readed from socket
+        MessageFramer framer; // socket bytes are buffered and parsed in place
 
-        bool executeMessageHandler(const MessageHeader &header);
+        bool executeMessageHandler(const MessageHeader &header, PayloadReader &payload);
 
         template<class MessageClazz> // MessageClazz will be 'translated' to some class derived from ServerMessage
-        bool handleMessage(quint32 payload)
+        void handleMessage(PayloadReader &payload)
         {
-            Q_ASSERT(device);
             Q_ASSERT(service);
 
-            bool allMessageDataIsAvailable = device->bytesAvailable() >= payload;
-            if (allMessageDataIsAvailable) {
-                auto msg = MessageClazz::from(device, payload);
-                service->process(msg); // calling overload versions of 'process'
-                return true; // the message was handled
-            }
-            return false; // the message was not handled
+            auto msg = MessageClazz::from(payload); // the framer guarantees the entire payload is available
+            service->process(msg); // calling overload versions of 'process'
         }
     };
 
@@ -5,6 +5,7 @@
 #include "ServerMessages.h"
 #include "ClientMessages.h"
 #include "ServerMessagesHandler.h"
+#include "UploadScheduler.h"
 #include "log/Logging.h"
 
 #include <QDataStream>
@@ -27,11 +28,13 @@ class Service::Download
 {
 
 public:
-    Download(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, bool audio = true) :
+    Download(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, quint64 sequence, bool audio = true) :
         channelIndex(channelIndex),
         userFullName(userFullName),
         GUID(GUID),
-        containsAudio(audio)
+        containsAudio(audio),
+        size(0),
+        sequence(sequence)
     {
 
     }
@@ -53,7 +56,28 @@ public:
 
     inline void appendEncodedData(const QByteArray &data)
     {
-        this->vorbisData.append(data);
+        encodedChunks.append(data); // QByteArray is implicitly shared, chunks are not copied
+        size += data.size();
+    }
+
+    inline qint64 getSize() const
+    {
+        return size;
+    }
+
+    inline quint64 getSequence() const
+    {
+        return sequence;
+    }
+
+    inline bool isFrom(const QString &userFullName, quint8 channelIndex) const
+    {
+        return this->userFullName == userFullName && this->channelIndex == channelIndex;
+    }
+
+    inline bool isEmpty() const
+    {
+        return encodedChunks.isEmpty();
     }
 
     inline quint8 getChannelIndex() const
@@ -71,19 +95,30 @@ public:
         return GUID;
     }
 
+    inline QList<QByteArray> getEncodedChunks() const
+    {
+        return encodedChunks;
+    }
+
     inline QByteArray getEncodedData() const
     {
-        return vorbisData;
+        return ninjam::joinChunks(encodedChunks);
     }
 
 private:
     quint8 channelIndex;
     QString userFullName;
     QByteArray GUID; // Global Unique ID
-    QByteArray vorbisData;
+    QList<QByteArray> encodedChunks; // received chunks, handed to the decoder without joining
     bool containsAudio; // audio or video?
+    qint64 size;
+    quint64 sequence; // downloads are dropped in the started order
 };
 
+const qint64 Service::MIN_DOWNLOADS_BYTES = 4 * 1024 * 1024;
+const qint64 Service::CHANNEL_BYTES_PER_SECOND = 32 * 1024; // 256 Kbps
+const int Service::BUFFERED_INTERVALS_PER_CHANNEL = 5;
+
 // ++++++++++++++++++++++++++++++++++++++++
 
 Service::Service() :
@@ -91,7 +126,11 @@ Service::Service() :
     initialized(false),
     socket(nullptr),
     messagesHandler(new ServerMessagesHandler(this)),
-    serverKeepAlivePeriod(30)
+    serverKeepAlivePeriod(30),
+    downloadsBytes(0),
+    downloadsBytesLimit(-1),
+    nextDownloadSequence(0),
+    droppedDownloads(0)
 {
 
 }
@@ -129,7 +168,11 @@ void Service::sendIntervalPart(const QByteArray &GUID, const QByteArray &encoded
         return;
 
     auto msg = UploadIntervalWrite(GUID, encodedData, isLastPart);
-    sendMessageToServer(msg);
+    const bool isVideo = videoUploads.contains(GUID);
+    if (isLastPart)
+        videoUploads.remove(GUID);
+
+    sendMessageToServer(msg, isVideo ? UploadScheduler::Video : UploadScheduler::Audio);
 }
 
 void Service::sendIntervalBegin(const QByteArray &GUID, quint8 channelIndex, bool isAudioInterval)
@@ -138,7 +181,18 @@ void Service::sendIntervalBegin(const QByteArray &GUID, quint8 channelIndex, boo
         return;
 
     auto msg = UploadIntervalBegin(GUID, channelIndex, isAudioInterval);
-    sendMessageToServer(msg);
+    if (!isAudioInterval)
+        videoUploads.insert(GUID); // write messages don't have the interval type
+
+    sendMessageToServer(msg, isAudioInterval ? UploadScheduler::Audio : UploadScheduler::Video);
+}
+
+void Service::sendIntervalBegin(const QByteArray &GUID, quint8 channelIndex, const QByteArray &audioFourCC)
+{
+    if (!initialized)
+        return;
+
+    sendMessageToServer(UploadIntervalBegin(GUID, channelIndex, audioFourCC), UploadScheduler::Audio);
 }
 
 // +++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -162,6 +216,15 @@ void Service::clear()
 {
     initialized = false;
     currentServer.reset();
+
+    downloads.clear();
+    downloadsSequence.clear();
+    downloadsBytes = 0;
+    mutedChannels.clear();
+    invalidateDownloadsBytesLimit();
+
+    uploadScheduler.clear();
+    videoUploads.clear();
 }
 
 void Service::handleSocketError(QAbstractSocket::SocketError e)
@@ -222,39 +285,38 @@ float Service::getIntervalPeriod() const
 void Service::voteToChangeBPI(quint16 newBPI)
 {
     QString text = "!vote bpi " + QString::number(newBPI);
-    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(text));
+    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(text), UploadScheduler::Chat);
 }
 
 void Service::voteToChangeBPM(quint16 newBPM)
 {
     QString text = "!vote bpm " + QString::number(newBPM);
-    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(text));
+    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(text), UploadScheduler::Chat);
 }
 
 void Service::sendPrivateChatMessage(const QString &message, const QString &destinationUser)
 {
-    sendMessageToServer(ClientToServerChatMessage::buildPrivateMessage(message, destinationUser));
+    sendMessageToServer(ClientToServerChatMessage::buildPrivateMessage(message, destinationUser), UploadScheduler::Chat);
 }
 
 void Service::sendPublicChatMessage(const QString &message)
 {
-    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(message));
+    sendMessageToServer(ClientToServerChatMessage::buildPublicMessage(message), UploadScheduler::Chat);
 }
 
 void Service::sendAdminCommand(const QString &message)
 {
     auto msg = ClientToServerChatMessage::buildAdminMessage(message);
-    sendMessageToServer(msg);
+    sendMessageToServer(msg, UploadScheduler::Chat);
 }
 
-void Service::sendMessageToServer(const ClientMessage &message)
+void Service::sendMessageToServer(const ClientMessage &message, UploadScheduler::Priority priority)
 {
     if (!socket)
         return;
 
-    message.serializeTo(socket);
+    uploadScheduler.send(message, priority); // written to the socket with the other messages sent in this event loop iteration
 
-    socket->flush();
     lastSendTime = QDateTime::currentMSecsSinceEpoch();
 }
 
@@ -280,20 +342,119 @@ void Service::process(const UserInfoChangeNotifyMessage &msg)
             setChannelReceiveStatus(user.getFullName(), channel.getIndex(), true);
         }
     }
+
+    invalidateDownloadsBytesLimit();
 }
 
 void Service::setChannelReceiveStatus(const QString &userFullName, quint8 channelIndex, bool receiveChannel)
 {
     if (currentServer->containsUser(userFullName)) {
         currentServer->updateUserChannelReceiveStatus(userFullName, channelIndex, receiveChannel);
+        sendChannelsMask(userFullName);
+    }
+}
+
+void Service::setChannelMuted(const QString &userFullName, quint8 channelIndex, bool muted)
+{
+    const ChannelKey key(userFullName, channelIndex);
+    if (muted == mutedChannels.contains(key))
+        return;
+
+    if (muted) {
+        mutedChannels.insert(key);
+        removeDownloads(userFullName, channelIndex);
+    }
+    else {
+        mutedChannels.remove(key);
+    }
+
+    invalidateDownloadsBytesLimit();
 
-        User user = currentServer->getUser(userFullName);
-        quint32 channelsMask = 0;
+    if (currentServer && currentServer->containsUser(userFullName))
+        sendChannelsMask(userFullName);
+}
+
+void Service::sendChannelsMask(const QString &userFullName)
+{
+    User user = currentServer->getUser(userFullName);
+    quint32 channelsMask = 0;
+    for (const UserChannel &channel : user.getChannels()) {
+        if (channel.isActive() && !mutedChannels.contains(ChannelKey(userFullName, channel.getIndex())))
+            channelsMask |= 1 << channel.getIndex();
+    }
+    sendMessageToServer(ClientSetUserMask(userFullName, channelsMask));
+}
+
+void Service::removeDownloads(const QString &userFullName, int channelIndex)
+{
+    auto it = downloads.begin();
+    while (it != downloads.end()) {
+        if (it->getUserFullName() == userFullName && (channelIndex < 0 || it->getChannelIndex() == channelIndex)) {
+            downloadsBytes -= it->getSize();
+            downloadsSequence.remove(it->getSequence());
+            it = downloads.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void Service::removeDownload(const QByteArray &GUID)
+{
+    auto it = downloads.find(GUID);
+    if (it != downloads.end()) {
+        downloadsBytes -= it->getSize();
+        downloadsSequence.remove(it->getSequence());
+        downloads.erase(it);
+    }
+}
+
+void Service::setQueuedIntervalsBytesCounter(const std::function<qint64()> &counter)
+{
+    queuedIntervalsBytes = counter;
+}
+
+void Service::invalidateDownloadsBytesLimit()
+{
+    downloadsBytesLimit = -1; // computed in the next download write
+}
+
+qint64 Service::getDownloadsBytesLimit() const
+{
+    if (!currentServer)
+        return MIN_DOWNLOADS_BYTES;
+
+    if (downloadsBytesLimit >= 0)
+        return downloadsBytesLimit;
+
+    int receivedChannels = 0;
+    for (const User &user : currentServer->getUsers()) {
         for (const UserChannel &channel : user.getChannels()) {
-            if (channel.isActive() || (channel.getIndex() == channelIndex && receiveChannel))
-                channelsMask |= 1 << channel.getIndex();
+            if (channel.isActive() && !mutedChannels.contains(ChannelKey(user.getFullName(), channel.getIndex())))
+                receivedChannels++;
         }
-        sendMessageToServer(ClientSetUserMask(userFullName, channelsMask));
+    }
+
+    const qint64 intervalBytes = static_cast<qint64>(getIntervalPeriod() / 1000.0f * CHANNEL_BYTES_PER_SECOND);
+    downloadsBytesLimit = qMax(MIN_DOWNLOADS_BYTES, intervalBytes * receivedChannels * BUFFERED_INTERVALS_PER_CHANNEL);
+    return downloadsBytesLimit;
+}
+
+void Service::dropOldestDownloads()
+{
+    const qint64 limit = getDownloadsBytesLimit();
+    const qint64 queuedBytes = queuedIntervalsBytes ? queuedIntervalsBytes() : 0;
+
+    while (downloadsBytes + queuedBytes > limit && !downloadsSequence.isEmpty()) {
+        auto oldest = downloads.find(downloadsSequence.first());
+        Q_ASSERT(oldest != downloads.end());
+
+        qCWarning(jtNinjamProtocol) << "Dropping the interval download of" << oldest->getUserFullName() << ", too many buffered bytes";
+        downloadsBytes -= oldest->getSize();
+        downloadsSequence.remove(oldest->getSequence());
+        downloads.erase(oldest);
+        droppedDownloads++;
     }
 }
 
@@ -303,7 +464,20 @@ void Service::process(const DownloadIntervalBegin &msg)
         quint8 channelIndex = msg.getChannelIndex();
         QString userFullName = msg.getUserName();
         QByteArray GUID = msg.getGUID();
-        downloads.insert(GUID, Download(userFullName, channelIndex, GUID, msg.isAudio()));
+
+        if (mutedChannels.contains(ChannelKey(userFullName, channelIndex)))
+            return; // old servers ignore the user mask
+
+        // a new interval is started only when the previous is complete, a download of the same channel will never be completed
+        for (const Download &download : downloads) {
+            if (download.isFrom(userFullName, channelIndex))
+                droppedDownloads++;
+        }
+        removeDownloads(userFullName, channelIndex);
+
+        removeDownload(GUID); // the GUID is reused, keeping the bytes and the started order consistent
+        downloadsSequence.insert(nextDownloadSequence, GUID);
+        downloads.insert(GUID, Download(userFullName, channelIndex, GUID, nextDownloadSequence++, msg.isAudio()));
     }
 }
 
@@ -312,9 +486,10 @@ void Service::process(const DownloadIntervalWrite &msg)
     if (downloads.contains(msg.getGUID())) {
         Download &download = downloads[msg.getGUID()];
 
-        bool isFirstPart = download.getEncodedData().isEmpty();
+        bool isFirstPart = download.isEmpty();
 
         download.appendEncodedData(msg.getEncodedData());
+        downloadsBytes += msg.getEncodedData().size();
 
         auto &measurer = channelDownloadMeasurers[download.getUserFullName()][download.getChannelIndex()];
         auto bytesReceived = msg.getEncodedData().size();
@@ -326,19 +501,24 @@ void Service::process(const DownloadIntervalWrite &msg)
             if (user.getChannel(download.getChannelIndex()).isActive()) {
                 if (msg.downloadIsComplete()) {
                     emit audioIntervalDownloading(user, download.getChannelIndex(), msg.getEncodedData(), isFirstPart, true); // the last chunk
-                    emit audioIntervalCompleted(user, download.getChannelIndex(), download.getEncodedData()); // full interval
-                    downloads.remove(msg.getGUID());
+                    emit audioIntervalCompleted(user, download.getChannelIndex(), download.getEncodedChunks()); // full interval
+                    removeDownload(msg.getGUID());
                 }
                 else
                     emit audioIntervalDownloading(user, download.getChannelIndex(), msg.getEncodedData(), isFirstPart, false);
              }
+             else {
+                removeDownload(msg.getGUID()); // not receiving this channel, the data is not buffered
+             }
         }
         else if (msg.downloadIsComplete()) { // download is video
             emit videoIntervalCompleted(user, download.getEncodedData());
-            downloads.remove(msg.getGUID());
+            removeDownload(msg.getGUID());
         }
+
+        dropOldestDownloads();
     } else {
-        qCritical() << "GUID is not in map!";
+        qCDebug(jtNinjamProtocol) << "GUID is not in map!"; // interval started before joining, dropped or muted channel
     }
 }
 
@@ -387,6 +567,7 @@ void Service::process(const AuthReplyMessage &msg)
         QString serverIp = socket->peerName();
         quint16 serverPort = socket->peerPort();
         currentServer.reset(new ServerInfo(serverIp, serverPort, serverMaxChannels));
+        invalidateDownloadsBytesLimit();
 
         if (!initialized) {
             initialized = true;
@@ -410,9 +591,10 @@ void Service::startServerConnection(const QString &serverIp, int serverPort,
     if (!socket) {
         socket = createSocket(); // createSocket is protected and can be overrided to create a custom socket for test purpouses.
 
-        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // low delay socket, disabling Nagle's Algorithm
+        socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // low delay socket, disabling Nagle's Algorithm. Small messages are coalesced by the upload scheduler
 
         setupSocketSignals();
+        uploadScheduler.setSocket(socket);
     }
     Q_ASSERT(socket);
 
@@ -431,6 +613,7 @@ void Service::disconnectFromServer(bool emitDisconnectedSignal)
 {
     if (socket && socket->isOpen()) {
         qCDebug(jtNinjamProtocol) << "disconnecting from " << socket->peerName();
+        uploadScheduler.flushAll(); // the last messages (chat, interval parts) are sent before closing
         if (!emitDisconnectedSignal)
             socket->blockSignals(true); // avoid generate events when disconnecting/exiting
         socket->disconnectFromHost();
@@ -440,6 +623,7 @@ void Service::disconnectFromServer(bool emitDisconnectedSignal)
 void Service::setBpm(quint16 newBpm)
 {
     Q_ASSERT(currentServer);
+    invalidateDownloadsBytesLimit();
     if (currentServer->setBpm(newBpm) && initialized)
         emit serverBpmChanged(currentServer->getBpm());
 }
@@ -448,6 +632,7 @@ void Service::setBpi(quint16 bpi)
 {
     Q_ASSERT(currentServer);
     quint16 lastBpi = currentServer->getBpi();
+    invalidateDownloadsBytesLimit();
     if (currentServer->setBpi(bpi) && initialized)
         emit serverBpiChanged(currentServer->getBpi(), lastBpi);
 }
@@ -457,6 +642,7 @@ void Service::setInitialBpmBpi(quint16 bpm, quint16 bpi)
     Q_ASSERT(currentServer);
     currentServer->setBpi(bpi);
     currentServer->setBpm(bpm);
+    invalidateDownloadsBytesLimit();
 
     emit serverInitialBpmBpiAvailable(bpm, bpi);
 }
@@ -524,6 +710,14 @@ void Service::process(const ServerToClientChatMessage &msg)
         QString userLeavingTheServer = msg.getArguments().at(0);
         if (currentServer)
             currentServer->removeUser(userLeavingTheServer);
+        removeDownloads(userLeavingTheServer);
+        for (auto it = mutedChannels.begin(); it != mutedChannels.end();) { // a new user can join using the same name
+            if (it->first == userLeavingTheServer)
+                it = mutedChannels.erase(it);
+            else
+                ++it;
+        }
+        invalidateDownloadsBytesLimit();
         emit userExited(User(userLeavingTheServer));
         break;
     }
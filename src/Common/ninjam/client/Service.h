@@ -3,6 +3,7 @@
 
 #include "log/Logging.h"
 #include "ninjam/Ninjam.h"
+#include "UploadScheduler.h"
 
 #include <QtGlobal>
 #include <QScopedPointer>
@@ -10,6 +11,10 @@
 #include <QByteArray>
 #include <QDataStream>
 #include <QStringList>
+#include <QSet>
+#include <QPair>
+
+#include <functional>
 
 namespace ninjam
 {
@@ -52,10 +57,12 @@ namespace client
         void sendAdminCommand(const QString &message);
 
         void setChannelReceiveStatus(const QString &userFullName, quint8 channelIndex, bool receiveChannel);
+        void setChannelMuted(const QString &userFullName, quint8 channelIndex, bool muted); // muted channels are not received
 
         // audio interval upload
         void sendIntervalPart(const QByteArray &GUID, const QByteArray &encodedAudioBuffer, bool isLastPart);
         void sendIntervalBegin(const QByteArray &GUID, quint8 channelIndex, bool isAudioInterval);
+        void sendIntervalBegin(const QByteArray &GUID, quint8 channelIndex, const QByteArray &audioFourCC); // audio intervals using other codecs
 
         void sendNewChannelsListToServer(const QList<ChannelMetadata> &channelsMetadata);
         void sendRemovedChannelIndex(int removedChannelIndex);
@@ -79,6 +86,21 @@ namespace client
         long getTotalDownloadTransferRate() const;
         long getDownloadTransferRate(const QString userFullName, quint8 channelIndex) const;
 
+        inline const UploadScheduler &getUploadScheduler() const { return uploadScheduler; } // sent messages and socket writes
+
+        quint64 getDroppedDownloads() const; // intervals not completely downloaded
+        qint64 getBufferedDownloadsBytes() const;
+
+        // completed intervals waiting to be played (owned by the audio decoders) are counted in the downloads limit
+        void setQueuedIntervalsBytesCounter(const std::function<qint64()> &counter);
+
+        // the oldest downloads are dropped when the incomplete downloads and the queued intervals use more bytes
+        qint64 getDownloadsBytesLimit() const;
+
+        static const qint64 MIN_DOWNLOADS_BYTES;
+        static const qint64 CHANNEL_BYTES_PER_SECOND; // higher vorbis quality, stereo
+        static const int BUFFERED_INTERVALS_PER_CHANNEL; // downloading, playing and the waiting intervals
+
     signals:
         void userChannelCreated(const User &user, const UserChannel &channel);
         void userChannelRemoved(const User &user, const UserChannel &channel);
@@ -87,7 +109,7 @@ namespace client
         void serverBpiChanged(quint16 currentBpi, quint16 lastBpi);
         void serverBpmChanged(quint16 currentBpm);
         void serverInitialBpmBpiAvailable(quint16 bpm, quint16 bpi);
-        void audioIntervalCompleted(const User &user, quint8 channelIndex, const QByteArray &encodedAudioData);
+        void audioIntervalCompleted(const User &user, quint8 channelIndex, const QList<QByteArray> &encodedAudioChunks);
         void videoIntervalCompleted(const User &user, const QByteArray &encodedVideoData);
         void audioIntervalDownloading(const User &user, quint8 channelIndex, const QByteArray &encodedAudioData, bool isFirstPart, bool isLastPart);
         void disconnectedFromServer(const ServerInfo &server);
@@ -143,7 +165,10 @@ namespace client
         NetworkUsageMeasurer totalDownloadMeasurer;
         QMap<QString, QMap<quint8, NetworkUsageMeasurer>> channelDownloadMeasurers; // using userFullName as key in first QMap and channel ID as key in second map
 
-        void sendMessageToServer(const ClientMessage &message);
+        void sendMessageToServer(const ClientMessage &message, UploadScheduler::Priority priority = UploadScheduler::Control);
+
+        UploadScheduler uploadScheduler;
+        QSet<QByteArray> videoUploads; // GUIDs of the video intervals being uploaded
         void handleUserChannels(const User &remoteUser);
         bool channelIsOutdate(const User &user, const UserChannel &serverChannel);
 
@@ -153,6 +178,22 @@ namespace client
 
         class Download; // using a nested class here. This class is for internal purpouses only.
         QMap<QByteArray, Download> downloads; // using GUID as key
+        QMap<quint64, QByteArray> downloadsSequence; // GUIDs in started order, the first download is the oldest
+        qint64 downloadsBytes;
+        mutable qint64 downloadsBytesLimit; // cached, negative when users, channels, muted channels or tempo changed
+        quint64 nextDownloadSequence;
+        quint64 droppedDownloads;
+        std::function<qint64()> queuedIntervalsBytes;
+
+        void removeDownload(const QByteArray &GUID);
+        void removeDownloads(const QString &userFullName, int channelIndex = -1); // all channels by default
+        void dropOldestDownloads();
+        void invalidateDownloadsBytesLimit();
+
+        using ChannelKey = QPair<QString, quint8>; // user full name and channel index
+        QSet<ChannelKey> mutedChannels;
+
+        void sendChannelsMask(const QString &userFullName);
 
         bool needSendKeepAlive() const;
 
@@ -172,6 +213,16 @@ namespace client
         return totalUploadMeasurer.getTransferRate();
     }
 
+    inline quint64 Service::getDroppedDownloads() const
+    {
+        return droppedDownloads;
+    }
+
+    inline qint64 Service::getBufferedDownloadsBytes() const
+    {
+        return downloadsBytes;
+    }
+
     inline QStringList Service::getBotNamesList()
     {
         return botNames;
@@ -0,0 +1,134 @@
+#include "UploadScheduler.h"
+#include "ClientMessages.h"
+
+#include <QBuffer>
+#include <QMetaObject>
+#include <QTimer>
+
+using ninjam::client::UploadScheduler;
+using ninjam::client::ClientMessage;
+
+const qint64 UploadScheduler::MAX_SOCKET_BACKLOG = 32 * 1024;
+const qint64 UploadScheduler::MAX_DEFERRED_BYTES = 512 * 1024;
+const int UploadScheduler::MAX_DEFERRED_TIME = 1000;
+
+UploadScheduler::UploadScheduler(QObject *parent) :
+    QObject(parent),
+    coalescing(true),
+    flushScheduled(false),
+    sentMessages(0),
+    socketWrites(0)
+{
+
+}
+
+void UploadScheduler::setSocket(QTcpSocket *socket)
+{
+    if (this->socket)
+        disconnect(this->socket, nullptr, this, nullptr);
+
+    clear();
+
+    this->socket = socket;
+
+    if (socket) {
+        connect(socket, &QTcpSocket::bytesWritten, this, [=]() {
+            if (!pending[Chat].isEmpty() || !pending[Video].isEmpty())
+                scheduleFlush(); // the deferred messages can be written now
+        });
+    }
+}
+
+void UploadScheduler::setCoalescing(bool coalescing)
+{
+    this->coalescing = coalescing;
+    flush();
+}
+
+void UploadScheduler::clear()
+{
+    for (auto &bytes : pending)
+        bytes.clear();
+
+    deferredTimer.invalidate();
+}
+
+void UploadScheduler::send(const ClientMessage &message, Priority priority)
+{
+    if (!socket)
+        return;
+
+    QBuffer buffer(&pending[priority]); // serialized after the previous messages with the same priority
+    buffer.open(QIODevice::WriteOnly | QIODevice::Append);
+    message.serializeTo(&buffer);
+    sentMessages++;
+
+    if (coalescing)
+        scheduleFlush();
+    else
+        flush();
+}
+
+void UploadScheduler::scheduleFlush()
+{
+    if (flushScheduled)
+        return;
+
+    flushScheduled = true;
+    QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection); // executed after the messages produced in this event loop iteration
+}
+
+void UploadScheduler::flush()
+{
+    flushScheduled = false;
+    write(false);
+}
+
+void UploadScheduler::flushAll()
+{
+    write(true);
+}
+
+bool UploadScheduler::deferredMessagesExpired() const
+{
+    if (pending[Chat].size() + pending[Video].size() > MAX_DEFERRED_BYTES)
+        return true;
+
+    return deferredTimer.isValid() && deferredTimer.elapsed() >= MAX_DEFERRED_TIME;
+}
+
+void UploadScheduler::write(bool writingDeferred)
+{
+    if (!socket || !socket->isOpen())
+        return;
+
+    const bool socketIsSending = socket->bytesToWrite() >= MAX_SOCKET_BACKLOG;
+    const bool deferring = socketIsSending && !writingDeferred && !deferredMessagesExpired();
+
+    QByteArray bytes;
+    for (int priority = Control; priority < PRIORITIES; ++priority) {
+        if (deferring && priority > Audio)
+            break; // waiting for bytesWritten()
+
+        if (bytes.isEmpty())
+            bytes.swap(pending[priority]); // not copied when only one priority has messages
+        else
+            bytes.append(pending[priority]);
+
+        pending[priority].clear();
+    }
+
+    if (pending[Chat].isEmpty() && pending[Video].isEmpty()) {
+        deferredTimer.invalidate();
+    } else if (!deferredTimer.isValid()) {
+        deferredTimer.start();
+        QTimer::singleShot(MAX_DEFERRED_TIME, Qt::PreciseTimer, this, SLOT(flush())); // written even when the socket is stalled
+    }
+
+    if (bytes.isEmpty())
+        return;
+
+    socket->write(bytes);
+    socket->flush();
+    socketWrites++;
+}
@@ -0,0 +1,79 @@
+#ifndef UPLOAD_SCHEDULER_H
+#define UPLOAD_SCHEDULER_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QPointer>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+
+namespace ninjam {
+
+namespace client {
+
+class ClientMessage;
+
+/**
+ * Messages sent to the server are serialized in memory and written to the socket once per event loop
+ * iteration, all pending messages in a single write. Audio interval parts produced by several channels
+ * (and video, chat, keep alive) in the same iteration are sent using one syscall instead of one per message.
+ *
+ * Control and audio messages are always written. Chat and video messages wait while the socket is not
+ * sending the written bytes, so audio is not delayed behind big video interval parts. The deferred
+ * messages are written anyway when they are older than MAX_DEFERRED_TIME or bigger than
+ * MAX_DEFERRED_BYTES, and all pending messages are written before disconnecting (flushAll).
+ */
+
+class UploadScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum Priority // lower values are written first
+    {
+        Control,
+        Audio,
+        Chat,
+        Video
+    };
+
+    explicit UploadScheduler(QObject *parent = nullptr);
+
+    void setSocket(QTcpSocket *socket); // pending messages are discarded
+    void setCoalescing(bool coalescing); // when disabled every message is written and flushed immediately
+
+    void send(const ClientMessage &message, Priority priority);
+    void clear();
+
+    inline quint64 getSentMessages() const { return sentMessages; }
+    inline quint64 getSocketWrites() const { return socketWrites; }
+
+    static const qint64 MAX_SOCKET_BACKLOG; // chat and video are not written when the socket has more bytes to write
+    static const qint64 MAX_DEFERRED_BYTES;
+    static const int MAX_DEFERRED_TIME; // in milliseconds
+
+public slots:
+    void flush();
+    void flushAll(); // deferred chat and video messages are written too
+
+private:
+    static const int PRIORITIES = Video + 1;
+
+    void scheduleFlush();
+    void write(bool writingDeferred);
+    bool deferredMessagesExpired() const;
+
+    QPointer<QTcpSocket> socket;
+    QByteArray pending[PRIORITIES];
+    bool coalescing;
+    bool flushScheduled;
+    QElapsedTimer deferredTimer; // started when chat or video messages are deferred
+
+    quint64 sentMessages;
+    quint64 socketWrites;
+};
+
+} // namespace
+} // namespace
+
+#endif // UPLOAD_SCHEDULER_H
@@ -4,6 +4,8 @@
 
 using ninjam::client::UserChannel;
 
+const quint8 UserChannel::VOICE_CHAT_CODEC_FLAG = 0x80;
+
 UserChannel::UserChannel(const QString &channelName, quint8 channelIndex, quint8 flags, bool active,
                          quint16 volume, quint8 pan) :
     channelName(channelName),
@@ -50,13 +50,21 @@ namespace client
         }
 
         inline bool isIntervalicChannel() const {
-            return flags == 0;
+            return (flags & ~VOICE_CHAT_CODEC_FLAG) == 0;
         }
 
         inline bool isVoiceChatChannel() const {
-            return flags == 2;
+            return (flags & ~VOICE_CHAT_CODEC_FLAG) == 2;
         }
 
+        inline bool supportsVoiceChatCodec() const {
+            return flags & VOICE_CHAT_CODEC_FLAG;
+        }
+
+        // set in intervalic channels when the user can decode the low latency voice chat codec. Not used in voice
+        // chat channels because old Jamtaba versions are comparing the flags value.
+        static const quint8 VOICE_CHAT_CODEC_FLAG;
+
         inline quint8 getFlags() const
         {
             return flags;
@@ -0,0 +1,146 @@
+#include "ClientConnection.h"
+
+#include <QDebug>
+#include <QThread>
+#include <QMetaObject>
+
+using ninjam::server::ClientConnection;
+using ninjam::MessageHeader;
+using ninjam::PayloadReader;
+
+const qint64 ClientConnection::MAX_PENDING_BYTES = 8 * 1024 * 1024; // more than 30 seconds of audio for 16 users
+const qint64 ClientConnection::SOCKET_BUFFER_SIZE = 64 * 1024;
+
+ClientConnection::ClientConnection(qintptr socketDescriptor, bool detachPayloads) :
+    socketDescriptor(socketDescriptor),
+    socket(nullptr),
+    detachPayloads(detachPayloads),
+    pendingBytes(0),
+    closing(false)
+{
+
+}
+
+void ClientConnection::start()
+{
+    socket = new QTcpSocket(this);
+    if (!socket->setSocketDescriptor(socketDescriptor)) {
+        qCritical() << "Can't use the client socket:" << socket->errorString();
+        closing = true;
+        emit disconnected(this);
+        return;
+    }
+
+    socket->setSocketOption(QAbstractSocket::LowDelayOption, 1); // small messages (keep alive, chat) are not delayed
+    peerAddress = socket->peerAddress();
+
+    connect(socket, &QIODevice::readyRead, this, &ClientConnection::readMessages);
+    connect(socket, &QTcpSocket::disconnected, this, &ClientConnection::handleDisconnection);
+    connect(socket, &QTcpSocket::bytesWritten, [=](qint64 bytes) {
+        emit bytesSent(bytes);
+        flush();
+    });
+
+    emit started(this);
+
+    if (socket->bytesAvailable() > 0)
+        readMessages();
+}
+
+void ClientConnection::send(const QByteArray &message)
+{
+    if (QThread::currentThread() == thread())
+        enqueue(message);
+    else
+        QMetaObject::invokeMethod(this, "enqueue", Qt::QueuedConnection, Q_ARG(QByteArray, message));
+}
+
+void ClientConnection::close()
+{
+    if (QThread::currentThread() == thread())
+        closeSocket();
+    else
+        QMetaObject::invokeMethod(this, "closeSocket", Qt::QueuedConnection);
+}
+
+void ClientConnection::enqueue(const QByteArray &message)
+{
+    if (closing || !socket)
+        return;
+
+    pendingMessages.enqueue(message); // not copied, the message bytes are shared by all recipients
+    pendingBytes += message.size();
+
+    if (pendingBytes > MAX_PENDING_BYTES) {
+        qWarning() << "Disconnecting" << peerAddress.toString() << ", the client is not receiving the messages";
+        discardPendingMessages();
+
+        // the server can be broadcasting, the disconnection is not handled while iterating the connections
+        QMetaObject::invokeMethod(this, "disconnectSocket", Qt::QueuedConnection);
+        return;
+    }
+
+    flush();
+}
+
+void ClientConnection::flush()
+{
+    if (closing)
+        return;
+
+    // the socket buffer is kept small, the queued messages are not copied until the socket can send them
+    while (!pendingMessages.isEmpty() && socket->bytesToWrite() < SOCKET_BUFFER_SIZE) {
+        const QByteArray message = pendingMessages.dequeue();
+        pendingBytes -= message.size();
+        socket->write(message);
+    }
+}
+
+void ClientConnection::readMessages()
+{
+    MessageHeader header;
+    PayloadReader payload;
+    qint64 receivedBytes = 0;
+    do {
+        receivedBytes += framer.readFrom(socket); // reading big chunks, messages are parsed from the framer buffer
+
+        while (!closing && framer.nextMessage(header, payload)) {
+            const QByteArray bytes = detachPayloads ? payload.readBytes(payload.getSize()) : payload.viewBytes(payload.getSize());
+            emit messageReceived(this, static_cast<quint8>(header.getMessageType()), bytes);
+        }
+    } while (!closing && socket->bytesAvailable() > 0 && !framer.hasError()); // the framer buffer was full
+
+    emit bytesReceived(receivedBytes);
+
+    if (framer.hasError()) {
+        qCritical() << "Disconnecting" << peerAddress.toString() << ", invalid data received";
+        closeSocket();
+    }
+}
+
+void ClientConnection::closeSocket()
+{
+    if (closing || !socket)
+        return;
+
+    discardPendingMessages();
+    disconnectSocket();
+}
+
+void ClientConnection::discardPendingMessages()
+{
+    closing = true;
+    pendingMessages.clear();
+    pendingBytes = 0;
+}
+
+void ClientConnection::disconnectSocket()
+{
+    socket->disconnectFromHost(); // 'disconnected' is emitted when the socket is closed
+}
+
+void ClientConnection::handleDisconnection()
+{
+    closing = true;
+    emit disconnected(this);
+}
@@ -0,0 +1,75 @@
+#ifndef _SERVER_CLIENT_CONNECTION_
+#define _SERVER_CLIENT_CONNECTION_
+
+#include <QObject>
+#include <QTcpSocket>
+#include <QHostAddress>
+#include <QQueue>
+
+#include "ninjam/MessageFramer.h"
+
+namespace ninjam {
+
+namespace server {
+
+/**
+ * A client socket living in the server thread or in one of the server IO threads. Received bytes
+ * are framed in the connection thread and every complete message is delivered by messageReceived().
+ *
+ * Outgoing messages are serialized once by the server and the same (implicitly shared) byte array is
+ * enqueued in all recipient write queues. Queued messages are handed to the socket when its write
+ * buffer is drained, a client not consuming the queued messages is disconnected.
+ */
+
+class ClientConnection : public QObject
+{
+    Q_OBJECT
+
+public:
+    ClientConnection(qintptr socketDescriptor, bool detachPayloads);
+
+    void send(const QByteArray &message); // thread safe
+    void close(); // thread safe, pending messages are discarded
+
+    inline QHostAddress getPeerAddress() const { return peerAddress; } // valid after started()
+
+    static const qint64 MAX_PENDING_BYTES;
+    static const qint64 SOCKET_BUFFER_SIZE;
+
+public slots:
+    void start(); // create the socket in the connection thread
+
+signals:
+    void started(ninjam::server::ClientConnection *connection);
+    void messageReceived(ninjam::server::ClientConnection *connection, quint8 messageType, const QByteArray &payload);
+    void disconnected(ninjam::server::ClientConnection *connection);
+    void bytesReceived(qint64 bytes);
+    void bytesSent(qint64 bytes);
+
+private slots:
+    void readMessages();
+    void enqueue(const QByteArray &message);
+    void flush();
+    void closeSocket();
+    void disconnectSocket();
+    void handleDisconnection();
+
+private:
+    void discardPendingMessages();
+
+    qintptr socketDescriptor;
+    QTcpSocket *socket;
+    QHostAddress peerAddress;
+
+    MessageFramer framer;
+    bool detachPayloads; // payloads delivered to other threads can't point to the framer buffer
+
+    QQueue<QByteArray> pendingMessages;
+    qint64 pendingBytes;
+    bool closing;
+};
+
+} // ns server
+} // ns ninjam
+
+#endif
@@ -0,0 +1,119 @@
+#include "IntervalArchive.h"
+
+using ninjam::server::IntervalArchive;
+
+namespace {
+
+// 128 kbps during one interval of 32 BPI at 90 BPM (~21.3 s) is ~341 KB per channel
+const qint64 CHANNEL_INTERVAL_BYTES = 128 * 1000 / 8 * 32 * 60 / 90;
+const qint64 ARCHIVED_CHANNELS = 16 * 2; // 16 users with 2 channels, ~10.9 MB
+
+} // namespace
+
+const qint64 IntervalArchive::DEFAULT_MEMORY_LIMIT = CHANNEL_INTERVAL_BYTES * ARCHIVED_CHANNELS * 5 / 4; // headroom for vorbis bitrate peaks
+
+IntervalArchive::IntervalArchive(qint64 memoryLimit) :
+    memoryLimit(memoryLimit),
+    memoryUsage(0),
+    nextSequence(0)
+{
+
+}
+
+void IntervalArchive::setMemoryLimit(qint64 bytes)
+{
+    memoryLimit = qMax(bytes, static_cast<qint64>(0));
+    evict();
+}
+
+void IntervalArchive::beginInterval(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, const QByteArray &message)
+{
+    removeChannel(userFullName, channelIndex); // the previous interval is replaced
+
+    if (memoryLimit <= 0)
+        return;
+
+    Interval interval;
+    interval.GUID = GUID;
+    interval.messages.append(message); // not copied, the message bytes are shared with the sent messages
+    interval.bytes = message.size();
+    interval.sequence = nextSequence++;
+    interval.complete = false;
+
+    const ChannelKey key(userFullName, channelIndex);
+    intervals.insert(key, interval);
+    intervalsOrder.insert(interval.sequence, key);
+    memoryUsage += interval.bytes;
+
+    evict();
+}
+
+void IntervalArchive::appendToInterval(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, const QByteArray &message, bool lastPart)
+{
+    auto it = intervals.find(ChannelKey(userFullName, channelIndex));
+    if (it == intervals.end() || it->GUID != GUID || it->complete)
+        return; // the interval was discarded
+
+    it->messages.append(message);
+    it->bytes += message.size();
+    it->complete = lastPart;
+    memoryUsage += message.size();
+
+    evict();
+}
+
+void IntervalArchive::removeChannel(const QString &userFullName, quint8 channelIndex)
+{
+    auto it = intervals.find(ChannelKey(userFullName, channelIndex));
+    if (it != intervals.end())
+        remove(it);
+}
+
+void IntervalArchive::removeUser(const QString &userFullName)
+{
+    auto it = intervals.begin();
+    while (it != intervals.end()) {
+        if (it.key().first == userFullName) {
+            memoryUsage -= it->bytes;
+            intervalsOrder.remove(it->sequence);
+            it = intervals.erase(it);
+        }
+        else {
+            ++it;
+        }
+    }
+}
+
+void IntervalArchive::clear()
+{
+    intervals.clear();
+    intervalsOrder.clear();
+    memoryUsage = 0;
+}
+
+void IntervalArchive::remove(QHash<ChannelKey, Interval>::iterator it)
+{
+    memoryUsage -= it->bytes;
+    intervalsOrder.remove(it->sequence);
+    intervals.erase(it);
+}
+
+void IntervalArchive::evict()
+{
+    while (memoryUsage > memoryLimit && !intervalsOrder.isEmpty())
+        remove(intervals.find(intervalsOrder.first()));
+}
+
+QList<QByteArray> IntervalArchive::getMessages() const
+{
+    QList<QByteArray> messages;
+    for (const ChannelKey &key : intervalsOrder)
+        messages.append(intervals.constFind(key)->messages);
+
+    return messages;
+}
+
+int IntervalArchive::getIntervalsCount() const
+{
+    return intervals.size();
+}
@@ -0,0 +1,71 @@
+#ifndef _SERVER_INTERVAL_ARCHIVE_
+#define _SERVER_INTERVAL_ARCHIVE_
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QPair>
+
+namespace ninjam {
+
+namespace server {
+
+/**
+ * The most recent interval of each user channel, stored as the serialized DownloadIntervalBegin and
+ * DownloadIntervalWrite messages (the same bytes sent to the connected users). The archived intervals
+ * are replayed to new users, so they can play the other users in the next interval instead of waiting
+ * a complete interval download.
+ *
+ * An interval is replaced when the next interval of the same channel begins. The interval being uploaded
+ * is archived too, a new user receiving it will get the remaining parts from the uploader. When the memory
+ * limit is exceeded the oldest intervals are discarded.
+ */
+
+class IntervalArchive
+{
+public:
+    explicit IntervalArchive(qint64 memoryLimit = DEFAULT_MEMORY_LIMIT);
+
+    void setMemoryLimit(qint64 bytes); // zero disables the archive
+    inline qint64 getMemoryLimit() const { return memoryLimit; }
+    inline qint64 getMemoryUsage() const { return memoryUsage; }
+
+    void beginInterval(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, const QByteArray &message);
+    void appendToInterval(const QString &userFullName, quint8 channelIndex, const QByteArray &GUID, const QByteArray &message, bool lastPart);
+    void removeChannel(const QString &userFullName, quint8 channelIndex); // the channel stopped transmitting
+    void removeUser(const QString &userFullName);
+    void clear();
+
+    QList<QByteArray> getMessages() const; // all archived messages, in the order they were received
+    int getIntervalsCount() const;
+
+    static const qint64 DEFAULT_MEMORY_LIMIT;
+
+private:
+    using ChannelKey = QPair<QString, quint8>; // user full name and channel index
+
+    struct Interval
+    {
+        QByteArray GUID;
+        QList<QByteArray> messages;
+        qint64 bytes;
+        quint64 sequence; // used to discard the oldest intervals
+        bool complete;
+    };
+
+    void remove(QHash<ChannelKey, Interval>::iterator it);
+    void evict();
+
+    QHash<ChannelKey, Interval> intervals;
+    QMap<quint64, ChannelKey> intervalsOrder; // sequence to channel, the oldest interval first
+    qint64 memoryLimit;
+    qint64 memoryUsage;
+    quint64 nextSequence;
+};
+
+} // ns server
+} // ns ninjam
+
+#endif
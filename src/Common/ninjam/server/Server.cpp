@@ -2,6 +2,7 @@
 
 #include <QDebug>
 #include <QDataStream>
+#include <QBuffer>
 #include <QRegularExpression>
 #include <QNetworkInterface>
 #include <QDateTime>
@@ -15,6 +16,8 @@
 
 using ninjam::server::Server;
 using ninjam::server::Voting;
+using ninjam::server::ClientConnection;
+using ninjam::server::ConnectionListener;
 using ninjam::client::AuthChallengeMessage;     // TODO message used both in server and client
 using ninjam::client::ClientAuthUserMessage;    // todo message used both in server and client
 using ninjam::client::ClientSetChannel;         // used in both
@@ -35,6 +38,8 @@ using ninjam::client::User;                     // both
 using ninjam::server::RemoteUser;
 using ninjam::MessageHeader;
 using ninjam::MessageType;
+using ninjam::MessageFramer;
+using ninjam::PayloadReader;
 
 enum AdminCommand
 {
@@ -45,6 +50,17 @@ enum AdminCommand
     kick
 };
 
+// messages are serialized once and the same bytes are sent to all recipients
+template <class Message>
+QByteArray serialize(const Message &message)
+{
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    message.to(&buffer);
+    return bytes;
+}
+
 AdminCommand getAdminCommand(const QString &cmd)
 {
     QString command = cmd.split(" ").first();
@@ -66,7 +82,6 @@ AdminCommand getAdminCommand(const QString &cmd)
 
 RemoteUser::RemoteUser() :
     lastKeepAliveReceived(QDateTime::currentMSecsSinceEpoch()),
-    currentHeader(MessageHeader()),
     receivedServerInfos(false)
 {
 
@@ -107,6 +122,44 @@ void RemoteUser::setLastKeepAliveToNow()
     lastKeepAliveReceived = QDateTime::currentMSecsSinceEpoch();
 }
 
+void RemoteUser::setChannelsMask(const QString &userFullName, quint32 channelsMask)
+{
+    channelsMasks.insert(userFullName, channelsMask);
+}
+
+void RemoteUser::removeChannelsMask(const QString &userFullName)
+{
+    channelsMasks.remove(userFullName);
+}
+
+bool RemoteUser::isReceiving(const QString &userFullName, quint8 channelIndex) const
+{
+    if (channelIndex >= 32)
+        return true;
+
+    auto it = channelsMasks.constFind(userFullName);
+    if (it == channelsMasks.constEnd())
+        return true; // old clients never send the mask
+
+    return (it.value() & (1u << channelIndex)) != 0;
+}
+
+void RemoteUser::startUpload(const QByteArray &GUID, quint8 channelIndex)
+{
+    uploads.insert(GUID, channelIndex);
+}
+
+void RemoteUser::finishUpload(const QByteArray &GUID)
+{
+    uploads.remove(GUID);
+}
+
+int RemoteUser::getUploadChannel(const QByteArray &GUID) const
+{
+    auto it = uploads.constFind(GUID);
+    return it != uploads.constEnd() ? it.value() : -1;
+}
+
 // -------------------------------------------------------------
 
 Voting::Voting(QObject *parent) :
@@ -187,8 +240,17 @@ void Voting::reset()
 
 // -------------------------------------------------------------
 
+void ConnectionListener::incomingConnection(qintptr socketDescriptor)
+{
+    emit newSocketDescriptor(socketDescriptor);
+}
+
+// -------------------------------------------------------------
 
 Server::Server() :
+    ioThreadsCount(0),
+    nextIOThread(0),
+    savedUploadBytes(0),
     bpm(120),
     bpi(16),
     topic("No topic!"),
@@ -198,8 +260,11 @@ Server::Server() :
     keepAlivePeriod(30),
     votingSettings({0.6, 10000}) // 60% for threshold, 60 seconds to vote expiration
 {
-    connect(&tcpServer, &QTcpServer::newConnection, this, &Server::handleNewConnection);
+    connect(&tcpServer, &ConnectionListener::newSocketDescriptor, this, &Server::handleNewConnection);
     connect(&tcpServer, &QTcpServer::acceptError, this, &Server::handleAcceptError);
+
+    keepAliveTimer.setInterval(1000);
+    connect(&keepAliveTimer, &QTimer::timeout, this, &Server::updateKeepAliveInfos);
 }
 
 Server::~Server()
@@ -275,45 +340,133 @@ QHostAddress Server::getBestHostAddress()
     return QHostAddress::AnyIPv4;
 }
 
+void Server::setIOThreads(int threads)
+{
+    ioThreadsCount = qMax(threads, 0);
+}
+
+void Server::setMaxUsers(quint8 maxUsers)
+{
+    this->maxUsers = maxUsers;
+}
+
+void Server::setIntervalArchiveLimit(qint64 bytes)
+{
+    intervalArchive.setMemoryLimit(bytes);
+}
+
 void Server::start(quint16 port)
 {
     shutdown();
 
     QHostAddress address = Server::getBestHostAddress();
     bool listening = tcpServer.listen(address, port);
-    if (listening)
+    if (listening) {
+        startIOThreads();
+        keepAliveTimer.start();
         emit serverStarted();
-    else
+    }
+    else {
         emit errorStartingServer(tcpServer.errorString());
+    }
 }
 
-void Server::handleNewConnection()
+void Server::startIOThreads()
 {
-    QTcpSocket *socket = tcpServer.nextPendingConnection();
-    if (!socket)
-        return;
+    for (int i = 0; i < ioThreadsCount; ++i) {
+        auto thread = new QThread(this);
+        thread->setObjectName(QString("Ninjam server IO %1").arg(i));
+        thread->start();
+        ioThreads.append(thread);
+    }
+    nextIOThread = 0;
+}
+
+void Server::stopIOThreads()
+{
+    for (auto thread : ioThreads) {
+        thread->quit(); // connections deleted later are deleted when the thread finishes
+        thread->wait();
+        delete thread;
+    }
+    ioThreads.clear();
+}
 
+void Server::handleNewConnection(qintptr socketDescriptor)
+{
     if (remoteUsers.size() >= maxUsers) {
-        socket->disconnectFromHost(); // reject the connection
+        QTcpSocket socket;
+        if (socket.setSocketDescriptor(socketDescriptor))
+            socket.abort(); // reject the connection
         return;
     }
 
-    emit incommingConnection(socket->peerAddress().toString());
+    const bool threaded = !ioThreads.isEmpty();
+    auto connection = new ClientConnection(socketDescriptor, threaded);
 
-    connect(socket, &QTcpSocket::disconnected, this, &Server::handleDisconnection);
-    connect(socket, static_cast<void (QTcpSocket::*)(QAbstractSocket::SocketError)>(&QAbstractSocket::error), this, &Server::handleClientSocketError);
-    connect(socket, &QIODevice::readyRead, this, &Server::processReceivedBytes);
-
-    connect(socket, &QTcpSocket::bytesWritten, [&](qint64 bytes){
+    connect(connection, &ClientConnection::started, this, &Server::handleConnectionStarted);
+    connect(connection, &ClientConnection::messageReceived, this, &Server::processMessage);
+    connect(connection, &ClientConnection::disconnected, this, &Server::disconnectClient);
+    connect(connection, &ClientConnection::bytesReceived, this, [=](qint64 bytes) {
+        totalDownloadMeasurer.addTransferedBytes(bytes);
+    });
+    connect(connection, &ClientConnection::bytesSent, this, [=](qint64 bytes) {
         totalUploadMeasurer.addTransferedBytes(bytes);
     });
 
-    remoteUsers.insert(socket, RemoteUser());
+    remoteUsers.insert(connection, RemoteUser());
 
-    sendAuthChallenge(socket);
+    if (threaded) {
+        connection->moveToThread(ioThreads.at(nextIOThread));
+        nextIOThread = (nextIOThread + 1) % ioThreads.size();
+        QMetaObject::invokeMethod(connection, "start", Qt::QueuedConnection);
+    }
+    else {
+        connection->start();
+    }
+
+    sendAuthChallenge(connection); // queued, sent when the socket is created
 }
 
-void Server::sendAuthChallenge(QTcpSocket *device)
+void Server::handleConnectionStarted(ClientConnection *connection)
+{
+    if (remoteUsers.contains(connection))
+        emit incommingConnection(connection->getPeerAddress().toString());
+}
+
+void Server::send(ClientConnection *connection, const QByteArray &message)
+{
+    connection->send(message);
+}
+
+void Server::broadcast(const QByteArray &message, ClientConnection *exclude)
+{
+    for (auto it = remoteUsers.cbegin(); it != remoteUsers.cend(); ++it) {
+        if (it.key() != exclude)
+            it.key()->send(message);
+    }
+}
+
+void Server::broadcastInterval(const QByteArray &message, ClientConnection *sender, quint8 channelIndex)
+{
+    const QString senderFullName = remoteUsers[sender].getFullName();
+
+    qint64 skippedBytes = 0;
+    for (auto it = remoteUsers.cbegin(); it != remoteUsers.cend(); ++it) {
+        if (it.key() == sender)
+            continue;
+
+        if (it.value().isReceiving(senderFullName, channelIndex))
+            it.key()->send(message);
+        else
+            skippedBytes += message.size(); // the recipient is not listening this channel
+    }
+
+    savedUploadBytes += skippedBytes;
+    savedUploadMeasurer.addTransferedBytes(skippedBytes); // zero is added too, the rate is updated when all users are receiving
+}
+
+void Server::sendAuthChallenge(ClientConnection *connection)
 {
     QByteArray challenge("abcdabcd");
     quint32 protocolVersion = 0x00020000; // fixed value
@@ -322,35 +475,32 @@ void Server::sendAuthChallenge(QTcpSocket *device)
         serverCapabilities |= 1; // when server has licence the first bit is set.
 
     auto msg = AuthChallengeMessage(challenge, licence, serverCapabilities, protocolVersion);
-    msg.to(device);
+    send(connection, serialize(msg));
 }
 
-void Server::processClientAuthUserMessage(QTcpSocket *socket, const MessageHeader &header)
+void Server::processClientAuthUserMessage(ClientConnection *connection, PayloadReader &payload)
 {
-    auto msg = ClientAuthUserMessage::unserializeFrom(socket, header.getPayload());
+    auto msg = ClientAuthUserMessage::unserializeFrom(payload);
 
     // ignoring challenge and password for while
 
     quint8 flag = 1; // authentication suceeded
     QString newUserName(generateUniqueUserName(msg.getUserName())); // updated user name or error message;
-    newUserName += "@" + socket->peerAddress().toString();
+    newUserName += "@" + connection->getPeerAddress().toString();
 
-    remoteUsers[socket].setFullName(newUserName);
+    remoteUsers[connection].setFullName(newUserName);
 
     AuthReplyMessage authReply(flag, newUserName, maxChannels);
-    authReply.to(socket);
+    send(connection, serialize(authReply));
 
     if (authReply.userIsAuthenticated()) {
         auto msg = ServerToClientChatMessage::buildUserJoinMessage(newUserName);
-        for (auto skt : remoteUsers.keys()) {
-            if (skt != socket)
-                msg.to(skt);
-        }
+        broadcast(serialize(msg), connection);
 
         emit userEntered(newUserName);
     }
     else {
-        disconnectClient(socket);
+        disconnectClient(connection);
     }
 }
 
@@ -373,7 +523,7 @@ QString Server::generateUniqueUserName(const QString &userName) const
         newName = "anon";
 
     // check if is unique name
-    for (const auto &user : remoteUsers.values()) {
+    for (const auto &user : remoteUsers) {
         if (user.getName() == newName) {
             if (newName.size() < MAX_NAME_SIZE)
                 newName = newName + "_";
@@ -386,29 +536,29 @@ QString Server::generateUniqueUserName(const QString &userName) const
     return newName;
 }
 
-void Server::sendServerInitialInfosTo(QTcpSocket *socket)
+void Server::sendServerInitialInfosTo(ClientConnection *connection)
 {
     // send server config change
     auto configChange = ConfigChangeNotifyMessage(bpm, bpi);
-    configChange.to(socket);
+    send(connection, serialize(configChange));
 
     auto topicMessage = ServerToClientChatMessage::buildTopicMessage(topic);
-    topicMessage.to(socket);
+    send(connection, serialize(topicMessage));
 }
 
-void Server::processClientSetChannel(QTcpSocket *socket, const ninjam::MessageHeader &header)
+void Server::processClientSetChannel(ClientConnection *connection, PayloadReader &payload)
 {
-    auto msg = ClientSetChannel::unserializeFrom(socket, header.getPayload());
+    auto msg = ClientSetChannel::unserializeFrom(payload);
 
     /**
       ClientSetChannel is received after server/client handshake, it's the end of the initialization process. But this message is
       received while jamming too, when channels are added, removed or the channel name is changed.
     */
 
-    if (!remoteUsers.contains(socket))
+    if (!remoteUsers.contains(connection))
         return;
 
-    RemoteUser &user = remoteUsers[socket];
+    RemoteUser &user = remoteUsers[connection];
 
     // update remote user channels list
     user.updateChannels(msg.getChannels(), maxChannels);
@@ -417,27 +567,30 @@ void Server::processClientSetChannel(QTcpSocket *socket, const ninjam::MessageHe
     broadcastUserChanges(user.getFullName(), user.getChannels());
     if (!user.receivedInitialServerInfos()) {
         // send everybody to connected remote user
-        sendConnectedUsersTo(socket);
+        sendConnectedUsersTo(connection);
 
         // send bpm, bpi and server topic to connected user
-        sendServerInitialInfosTo(socket);
+        sendServerInitialInfosTo(connection);
         user.setReceivedServerInfos();
 
+        // the last intervals are played in the next interval, without waiting a complete download
+        sendArchivedIntervalsTo(connection);
+
         //QString message = QString("%1 has joined the room.").arg(user.getName());
-        //broadcastServerMessage(message, socket); // broadcast to everybody, except the connected user
+        //broadcast(serialize(message), connection); // broadcast to everybody, except the connected user
     }
 }
 
-void Server::sendConnectedUsersTo(QTcpSocket *socket)
+void Server::sendConnectedUsersTo(ClientConnection *connection)
 {
-    if (!remoteUsers.contains(socket))
+    if (!remoteUsers.contains(connection))
         return;
 
-    const RemoteUser & connectedUser = remoteUsers[socket];
+    const RemoteUser & connectedUser = remoteUsers[connection];
 
     UserInfoChangeNotifyMessage msg;
 
-    for (const RemoteUser &user : remoteUsers.values()) {
+    for (const RemoteUser &user : remoteUsers) {
         QString fullName(user.getFullName());
         if (fullName != connectedUser.getFullName()) {
             for (const auto & channel : user.getChannels()) {
@@ -446,7 +599,13 @@ void Server::sendConnectedUsersTo(QTcpSocket *socket)
         }
     }
 
-    msg.to(socket);
+    send(connection, serialize(msg));
+}
+
+void Server::sendArchivedIntervalsTo(ClientConnection *connection)
+{
+    for (const QByteArray &message : intervalArchive.getMessages())
+        send(connection, message);
 }
 
 void Server::broadcastUserChanges(const QString userFullName, const QList<UserChannel> &userChannels)
@@ -456,50 +615,74 @@ void Server::broadcastUserChanges(const QString userFullName, const QList<UserCh
     for (int c = 0; c < userChannels.size(); ++c)
         msg.addUserChannel(userFullName, userChannels.at(c));
 
-    for (auto socket : remoteUsers.keys()) {
-        if (remoteUsers[socket].getFullName() != userFullName) {
-            msg.to(socket);
-        }
+    const QByteArray bytes = serialize(msg);
+    for (auto it = remoteUsers.cbegin(); it != remoteUsers.cend(); ++it) {
+        if (it.value().getFullName() != userFullName)
+            send(it.key(), bytes);
     }
 }
 
-void Server::processUploadIntervalBegin(QTcpSocket *senderSocket, const MessageHeader &header)
+void Server::processUploadIntervalBegin(ClientConnection *sender, PayloadReader &payload)
 {
-    if (!remoteUsers.contains(senderSocket))
+    if (!remoteUsers.contains(sender))
         return;
 
-    auto msg = UploadIntervalBegin::from(senderSocket, header.getPayload());
-    auto senderFullName = remoteUsers[senderSocket].getFullName();
+    auto msg = UploadIntervalBegin::from(payload);
+    RemoteUser &user = remoteUsers[sender];
 
-    auto downloadMsg = DownloadIntervalBegin::from(msg, senderFullName);
+    auto downloadMsg = DownloadIntervalBegin::from(msg, user.getFullName());
+    const QByteArray bytes = serialize(downloadMsg);
 
-    for (auto socket : remoteUsers.keys()) {
-        if (socket != senderSocket) {
-            downloadMsg.to(socket);
-        }
+    const QByteArray GUID = msg.getGUID();
+    if (GUID.count('\0') != GUID.size()) { // a zeroed GUID is sent when the channel stops transmitting, no writes will follow
+        user.startUpload(GUID, msg.getChannelIndex());
+        intervalArchive.beginInterval(user.getFullName(), msg.getChannelIndex(), GUID, bytes);
+    }
+    else {
+        intervalArchive.removeChannel(user.getFullName(), msg.getChannelIndex());
     }
+
+    broadcastInterval(bytes, sender, msg.getChannelIndex());
 }
 
-void Server::processUploadIntervalWrite(QTcpSocket *senderSocket, const MessageHeader &header)
+void Server::processUploadIntervalWrite(ClientConnection *sender, PayloadReader &payload)
 {
-    if (!remoteUsers.contains(senderSocket))
+    if (!remoteUsers.contains(sender))
         return;
 
-    // parsing the DownloadIntervalWrite directly, because the message is identical to UploadIntervaWrite
-    auto downloadMsg = DownloadIntervalWrite::from(senderSocket, header.getPayload());
+    // GUID and flags are peeked to find the uploaded channel, the payload is forwarded untouched
+    PayloadReader header(payload);
+    const QByteArray GUID = header.viewBytes(16);
+    const bool lastPart = (header.readUInt8() & 1) != 0;
+    if (header.hasOverflowed())
+        return;
 
-    for (auto socket : remoteUsers.keys()) {
-        if (socket != senderSocket) {
-            downloadMsg.to(socket);
-        }
+    RemoteUser &user = remoteUsers[sender];
+    const int channelIndex = user.getUploadChannel(GUID);
+    if (lastPart)
+        user.finishUpload(GUID);
+
+    // the DownloadIntervalWrite payload is identical to UploadIntervaWrite, only the message type is changed
+    const quint32 payloadSize = payload.getSize();
+    QByteArray downloadMsg;
+    downloadMsg.reserve(MessageFramer::HEADER_SIZE + payloadSize);
+    downloadMsg.append(static_cast<char>(MessageType::DownloadIntervalWrite));
+    for (int byte = 0; byte < 4; ++byte)
+        downloadMsg.append(static_cast<char>((payloadSize >> (8 * byte)) & 0xff)); // little endian payload size
+    downloadMsg.append(payload.viewBytes(payloadSize));
+
+    if (channelIndex >= 0) {
+        intervalArchive.appendToInterval(user.getFullName(), static_cast<quint8>(channelIndex), GUID, downloadMsg, lastPart);
+        broadcastInterval(downloadMsg, sender, static_cast<quint8>(channelIndex));
     }
+    else
+        broadcast(downloadMsg, sender); // interval begin not received, sending to everybody
 }
 
 void Server::broadcastVotingSystemMessage(const QString &message)
 {
     auto msg = ServerToClientChatMessage::buildVoteSystemMessage(message);
-    for (auto socket : remoteUsers.keys())
-        msg.to(socket);
+    broadcast(serialize(msg));
 }
 
 void Server::broadcastPublicChatMessage(const ClientToServerChatMessage &receivedMessage, const QString &userFullName)
@@ -508,9 +691,7 @@ void Server::broadcastPublicChatMessage(const ClientToServerChatMessage &receive
 
     QString messageText = receivedMessage.getArguments().at(0);
     auto msg = ServerToClientChatMessage::buildPublicMessage(userFullName, messageText);
-    for (auto s : remoteUsers.keys()) {
-        msg.to(s);
-    }
+    broadcast(serialize(msg));
 }
 
 void Server::sendPrivateMessage(const QString &sender, const ClientToServerChatMessage &receivedMessage)
@@ -522,10 +703,9 @@ void Server::sendPrivateMessage(const QString &sender, const ClientToServerChatM
     QString text = receivedMessage.getArguments().at(1);
 
     auto msg = ServerToClientChatMessage::buildPrivateMessage(sender, text);
-    for (auto s : remoteUsers.keys()) {
-        const RemoteUser &user = remoteUsers[s];
-        if (user.getFullName() == destinationUserName) {
-            msg.to(s);
+    for (auto it = remoteUsers.cbegin(); it != remoteUsers.cend(); ++it) {
+        if (it.value().getFullName() == destinationUserName) {
+            send(it.key(), serialize(msg));
             break;
         }
     }
@@ -537,9 +717,7 @@ void Server::setTopic(const QString &newTopic)
         topic = newTopic;
 
         auto msg = ServerToClientChatMessage::buildTopicMessage(newTopic);
-        for (auto socket : remoteUsers.keys()) {
-            msg.to(socket);
-        }
+        broadcast(serialize(msg));
     }
 }
 
@@ -547,11 +725,10 @@ void Server::setBpi(quint16 newBpi)
 {
     if (newBpi != bpi && newBpi > 0) {
         bpi = newBpi;
+        intervalArchive.clear(); // archived intervals have the previous interval length
 
         auto msg = ConfigChangeNotifyMessage(bpm, bpi);
-        for (auto socket : remoteUsers.keys()) {
-            msg.to(socket);
-        }
+        broadcast(serialize(msg));
     }
 }
 
@@ -559,11 +736,10 @@ void Server::setBpm(quint16 newBpm)
 {
     if (newBpm != bpm && newBpm > 0) {
         bpm = newBpm;
+        intervalArchive.clear(); // archived intervals have the previous interval length
 
         auto msg = ConfigChangeNotifyMessage(bpm, bpi);
-        for (auto socket : remoteUsers.keys()) {
-            msg.to(socket);
-        }
+        broadcast(serialize(msg));
     }
 }
 
@@ -658,14 +834,14 @@ void Server::processBpmVoteMessage(const ninjam::client::ClientToServerChatMessa
     processVoteMessage(userFullName, voteValue, bpm, bpmVotings, std::bind(&Server::createBpmVoting, this));
 }
 
-void Server::processChatMessage(QTcpSocket *socket, const ninjam::MessageHeader &header)
+void Server::processChatMessage(ClientConnection *connection, PayloadReader &payload)
 {
-    if (!remoteUsers.contains(socket))
+    if (!remoteUsers.contains(connection))
         return;
 
-    ClientToServerChatMessage receivedMessage = ClientToServerChatMessage::from(socket, header.getPayload());
+    ClientToServerChatMessage receivedMessage = ClientToServerChatMessage::from(payload);
 
-    QString userFullName = remoteUsers[socket].getFullName();
+    QString userFullName = remoteUsers[connection].getFullName();
 
     if (receivedMessage.isPublicMessage()) {
         broadcastPublicChatMessage(receivedMessage, userFullName);
@@ -687,167 +863,134 @@ void Server::processChatMessage(QTcpSocket *socket, const ninjam::MessageHeader
 
 }
 
-void Server::processKeepAlive(QTcpSocket *socket, const ninjam::MessageHeader &)
+void Server::processKeepAlive(ClientConnection *connection, PayloadReader &)
 {
-    if (remoteUsers.contains(socket)) {
-        remoteUsers[socket].setLastKeepAliveToNow();
+    if (remoteUsers.contains(connection)) {
+        remoteUsers[connection].setLastKeepAliveToNow();
     }
 }
 
 void Server::updateKeepAliveInfos()
 {
     // check if remote users need keep alive request
-    for (auto socket : remoteUsers.keys()) {
-        const auto &user = remoteUsers[socket];
-        auto now = QDateTime::currentMSecsSinceEpoch();
-        auto delta = (now - user.getLastKeepAliveReceived()) / 1000; // in seconds
+    QByteArray keepAliveMessage;
+    QList<ClientConnection *> notResponding;
+    const auto now = QDateTime::currentMSecsSinceEpoch();
+    for (auto it = remoteUsers.cbegin(); it != remoteUsers.cend(); ++it) {
+        auto delta = (now - it.value().getLastKeepAliveReceived()) / 1000; // in seconds
         if (delta >= keepAlivePeriod) {
             if (delta >= keepAlivePeriod * 3) { // client is not responding
-                disconnectClient(socket);
+                notResponding.append(it.key());
             }
             else {
-                ClientKeepAlive msg;
-                msg.serializeTo(socket);
+                if (keepAliveMessage.isEmpty()) {
+                    QBuffer buffer(&keepAliveMessage);
+                    buffer.open(QIODevice::WriteOnly);
+                    ClientKeepAlive().serializeTo(&buffer);
+                }
+                send(it.key(), keepAliveMessage);
             }
         }
     }
-}
-
-void Server::processClientSetUserMask(QTcpSocket *socket, const ninjam::MessageHeader &header)
-{
-    auto msg = ClientSetUserMask::from(socket, header.getPayload());
 
+    for (auto connection : notResponding)
+        disconnectClient(connection);
 }
 
-void Server::processReceivedBytes()
+void Server::processClientSetUserMask(ClientConnection *connection, PayloadReader &payload)
 {
-    updateKeepAliveInfos();
+    RemoteUser &user = remoteUsers[connection];
 
-    auto socket = qobject_cast<QTcpSocket *>(QObject::sender());
-    if (!socket) {
-        qCritical("Error, socket is NULL!");
-        return;
-    }
+    while (!payload.atEnd()) { // one or more user name + channels mask pairs
+        auto msg = ClientSetUserMask::from(payload);
+        if (payload.hasOverflowed())
+            break;
 
-    if (!remoteUsers.contains(socket)) {
-        qCritical("not contain socket!");
-        if (socket->isOpen()) {
-            socket->close();
-            socket->deleteLater();
-        }
-        return;
+        user.setChannelsMask(msg.getUserName(), msg.getChannelsMask());
     }
+}
 
-    qint64 bytesAvailable = socket->bytesAvailable();
-
-    RemoteUser &user = remoteUsers[socket];
-
-    while (socket->bytesAvailable() >= 5) { // all messages have minimum of 5 bytes
-
-        MessageHeader header = user.getCurrentHeader();
-        if (!header.isValid()) {
-            header = MessageHeader::from(socket);
-            user.setCurrentHeader(header);
-        }
-
-        Q_ASSERT(header.isValid());
-
-        if (socket->bytesAvailable() < header.getPayload()) {
-//            qDebug() << "not enough bytes " << socket->bytesAvailable() << "/" << header.getPayload()
-//                     << " bytes available  msg code:"<< QString::number(static_cast<quint8>(header.getMessageType()), 16);
-            return;
-        }
+void Server::processMessage(ClientConnection *connection, quint8 messageType, const QByteArray &payload)
+{
+    if (!remoteUsers.contains(connection))
+        return; // messages received before the disconnection
 
-        switch (header.getMessageType()) {
-        case MessageType::ClientAuthUser:
-            processClientAuthUserMessage(socket, header);
-            break;
+    PayloadReader reader(payload);
 
-        case MessageType::ClientSetChannel:
-            processClientSetChannel(socket, header);
-            break;
+    switch (static_cast<MessageType>(messageType)) {
+    case MessageType::ClientAuthUser:
+        processClientAuthUserMessage(connection, reader);
+        break;
 
-        case MessageType::KeepAlive:
-            processKeepAlive(socket, header);
-            break;
+    case MessageType::ClientSetChannel:
+        processClientSetChannel(connection, reader);
+        break;
 
-        case MessageType::UploadIntervalBegin:
-            processUploadIntervalBegin(socket, header);
-            break;
+    case MessageType::KeepAlive:
+        processKeepAlive(connection, reader);
+        break;
 
-        case MessageType::UploadIntervalWrite:
-            processUploadIntervalWrite(socket, header);
-            break;
+    case MessageType::UploadIntervalBegin:
+        processUploadIntervalBegin(connection, reader);
+        break;
 
-        case MessageType::ChatMessage:
-            processChatMessage(socket, header);
-            break;
+    case MessageType::UploadIntervalWrite:
+        processUploadIntervalWrite(connection, reader);
+        break;
 
-        case MessageType::ClientSetUserMask:
-            processClientSetUserMask(socket, header);
-            break;
+    case MessageType::ChatMessage:
+        processChatMessage(connection, reader);
+        break;
 
-        default:
-            qFatal("not handled message code: %s",
-                   QString::number(static_cast<quint8>(header.getMessageType()), 16).toStdString().c_str());
-        }
+    case MessageType::ClientSetUserMask:
+        processClientSetUserMask(connection, reader);
+        break;
 
-        user.setCurrentHeader(MessageHeader()); // invalidate header to force a new parsing in next loop iteration
+    default: // the payload is skipped
+        qCritical() << "not handled message code:" << QString::number(messageType, 16);
     }
 
-    user.setLastKeepAliveToNow();
-
-    qint64 bytesRemaining = socket->bytesAvailable();
-    totalDownloadMeasurer.addTransferedBytes(bytesAvailable - bytesRemaining);
-}
-
-void Server::handleDisconnection()
-{
-    auto socket = qobject_cast<QTcpSocket *>(QObject::sender());
-    if (socket)
-        disconnectClient(socket);
+    if (remoteUsers.contains(connection))
+        remoteUsers[connection].setLastKeepAliveToNow();
 }
 
 QStringList Server::getConnectedUsersNames() const
 {
     QStringList names;
 
-    for (const RemoteUser &user : remoteUsers.values())
+    for (const RemoteUser &user : remoteUsers)
         names.append(user.getFullName());
 
     return names;
 }
 
-void Server::disconnectClient(QTcpSocket *socket)
+void Server::disconnectClient(ClientConnection *connection)
 {
-    if (remoteUsers.contains(socket)) {
-        const RemoteUser &user = remoteUsers[socket];
+    if (remoteUsers.contains(connection)) {
+        const RemoteUser &user = remoteUsers[connection];
 
         QString userFullName = user.getFullName();
 
         // send the PART message and deactivate all user channels
         auto msg = UserInfoChangeNotifyMessage::buildDeactivationMessage(user);
         auto partMsg = ServerToClientChatMessage::buildUserPartMessage(userFullName);
-        for (auto skt : remoteUsers.keys()) {
-            if (skt != socket) {
-                partMsg.to(skt);
-                msg.to(skt);
-            }
-        }
 
-        remoteUsers.remove(socket);
-        socket->deleteLater();
+        remoteUsers.remove(connection);
+        connection->close();
+        connection->deleteLater(); // deleted in the connection thread
+
+        for (auto &remoteUser : remoteUsers) // a new user can join using the same name
+            remoteUser.removeChannelsMask(userFullName);
+
+        intervalArchive.removeUser(userFullName);
+
+        broadcast(serialize(partMsg));
+        broadcast(serialize(msg));
 
         emit userLeave(userFullName);
     }
 }
 
-void Server::handleClientSocketError(QAbstractSocket::SocketError error)
-{
-    Q_UNUSED(error)
-    //qDebug() << qobject_cast<QTcpSocket *>(QObject::sender())->errorString();
-}
-
 void Server::handleAcceptError(QAbstractSocket::SocketError socketError)
 {
     qCritical() << socketError <<  tcpServer.errorString();
@@ -868,11 +1011,15 @@ void Server::shutdown()
     if (tcpServer.isListening()) {
         tcpServer.close();
 
-        for (auto socket : remoteUsers.keys())
-            disconnectClient(socket);
+        keepAliveTimer.stop();
+
+        for (auto connection : remoteUsers.keys())
+            disconnectClient(connection);
 
         remoteUsers.clear();
 
+        stopIOThreads();
+
         emit serverStopped();
     }
 }
@@ -5,10 +5,14 @@
 #include <QTcpSocket>
 #include <QObject>
 #include <QList>
+#include <QHash>
 #include <QTimer>
+#include <QThread>
 
 #include "ninjam/Ninjam.h"
 #include "ninjam/client/User.h"
+#include "ClientConnection.h"
+#include "IntervalArchive.h"
 
 #include <functional>
 
@@ -31,11 +35,19 @@ public:
     RemoteUser();
     void setLastKeepAliveToNow();
     quint64 getLastKeepAliveReceived() const;
-    MessageHeader getCurrentHeader() const;
-    void setCurrentHeader(MessageHeader header);
     void setFullName(const QString &fullName);
     void updateChannels(const QList<UserChannel> &newChannels, quint8 maxChannels);
 
+    // channels received from other users, all channels are received until the client set a mask
+    void setChannelsMask(const QString &userFullName, quint32 channelsMask);
+    void removeChannelsMask(const QString &userFullName);
+    bool isReceiving(const QString &userFullName, quint8 channelIndex) const;
+
+    // intervals uploaded by this user, write messages contain the interval GUID only
+    void startUpload(const QByteArray &GUID, quint8 channelIndex);
+    void finishUpload(const QByteArray &GUID);
+    int getUploadChannel(const QByteArray &GUID) const; // -1 if the interval is unknown
+
     inline bool receivedInitialServerInfos() const
     {
         return receivedServerInfos;
@@ -47,21 +59,12 @@ public:
     }
 
 private:
-    MessageHeader currentHeader;
     quint64 lastKeepAliveReceived;
     bool receivedServerInfos;
+    QHash<QString, quint32> channelsMasks;
+    QHash<QByteArray, quint8> uploads; // GUID -> channel index
 };
 
-inline void RemoteUser::setCurrentHeader(MessageHeader header)
-{
-    currentHeader = header;
-}
-
-inline MessageHeader RemoteUser::getCurrentHeader() const
-{
-    return currentHeader;
-}
-
 inline quint64 RemoteUser::getLastKeepAliveReceived() const
 {
     return lastKeepAliveReceived;
@@ -92,6 +95,18 @@ private:
     void reset();
 };
 
+// create the client sockets using the accepted socket descriptors, sockets can live in other threads
+class ConnectionListener : public QTcpServer
+{
+    Q_OBJECT
+
+signals:
+    void newSocketDescriptor(qintptr socketDescriptor);
+
+protected:
+    void incomingConnection(qintptr socketDescriptor) override;
+};
+
 class Server : public QObject
 {
     Q_OBJECT
@@ -102,6 +117,10 @@ public:
     virtual void start(quint16 port);
     void shutdown();
 
+    void setIOThreads(int threads); // sockets are handled in the server thread by default, used in the next start()
+    void setMaxUsers(quint8 maxUsers);
+    void setIntervalArchiveLimit(qint64 bytes); // last intervals replayed to new users, zero disables the archive
+
     bool isStarted() const;
 
     quint16 getPort() const;
@@ -118,6 +137,8 @@ public:
 
     quint64 getDownloadTransferRate() const;
     quint64 getUploadTransferRate() const;
+    quint64 getSavedUploadTransferRate() const; // intervals not sent to users not receiving the channel
+    quint64 getSavedUploadBytes() const;
 
 signals:
     void serverStarted();
@@ -128,14 +149,15 @@ signals:
     void userLeave(const QString &userName);
 
 protected:
-    void sendAuthChallenge(QTcpSocket *device);
+    void sendAuthChallenge(ClientConnection *connection);
 
 protected slots:
-    virtual void handleNewConnection();
+    virtual void handleNewConnection(qintptr socketDescriptor);
     void handleAcceptError(QAbstractSocket::SocketError socketError);
-    void processReceivedBytes();
-    void handleDisconnection();
-    void handleClientSocketError(QAbstractSocket::SocketError error);
+    void handleConnectionStarted(ninjam::server::ClientConnection *connection);
+    void processMessage(ninjam::server::ClientConnection *connection, quint8 messageType, const QByteArray &payload);
+    void disconnectClient(ninjam::server::ClientConnection *connection);
+    void updateKeepAliveInfos();
 
     void bpiVotingExpired(quint16 bpiValue);
     void bpiVotingAccepted(quint16 acceptedValue);
@@ -146,8 +168,14 @@ protected slots:
     void bpmVotingIncremented(quint16 votingValue, quint16 currentVotes, quint16 requiredVotes, quint64 expirationTime);
 
 private:
-    QTcpServer tcpServer;
-    QMap<QTcpSocket *, RemoteUser> remoteUsers; // connected clients
+    ConnectionListener tcpServer;
+    QMap<ClientConnection *, RemoteUser> remoteUsers; // connected clients
+
+    int ioThreadsCount;
+    QList<QThread *> ioThreads;
+    int nextIOThread;
+
+    QTimer keepAliveTimer;
 
     quint16 bpm;
     quint16 bpi;
@@ -159,6 +187,10 @@ private:
 
     NetworkUsageMeasurer totalUploadMeasurer;
     NetworkUsageMeasurer totalDownloadMeasurer;
+    NetworkUsageMeasurer savedUploadMeasurer;
+    quint64 savedUploadBytes;
+
+    IntervalArchive intervalArchive;
 
     struct VotingSettings
     {
@@ -172,11 +204,15 @@ private:
     VotingMap bpmVotings;
     VotingMap bpiVotings;
 
+    void send(ClientConnection *connection, const QByteArray &message);
+    void broadcast(const QByteArray &message, ClientConnection *exclude = nullptr); // message serialized once
+    void broadcastInterval(const QByteArray &message, ClientConnection *sender, quint8 channelIndex);
+
     void broadcastUserChanges(const QString userFullName, const QList<UserChannel> &userChannels);
-    void sendConnectedUsersTo(QTcpSocket *socket);
+    void sendConnectedUsersTo(ClientConnection *connection);
+    void sendArchivedIntervalsTo(ClientConnection *connection);
     void broadcastPublicChatMessage(const ClientToServerChatMessage &receivedMessage, const QString &userFullName);
     void broadcastVotingSystemMessage(const QString &message);
-    void broadcastServerMessage(const QString &serverMessage, QTcpSocket *exclude);
 
     void processBpiVoteMessage(const ClientToServerChatMessage &msg, const QString &userFullName);
     void processBpmVoteMessage(const ClientToServerChatMessage &msg, const QString &userFullName);
@@ -184,15 +220,15 @@ private:
     Voting *createBpiVoting();
     Voting *createBpmVoting();
 
-    void processClientAuthUserMessage(QTcpSocket *socket, const MessageHeader &header);
-    void processClientSetChannel(QTcpSocket *socket, const MessageHeader &header);
-    void processUploadIntervalBegin(QTcpSocket *socket, const MessageHeader &header);
-    void processUploadIntervalWrite(QTcpSocket *socket, const MessageHeader &header);
-    void processChatMessage(QTcpSocket *socket, const MessageHeader &header);
-    void processKeepAlive(QTcpSocket *socket, const MessageHeader &header);
-    void processClientSetUserMask(QTcpSocket *socket, const MessageHeader &header);
+    void processClientAuthUserMessage(ClientConnection *connection, PayloadReader &payload);
+    void processClientSetChannel(ClientConnection *connection, PayloadReader &payload);
+    void processUploadIntervalBegin(ClientConnection *connection, PayloadReader &payload);
+    void processUploadIntervalWrite(ClientConnection *connection, PayloadReader &payload);
+    void processChatMessage(ClientConnection *connection, PayloadReader &payload);
+    void processKeepAlive(ClientConnection *connection, PayloadReader &payload);
+    void processClientSetUserMask(ClientConnection *connection, PayloadReader &payload);
 
-    void sendServerInitialInfosTo(QTcpSocket *socket);
+    void sendServerInitialInfosTo(ClientConnection *connection);
 
     void sendPrivateMessage(const QString &sender, const ClientToServerChatMessage &receivedMessage);
     void processAdminCommand(const QString &cmd);
@@ -200,12 +236,11 @@ private:
     void setBpi(quint16 newBpi);
     void setBpm(quint16 newBpm);
 
-    void disconnectClient(QTcpSocket *socket);
+    void startIOThreads();
+    void stopIOThreads();
 
     QString generateUniqueUserName(const QString &userName) const; // return sanitized and unique username
 
-    void updateKeepAliveInfos();
-
     static QHostAddress getBestHostAddress();
 };
 
@@ -219,6 +254,16 @@ inline quint64 Server::getUploadTransferRate() const
     return totalUploadMeasurer.getTransferRate();
 }
 
+inline quint64 Server::getSavedUploadTransferRate() const
+{
+    return savedUploadMeasurer.getTransferRate();
+}
+
+inline quint64 Server::getSavedUploadBytes() const
+{
+    return savedUploadBytes;
+}
+
 inline quint8 Server::getMaxChannels() const
 {
     return maxChannels;
@@ -0,0 +1,321 @@
+#include "ResampledAudioCache.h"
+
+#include "file/FileReaderFactory.h"
+#include "file/FileReader.h"
+#include "audio/Resampler.h"
+#include "log/Logging.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QMutexLocker>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <memory>
+
+using persistence::ResampledAudioCache;
+using audio::SamplesBuffer;
+
+const qint64 ResampledAudioCache::DEFAULT_MEMORY_LIMIT = 64 * 1024 * 1024;
+const qint64 ResampledAudioCache::DEFAULT_DISK_LIMIT = 256 * 1024 * 1024;
+
+namespace {
+
+const char FILE_SUFFIX[] = ".pcm";
+
+const quint32 MAGIC = 0x4D435054; // "TPCM"
+
+/**
+   - Revision 1: planar 32 bits float samples resampled using the High quality resampler
+*/
+const quint32 REVISION = 1;
+
+struct DiskHeader // 64 bytes, written in the machine byte order, cache files are not shared
+{
+    quint32 magic;
+    quint32 revision;
+    quint32 channels;
+    quint32 frames;
+    quint32 sampleRate;
+    quint32 sourceSampleRate;
+    qint64 lastUsed; // msecs since epoch, rewritten when the entry is used
+    quint8 reserved[32];
+};
+
+static_assert(sizeof(DiskHeader) == 64, "Disk header must be 64 bytes, samples are aligned after the header");
+
+qint64 currentMSecs()
+{
+    return QDateTime::currentDateTime().toMSecsSinceEpoch();
+}
+
+} // namespace
+
+ResampledAudioCache &ResampledAudioCache::getInstance()
+{
+    static ResampledAudioCache instance;
+    return instance;
+}
+
+ResampledAudioCache::ResampledAudioCache() :
+    memoryEntries(DEFAULT_MEMORY_LIMIT / 1024),
+    diskEnabled(false),
+    diskLimit(DEFAULT_DISK_LIMIT)
+{
+
+}
+
+void ResampledAudioCache::setCacheDir(const QDir &dir)
+{
+    QMutexLocker locker(&mutex);
+
+    cacheDir = dir;
+    diskEnabled = cacheDir.exists() || cacheDir.mkpath(".");
+    if (!diskEnabled)
+        qCWarning(jtCache) << "Can't create the audio cache dir" << cacheDir.absolutePath();
+}
+
+void ResampledAudioCache::setMemoryLimit(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+
+    memoryEntries.setMaxCost(static_cast<int>(bytes / 1024));
+}
+
+void ResampledAudioCache::setDiskLimit(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+
+    diskLimit = bytes;
+    evictDiskEntries();
+}
+
+void ResampledAudioCache::clear()
+{
+    QMutexLocker locker(&mutex);
+
+    memoryEntries.clear();
+
+    if (!diskEnabled)
+        return;
+
+    for (const auto &fileName : cacheDir.entryList(QStringList(QString("*") + FILE_SUFFIX), QDir::Files))
+        cacheDir.remove(fileName);
+}
+
+bool ResampledAudioCache::load(const QString &filePath, quint32 sampleRate, SamplesBuffer &out)
+{
+    const uint maxFrames = out.getFrameLenght(); // in the file sample rate, zero means the entire file
+
+    QMutexLocker locker(&mutex);
+
+    const QString key = getKey(filePath, sampleRate);
+    if (key.isEmpty()) {
+        out.setFrameLenght(0);
+        return false;
+    }
+
+    Entry *entry = memoryEntries.object(key);
+    std::unique_ptr<Entry> newEntry;
+    if (!entry) {
+        newEntry.reset(loadFromDisk(key));
+        if (!newEntry) {
+            locker.unlock(); // decoding is slow, the layers of a loop are decoded in parallel
+            newEntry.reset(decode(filePath, sampleRate));
+            locker.relock();
+            if (!newEntry) {
+                out.setFrameLenght(0);
+                return false;
+            }
+            saveToDisk(key, *newEntry, sampleRate);
+        }
+        entry = newEntry.get();
+    }
+
+    uint frames = entry->samples.getFrameLenght();
+    if (maxFrames > 0 && entry->sourceSampleRate > 0)
+        frames = qMin(frames, static_cast<uint>(static_cast<double>(sampleRate) / entry->sourceSampleRate * maxFrames));
+
+    const uint channels = entry->samples.getChannels();
+    out.setChannels(channels);
+    out.setFrameLenght(frames);
+    for (uint c = 0; c < channels; ++c)
+        std::copy(entry->samples.getSamplesArray(c), entry->samples.getSamplesArray(c) + frames, out.getSamplesArray(c));
+
+    if (newEntry) {
+        const int cost = getCost(*newEntry);
+        memoryEntries.insert(key, newEntry.release(), cost); // entries bigger than the limit are deleted by QCache
+    }
+
+    return true;
+}
+
+QString ResampledAudioCache::getKey(const QString &filePath, quint32 sampleRate)
+{
+    const QByteArray hash = getContentHash(filePath);
+    if (hash.isEmpty())
+        return QString();
+
+    return QString("%1_%2_r%3").arg(QString::fromLatin1(hash.toHex())).arg(sampleRate).arg(REVISION);
+}
+
+QByteArray ResampledAudioCache::getContentHash(const QString &filePath)
+{
+    const QFileInfo fileInfo(filePath);
+    const qint64 size = fileInfo.size();
+    const qint64 lastModified = fileInfo.lastModified().toMSecsSinceEpoch();
+
+    auto it = fileHashes.constFind(filePath);
+    if (it != fileHashes.constEnd() && it->size == size && it->lastModified == lastModified)
+        return it->hash;
+
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly)) {
+        qCritical() << "Error loading audio file, can't open " << filePath << file.errorString();
+        return QByteArray();
+    }
+
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    while (!file.atEnd())
+        hash.addData(file.read(64 * 1024));
+
+    FileHash fileHash = { size, lastModified, hash.result() };
+    fileHashes.insert(filePath, fileHash);
+
+    return fileHash.hash;
+}
+
+ResampledAudioCache::Entry *ResampledAudioCache::decode(const QString &filePath, quint32 sampleRate) const
+{
+    std::unique_ptr<audio::FileReader> reader = audio::FileReaderFactory::createFileReader(filePath);
+    quint32 fileSampleRate = 0;
+    SamplesBuffer decoded(2); // the reader change to mono when necessary
+    if (!reader->read(filePath, decoded, fileSampleRate) || decoded.getFrameLenght() == 0) {
+        qCritical() << "Error decoding audio file" << filePath;
+        return nullptr;
+    }
+
+    if (fileSampleRate == 0 || fileSampleRate == sampleRate)
+        return new Entry{ decoded, fileSampleRate };
+
+    const uint channels = decoded.getChannels();
+    const uint resampledFrames = static_cast<double>(sampleRate) / fileSampleRate * decoded.getFrameLenght();
+    std::unique_ptr<Entry> entry(new Entry{ SamplesBuffer(channels, resampledFrames), fileSampleRate });
+
+    PolyphaseResampler resampler(Resampler::High); // resampled once, using the best quality
+    for (uint c = 0; c < channels; ++c) {
+        resampler.processAll(decoded.getSamplesArray(c), decoded.getFrameLenght(),
+                             entry->samples.getSamplesArray(c), resampledFrames);
+    }
+
+    return entry.release();
+}
+
+ResampledAudioCache::Entry *ResampledAudioCache::loadFromDisk(const QString &key) const
+{
+    if (!diskEnabled)
+        return nullptr;
+
+    QFile file(cacheDir.absoluteFilePath(key + FILE_SUFFIX));
+    if (!file.exists() || !file.open(QFile::ReadWrite))
+        return nullptr;
+
+    if (file.size() < static_cast<qint64>(sizeof(DiskHeader)))
+        return nullptr;
+
+    const uchar *data = file.map(0, file.size());
+    if (!data)
+        return nullptr;
+
+    DiskHeader header;
+    std::memcpy(&header, data, sizeof(DiskHeader));
+
+    const qint64 expectedSize = sizeof(DiskHeader) + static_cast<qint64>(header.channels) * header.frames * sizeof(float);
+    if (header.magic != MAGIC || header.revision != REVISION || header.channels < 1 || header.channels > 2 || file.size() != expectedSize) {
+        qCWarning(jtCache) << "Discarding invalid audio cache entry" << file.fileName();
+        file.unmap(const_cast<uchar *>(data));
+        file.close();
+        file.remove();
+        return nullptr;
+    }
+
+    std::unique_ptr<Entry> entry(new Entry{ SamplesBuffer(header.channels, header.frames), header.sourceSampleRate });
+    const float *samples = reinterpret_cast<const float *>(data + sizeof(DiskHeader));
+    for (uint c = 0; c < header.channels; ++c) {
+        const float *channel = samples + static_cast<size_t>(c) * header.frames;
+        std::copy(channel, channel + header.frames, entry->samples.getSamplesArray(c));
+    }
+
+    file.unmap(const_cast<uchar *>(data));
+
+    // rewriting the last used time also updates the file modification time used to evict old entries
+    header.lastUsed = currentMSecs();
+    if (file.seek(offsetof(DiskHeader, lastUsed)))
+        file.write(reinterpret_cast<const char *>(&header.lastUsed), sizeof(header.lastUsed));
+
+    return entry.release();
+}
+
+void ResampledAudioCache::saveToDisk(const QString &key, const Entry &entry, quint32 sampleRate)
+{
+    if (!diskEnabled)
+        return;
+
+    DiskHeader header;
+    std::memset(&header, 0, sizeof(DiskHeader));
+    header.magic = MAGIC;
+    header.revision = REVISION;
+    header.channels = entry.samples.getChannels();
+    header.frames = entry.samples.getFrameLenght();
+    header.sampleRate = sampleRate;
+    header.sourceSampleRate = entry.sourceSampleRate;
+    header.lastUsed = currentMSecs();
+
+    QSaveFile file(cacheDir.absoluteFilePath(key + FILE_SUFFIX)); // readers never see a partial entry
+    if (!file.open(QFile::WriteOnly)) {
+        qCWarning(jtCache) << "Can't write the audio cache entry" << file.fileName() << file.errorString();
+        return;
+    }
+
+    file.write(reinterpret_cast<const char *>(&header), sizeof(DiskHeader));
+    for (uint c = 0; c < header.channels; ++c)
+        file.write(reinterpret_cast<const char *>(entry.samples.getSamplesArray(c)), header.frames * sizeof(float));
+
+    if (!file.commit()) {
+        qCWarning(jtCache) << "Can't write the audio cache entry" << file.fileName() << file.errorString();
+        return;
+    }
+
+    evictDiskEntries();
+}
+
+void ResampledAudioCache::evictDiskEntries()
+{
+    if (!diskEnabled)
+        return;
+
+    // oldest entries first
+    const auto entries = cacheDir.entryInfoList(QStringList(QString("*") + FILE_SUFFIX), QDir::Files, QDir::Time | QDir::Reversed);
+
+    qint64 totalSize = 0;
+    for (const auto &entry : entries)
+        totalSize += entry.size();
+
+    for (const auto &entry : entries) {
+        if (totalSize <= diskLimit)
+            break;
+
+        if (QFile::remove(entry.absoluteFilePath()))
+            totalSize -= entry.size();
+    }
+}
+
+int ResampledAudioCache::getCost(const Entry &entry)
+{
+    const qint64 bytes = static_cast<qint64>(entry.samples.getChannels()) * entry.samples.getFrameLenght() * sizeof(float);
+    return qMax(1, static_cast<int>(bytes / 1024));
+}
@@ -0,0 +1,79 @@
+#ifndef RESAMPLED_AUDIO_CACHE_H
+#define RESAMPLED_AUDIO_CACHE_H
+
+#include <QString>
+#include <QDir>
+#include <QHash>
+#include <QCache>
+#include <QMutex>
+#include <QByteArray>
+
+#include "audio/core/SamplesBuffer.h"
+
+/**
+  Decoded and resampled audio files (metronome sounds, loop layers) are cached in memory and in
+  the cache dir, so changing the metronome or loading a loop again doesn't decode and resample
+  the same file again. Entries are keyed by the file content hash and the target sample rate.
+
+  Disk entries are raw planar float samples after a small header and are read using a memory
+  mapped file. Both layers are bounded and the least recently used entries are evicted first.
+ */
+
+namespace persistence {
+
+class ResampledAudioCache
+{
+
+public:
+    static ResampledAudioCache &getInstance();
+
+    void setCacheDir(const QDir &cacheDir); // disk layer is disabled until a cache dir is set
+    void setMemoryLimit(qint64 bytes);
+    void setDiskLimit(qint64 bytes);
+
+    /** Decode 'filePath' and resample to 'sampleRate'. Like the file readers, if 'out' is not empty
+        only the first 'out.getFrameLenght()' frames (in the file sample rate) are used. */
+    bool load(const QString &filePath, quint32 sampleRate, audio::SamplesBuffer &out);
+
+    void clear(); // discard memory and disk entries
+
+    static const qint64 DEFAULT_MEMORY_LIMIT;
+    static const qint64 DEFAULT_DISK_LIMIT;
+
+private:
+    ResampledAudioCache();
+
+    struct Entry
+    {
+        audio::SamplesBuffer samples;
+        quint32 sourceSampleRate;
+    };
+
+    struct FileHash
+    {
+        qint64 size;
+        qint64 lastModified;
+        QByteArray hash;
+    };
+
+    QString getKey(const QString &filePath, quint32 sampleRate);
+    QByteArray getContentHash(const QString &filePath);
+
+    Entry *decode(const QString &filePath, quint32 sampleRate) const;
+    Entry *loadFromDisk(const QString &key) const;
+    void saveToDisk(const QString &key, const Entry &entry, quint32 sampleRate);
+    void evictDiskEntries();
+
+    static int getCost(const Entry &entry); // kilobytes
+
+    QMutex mutex;
+    QCache<QString, Entry> memoryEntries;
+    QHash<QString, FileHash> fileHashes; // avoid reading the whole file to compute the hash
+    QDir cacheDir;
+    bool diskEnabled;
+    qint64 diskLimit;
+};
+
+} // namespace
+
+#endif // RESAMPLED_AUDIO_CACHE_H
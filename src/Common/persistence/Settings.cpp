@@ -12,6 +12,7 @@
 #include <QSettings>
 #include "log/Logging.h"
 #include "audio/vorbis/Vorbis.h"
+#include "audio/voicechat/VoiceChat.h"
 
 using namespace persistence;
 
@@ -245,7 +246,12 @@ AudioSettings::AudioSettings() :
     lastIn(-1),
     lastOut(-1),
     audioInputDevice(""),
-    audioOutputDevice("")
+    audioOutputDevice(""),
+    renderWorkers(0),
+    decodeLookAhead(2000),
+    decodeMemoryLimit(64),
+    latencyProbes(false),
+    voiceChatFrameDuration(voicechat::DEFAULT_FRAME_DURATION)
 {
     qCDebug(jtSettings) << "AudioSettings ctor";
 }
@@ -269,6 +275,13 @@ void AudioSettings::read(const QJsonObject &in)
     else if(encodingQuality > vorbis::EncoderQualityHigh)
         encodingQuality = vorbis::EncoderQualityHigh;
 
+    renderWorkers = qBound(0, getValueFromJson(in, "renderWorkers", 0), 16);
+    decodeLookAhead = qBound(100, getValueFromJson(in, "decodeLookAhead", 2000), 30000);
+    decodeMemoryLimit = qBound(4, getValueFromJson(in, "decodeMemoryLimit", 64), 1024);
+    latencyProbes = getValueFromJson(in, "latencyProbes", false);
+    voiceChatFrameDuration = qBound(0, getValueFromJson(in, "voiceChatFrameDuration", static_cast<int>(voicechat::DEFAULT_FRAME_DURATION)),
+                                    static_cast<int>(voicechat::MAX_FRAME_DURATION));
+
     qCDebug(jtSettings) << "AudioSettings: sampleRate " << sampleRate
                         << "; bufferSize " << bufferSize
                         << "; firstIn " << firstIn
@@ -277,7 +290,12 @@ void AudioSettings::read(const QJsonObject &in)
                         << "; lastOut " << lastOut
                         << "; audioInputDevice " << audioInputDevice
                         << "; audioOutputDevice " << audioOutputDevice
-                        << "; encodingQuality " << encodingQuality;
+                        << "; encodingQuality " << encodingQuality
+                        << "; renderWorkers " << renderWorkers
+                        << "; decodeLookAhead " << decodeLookAhead
+                        << "; decodeMemoryLimit " << decodeMemoryLimit
+                        << "; latencyProbes " << latencyProbes
+                        << "; voiceChatFrameDuration " << voiceChatFrameDuration;
 }
 
 void AudioSettings::write(QJsonObject &out) const
@@ -294,6 +312,11 @@ void AudioSettings::write(QJsonObject &out) const
     out["audioOutputDevice"] = audioOutputDevice;
 
     out["encodingQuality"] = encodingQuality;
+    out["renderWorkers"] = renderWorkers;
+    out["decodeLookAhead"] = decodeLookAhead;
+    out["decodeMemoryLimit"] = decodeMemoryLimit;
+    out["latencyProbes"] = latencyProbes;
+    out["voiceChatFrameDuration"] = voiceChatFrameDuration;
 }
 
 // +++++++++++++++++++++++++++++
@@ -366,7 +389,8 @@ MultiTrackRecordingSettings::MultiTrackRecordingSettings() :
     saveMultiTracksActivated(false),
     jamRecorderActivated(QMap<QString, bool>()),
     recordingPath(""),
-    dirNameDateFormat("Qt::TextDate")
+    dirNameDateFormat("Qt::TextDate"),
+    singleFilePerTrack(false)
 {
     qCDebug(jtSettings) << "MultiTrackRecordingSettings ctor";
     // TODO: populate jamRecorderActivated with {jamRecorderId, false} pairs for each known jamRecorder
@@ -378,6 +402,7 @@ void MultiTrackRecordingSettings::write(QJsonObject &out) const
     out["recordingPath"] = QDir::toNativeSeparators(recordingPath);
     out["dirNameDateFormat"] = dirNameDateFormat;
     out["recordActivated"] = saveMultiTracksActivated;
+    out["singleFilePerTrack"] = singleFilePerTrack;
     QJsonObject jamRecorders = QJsonObject();
     for (const QString &key : jamRecorderActivated.keys()) {
         QJsonObject jamRecorder = QJsonObject();
@@ -414,6 +439,7 @@ void MultiTrackRecordingSettings::read(const QJsonObject &in)
     }
 
     saveMultiTracksActivated = getValueFromJson(in, "recordActivated", false);
+    singleFilePerTrack = getValueFromJson(in, "singleFilePerTrack", false);
 
     QJsonObject jamRecorders = getValueFromJson(in, "jamRecorders", QJsonObject());
     for(const QString &key : jamRecorders.keys()) {
@@ -425,6 +451,7 @@ void MultiTrackRecordingSettings::read(const QJsonObject &in)
                         << " (useDefaultRecordingPath " << useDefaultRecordingPath << ")"
                         << "; dirNameDateFormat " << dirNameDateFormat
                         << "; saveMultiTracksActivated " << saveMultiTracksActivated
+                        << "; singleFilePerTrack " << singleFilePerTrack
                         << "; jamRecorderActivated " << jamRecorderActivated;
 }
 
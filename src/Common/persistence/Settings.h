@@ -59,6 +59,11 @@ public:
     QString audioInputDevice;
     QString audioOutputDevice;
     float encodingQuality;
+    int renderWorkers; // threads used to render remote tracks, zero is rendering in audio thread only
+    int decodeLookAhead; // milliseconds decoded ahead of playback for each downloaded interval
+    int decodeMemoryLimit; // megabytes of decoded samples for all downloaded intervals
+    bool latencyProbes; // audio callback timing probes and debug overlay in main window
+    int voiceChatFrameDuration; // milliseconds in each frame of the low latency voice chat codec, zero is using vorbis in voice chat
 };
 
 // +++++++++++++++++++++++++++++++++++++
@@ -178,6 +183,7 @@ public:
     bool saveMultiTracksActivated;
     QString recordingPath;
     QString dirNameDateFormat;
+    bool singleFilePerTrack; // the intervals of each track are appended in the same file
 
     inline bool isJamRecorderActivated(const QString &key) const
     {
@@ -450,6 +456,15 @@ public:
     float getEncodingQuality() const;
     void setEncodingQuality(float quality);
 
+    int getRenderWorkers() const;
+    void setRenderWorkers(int workers);
+
+    int getDecodeLookAhead() const;
+    int getVoiceChatFrameDuration() const;
+    int getDecodeMemoryLimit() const;
+
+    bool isLatencyProbesEnabled() const;
+
     void setBuiltInMetronome(const QString &metronomeAlias);
     QString getBuiltInMetronome() const;
     void setCustomMetronome(const QString &primaryBeatAudioFile, const QString &offBeatAudioFile, const QString &accentBeatAudioFile);
@@ -498,6 +513,8 @@ public:
     void setMultiTrackRecordingPath(const QString &newPath);
     QString getDirNameDateFormat() const;
     void setDirNameDateFormat(const QString &newDateFormat);
+    bool isSingleFilePerTrackRecording() const;
+    void setSingleFilePerTrackRecording(bool singleFile);
 
     // user name
     QString getUserName() const;
@@ -944,6 +961,16 @@ inline void Settings::setDirNameDateFormat(const QString &newDateFormat)
     recordingSettings.dirNameDateFormat = newDateFormat;
 }
 
+inline bool Settings::isSingleFilePerTrackRecording() const
+{
+    return recordingSettings.singleFilePerTrack;
+}
+
+inline void Settings::setSingleFilePerTrackRecording(bool singleFile)
+{
+    recordingSettings.singleFilePerTrack = singleFile;
+}
+
 
 // user name
 inline QString Settings::getUserName() const
@@ -1062,6 +1089,36 @@ inline void Settings::setEncodingQuality(float quality)
     audioSettings.encodingQuality = quality;
 }
 
+inline int Settings::getRenderWorkers() const
+{
+    return audioSettings.renderWorkers;
+}
+
+inline void Settings::setRenderWorkers(int workers)
+{
+    audioSettings.renderWorkers = workers;
+}
+
+inline int Settings::getDecodeLookAhead() const
+{
+    return audioSettings.decodeLookAhead;
+}
+
+inline int Settings::getVoiceChatFrameDuration() const
+{
+    return audioSettings.voiceChatFrameDuration;
+}
+
+inline int Settings::getDecodeMemoryLimit() const
+{
+    return audioSettings.decodeMemoryLimit;
+}
+
+inline bool Settings::isLatencyProbesEnabled() const
+{
+    return audioSettings.latencyProbes;
+}
+
 } // namespace
 
 #endif
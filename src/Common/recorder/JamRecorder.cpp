@@ -1,23 +1,25 @@
 #include "JamRecorder.h"
+#include "RecordingWriter.h"
 #include <QDateTime>
 #include <QDebug>
-#include <QtConcurrent/QtConcurrent>
 #include "../log/Logging.h"
 
 using namespace recorder;
 
 const quint8 JamRecorder::VIDEO_CHANNEL_KEY = 255;
 
-JamAudioFile::JamAudioFile(const QString &path, uint intervalIndex) :
+JamAudioFile::JamAudioFile(const QString &path, uint intervalIndex, double sourceOffset) :
     path(path),
-    intervalIndex(intervalIndex)
+    intervalIndex(intervalIndex),
+    sourceOffset(sourceOffset)
 {
     //
 }
 
 JamAudioFile::JamAudioFile() : // default construtor to use this class in QMap and QList without pointers
     path(""),
-    intervalIndex(0)
+    intervalIndex(0),
+    sourceOffset(0)
 {
     //
 }
@@ -37,9 +39,9 @@ JamTrack::JamTrack() : // default construtor to use this class in QMap and QList
 
 }
 
-void JamTrack::addAudioFile(const QString &path, int intervalIndex)
+void JamTrack::addAudioFile(const QString &path, int intervalIndex, double sourceOffset)
 {
-    audioFiles.append( JamAudioFile(path, intervalIndex));
+    audioFiles.append( JamAudioFile(path, intervalIndex, sourceOffset));
 }
 
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -96,8 +98,8 @@ QList<JamInterval> Jam::getJamIntervals() const
     return intervals;
 }
 
-// called when a new file is writed in disk
-void Jam::addAudioFile(const QString &userName, quint8 channelIndex, const QString &filePath, int intervalIndex)
+// called when a new interval is writed in disk
+void Jam::addAudioFile(const QString &userName, quint8 channelIndex, const QString &filePath, int intervalIndex, double sourceOffset)
 {
 
     if (!jamTracks.contains(userName)) {
@@ -108,13 +110,13 @@ void Jam::addAudioFile(const QString &userName, quint8 channelIndex, const QStri
         jamTracks[userName].insert(channelIndex, JamTrack(userName, channelIndex));
     }
 
-    jamTracks[userName][channelIndex].addAudioFile(filePath, intervalIndex);
+    jamTracks[userName][channelIndex].addAudioFile(filePath, intervalIndex, sourceOffset);
 
     if (!jamIntervals.contains(intervalIndex)) {
         jamIntervals.insert(intervalIndex, QList<JamInterval>());
     }
 
-    jamIntervals[intervalIndex].insert(intervalIndex, JamInterval(intervalIndex, getBpm(), getBpi(), filePath, userName, channelIndex));
+    jamIntervals[intervalIndex].append(JamInterval(intervalIndex, getBpm(), getBpi(), filePath, userName, channelIndex));
 }
 
 //+++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -127,14 +129,48 @@ QString JamRecorder::getNewJamName()
     return "Jam-" + nowString;
 }
 
-void JamRecorder::writeEncodedFile(const QByteArray& encodedData, const QString &path)
+bool JamRecorder::isUsingSingleFilePerTrack() const
 {
-    QFile audioFile(path);
-    if (!audioFile.open(QFile::WriteOnly)) {
-        qCritical() << "can't open file " << path;
-        return;
+    return singleFilePerTrack && jamMetadataWritter->canUseSingleFilePerTrack();
+}
+
+QString JamRecorder::getAudioFilePath(const QString &userName, quint8 channelIndex, int intervalIndex) const
+{
+    if (isUsingSingleFilePerTrack())
+        return jamMetadataWritter->getAudioAbsolutePath(buildTrackFileName(userName, channelIndex));
+
+    return jamMetadataWritter->getAudioAbsolutePath(buildAudioFileName(userName, channelIndex, intervalIndex));
+}
+
+void JamRecorder::finishAudioInterval(const QString &userName, quint8 channelIndex, const QString &filePath, int intervalIndex)
+{
+    if (filePath.isEmpty())
+        return; // not recorded
+
+    double sourceOffset = 0;
+    if (isUsingSingleFilePerTrack()) {
+        int &storedIntervals = trackFilesIntervals[filePath];
+        sourceOffset = storedIntervals * jam->getIntervalsLenght();
+        storedIntervals++;
+    } else {
+        RecordingWriter::getInstance().close(filePath);
+    }
+
+    jam->addAudioFile(userName, channelIndex, filePath, intervalIndex, sourceOffset);
+}
+
+void JamRecorder::finishLocalUserIntervals()
+{
+    for (quint8 key : localUserIntervals.keys()) {
+        const auto &interval = localUserIntervals[key];
+        if (key == VIDEO_CHANNEL_KEY) {
+            if (!interval.getFilePath().isEmpty())
+                RecordingWriter::getInstance().close(interval.getFilePath());
+        } else {
+            finishAudioInterval(localUserName, key, interval.getFilePath(), interval.getIntervalIndex());
+        }
     }
-    audioFile.write(encodedData.data(), encodedData.size());
+    localUserIntervals.clear();
 }
 
 QString JamRecorder::buildVideoFileName(const QString &userName, int currentInterval, const QString &fileExtension)
@@ -148,6 +184,11 @@ QString JamRecorder::buildAudioFileName(const QString &userName, quint8 channelI
     return userName + " (" + channelName + ") part " + buildPaddedFileNumber(currentInterval) + ".ogg";
 }
 
+QString JamRecorder::buildTrackFileName(const QString &userName, quint8 channelIndex)
+{
+    return userName + " (Channel " + QString::number(channelIndex + 1) + ").ogg";
+}
+
 QString JamRecorder::buildPaddedFileNumber(int fileNumber)
 {
     const int padDigits = 3;
@@ -160,7 +201,8 @@ JamRecorder::JamRecorder(JamMetadataWriter* jamMetadataWritter) :
     jam(nullptr),
     jamMetadataWritter(jamMetadataWritter),
     globalIntervalIndex(0),
-    running(false)
+    running(false),
+    singleFilePerTrack(false)
 {
     //this->recordingActivated = true;//just to test
     qCDebug(jtJamRecorder) << "Creating JamRecorder!";
@@ -184,17 +226,24 @@ void JamRecorder::appendLocalUserAudio(const QByteArray &encodedAudio, quint8 ch
 
     auto &interval = localUserIntervals[channelIndex];
 
-    bool needSave = isFirstPartOfInterval && !interval.isEmpty();
-    if (needSave) {
-        QString audioFileName = buildAudioFileName(localUserName, channelIndex, interval.getIntervalIndex());
-        QString audioFilePath = jamMetadataWritter->getAudioAbsolutePath(audioFileName);
-        QByteArray encodedData(interval.getEncodedData());
-        QtConcurrent::run(this, &JamRecorder::writeEncodedFile, encodedData, audioFilePath);
-        jam->addAudioFile(localUserName, channelIndex, audioFilePath, interval.getIntervalIndex());
+    bool intervalFinished = isFirstPartOfInterval && !interval.isEmpty();
+    if (intervalFinished) {
+        finishAudioInterval(localUserName, channelIndex, interval.getFilePath(), interval.getIntervalIndex());
         interval.clear();
     }
 
+    if (interval.isEmpty()) {
+        // voice chat codec intervals are not saved, the recorded files are ogg vorbis. A partial interval
+        // (recording started in the middle of the interval) would shift the next intervals in a track file.
+        bool canRecord = encodedAudio.startsWith("OggS") && (isFirstPartOfInterval || !isUsingSingleFilePerTrack());
+        if (canRecord)
+            interval.setFilePath(getAudioFilePath(localUserName, channelIndex, interval.getIntervalIndex()));
+    }
+
     interval.appendEncodedData(encodedAudio);
+
+    if (!interval.getFilePath().isEmpty())
+        RecordingWriter::getInstance().append(interval.getFilePath(), encodedAudio);
 }
 
 void JamRecorder::appendLocalUserVideo(const QByteArray &encodedVideo, bool isFirstPartOfInterval)
@@ -210,35 +259,45 @@ void JamRecorder::appendLocalUserVideo(const QByteArray &encodedVideo, bool isFi
 
     auto &videoInterval = localUserIntervals[VIDEO_CHANNEL_KEY];
 
-    bool needSave = isFirstPartOfInterval && !videoInterval.isEmpty();
-    if (needSave) {
+    bool intervalFinished = isFirstPartOfInterval && !videoInterval.isEmpty();
+    if (intervalFinished) {
+        if (!videoInterval.getFilePath().isEmpty())
+            RecordingWriter::getInstance().close(videoInterval.getFilePath());
 
-        QByteArray encodedData(videoInterval.getEncodedData());
+        videoInterval.clear();
+    }
 
+    if (videoInterval.isEmpty()) {
         QString videoFileName = buildVideoFileName(localUserName, videoInterval.getIntervalIndex(), "mp4");
-        QString videoFilePath = jamMetadataWritter->getVideoAbsolutePath(videoFileName);
-
-        if (!videoFilePath.isEmpty()) // some recorders (like ClipSort) can't save videos
-            QtConcurrent::run(this, &JamRecorder::writeEncodedFile, encodedData, videoFilePath);
-
-        videoInterval.clear();
+        videoInterval.setFilePath(jamMetadataWritter->getVideoAbsolutePath(videoFileName)); // some recorders (like ClipSort) can't save videos
     }
 
     videoInterval.appendEncodedData(encodedVideo);
+
+    if (!videoInterval.getFilePath().isEmpty())
+        RecordingWriter::getInstance().append(videoInterval.getFilePath(), encodedVideo);
 }
 
-void JamRecorder::addRemoteUserAudio(const QString &userName, const QByteArray &encodedAudio, quint8 channelIndex)
+void JamRecorder::addRemoteUserAudio(const QString &userName, const QList<QByteArray> &encodedChunks, quint8 channelIndex)
 {
     if (!running) {
         qCritical() << "Illegal state! Recorder is not running!";
         return;
     }
 
+    if (encodedChunks.isEmpty() || !encodedChunks.first().startsWith("OggS"))
+        return; // voice chat codec interval
+
     int intervalIndex = globalIntervalIndex;
-    QString audioFileName = buildAudioFileName(userName, channelIndex, intervalIndex);
-    QString audioFilePath = jamMetadataWritter->getAudioAbsolutePath(audioFileName);
-    QtConcurrent::run(this, &JamRecorder::writeEncodedFile, encodedAudio, audioFilePath);
-    jam->addAudioFile(userName, channelIndex, audioFilePath, intervalIndex);
+    QString audioFilePath = getAudioFilePath(userName, channelIndex, intervalIndex);
+    if (audioFilePath.isEmpty())
+        return;
+
+    auto &writer = RecordingWriter::getInstance();
+    for (const QByteArray &chunk : encodedChunks)
+        writer.append(audioFilePath, chunk); // the chunks are not joined in memory
+
+    finishAudioInterval(userName, channelIndex, audioFilePath, intervalIndex);
 }
 
 void JamRecorder::startRecording(const QString &localUser, const QDir &recordBaseDir, int bpm, int bpi, int sampleRate)
@@ -299,15 +358,35 @@ void JamRecorder::setSampleRate(int newSampleRate)
     }
 }
 
+void JamRecorder::setSingleFilePerTrack(bool singleFile)
+{
+    if (singleFile == singleFilePerTrack)
+        return;
+
+    singleFilePerTrack = singleFile;
+    if (running) {
+        stopRecording();
+        startRecording(localUserName, recordBaseDir, jam->getBpm(), jam->getBpi(), jam->getSampleRate() );
+    }
+}
+
 //++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
 
 void JamRecorder::stopRecording()
 {
     if (running) {
+        finishLocalUserIntervals(); // the data is already in disk
         writeProjectFile();
+
+        auto &writer = RecordingWriter::getInstance();
+        for (const QString &trackFile : trackFilesIntervals.keys())
+            writer.close(trackFile);
+        trackFilesIntervals.clear();
+
+        writer.waitForPendingWrites(); // the recorded files are complete when the recording is stopped
+
         this->running = false;
         this->globalIntervalIndex = 0;
-        this->localUserIntervals.clear();
     }
 }
 
@@ -325,6 +404,7 @@ void JamRecorder::newInterval()
     if (running) {
         globalIntervalIndex++;
         writeProjectFile();
+        RecordingWriter::getInstance().sync(); // the recorded intervals are safe in disk after a crash
     }
 
 }
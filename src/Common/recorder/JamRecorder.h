@@ -3,6 +3,7 @@
 
 #include <QDir>
 #include <QMap>
+#include <QByteArray>
 
 #include <memory>
 
@@ -13,7 +14,7 @@ class JamAudioFile
 {
 
 public:
-    JamAudioFile(const QString &path, uint intervalIndex);
+    JamAudioFile(const QString &path, uint intervalIndex, double sourceOffset = 0);
     JamAudioFile(); // default construtor to use this class in QMap and QList without pointers
 
     inline uint getIntervalIndex() const
@@ -26,9 +27,15 @@ public:
         return path;
     }
 
+    inline double getSourceOffset() const // in seconds, non zero when many intervals are stored in the same file
+    {
+        return sourceOffset;
+    }
+
 private:
     QString path;
     uint intervalIndex;
+    double sourceOffset;
 };
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -39,7 +46,7 @@ public:
     JamTrack(const QString &userName, quint8 channelIndex);
     JamTrack(); // default construtor to use this class in QMap and QList without pointers
 
-    void addAudioFile(const QString &path, int intervalIndex);
+    void addAudioFile(const QString &path, int intervalIndex, double sourceOffset = 0);
 
     inline QString getUserName() const
     {
@@ -138,8 +145,8 @@ public:
         return 60.0/bpm * (double)bpi;
     }
 
-    // called when a new file is writed in disk
-    void addAudioFile(const QString &userName, const quint8 channelIndex, const QString &filePath, const int intervalIndex);
+    // called when a new interval is writed in disk
+    void addAudioFile(const QString &userName, const quint8 channelIndex, const QString &filePath, const int intervalIndex, double sourceOffset = 0);
 
     QList<JamTrack> getJamTracks() const;
 
@@ -172,6 +179,9 @@ public:
     virtual QString getAudioAbsolutePath(const QString &audioFileName) = 0;
 
     virtual QString getVideoAbsolutePath(const QString &videoFileName) = 0;
+
+    // the intervals of each track can be stored in a single file (chained ogg streams) when the project can use a source offset
+    virtual bool canUseSingleFilePerTrack() const { return false; }
 };
 
 // ++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++++
@@ -180,27 +190,36 @@ class LocalNinjamInterval
 {
 public:
     explicit LocalNinjamInterval(int intervalIndex) :
-        intervalIndex(intervalIndex)
+        intervalIndex(intervalIndex),
+        encodedBytes(0)
     {
     }
 
-    LocalNinjamInterval()
+    LocalNinjamInterval() :
+        intervalIndex(0),
+        encodedBytes(0)
     {
     }
 
-    void appendEncodedData(const QByteArray &data)
+    void appendEncodedData(const QByteArray &data) // the data is streamed to disk, only the size is stored
     {
-        encodedData.append(data);
+        encodedBytes += data.size();
     }
 
-    inline QByteArray getEncodedData() const
+    inline QString getFilePath() const // empty when the interval is not recorded
     {
-        return encodedData;
+        return filePath;
+    }
+
+    void setFilePath(const QString &path)
+    {
+        filePath = path;
     }
 
     void clear()
     {
-        encodedData.clear();
+        filePath.clear();
+        encodedBytes = 0;
         this->intervalIndex++;
     }
 
@@ -211,12 +230,13 @@ public:
 
     inline bool isEmpty() const
     {
-        return encodedData.isEmpty();
+        return encodedBytes == 0;
     }
 
 private:
-    QByteArray encodedData;
+    QString filePath;
     int intervalIndex;
+    qint64 encodedBytes;
 };
 
 class JamRecorder
@@ -229,7 +249,7 @@ public:
 
     void appendLocalUserVideo(const QByteArray &encodedVideo, bool isFirstPartOfInterval);
 
-    void addRemoteUserAudio(const QString &userName, const QByteArray &encodedAudio, quint8 channelIndex);
+    void addRemoteUserAudio(const QString &userName, const QList<QByteArray> &encodedChunks, quint8 channelIndex);
     void startRecording(const QString &localUser, const QDir &recordBasePath, int bpm, int bpi, int sampleRate);
 
     // these methods start a new recording
@@ -237,6 +257,7 @@ public:
     void setBpm(int newBpm);
     void setBpi(int newBpi);
     void setSampleRate(int newSampleRate);
+    void setSingleFilePerTrack(bool singleFile);
 
     void stopRecording();
     void newInterval();
@@ -255,19 +276,26 @@ private:
     bool running;
     QDir recordBaseDir;
     Qt::DateFormat dirNameDateFormat;
+    bool singleFilePerTrack;
 
     /**
-        Audio Intervals: Using channel index as key and store encoded bytes. When a full interval is stored the encoded bytes are store in a ogg file.
+        Audio Intervals: Using channel index as key. The encoded chunks are appended to the interval (or track) file as they are produced.
         Video Intervals: Using 255 as default channel index.
      */
-    QMap<quint8, LocalNinjamInterval> localUserIntervals; // storing encoded data for audio and video intervals
+    QMap<quint8, LocalNinjamInterval> localUserIntervals; // audio and video intervals in progress
     static const quint8 VIDEO_CHANNEL_KEY;
 
+    QMap<QString, int> trackFilesIntervals; // intervals stored in each track file when using a single file per track
+
     QString getNewJamName();
 
-    void writeEncodedFile(const QByteArray &encodedData, const QString &path);
+    bool isUsingSingleFilePerTrack() const;
+    QString getAudioFilePath(const QString &userName, quint8 channelIndex, int intervalIndex) const;
+    void finishAudioInterval(const QString &userName, quint8 channelIndex, const QString &filePath, int intervalIndex);
+    void finishLocalUserIntervals();
 
     static QString buildAudioFileName(const QString &userName, quint8 channelIndex, int currentInterval);
+    static QString buildTrackFileName(const QString &userName, quint8 channelIndex);
     static QString buildVideoFileName(const QString &userName, int currentInterval, const QString &fileExtension);
     static QString buildPaddedFileNumber(int fileNumber);
 
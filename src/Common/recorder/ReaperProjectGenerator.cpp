@@ -34,6 +34,8 @@ void ReaperProjectGenerator::write(const Jam &jam)
             stringBuffer.append("    <ITEM").append("\n");
             stringBuffer.append("      POSITION " + QString::number(position)).append("\n");
             stringBuffer.append("      LENGTH " + QString::number(jam.getIntervalsLenght())).append("\n");
+            if (audioFile.getSourceOffset() > 0) // many intervals in the same file
+                stringBuffer.append("      SOFFS " + QString::number(audioFile.getSourceOffset())).append("\n");
             stringBuffer.append("      FADEIN 1 0.01 0 1 0 0").append("\n");
             stringBuffer.append("      FADEOUT 1 0.01 0 1 0 0").append("\n");
             stringBuffer.append("      IID " + QString::number(part)).append("\n");
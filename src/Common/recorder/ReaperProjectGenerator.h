@@ -27,6 +27,11 @@ public:
     QString getAudioAbsolutePath(const QString &audioFileName) override;
     QString getVideoAbsolutePath(const QString &videoFileName) override;
 
+    inline bool canUseSingleFilePerTrack() const override
+    {
+        return true; // items are using SOFFS
+    }
+
 private:
     static QString buildTrackName(const QString &userName, quint8 channelIndex);
     QString rppPath;
@@ -0,0 +1,346 @@
+#include "RecordingWriter.h"
+
+#include <QThread>
+#include <QFile>
+#include <QMutexLocker>
+#include <QDebug>
+
+#ifdef Q_OS_WIN
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+using recorder::RecordingWriter;
+
+namespace {
+
+bool syncToDisk(QFile &file)
+{
+    if (!file.flush())
+        return false;
+
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return fsync(file.handle()) == 0;
+#endif
+}
+
+} // namespace
+
+class RecordingWriter::Worker : public QThread
+{
+public:
+    explicit Worker(RecordingWriter &writer) :
+        writer(writer)
+    {
+
+    }
+
+protected:
+    void run() override
+    {
+        writer.run();
+    }
+
+private:
+    RecordingWriter &writer;
+};
+
+// -------------------------------------------------------------
+
+RecordingWriter &RecordingWriter::getInstance()
+{
+    static RecordingWriter instance;
+    return instance;
+}
+
+RecordingWriter::RecordingWriter() :
+    queuedBytes(0),
+    maxQueuedBytes(DEFAULT_MAX_QUEUED_BYTES),
+    processing(false),
+    stopRequested(false),
+    pendingSpilledBytes(0),
+    spillFileEnd(0),
+    writtenBytes(0),
+    spilledBytes(0),
+    droppedBytes(0)
+{
+
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    if (worker) {
+        {
+            QMutexLocker locker(&mutex);
+            stopRequested = true; // the worker stops when the queue is empty
+            operationsAdded.wakeAll();
+        }
+        worker->wait();
+    }
+
+    for (const QString &filePath : openFiles.keys())
+        closeFile(filePath);
+}
+
+void RecordingWriter::startWorker()
+{
+    worker.reset(new Worker(*this));
+    worker->start(QThread::LowPriority); // below audio and network threads
+}
+
+void RecordingWriter::append(const QString &filePath, const QByteArray &data)
+{
+    if (filePath.isEmpty() || data.isEmpty())
+        return;
+
+    Operation operation = { Operation::Append, filePath, data, 0, 0 };
+    enqueue(operation);
+}
+
+void RecordingWriter::close(const QString &filePath)
+{
+    Operation operation = { Operation::Close, filePath, QByteArray(), 0, 0 };
+    enqueue(operation);
+}
+
+void RecordingWriter::sync()
+{
+    Operation operation = { Operation::Sync, QString(), QByteArray(), 0, 0 };
+    enqueue(operation);
+}
+
+void RecordingWriter::enqueue(const Operation &operation)
+{
+    QMutexLocker locker(&mutex);
+
+    if (!worker)
+        startWorker();
+
+    // never waiting for the worker, the operations order is kept even when some data is spilled
+    Operation queued = operation;
+    const qint64 bytes = queued.data.size();
+    if (bytes > 0 && queuedBytes + bytes > maxQueuedBytes) {
+        // the spill file region is reserved and the operation is queued before writing the data. The worker
+        // is reading the region after the write because spillMutex is locked before unlocking mutex
+        QMutexLocker spillLocker(&spillMutex);
+
+        if (!reserveSpill(queued)) {
+            droppedBytes += bytes;
+            qCritical() << "Recording queue is full, dropping" << bytes << "bytes of" << queued.filePath;
+            return;
+        }
+
+        operations.append(queued);
+        operationsAdded.wakeAll();
+        locker.unlock();
+
+        writeSpilled(queued, operation.data);
+        return;
+    }
+
+    operations.append(queued);
+    queuedBytes += queued.data.size();
+    operationsAdded.wakeAll();
+}
+
+bool RecordingWriter::reserveSpill(Operation &operation)
+{
+    const qint64 bytes = operation.data.size();
+    if (pendingSpilledBytes + bytes > MAX_SPILLED_BYTES)
+        return false;
+
+    operation.spillOffset = spillFileEnd;
+    operation.spillSize = bytes;
+    operation.data = QByteArray();
+
+    spillFileEnd += bytes;
+    pendingSpilledBytes += bytes;
+
+    return true;
+}
+
+void RecordingWriter::writeSpilled(const Operation &operation, const QByteArray &data)
+{
+    if (!spillFile.isOpen() && !spillFile.open())
+        qCritical() << "Can't create the recording spill file" << spillFile.errorString();
+    else if (!spillFile.seek(operation.spillOffset) || spillFile.write(data) != data.size())
+        qCritical() << "Error writing the recording spill file" << spillFile.errorString();
+    else {
+        spilledBytes += data.size();
+        return;
+    }
+
+    lostSpills.insert(operation.spillOffset); // the worker is skipping this operation
+    droppedBytes += data.size();
+}
+
+QByteArray RecordingWriter::readSpilled(const Operation &operation)
+{
+    QMutexLocker locker(&spillMutex);
+
+    if (lostSpills.remove(operation.spillOffset))
+        return QByteArray(); // already counted as dropped
+
+    QByteArray data;
+    if (spillFile.seek(operation.spillOffset))
+        data = spillFile.read(operation.spillSize);
+
+    if (data.size() != operation.spillSize) {
+        qCritical() << "Error reading the recording spill file" << spillFile.errorString();
+        droppedBytes += operation.spillSize;
+        return QByteArray();
+    }
+
+    return data;
+}
+
+void RecordingWriter::waitForPendingWrites()
+{
+    QMutexLocker locker(&mutex);
+    while (!operations.isEmpty() || processing)
+        operationsWritten.wait(&mutex);
+}
+
+void RecordingWriter::setMaxQueuedBytes(qint64 bytes)
+{
+    QMutexLocker locker(&mutex);
+    maxQueuedBytes = bytes;
+}
+
+qint64 RecordingWriter::getMaxQueuedBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return maxQueuedBytes;
+}
+
+qint64 RecordingWriter::getQueuedBytes() const
+{
+    QMutexLocker locker(&mutex);
+    return queuedBytes;
+}
+
+quint64 RecordingWriter::getWrittenBytes() const
+{
+    return writtenBytes;
+}
+
+quint64 RecordingWriter::getSpilledBytes() const
+{
+    return spilledBytes;
+}
+
+quint64 RecordingWriter::getDroppedBytes() const
+{
+    return droppedBytes;
+}
+
+void RecordingWriter::run()
+{
+    QMutexLocker locker(&mutex);
+    while (true) {
+        while (operations.isEmpty() && !stopRequested)
+            operationsAdded.wait(&mutex);
+
+        if (operations.isEmpty())
+            break; // stop requested and all operations written
+
+        const Operation operation = operations.takeFirst();
+        processing = true;
+
+        locker.unlock();
+        process(operation);
+        locker.relock();
+
+        processing = false;
+        queuedBytes -= operation.data.size();
+        if (operation.isSpilled()) {
+            pendingSpilledBytes -= operation.spillSize;
+            if (pendingSpilledBytes == 0) {
+                QMutexLocker spillLocker(&spillMutex);
+                if (spillFile.resize(0)) // all spilled data written, reusing the file from the start
+                    spillFileEnd = 0;
+            }
+        }
+        operationsWritten.wakeAll();
+    }
+}
+
+void RecordingWriter::process(const Operation &operation)
+{
+    switch (operation.type) {
+    case Operation::Append:
+        if (QFile *file = getFile(operation.filePath)) {
+            const QByteArray data = operation.isSpilled() ? readSpilled(operation) : operation.data;
+            if (data.isEmpty())
+                break; // spilled data not written or not readable
+
+            const qint64 written = file->write(data);
+            if (written != data.size())
+                qCritical() << "Error writing the recorded file" << operation.filePath << file->errorString();
+            else
+                writtenBytes += written;
+        }
+        break;
+
+    case Operation::Close:
+        closeFile(operation.filePath);
+        createdFiles.remove(operation.filePath);
+        break;
+
+    case Operation::Sync:
+        syncFiles();
+        break;
+    }
+}
+
+QFile *RecordingWriter::getFile(const QString &filePath)
+{
+    QFile *file = openFiles.value(filePath);
+    if (file) {
+        recentlyUsedFiles.removeOne(filePath);
+        recentlyUsedFiles.append(filePath);
+        return file;
+    }
+
+    if (openFiles.size() >= MAX_OPEN_FILES)
+        closeFile(recentlyUsedFiles.first());
+
+    const bool created = createdFiles.contains(filePath);
+    file = new QFile(filePath);
+    if (!file->open(created ? (QFile::WriteOnly | QFile::Append) : QFile::WriteOnly)) {
+        qCritical() << "Can't open the recorded file" << filePath << file->errorString();
+        delete file;
+        return nullptr;
+    }
+
+    createdFiles.insert(filePath);
+    openFiles.insert(filePath, file);
+    recentlyUsedFiles.append(filePath);
+
+    return file;
+}
+
+void RecordingWriter::closeFile(const QString &filePath)
+{
+    QFile *file = openFiles.take(filePath);
+    if (!file)
+        return;
+
+    recentlyUsedFiles.removeOne(filePath);
+
+    if (!syncToDisk(*file))
+        qCritical() << "Error flushing the recorded file" << filePath << file->errorString();
+
+    delete file;
+}
+
+void RecordingWriter::syncFiles()
+{
+    for (auto it = openFiles.begin(); it != openFiles.end(); ++it) {
+        if (!syncToDisk(*it.value()))
+            qCritical() << "Error flushing the recorded file" << it.key() << it.value()->errorString();
+    }
+}
@@ -0,0 +1,123 @@
+#ifndef RECORDING_WRITER_H
+#define RECORDING_WRITER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QScopedPointer>
+#include <QTemporaryFile>
+
+#include <atomic>
+
+class QFile;
+
+namespace recorder {
+
+/**
+ * Recorded files are written in a dedicated thread. Encoded chunks are appended as soon as they are
+ * produced (local channels) or downloaded (remote channels), instead of buffering whole intervals in
+ * memory. The writer keeps the files open and writes the operations in order.
+ *
+ * The in-memory queue is bounded and append() never waits for the worker (it is called in the GUI thread):
+ * when the disk is not keeping up the appended data is spilled to a temporary file and read back by the
+ * worker, so memory usage doesn't grow with the session length. The spill file is written without locking
+ * the queue. When the spill file is full or can't be written the data is dropped and counted. Closed files
+ * and sync() calls (in interval boundaries) are flushed to disk using fsync.
+ */
+
+class RecordingWriter
+{
+
+public:
+    static RecordingWriter &getInstance();
+
+    ~RecordingWriter(); // pending operations are written
+
+    void append(const QString &filePath, const QByteArray &data); // the file is truncated in the first append
+    void close(const QString &filePath); // the next append will create a new file
+    void sync(); // flush all open files to disk
+
+    void waitForPendingWrites(); // called when the recording is stopped and in the application exit
+
+    void setMaxQueuedBytes(qint64 bytes);
+    qint64 getMaxQueuedBytes() const;
+    qint64 getQueuedBytes() const;
+    quint64 getWrittenBytes() const;
+    quint64 getSpilledBytes() const; // appended data written to the temporary file because the queue was full
+    quint64 getDroppedBytes() const; // appended data lost because the spill file was full or not writable
+
+    static const qint64 DEFAULT_MAX_QUEUED_BYTES = 8 * 1024 * 1024;
+    static const qint64 MAX_SPILLED_BYTES = 1024 * 1024 * 1024;
+    static const int MAX_OPEN_FILES = 64; // least recently used files are closed and reopened when necessary
+
+private:
+    RecordingWriter();
+    RecordingWriter(const RecordingWriter &other);
+    RecordingWriter &operator=(const RecordingWriter &other);
+
+    class Worker;
+
+    struct Operation
+    {
+        enum Type
+        {
+            Append,
+            Close,
+            Sync
+        };
+
+        Type type;
+        QString filePath;
+        QByteArray data; // not copied, shared with the recorder. Empty when spilled
+        qint64 spillOffset;
+        qint64 spillSize; // zero when the data is in memory
+
+        bool isSpilled() const { return spillSize > 0; }
+    };
+
+    void enqueue(const Operation &operation);
+    bool reserveSpill(Operation &operation); // mutex and spillMutex are locked
+    void writeSpilled(const Operation &operation, const QByteArray &data); // only spillMutex is locked
+    QByteArray readSpilled(const Operation &operation); // used in worker thread
+    void startWorker();
+    void run(); // worker thread loop
+
+    // used in worker thread only
+    void process(const Operation &operation);
+    QFile *getFile(const QString &filePath);
+    void closeFile(const QString &filePath);
+    void syncFiles();
+
+    QScopedPointer<Worker> worker;
+
+    mutable QMutex mutex;
+    QWaitCondition operationsAdded;
+    QWaitCondition operationsWritten;
+    QList<Operation> operations; // protected by mutex
+    qint64 queuedBytes; // protected by mutex
+    qint64 maxQueuedBytes; // protected by mutex
+    bool processing; // protected by mutex, the worker is writing an operation
+    bool stopRequested; // protected by mutex
+    qint64 pendingSpilledBytes; // protected by mutex, the spill file is truncated when all are written
+
+    QMutex spillMutex; // locked after mutex, the spill file is written and read without locking mutex
+    QTemporaryFile spillFile;
+    qint64 spillFileEnd; // changed when mutex and spillMutex are locked
+    QSet<qint64> lostSpills; // protected by spillMutex, offsets of the spilled data not written
+
+    QHash<QString, QFile *> openFiles;
+    QList<QString> recentlyUsedFiles; // least recently used first
+    QSet<QString> createdFiles; // appended after the first write, even when closed to limit the open files
+
+    std::atomic<quint64> writtenBytes;
+    std::atomic<quint64> spilledBytes;
+    std::atomic<quint64> droppedBytes;
+};
+
+} // namespace
+
+#endif // RECORDING_WRITER_H
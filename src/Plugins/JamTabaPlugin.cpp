@@ -18,7 +18,8 @@ JamTabaPlugin::JamTabaPlugin(quint8 inputChannels, quint8 outputChannels) :
     running(false),
     inputBuffer(inputChannels),
     outputBuffer(outputChannels),
-    hostWasPlayingInLastAudioCallBack(false)
+    hostWasPlayingInLastAudioCallBack(false),
+    maxFramesPerBuffer(0)
 {
     qCDebug(jtVstPlugin) << "Base Plugin constructor...";
 }
@@ -47,6 +48,7 @@ void JamTabaPlugin::initialize()
             controller.reset(createPluginMainController(settings, this));
             controller->setSampleRate(getSampleRate());
             controller->start();
+            prepareToProcess(); // the host block size is received before the controller is created
 
             qCDebug(jtVstPlugin)<< "Controller started!";
             running = true;
@@ -70,4 +72,25 @@ void JamTabaPlugin::setSampleRate(float sampleRate)
 {
     if (controller)
         controller->setSampleRate(sampleRate);
+
+    prepareToProcess();
+}
+
+void JamTabaPlugin::setMaxFramesPerBuffer(int maxFrames)
+{
+    maxFramesPerBuffer = qMax(maxFrames, 0);
+    prepareToProcess();
+}
+
+void JamTabaPlugin::prepareToProcess()
+{
+    if (maxFramesPerBuffer <= 0)
+        return;
+
+    // the host buffers are copied in these buffers, not resized in the audio callback
+    inputBuffer.setFrameLenght(static_cast<uint>(maxFramesPerBuffer));
+    outputBuffer.setFrameLenght(static_cast<uint>(maxFramesPerBuffer));
+
+    if (controller)
+        controller->prepareToProcess(inputBuffer.getChannels(), maxFramesPerBuffer);
 }
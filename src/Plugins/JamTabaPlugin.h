@@ -23,6 +23,8 @@ public:
     virtual void setSampleRate(float sampleRate);
     virtual float getSampleRate() const = 0;
 
+    void setMaxFramesPerBuffer(int maxFrames); // the host block size
+
     inline bool isRunning() const;
 
     virtual int getHostBpm() const = 0;
@@ -34,8 +36,9 @@ protected:
     audio::SamplesBuffer inputBuffer;
     audio::SamplesBuffer outputBuffer;
     bool hostWasPlayingInLastAudioCallBack;
+    int maxFramesPerBuffer;
 
-    
+    void prepareToProcess(); // called out of the audio callback when the sample rate or the block size change
 
     static bool instanceIsInitialized;
 
@@ -37,7 +37,7 @@ void NinjamControllerPlugin::activateAudioNodes()
 {
     metronomeTrackNode->activate();
 
-    for (NinjamTrackNode *node : trackNodes)
+    for (NinjamTrackNode *node : *processingTrackNodes.load()) // called in audio thread when the host start playing
         node->activate();
 
     mainController->setAllLoopersStatus(true); // activate all loopers
@@ -223,8 +223,14 @@ float JamTabaVSTPlugin::getSampleRate() const
 
 void JamTabaVSTPlugin::setSampleRate(float sampleRate)
 {
-    JamTabaPlugin::setSampleRate(sampleRate);
     this->sampleRate = sampleRate;
+    JamTabaPlugin::setSampleRate(sampleRate);
+}
+
+void JamTabaVSTPlugin::setBlockSize(VstInt32 blockSize)
+{
+    AudioEffectX::setBlockSize(blockSize);
+    JamTabaPlugin::setMaxFramesPerBuffer(blockSize); // called by the host before resume()
 }
 
 void JamTabaVSTPlugin::suspend()
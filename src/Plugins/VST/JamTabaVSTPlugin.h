@@ -41,6 +41,7 @@ public:
     void open();
     void close() override;
     void setSampleRate(float sampleRate) override;
+    void setBlockSize(VstInt32 blockSize) override;
     float getSampleRate() const override;
 
     inline VstPlugCategory getPlugCategory();
@@ -4,6 +4,7 @@
 #include "midi/MidiMessage.h"
 #include "audio/PortAudioDriver.h"
 #include "audio/core/LocalInputNode.h"
+#include "audio/core/LatencyProbes.h"
 #include "vst/VstPlugin.h"
 #include "vst/VstHost.h"
 #include "vst/VstPluginFinder.h"
@@ -114,21 +115,19 @@ audio::Plugin *MainControllerStandalone::addPlugin(quint32 inputTrackIndex, quin
     if (plugin)
     {
         plugin->start();
-        QMutexLocker locker(&mutex);
-        getInputTrack(inputTrackIndex)->addProcessor(plugin, pluginSlotIndex);
+        getInputTrack(inputTrackIndex)->addProcessor(plugin, pluginSlotIndex); // the started plugin is used in the next callback
     }
     return plugin;
 }
 
 void MainControllerStandalone::removePlugin(int inputTrackIndex, audio::Plugin *plugin)
 {
-    QMutexLocker locker(&mutex);
     QString pluginName = plugin->getName();
     try
     {
         auto trackNode = getInputTrack(inputTrackIndex);
         if (trackNode)
-            trackNode->removeProcessor(plugin);
+            trackNode->removeProcessor(plugin, renderEpoch);
     }
     catch (...)
     {
@@ -306,6 +305,8 @@ void MainControllerStandalone::on_audioDriverStopped()
 {
     for (auto inputTrack : inputTracks)
         inputTrack->suspendProcessors();    // suspend plugins
+
+    audio::LatencyProbes::releaseAudioCallbackRings();
 }
 
 void MainControllerStandalone::handleNewNinjamInterval()
@@ -471,6 +472,8 @@ void MainControllerStandalone::start()
                          SLOT(on_audioDriverStopped()));
         QObject::connect(audioDriver.data(), SIGNAL(started()), this,
                          SLOT(on_audioDriverStarted()));
+        QObject::connect(audioDriver.data(), &audio::AudioDriver::buffersRecreated, this,
+                         &MainControllerStandalone::prepareToProcess, Qt::DirectConnection);
     }
 
     // calling the base class
@@ -816,6 +819,9 @@ void MainControllerStandalone::useNullAudioDriver()
 {
     qCWarning(jtCore) << "Audio driver can't be used, using NullAudioDriver!";
     audioDriver.reset(new audio::NullAudioDriver());
+
+    QObject::connect(audioDriver.data(), &audio::AudioDriver::buffersRecreated, this,
+                     &MainControllerStandalone::prepareToProcess, Qt::DirectConnection);
 }
 
 void MainControllerStandalone::updateInputTracksRange()
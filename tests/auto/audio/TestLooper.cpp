@@ -724,6 +724,37 @@ void TestLooper::resizeLayersAndCopySamples_data()
     QTest::newRow("2 samples, resized to 5") << (QStringList() << "1" << "2") << (QStringList() << "1" << "2" << "1" << "2" << "1");
 }
 
+void TestLooper::growLayersWithoutMovingRecordedSamples()
+{
+    const uint cycleLenght = LooperLayer::SEGMENT_SAMPLES + 100; // recorded in two layer segments
+
+    Looper looper;
+    looper.setLayers(1, true);
+    looper.setLayerPan(0, -1); // 100% left to not apply pan law in expected values
+
+    looper.toggleRecording(); // the layers memory is allocated when the looper is armed
+    looper.reserve(cycleLenght);
+    looper.startNewCycle(cycleLenght);
+    QVERIFY(looper.isRecording());
+
+    SamplesBuffer input(1, cycleLenght);
+    for (uint s = 0; s < cycleLenght; ++s)
+        input.set(0, s, (s % 1000) / 1000.0f);
+
+    looper.addBuffer(input);
+
+    // longer intervals, the new segments are appended and the recorded samples are not moved
+    looper.reserve(cycleLenght * 2);
+    looper.startNewCycle(cycleLenght * 2); // stop recording and repeat the recorded samples
+    QVERIFY(looper.isPlaying());
+
+    SamplesBuffer out(1, cycleLenght * 2);
+    out.zero();
+    looper.mixToBuffer(out);
+    for (uint s = 0; s < cycleLenght * 2; ++s)
+        QCOMPARE(out.get(0, s), input.get(0, s % cycleLenght));
+}
+
 void TestLooper::firstUnlockedLayer()
 {
     QFETCH(quint8, maxLayers);
@@ -0,0 +1,110 @@
+#include "TestPeakPyramid.h"
+
+#include "audio/core/PeakPyramid.h"
+#include <QTest>
+#include <cmath>
+
+using namespace audio;
+
+namespace {
+
+void fill(std::vector<float> &left, std::vector<float> &right)
+{
+    for (size_t i = 0; i < left.size(); ++i) {
+        left[i] = static_cast<float>(std::sin(i * 0.01) * (i % 100) / 100.0);
+        right[i] = static_cast<float>(std::cos(i * 0.003) * 0.5);
+    }
+}
+
+PeakPyramid::Peak computePeak(const std::vector<float> &left, const std::vector<float> &right, uint from, uint samples)
+{
+    PeakPyramid::Peak peak = { 0, 0, 0 };
+    for (uint i = from; i < from + samples; ++i) {
+        peak.min = qMin(peak.min, qMin(left[i], right[i]));
+        peak.max = qMax(peak.max, qMax(left[i], right[i]));
+        peak.squares += (left[i] * left[i] + right[i] * right[i]) * 0.5f;
+    }
+    return peak;
+}
+
+} // namespace
+
+void TestPeakPyramid::rangeQueries()
+{
+    QFETCH(uint, samples);
+    QFETCH(uint, blockSize);
+    QFETCH(uint, from);
+    QFETCH(uint, length);
+
+    std::vector<float> left(samples);
+    std::vector<float> right(samples);
+    fill(left, right);
+
+    PeakPyramid pyramid;
+    pyramid.resize(samples);
+    for (uint i = 0; i < samples; i += blockSize) // appending in blocks, like the looper
+        pyramid.update(&left[0], &right[0], i, qMin(blockSize, samples - i), qMin(i + blockSize, samples));
+
+    const auto expected = computePeak(left, right, from, length);
+    const auto peak = pyramid.getPeak(from, length);
+
+    QCOMPARE(peak.min, expected.min);
+    QCOMPARE(peak.max, expected.max);
+    QVERIFY(qAbs(peak.getRms(length) - expected.getRms(length)) < 0.0001f);
+}
+
+void TestPeakPyramid::rangeQueries_data()
+{
+    QTest::addColumn<uint>("samples");
+    QTest::addColumn<uint>("blockSize");
+    QTest::addColumn<uint>("from");
+    QTest::addColumn<uint>("length");
+
+    const uint bucket = PeakPyramid::BUCKET_SAMPLES;
+
+    QTest::newRow("Single bucket") << 4096u << 128u << bucket * 3 << bucket;
+    QTest::newRow("Whole buffer") << 4096u << 256u << 0u << 4096u;
+    QTest::newRow("Unaligned blocks") << 10000u << 100u << bucket * 5 << bucket * 77;
+    QTest::newRow("Last incomplete bucket") << 10000u << 512u << bucket * 150 << 10000u - bucket * 150;
+    QTest::newRow("Odd buckets in all levels") << 44100u << 441u << bucket * 31 << bucket * 511;
+}
+
+void TestPeakPyramid::overdubUpdatesAllLevels()
+{
+    const uint samples = 8192;
+    std::vector<float> left(samples, 0.1f);
+    std::vector<float> right(samples, -0.1f);
+
+    PeakPyramid pyramid;
+    pyramid.resize(samples);
+    pyramid.update(&left[0], &right[0], 0, samples, samples);
+
+    QCOMPARE(pyramid.getPeak(0, samples).getMaxPeak(), 0.1f);
+
+    left[5000] = 0.9f; // overdubbing a single sample
+    pyramid.update(&left[0], &right[0], 5000, 1, samples);
+
+    QCOMPARE(pyramid.getPeak(0, samples).max, 0.9f);
+    QCOMPARE(pyramid.getPeak(4096, 4096).max, 0.9f);
+    QCOMPARE(pyramid.getPeak(0, 4096).max, 0.1f);
+
+    const auto peaks = pyramid.getMaxPeaks(1024, samples);
+    QCOMPARE(peaks.size(), static_cast<size_t>(8));
+    QCOMPARE(peaks[4], 0.9f);
+    QCOMPARE(peaks[3], 0.1f);
+}
+
+void TestPeakPyramid::clear()
+{
+    std::vector<float> left(1000, 1.0f);
+    std::vector<float> right(1000, 1.0f);
+
+    PeakPyramid pyramid;
+    pyramid.resize(1000);
+    pyramid.update(&left[0], &right[0], 0, 1000, 1000);
+    QCOMPARE(pyramid.getPeak(0, 1000).max, 1.0f);
+
+    pyramid.clear();
+    QCOMPARE(pyramid.getPeak(0, 1000).max, 0.0f);
+    QCOMPARE(pyramid.getLevels(), 5u); // 16 buckets of 64 samples
+}
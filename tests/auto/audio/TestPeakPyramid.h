@@ -0,0 +1,18 @@
+#ifndef TESTPEAKPYRAMID_H
+#define TESTPEAKPYRAMID_H
+
+#include <QObject>
+
+class TestPeakPyramid: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void rangeQueries(); // comparing the pyramid peaks with the peaks computed from the samples
+    void rangeQueries_data();
+
+    void overdubUpdatesAllLevels();
+    void clear();
+};
+
+#endif // TESTPEAKPYRAMID_H
@@ -0,0 +1,241 @@
+#include "TestResampler.h"
+
+#include "audio/Resampler.h"
+#include "audio/SamplesBufferResampler.h"
+#include <QTest>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+Q_DECLARE_METATYPE(Resampler::Quality)
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double AMPLITUDE = 0.5;
+
+float sine(double frequency, double position, int sampleRate)
+{
+    return static_cast<float>(AMPLITUDE * std::sin(2.0 * PI * frequency * position / sampleRate));
+}
+
+double decibels(double signalEnergy, double noiseEnergy)
+{
+    return 10.0 * std::log10(signalEnergy / qMax(noiseEnergy, 1e-30));
+}
+
+} // namespace
+
+void TestResampler::signalToNoise_data()
+{
+    QTest::addColumn<Resampler::Quality>("quality");
+    QTest::addColumn<int>("inSampleRate");
+    QTest::addColumn<int>("outSampleRate");
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<double>("minimumSnr");
+    QTest::addColumn<bool>("unevenBlocks");
+
+    QTest::newRow("Fast, 44100 to 48000, 1 KHz")    << Resampler::Fast   << 44100 << 48000 << 1000.0  << 45.0 << false;
+    QTest::newRow("Medium, 44100 to 48000, 1 KHz")  << Resampler::Medium << 44100 << 48000 << 1000.0  << 65.0 << false;
+    QTest::newRow("Medium, 48000 to 44100, 1 KHz")  << Resampler::Medium << 48000 << 44100 << 1000.0  << 60.0 << false;
+    QTest::newRow("Medium, 44100 to 48000, 10 KHz") << Resampler::Medium << 44100 << 48000 << 10000.0 << 60.0 << false;
+    QTest::newRow("High, 44100 to 48000, 1 KHz")    << Resampler::High   << 44100 << 48000 << 1000.0  << 90.0 << false;
+    QTest::newRow("High, 48000 to 44100, 1 KHz")    << Resampler::High   << 48000 << 44100 << 1000.0  << 90.0 << false;
+    QTest::newRow("High, 44100 to 48000, 10 KHz")   << Resampler::High   << 44100 << 48000 << 10000.0 << 90.0 << false;
+
+    QTest::newRow("Fast, 44100 to 48000, 1 KHz, uneven blocks")   << Resampler::Fast   << 44100 << 48000 << 1000.0 << 45.0 << true;
+    QTest::newRow("Medium, 44100 to 48000, 1 KHz, uneven blocks") << Resampler::Medium << 44100 << 48000 << 1000.0 << 65.0 << true;
+    QTest::newRow("Medium, 48000 to 44100, 1 KHz, uneven blocks") << Resampler::Medium << 48000 << 44100 << 1000.0 << 60.0 << true;
+    QTest::newRow("High, 44100 to 48000, 1 KHz, uneven blocks")   << Resampler::High   << 44100 << 48000 << 1000.0 << 90.0 << true;
+    QTest::newRow("High, 48000 to 44100, 1 KHz, uneven blocks")   << Resampler::High   << 48000 << 44100 << 1000.0 << 90.0 << true;
+}
+
+void TestResampler::signalToNoise()
+{
+    QFETCH(Resampler::Quality, quality);
+    QFETCH(int, inSampleRate);
+    QFETCH(int, outSampleRate);
+    QFETCH(double, frequency);
+    QFETCH(double, minimumSnr);
+    QFETCH(bool, unevenBlocks);
+
+    // 147 and 160 are the 44100/48000 ratio, blocks are exactly representing the rates ratio
+    const int exactInBlock = inSampleRate < outSampleRate ? 147 : 160;
+    const int exactOutBlock = inSampleRate < outSampleRate ? 160 : 147;
+    const double step = static_cast<double>(inSampleRate) / outSampleRate;
+
+    // audio drivers and plugin hosts are not always using the same block size, the input lenght is rounded in each block
+    const int unevenOutBlocks[] = { 64, 97, 31, 128, 256, 1, 63 };
+
+    std::unique_ptr<Resampler> resampler(Resampler::create(quality));
+    std::vector<float> in(512);
+    std::vector<float> out(256);
+
+    double signalEnergy = 0;
+    double noiseEnergy = 0;
+    qint64 inPosition = 0;
+    qint64 outPosition = 0;
+    for (int block = 0; block < 300; ++block) {
+        const int outBlock = unevenBlocks ? unevenOutBlocks[block % 7] : exactOutBlock;
+        const int inBlock = unevenBlocks ? static_cast<int>(std::ceil((outPosition + outBlock) * step) - inPosition) : exactInBlock;
+
+        for (int i = 0; i < inBlock; ++i)
+            in[i] = sine(frequency, inPosition + i, inSampleRate);
+
+        if (unevenBlocks)
+            resampler->process(in.data(), inBlock, out.data(), outBlock, step);
+        else
+            resampler->process(in.data(), inBlock, out.data(), outBlock);
+
+        if (outPosition >= 256) { // filter is not full in the first blocks
+            for (int i = 0; i < outBlock; ++i) {
+                const double inputPosition = (outPosition + i) * step - resampler->getLatency();
+                const double expected = sine(frequency, inputPosition, inSampleRate);
+                signalEnergy += expected * expected;
+                noiseEnergy += (out[i] - expected) * (out[i] - expected);
+            }
+        }
+
+        inPosition += inBlock;
+        outPosition += outBlock;
+    }
+
+    const double snr = decibels(signalEnergy, noiseEnergy);
+    QVERIFY2(snr >= minimumSnr, qPrintable(QString("SNR is %1 dB").arg(snr)));
+}
+
+void TestResampler::aliasing_data()
+{
+    QTest::addColumn<Resampler::Quality>("quality");
+    QTest::addColumn<int>("inSampleRate");
+    QTest::addColumn<int>("outSampleRate");
+    QTest::addColumn<double>("frequency");
+    QTest::addColumn<double>("maximumAliasing");
+
+    QTest::newRow("Medium, 48000 to 44100, 23 KHz") << Resampler::Medium << 48000 << 44100 << 23000.0 << -55.0;
+    QTest::newRow("Medium, 48000 to 32000, 20 KHz") << Resampler::Medium << 48000 << 32000 << 20000.0 << -55.0;
+    QTest::newRow("High, 48000 to 44100, 23 KHz")   << Resampler::High   << 48000 << 44100 << 23000.0 << -90.0;
+    QTest::newRow("High, 48000 to 32000, 20 KHz")   << Resampler::High   << 48000 << 32000 << 20000.0 << -90.0;
+}
+
+void TestResampler::aliasing()
+{
+    QFETCH(Resampler::Quality, quality);
+    QFETCH(int, inSampleRate);
+    QFETCH(int, outSampleRate);
+    QFETCH(double, frequency);
+    QFETCH(double, maximumAliasing);
+
+    const int inLength = inSampleRate;
+    const int outLength = outSampleRate;
+    std::vector<float> in(inLength);
+    for (int i = 0; i < inLength; ++i)
+        in[i] = sine(frequency, i, inSampleRate);
+
+    std::vector<float> out(outLength);
+    std::unique_ptr<Resampler> resampler(Resampler::create(quality));
+    resampler->processAll(in.data(), inLength, out.data(), outLength);
+
+    // everything in the output is aliasing, the edges (signal starting and stopping) are ignored
+    const int edge = 1000;
+    double aliasingEnergy = 0;
+    for (int i = edge; i < outLength - edge; ++i)
+        aliasingEnergy += out[i] * out[i];
+
+    const double signalEnergy = (outLength - 2 * edge) * AMPLITUDE * AMPLITUDE / 2.0;
+    const double aliasing = -decibels(signalEnergy, aliasingEnergy);
+    QVERIFY2(aliasing <= maximumAliasing, qPrintable(QString("Aliasing is %1 dB").arg(aliasing)));
+}
+
+void TestResampler::processAllCompensatesLatency()
+{
+    const int inLength = 44100;
+    const int outLength = 48000;
+    const double frequency = 440.0;
+
+    std::vector<float> in(inLength);
+    for (int i = 0; i < inLength; ++i)
+        in[i] = sine(frequency, i, 44100);
+
+    std::vector<float> out(outLength);
+    PolyphaseResampler resampler(Resampler::High);
+    resampler.processAll(in.data(), inLength, out.data(), outLength);
+
+    double signalEnergy = 0;
+    double noiseEnergy = 0;
+    for (int i = 100; i < outLength - 100; ++i) {
+        const double expected = sine(frequency, i, 48000);
+        signalEnergy += expected * expected;
+        noiseEnergy += (out[i] - expected) * (out[i] - expected);
+    }
+
+    QVERIFY(decibels(signalEnergy, noiseEnergy) > 90.0);
+}
+
+void TestResampler::blockBoundariesWithChangingRatio()
+{
+    const int outBlock = 128;
+    const double nominalRatio = 44100.0 / 48000.0;
+    const double frequency = 1000.0;
+
+    SamplesBufferResampler resampler(Resampler::High);
+    audio::SamplesBuffer in(2, 128);
+
+    const int latency = PolyphaseResampler(Resampler::High).getLatency();
+
+    double signalEnergy = 0;
+    double noiseEnergy = 0;
+    int inPosition = 0;
+    double inputTime = 0; // continuous input position of the first sample in each output block
+    for (int block = 0; block < 500; ++block) {
+        // the ratio is changing slowly around the nominal ratio, the input lenght is 117 or 118
+        const double ratio = nominalRatio * (1.0 + 0.002 * std::sin(block * 0.05));
+        const int inBlock = static_cast<int>(std::ceil(inputTime + outBlock * ratio)) - inPosition;
+        in.setFrameLenght(inBlock);
+        for (int i = 0; i < inBlock; ++i) {
+            in.set(0, i, sine(frequency, inPosition + i, 44100));
+            in.set(1, i, -sine(frequency, inPosition + i, 44100));
+        }
+
+        const auto &out = resampler.resample(in, outBlock, ratio);
+        QCOMPARE(static_cast<int>(out.getFrameLenght()), outBlock);
+
+        if (block >= 2) {
+            for (int i = 0; i < outBlock; ++i) {
+                const double expected = sine(frequency, inputTime + i * ratio - latency, 44100);
+                signalEnergy += 2 * expected * expected;
+                noiseEnergy += (out.get(0, i) - expected) * (out.get(0, i) - expected);
+                noiseEnergy += (out.get(1, i) + expected) * (out.get(1, i) + expected);
+            }
+        }
+
+        inPosition += inBlock;
+        inputTime += outBlock * ratio;
+    }
+
+    const double snr = decibels(signalEnergy, noiseEnergy);
+    QVERIFY2(snr > 80.0, qPrintable(QString("SNR is %1 dB").arg(snr)));
+}
+
+void TestResampler::preparedBigBlocks()
+{
+    const int block = 20000; // bigger than the default work buffer
+
+    std::unique_ptr<Resampler> resampler(Resampler::create(Resampler::Medium));
+    resampler->prepare(block, 1.0);
+
+    std::vector<float> in(block);
+    std::vector<float> out(block);
+    for (int b = 0; b < 2; ++b) {
+        for (int i = 0; i < block; ++i)
+            in[i] = sine(1000.0, b * block + i, 44100);
+
+        resampler->process(in.data(), block, out.data(), block);
+
+        // same rate, the samples are just delayed
+        const int latency = resampler->getLatency();
+        for (int i = b ? 0 : latency; i < block; ++i)
+            QCOMPARE(out[i], sine(1000.0, b * block + i - latency, 44100));
+    }
+}
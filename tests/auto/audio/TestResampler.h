@@ -0,0 +1,24 @@
+#ifndef TESTRESAMPLER_H
+#define TESTRESAMPLER_H
+
+#include <QObject>
+
+class TestResampler: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void signalToNoise(); // streaming a sine in blocks, comparing with the ideal resampled sine
+    void signalToNoise_data();
+
+    void aliasing(); // downsampling a tone above the new Nyquist frequency
+    void aliasing_data();
+
+    void processAllCompensatesLatency();
+
+    void blockBoundariesWithChangingRatio(); // drift compensation is changing the input lenght in each block
+
+    void preparedBigBlocks(); // process() is not allocating, big blocks are prepared
+};
+
+#endif // TESTRESAMPLER_H
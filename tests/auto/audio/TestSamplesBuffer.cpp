@@ -3,6 +3,7 @@
 #include <QString>
 #include "audio/core/SamplesBuffer.h"
 #include <QTest>
+#include <cstdint>
 
 using namespace audio;
 
@@ -256,3 +257,172 @@ void TestSamplesBuffer::append_data()
     QTest::newRow("Appending 2 samples") << "1,2,3" << "4,5" << "1,2,3,4,5";
     QTest::newRow("Appending zero samples") << "1,2,3" << "" << "1,2,3";
 }
+
+void TestSamplesBuffer::channelsAreAligned()
+{
+    QFETCH(int, channels);
+    QFETCH(int, frameLenght);
+
+    SamplesBuffer buffer(channels, frameLenght);
+    for (int c = 0; c < channels; ++c) {
+        auto address = reinterpret_cast<std::uintptr_t>(buffer.getSamplesArray(c));
+        QCOMPARE(address % SamplesBuffer::ALIGNMENT, static_cast<std::uintptr_t>(0));
+    }
+
+    QVERIFY(buffer.getCapacity() >= static_cast<uint>(frameLenght));
+}
+
+void TestSamplesBuffer::channelsAreAligned_data()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<int>("frameLenght");
+
+    QTest::newRow("Mono") << 1 << 256;
+    QTest::newRow("Stereo") << 2 << 256;
+    QTest::newRow("Stereo, odd frame lenght") << 2 << 3;
+    QTest::newRow("8 channels") << 8 << 1001;
+}
+
+void TestSamplesBuffer::discardAndAppendIsReusingCapacity()
+{
+    SamplesBuffer buffer(2);
+
+    SamplesBuffer chunk(2, 64);
+    float nextValue = 0;
+    float expectedFirstValue = 0;
+    for (int i = 0; i < 100; ++i) {
+        for (uint s = 0; s < chunk.getFrameLenght(); ++s) {
+            chunk.set(0, s, nextValue);
+            chunk.set(1, s, -nextValue);
+            nextValue++;
+        }
+        buffer.append(chunk);
+
+        QCOMPARE(buffer.get(0, 0), expectedFirstValue);
+        QCOMPARE(buffer.get(1, 0), -expectedFirstValue);
+
+        buffer.discardFirstSamples(60);
+        expectedFirstValue += 60;
+
+        QCOMPARE(buffer.get(0, 0), expectedFirstValue);
+    }
+
+    // 400 samples are buffered, the capacity is growing with the buffered samples only
+    QCOMPARE(buffer.getFrameLenght(), 400u);
+    QVERIFY(buffer.getCapacity() < 1024);
+}
+
+void TestSamplesBuffer::copyIsReusingCapacity()
+{
+    SamplesBuffer source(2, 4096);
+    source.setFrameLenght(64); // shrunk, the samples after the frame lenght are not copied
+    for (uint s = 0; s < source.getFrameLenght(); ++s) {
+        source.set(0, s, s);
+        source.set(1, s, -static_cast<float>(s));
+    }
+
+    SamplesBuffer buffer(2, 256);
+    const float *samples = buffer.getSamplesArray(0);
+
+    buffer = source;
+
+    QCOMPARE(buffer.getSamplesArray(0), samples);
+    QCOMPARE(buffer.getFrameLenght(), 64u);
+    QCOMPARE(buffer.get(0, 63), 63.0f);
+    QCOMPARE(buffer.get(1, 63), -63.0f);
+
+    buffer.setFrameLenght(128); // growing again, the new samples are zeroed
+    QCOMPARE(buffer.get(0, 100), 0.0f);
+}
+
+void TestSamplesBuffer::view()
+{
+    QFETCH(QString, samples);
+    QFETCH(int, offset);
+    QFETCH(int, frames);
+    QFETCH(QString, expectedSamples);
+
+    SamplesBuffer buffer = createBuffer(samples);
+    SamplesBufferView view = buffer.getView(offset, frames);
+
+    QStringList expectedValues;
+    if (!expectedSamples.isEmpty())
+        expectedValues.append(expectedSamples.split(","));
+
+    QCOMPARE(view.getFrameLenght(), static_cast<uint>(expectedValues.size()));
+    for (int i = 0; i < expectedValues.size(); ++i)
+        QCOMPARE(view.getSamplesArray(0)[i], expectedValues.at(i).toFloat());
+}
+
+void TestSamplesBuffer::view_data()
+{
+    QTest::addColumn<QString>("samples");
+    QTest::addColumn<int>("offset");
+    QTest::addColumn<int>("frames");
+    QTest::addColumn<QString>("expectedSamples");
+
+    QTest::newRow("Whole buffer") << "1,2,3" << 0 << 3 << "1,2,3";
+    QTest::newRow("Middle") << "1,2,3,4" << 1 << 2 << "2,3";
+    QTest::newRow("Clipped at the end") << "1,2,3" << 2 << 5 << "3";
+    QTest::newRow("Offset after the end") << "1,2,3" << 4 << 1 << "";
+}
+
+void TestSamplesBuffer::bufferWrappingView()
+{
+    SamplesBuffer buffer(2, 8);
+    for (uint s = 0; s < buffer.getFrameLenght(); ++s) {
+        buffer.set(0, s, s);
+        buffer.set(1, s, s + 100);
+    }
+
+    const SamplesBuffer wrapper(buffer.getView(2, 4)); // not copying the samples
+    QCOMPARE(wrapper.getChannels(), 2);
+    QCOMPARE(wrapper.getFrameLenght(), 4u);
+    QCOMPARE(wrapper.getSamplesArray(1), buffer.getSamplesArray(1) + 2);
+    QCOMPARE(wrapper.get(1, 3), 105.0f);
+
+    // growing a wrapper is copying the samples, the wrapped buffer is untouched
+    SamplesBuffer grownWrapper(buffer.getView(2, 4));
+    grownWrapper.setFrameLenght(6);
+    QCOMPARE(grownWrapper.get(0, 3), 5.0f);
+    QCOMPARE(grownWrapper.get(0, 4), 0.0f);
+    QCOMPARE(buffer.get(0, 6), 6.0f);
+}
+
+void TestSamplesBuffer::applyGainAndComputePeak()
+{
+    SamplesBuffer buffer(2, 3);
+    for (uint s = 0; s < buffer.getFrameLenght(); ++s) {
+        buffer.set(0, s, s * 0.25f);
+        buffer.set(1, s, -0.5f);
+    }
+
+    const AudioPeak peak = buffer.applyGainAndComputePeak(0.5f, 1.0f, 0.5f, 2.0f); // gain * boost is 1
+
+    QCOMPARE(buffer.get(0, 2), 0.5f);
+    QCOMPARE(buffer.get(1, 2), -0.25f);
+    QCOMPARE(peak.getLeftPeak(), 0.5f);
+    QCOMPARE(peak.getRightPeak(), 0.25f);
+
+    SamplesBuffer mono(1, 2);
+    mono.set(0, 1, -0.5f);
+    QCOMPARE(mono.applyGainAndComputePeak(0.5f, 0.1f, 0.1f, 1.0f).getMaxPeak(), 0.25f); // pan gains are not used
+    QCOMPARE(mono.get(0, 1), -0.25f);
+}
+
+void TestSamplesBuffer::applyGainAndComputePeakInExtraChannels()
+{
+    SamplesBuffer buffer(4, 2);
+    for (uint c = 0; c < buffer.getChannels(); ++c) {
+        buffer.set(c, 0, 1.0f);
+        buffer.set(c, 1, -1.0f);
+    }
+
+    const AudioPeak peak = buffer.applyGainAndComputePeak(0.5f, 0.5f, 0.25f, 1.0f);
+
+    QCOMPARE(buffer.get(0, 1), -0.25f);
+    QCOMPARE(buffer.get(1, 1), -0.125f);
+    QCOMPARE(buffer.get(2, 1), -0.5f); // not panned
+    QCOMPARE(buffer.get(3, 0), 0.5f);
+    QCOMPARE(peak.getMaxPeak(), 0.25f); // only the first 2 channels are metered
+}
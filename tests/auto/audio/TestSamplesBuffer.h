@@ -34,6 +34,20 @@ private slots:
     void copy();
     void copy_data();
 
+    void channelsAreAligned();
+    void channelsAreAligned_data();
+
+    void discardAndAppendIsReusingCapacity(); // the decoders are discarding and appending samples in every audio callback
+    void copyIsReusingCapacity(); // buffers are assigned in the audio thread
+
+    void view();
+    void view_data();
+
+    void bufferWrappingView();
+
+    void applyGainAndComputePeak();
+    void applyGainAndComputePeakInExtraChannels(); // the master bus can have more than 2 channels
+
 private:
     audio::SamplesBuffer createBuffer(QString comaSeparatedValues);
     void checkExpectedValues(QString comaSeparatedExpectedValues, const audio::SamplesBuffer &buffer);
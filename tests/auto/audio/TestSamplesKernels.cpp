@@ -0,0 +1,217 @@
+#include "TestSamplesKernels.h"
+
+#include "audio/core/SamplesKernels.h"
+#include <QTest>
+
+#include <cmath>
+#include <functional>
+#include <vector>
+
+using audio::kernels::InstructionSet;
+using audio::kernels::Kernels;
+
+Q_DECLARE_METATYPE(InstructionSet)
+
+namespace {
+
+const uint OFFSETS[] = {0, 1, 2, 3}; // samples, 0 is the vector allocation alignment
+const uint LENGHTS[] = {0, 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 63, 65, 257};
+const uint PADDING = 16; // samples after the processed lenght, never changed by the kernels
+const float GUARD = 123.0f;
+
+std::vector<float> createSamples(uint offset, uint lenght, float frequency)
+{
+    std::vector<float> samples(offset + lenght + PADDING, GUARD);
+    for (uint i = 0; i < lenght; ++i)
+        samples[offset + i] = std::sin((i + 1) * frequency) * ((i % 7) ? 0.9f : -0.5f);
+
+    return samples;
+}
+
+void compare(const std::vector<float> &samples, const std::vector<float> &expected, float epsilon)
+{
+    QCOMPARE(samples.size(), expected.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (std::abs(samples[i] - expected[i]) > epsilon)
+            QFAIL(qPrintable(QString("Sample %1 is %2, expected %3").arg(i).arg(samples[i]).arg(expected[i])));
+    }
+}
+
+// the sums are computed in different orders by each instruction set
+void compareSums(float sum, float expected, uint lenght)
+{
+    const float epsilon = 1e-6f * (lenght + 1) * qMax(1.0f, std::abs(expected));
+    QVERIFY2(std::abs(sum - expected) <= epsilon, qPrintable(QString("Sum is %1, expected %2").arg(sum).arg(expected)));
+}
+
+// call 'test' for all offsets and lenghts, stopping in the first failure
+void forAllBuffers(std::function<void(uint offset, uint lenght)> test)
+{
+    for (uint offset : OFFSETS) {
+        for (uint lenght : LENGHTS) {
+            test(offset, lenght);
+            if (QTest::currentTestFailed()) {
+                qWarning("offset %u, lenght %u", offset, lenght);
+                return;
+            }
+        }
+    }
+}
+
+} // namespace
+
+void TestSamplesKernels::addInstructionSetsColumn()
+{
+    QTest::addColumn<InstructionSet>("instructionSet");
+
+    for (auto set : {InstructionSet::Scalar, InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::NEON}) {
+        if (audio::kernels::isSupported(set))
+            QTest::newRow(audio::kernels::getName(set)) << set;
+    }
+}
+
+void TestSamplesKernels::scale_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::scale()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        auto samples = createSamples(offset, lenght, 0.01f);
+        auto expected = samples;
+        kernels.scale(samples.data() + offset, lenght, 0.75f);
+        reference.scale(expected.data() + offset, lenght, 0.75f);
+        compare(samples, expected, 0.0f); // bit exact
+    });
+}
+
+void TestSamplesKernels::ramp_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::ramp()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        const float step = 1.0f / (lenght + 1);
+        auto samples = createSamples(offset, lenght, 0.02f);
+        auto expected = samples;
+        kernels.ramp(samples.data() + offset, lenght, 0.1f, step);
+        reference.ramp(expected.data() + offset, lenght, 0.1f, step);
+        compare(samples, expected, 1e-5f); // gains are accumulated in different orders
+    });
+}
+
+void TestSamplesKernels::add_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::add()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        const auto source = createSamples(offset + 1, lenght, 0.03f); // source and destination are not aligned in the same way
+        auto samples = createSamples(offset, lenght, 0.01f);
+        auto expected = samples;
+        kernels.add(samples.data() + offset, source.data() + offset + 1, lenght);
+        reference.add(expected.data() + offset, source.data() + offset + 1, lenght);
+        compare(samples, expected, 0.0f);
+    });
+}
+
+void TestSamplesKernels::mix_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::mix()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        const auto source = createSamples(offset + 1, lenght, 0.03f);
+        auto samples = createSamples(offset, lenght, 0.01f);
+        auto expected = samples;
+        kernels.mix(samples.data() + offset, source.data() + offset + 1, lenght, 0.6f);
+        reference.mix(expected.data() + offset, source.data() + offset + 1, lenght, 0.6f);
+        compare(samples, expected, 1e-6f); // fused multiply add in some instruction sets
+    });
+}
+
+void TestSamplesKernels::peak_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::peak()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        const auto samples = createSamples(offset, lenght, 0.05f);
+        float squares = 0;
+        float expectedSquares = 0;
+        QCOMPARE(kernels.peak(samples.data() + offset, lenght, &squares),
+                 reference.peak(samples.data() + offset, lenght, &expectedSquares)); // the guard samples are not read
+        compareSums(squares, expectedSquares, lenght);
+    });
+}
+
+void TestSamplesKernels::scaleAndPeak_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::scaleAndPeak()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        auto samples = createSamples(offset, lenght, 0.05f);
+        auto expected = samples;
+        float squares = 0;
+        float expectedSquares = 0;
+        QCOMPARE(kernels.scaleAndPeak(samples.data() + offset, lenght, 0.5f, &squares),
+                 reference.scaleAndPeak(expected.data() + offset, lenght, 0.5f, &expectedSquares));
+        compare(samples, expected, 0.0f);
+        compareSums(squares, expectedSquares, lenght);
+    });
+}
+
+void TestSamplesKernels::dot_data()
+{
+    addInstructionSetsColumn();
+}
+
+void TestSamplesKernels::dot()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    forAllBuffers([&](uint offset, uint lenght) {
+        const auto a = createSamples(offset, lenght, 0.07f);
+        const auto b = createSamples(offset + 3, lenght, 0.11f);
+        compareSums(kernels.dot(a.data() + offset, b.data() + offset + 3, lenght),
+                    reference.dot(a.data() + offset, b.data() + offset + 3, lenght), lenght);
+    });
+}
@@ -0,0 +1,38 @@
+#ifndef TESTSAMPLESKERNELS_H
+#define TESTSAMPLESKERNELS_H
+
+#include <QObject>
+
+// each instruction set supported by the running CPU is compared with the scalar (reference) kernels,
+// using unaligned buffers and lenghts not multiple of the vector size
+class TestSamplesKernels: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void scale();
+    void scale_data();
+
+    void ramp();
+    void ramp_data();
+
+    void add();
+    void add_data();
+
+    void mix();
+    void mix_data();
+
+    void peak();
+    void peak_data();
+
+    void scaleAndPeak();
+    void scaleAndPeak_data();
+
+    void dot();
+    void dot_data();
+
+private:
+    void addInstructionSetsColumn();
+};
+
+#endif // TESTSAMPLESKERNELS_H
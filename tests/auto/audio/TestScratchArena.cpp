@@ -0,0 +1,96 @@
+#include "TestScratchArena.h"
+
+#include "audio/core/ScratchArena.h"
+#include <QTest>
+
+using namespace audio;
+
+void TestScratchArena::takeBuffer()
+{
+    QFETCH(int, channels);
+    QFETCH(int, frames);
+
+    ScratchArena arena;
+    arena.prepare(8, 512);
+
+    ScratchArena::Scope scope(arena);
+    auto &buffer = arena.takeBuffer(channels, frames);
+
+    QCOMPARE(buffer.getChannels(), channels);
+    QCOMPARE(static_cast<int>(buffer.getFrameLenght()), frames);
+
+    for (int c = 0; c < channels; ++c) {
+        for (int s = 0; s < frames; ++s)
+            QCOMPARE(buffer.get(c, s), 0.0f);
+    }
+}
+
+void TestScratchArena::takeBuffer_data()
+{
+    QTest::addColumn<int>("channels");
+    QTest::addColumn<int>("frames");
+
+    QTest::newRow("Mono") << 1 << 64;
+    QTest::newRow("Stereo") << 2 << 256;
+    QTest::newRow("Multichannel, max frames") << 8 << 512;
+}
+
+void TestScratchArena::buffersAreReusedAfterScope()
+{
+    ScratchArena arena;
+    arena.prepare(2, 256);
+
+    SamplesBuffer *firstBuffer = nullptr;
+    float *firstSamples = nullptr;
+    {
+        ScratchArena::Scope scope(arena);
+        auto &buffer = arena.takeBuffer(2, 256);
+        buffer.set(0, 0, 1.0f);
+        firstBuffer = &buffer;
+        firstSamples = buffer.getSamplesArray(0);
+    }
+
+    ScratchArena::Scope scope(arena);
+    auto &buffer = arena.takeBuffer(1, 128); // smaller buffer is using the same pre allocated memory
+
+    QCOMPARE(&buffer, firstBuffer);
+    QCOMPARE(buffer.getSamplesArray(0), firstSamples);
+    QCOMPARE(buffer.get(0, 0), 0.0f); // taken buffers are always zeroed
+}
+
+void TestScratchArena::nestedScopesUseDifferentBuffers()
+{
+    ScratchArena arena;
+
+    ScratchArena::Scope outerScope(arena);
+    auto &outerBuffer = arena.takeBuffer(2, 64);
+    outerBuffer.set(0, 0, 1.0f);
+    {
+        ScratchArena::Scope innerScope(arena);
+        auto &innerBuffer = arena.takeBuffer(2, 64);
+        QVERIFY(&innerBuffer != &outerBuffer);
+        innerBuffer.set(0, 0, -1.0f);
+    }
+
+    QCOMPARE(outerBuffer.get(0, 0), 1.0f);
+}
+
+void TestScratchArena::midiBufferIsEmptyAndKeepsCapacity()
+{
+    ScratchArena arena;
+    const std::vector<midi::MidiMessage> *firstMidiBuffer = nullptr;
+    {
+        ScratchArena::Scope scope(arena);
+        auto &midiBuffer = arena.takeMidiBuffer();
+        QVERIFY(midiBuffer.empty());
+        QVERIFY(midiBuffer.capacity() >= ScratchArena::MAX_MIDI_MESSAGES);
+        midiBuffer.push_back(midi::MidiMessage(0x90, 0));
+        firstMidiBuffer = &midiBuffer;
+    }
+
+    ScratchArena::Scope scope(arena);
+    auto &midiBuffer = arena.takeMidiBuffer();
+    QCOMPARE(&midiBuffer, firstMidiBuffer);
+    QVERIFY(midiBuffer.empty());
+    QVERIFY(midiBuffer.capacity() >= ScratchArena::MAX_MIDI_MESSAGES);
+}
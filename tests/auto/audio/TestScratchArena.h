@@ -0,0 +1,20 @@
+#ifndef TESTSCRATCHARENA_H
+#define TESTSCRATCHARENA_H
+
+#include <QObject>
+
+class TestScratchArena: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void takeBuffer();
+    void takeBuffer_data();
+
+    void buffersAreReusedAfterScope();
+    void nestedScopesUseDifferentBuffers();
+
+    void midiBufferIsEmptyAndKeepsCapacity();
+};
+
+#endif // TESTSCRATCHARENA_H
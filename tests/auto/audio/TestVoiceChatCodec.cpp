@@ -0,0 +1,156 @@
+#include "TestVoiceChatCodec.h"
+
+#include "audio/voicechat/VoiceChatEncoder.h"
+#include "audio/voicechat/VoiceChatDecoder.h"
+#include <QTest>
+
+#include <cmath>
+#include <vector>
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+const double AMPLITUDE = 0.5;
+
+QByteArray encodeSine(voicechat::Encoder &encoder, double frequency, int blocks, int blockSize, std::vector<float> &encodedSamples)
+{
+    audio::SamplesBuffer block(2, static_cast<uint>(blockSize));
+    QByteArray encoded;
+    for (int b = 0; b < blocks; ++b) {
+        for (int i = 0; i < blockSize; ++i) {
+            const double position = b * blockSize + i;
+            const float value = static_cast<float>(AMPLITUDE * std::sin(2.0 * PI * frequency * position / encoder.getSampleRate()));
+            block.set(0, static_cast<uint>(i), value);
+            block.set(1, static_cast<uint>(i), value);
+            encodedSamples.push_back(value);
+        }
+        encoded.append(encoder.encode(block));
+    }
+    encoded.append(encoder.finishIntervalEncoding());
+
+    return encoded;
+}
+
+} // namespace
+
+void TestVoiceChatCodec::roundTrip_data()
+{
+    QTest::addColumn<int>("sampleRate");
+    QTest::addColumn<int>("frameDuration");
+    QTest::addColumn<int>("blockSize");
+    QTest::addColumn<double>("minimumSnr");
+
+    QTest::newRow("44100, 10 ms frames, 128 samples blocks") << 44100 << 10 << 128 << 20.0;
+    QTest::newRow("48000, 10 ms frames, 441 samples blocks") << 48000 << 10 << 441 << 20.0;
+    QTest::newRow("48000, 2 ms frames, 64 samples blocks")   << 48000 << 2  << 64  << 20.0;
+    QTest::newRow("48000, 60 ms frames, 1024 samples blocks") << 48000 << 60 << 1024 << 20.0;
+}
+
+void TestVoiceChatCodec::roundTrip()
+{
+    QFETCH(int, sampleRate);
+    QFETCH(int, frameDuration);
+    QFETCH(int, blockSize);
+    QFETCH(double, minimumSnr);
+
+    voicechat::Encoder encoder(2, static_cast<uint>(sampleRate), static_cast<uint>(frameDuration));
+    QCOMPARE(encoder.getChannels(), 2);
+    QCOMPARE(encoder.getFrameSize(), static_cast<uint>(sampleRate / 2 * frameDuration / 1000));
+
+    std::vector<float> input;
+    const QByteArray encoded = encodeSine(encoder, 440.0, 40, blockSize, input);
+    QVERIFY(voicechat::isVoiceChatStream(encoded));
+
+    voicechat::Decoder decoder;
+    decoder.addInputData(encoded);
+
+    std::vector<float> output;
+    while (true) {
+        const auto &decoded = decoder.decode(256);
+        if (decoded.isEmpty())
+            break;
+        for (uint i = 0; i < decoded.getFrameLenght(); ++i)
+            output.push_back(decoded.get(0, i));
+    }
+
+    QVERIFY(decoder.isValid());
+    QVERIFY(decoder.isFinished());
+    QVERIFY(!decoder.isStereo());
+    QCOMPARE(decoder.getSampleRate(), sampleRate / 2);
+    QCOMPARE(output.size(), input.size() / 2);
+
+    double signal = 0;
+    double noise = 0;
+    for (size_t i = 0; i < output.size(); ++i) {
+        const int inputIndex = static_cast<int>(i * 2 + 1) - voicechat::Encoder::FILTER_DELAY; // delayed by the half band filter
+        if (inputIndex < 0)
+            continue;
+
+        const double expected = input[static_cast<size_t>(inputIndex)];
+        signal += expected * expected;
+        noise += (output[i] - expected) * (output[i] - expected);
+    }
+
+    const double snr = 10.0 * std::log10(signal / qMax(noise, 1e-30));
+    QVERIFY2(snr >= minimumSnr, qPrintable(QString("SNR %1 dB").arg(snr)));
+}
+
+void TestVoiceChatCodec::aliasingRejection()
+{
+    voicechat::Encoder encoder(2, 48000, 10);
+    std::vector<float> input;
+    const QByteArray encoded = encodeSine(encoder, 18000.0, 40, 441, input); // above the 12 KHz output nyquist
+
+    voicechat::Decoder decoder;
+    decoder.addInputData(encoded);
+
+    double inputEnergy = 0;
+    for (size_t i = 0; i < input.size(); i += 2)
+        inputEnergy += input[i] * input[i];
+
+    double outputEnergy = 0;
+    while (true) {
+        const auto &decoded = decoder.decode(256);
+        if (decoded.isEmpty())
+            break;
+        for (uint i = 0; i < decoded.getFrameLenght(); ++i)
+            outputEnergy += decoded.get(0, i) * decoded.get(0, i);
+    }
+
+    const double rejection = 10.0 * std::log10(inputEnergy / qMax(outputEnergy, 1e-30));
+    QVERIFY2(rejection >= 40.0, qPrintable(QString("Rejection %1 dB").arg(rejection))); // averaging 2 samples is about 8 dB
+}
+
+void TestVoiceChatCodec::decodingIncompleteStream()
+{
+    voicechat::Encoder encoder(1, 48000, 10);
+    std::vector<float> input;
+    const QByteArray encoded = encodeSine(encoder, 440.0, 10, 480, input); // 10 frames
+
+    voicechat::Decoder decoder;
+    int decodedFrames = 0;
+    int firstDecodedOffset = -1;
+    for (int offset = 0; offset < encoded.size(); ++offset) {
+        decoder.addInputData(encoded.mid(offset, 1)); // one byte each time
+        const auto &decoded = decoder.decode(4096);
+        if (!decoded.isEmpty() && firstDecodedOffset < 0)
+            firstDecodedOffset = offset;
+
+        decodedFrames += static_cast<int>(decoded.getFrameLenght());
+    }
+
+    QCOMPARE(decodedFrames, static_cast<int>(input.size() / 2));
+    QVERIFY(decoder.isFinished());
+
+    // header (12 bytes) + frame header (5 bytes) + 240 samples (120 bytes)
+    QCOMPARE(firstDecodedOffset, voicechat::HEADER_SIZE + 5 + 120 - 1);
+}
+
+void TestVoiceChatCodec::invalidStream()
+{
+    voicechat::Decoder decoder;
+    decoder.addInputData(QByteArray("OggS and some bytes"));
+
+    QVERIFY(decoder.decode(256).isEmpty());
+    QVERIFY(!decoder.isValid());
+}
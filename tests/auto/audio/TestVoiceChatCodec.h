@@ -0,0 +1,20 @@
+#ifndef TESTVOICECHATCODEC_H
+#define TESTVOICECHATCODEC_H
+
+#include <QObject>
+
+class TestVoiceChatCodec: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void roundTrip(); // encoding a sine in blocks, comparing the decoded samples with the downsampled sine
+    void roundTrip_data();
+
+    void aliasingRejection(); // frequencies above the half of the output sample rate are filtered before downsampling
+
+    void decodingIncompleteStream(); // every frame is decoded as soon as it is received
+    void invalidStream();
+};
+
+#endif // TESTVOICECHATCODEC_H
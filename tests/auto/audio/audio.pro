@@ -10,15 +10,48 @@ INCLUDEPATH += ../../../src/Common
 VPATH += ../../../src/Common
 
 HEADERS += TestSamplesBuffer.h
+HEADERS += TestSamplesKernels.h
 HEADERS += TestLooper.h
+HEADERS += TestScratchArena.h
+HEADERS += TestResampler.h
+HEADERS += TestVoiceChatCodec.h
+HEADERS += TestPeakPyramid.h
 HEADERS += audio/core/SamplesBuffer.h
+HEADERS += audio/core/SamplesBufferView.h
+HEADERS += audio/core/SamplesKernels.h
 HEADERS += audio/core/AudioPeak.h
+HEADERS += audio/core/ScratchArena.h
+HEADERS += audio/core/PeakPyramid.h
+HEADERS += audio/Resampler.h
+HEADERS += audio/SamplesBufferResampler.h
+HEADERS += audio/core/LatencyProbes.h
+HEADERS += audio/Encoder.h
+HEADERS += audio/Decoder.h
+HEADERS += audio/voicechat/VoiceChat.h
+HEADERS += audio/voicechat/VoiceChatEncoder.h
+HEADERS += audio/voicechat/VoiceChatDecoder.h
+HEADERS += midi/MidiMessage.h
 HEADERS += looper/Looper.h
 
 SOURCES += TestSamplesBuffer.cpp
+SOURCES += TestSamplesKernels.cpp
 SOURCES += TestLooper.cpp
+SOURCES += TestScratchArena.cpp
+SOURCES += TestResampler.cpp
+SOURCES += TestVoiceChatCodec.cpp
+SOURCES += TestPeakPyramid.cpp
 SOURCES += audio/core/SamplesBuffer.cpp
+SOURCES += audio/core/SamplesKernels.cpp
 SOURCES += audio/core/AudioPeak.cpp
+SOURCES += audio/core/ScratchArena.cpp
+SOURCES += audio/core/PeakPyramid.cpp
+SOURCES += audio/Resampler.cpp
+SOURCES += audio/SamplesBufferResampler.cpp
+SOURCES += audio/core/LatencyProbes.cpp
+SOURCES += audio/voicechat/VoiceChat.cpp
+SOURCES += audio/voicechat/VoiceChatEncoder.cpp
+SOURCES += audio/voicechat/VoiceChatDecoder.cpp
+SOURCES += midi/MidiMessage.cpp
 SOURCES += looper/Looper.cpp
 SOURCES += looper/LooperStates.cpp
 SOURCES += looper/LooperLayer.cpp
@@ -2,16 +2,36 @@
 
 #include <QtTest>
 #include "TestSamplesBuffer.h"
+#include "TestSamplesKernels.h"
 #include "TestLooper.h"
+#include "TestScratchArena.h"
+#include "TestResampler.h"
+#include "TestVoiceChatCodec.h"
+#include "TestPeakPyramid.h"
 
 int main(int argc, char *argv[])
 {
     TestSamplesBuffer testSamplesBuffer;
+    TestSamplesKernels testSamplesKernels;
     TestLooper testLooper;
+    TestScratchArena testScratchArena;
+    TestResampler testResampler;
+    TestVoiceChatCodec testVoiceChatCodec;
+    TestPeakPyramid testPeakPyramid;
 
     int result = QTest::qExec(&testSamplesBuffer, argc, argv);
 
+    result |= QTest::qExec(&testSamplesKernels, argc, argv);
+
     result |= QTest::qExec(&testLooper, argc, argv);
 
+    result |= QTest::qExec(&testScratchArena, argc, argv);
+
+    result |= QTest::qExec(&testResampler, argc, argv);
+
+    result |= QTest::qExec(&testVoiceChatCodec, argc, argv);
+
+    result |= QTest::qExec(&testPeakPyramid, argc, argv);
+
     return result;
 }
@@ -0,0 +1,120 @@
+#include "TestDownloadsGovernor.h"
+#include "ninjam/client/Service.h"
+#include "ninjam/client/ServerMessages.h"
+#include "ninjam/client/UserChannel.h"
+#include "ninjam/client/Types.h"
+#include <QTest>
+
+using namespace ninjam::client;
+
+namespace {
+
+/**
+ * The server messages are processed directly, the socket is never connected (the event loop is not running).
+ */
+
+class OfflineService : public Service
+{
+public:
+    using Service::process;
+
+    void connectInServer(quint16 bpm, quint16 bpi)
+    {
+        startServerConnection("127.0.0.1", 2049, "tester", QList<ChannelMetadata>());
+        process(AuthReplyMessage(1, "tester", 2));
+        process(ConfigChangeNotifyMessage(bpm, bpi));
+    }
+
+    void addUser(const QString &userFullName, int channels)
+    {
+        UserInfoChangeNotifyMessage msg;
+        for (int i = 0; i < channels; ++i)
+            msg.addUserChannel(userFullName, UserChannel(QString("channel %1").arg(i), i, 0, true));
+
+        process(msg);
+    }
+
+    void download(const QByteArray &GUID, const QString &userFullName, quint8 channelIndex, int bytes)
+    {
+        process(DownloadIntervalBegin(GUID, 0, "OGGv", channelIndex, userFullName));
+        process(DownloadIntervalWrite(GUID, 0, QByteArray(bytes, 'x')));
+    }
+
+protected:
+    QTcpSocket *createSocket() override
+    {
+        return new QTcpSocket(this);
+    }
+};
+
+const int MB = 1024 * 1024;
+
+} // namespace
+
+void TestDownloadsGovernor::limitScalesWithIntervalAndChannels()
+{
+    OfflineService service;
+    service.connectInServer(60, 32); // 32 seconds
+
+    QCOMPARE(service.getDownloadsBytesLimit(), Service::MIN_DOWNLOADS_BYTES); // nobody in the server
+
+    service.addUser("user1@ip", 2);
+    service.addUser("user2@ip", 4);
+
+    const qint64 intervalBytes = 32 * Service::CHANNEL_BYTES_PER_SECOND;
+    QCOMPARE(service.getDownloadsBytesLimit(), intervalBytes * 6 * Service::BUFFERED_INTERVALS_PER_CHANNEL);
+
+    service.setChannelMuted("user2@ip", 3, true); // muted channels are not downloaded
+    QCOMPARE(service.getDownloadsBytesLimit(), intervalBytes * 5 * Service::BUFFERED_INTERVALS_PER_CHANNEL);
+
+    service.process(ConfigChangeNotifyMessage(60, 64)); // longer intervals
+    QCOMPARE(service.getDownloadsBytesLimit(), 2 * intervalBytes * 5 * Service::BUFFERED_INTERVALS_PER_CHANNEL);
+}
+
+void TestDownloadsGovernor::dropOldestDownloads()
+{
+    OfflineService service;
+    service.connectInServer(120, 16); // 8 seconds, the minimum limit is used
+    service.addUser("user1@ip", 1);
+    service.addUser("user2@ip", 1);
+    QCOMPARE(service.getDownloadsBytesLimit(), Service::MIN_DOWNLOADS_BYTES);
+
+    service.download(QByteArray(16, 'a'), "user1@ip", 0, 3 * MB);
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(3 * MB));
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(0));
+
+    service.download(QByteArray(16, 'b'), "user2@ip", 0, 2 * MB);
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(2 * MB)); // the first download was dropped
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(1));
+
+    service.process(DownloadIntervalWrite(QByteArray(16, 'a'), 0, QByteArray(MB, 'x'))); // ignored
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(2 * MB));
+
+    service.process(DownloadIntervalWrite(QByteArray(16, 'b'), 1, QByteArray(MB, 'x'))); // completed
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(0));
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(1));
+}
+
+void TestDownloadsGovernor::countQueuedIntervals()
+{
+    OfflineService service;
+    service.connectInServer(120, 16);
+    service.addUser("user1@ip", 1);
+
+    qint64 queuedBytes = 3 * MB;
+    service.setQueuedIntervalsBytesCounter([&queuedBytes]() {
+        return queuedBytes;
+    });
+
+    service.download(QByteArray(16, 'a'), "user1@ip", 0, MB / 2);
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(0));
+
+    service.process(DownloadIntervalWrite(QByteArray(16, 'a'), 0, QByteArray(MB, 'x')));
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(0)); // 3.5 MB downloaded + 3 MB queued
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(1));
+
+    queuedBytes = 0;
+    service.download(QByteArray(16, 'b'), "user1@ip", 0, 3 * MB);
+    QCOMPARE(service.getBufferedDownloadsBytes(), static_cast<qint64>(3 * MB));
+    QCOMPARE(service.getDroppedDownloads(), static_cast<quint64>(1));
+}
@@ -0,0 +1,16 @@
+#ifndef TEST_DOWNLOADS_GOVERNOR_H
+#define TEST_DOWNLOADS_GOVERNOR_H
+
+#include <QObject>
+
+class TestDownloadsGovernor : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void limitScalesWithIntervalAndChannels();
+    void dropOldestDownloads();
+    void countQueuedIntervals(); // completed intervals waiting in the decoders
+};
+
+#endif
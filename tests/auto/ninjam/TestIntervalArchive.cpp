@@ -0,0 +1,125 @@
+#include "TestIntervalArchive.h"
+#include "ninjam/server/IntervalArchive.h"
+#include <QTest>
+
+using ninjam::server::IntervalArchive;
+
+void TestIntervalArchive::archiveInterval()
+{
+    IntervalArchive archive;
+    QByteArray GUID(16, 'a');
+
+    archive.beginInterval("user@ip", 0, GUID, "begin");
+    archive.appendToInterval("user@ip", 0, GUID, "write1", false);
+    archive.appendToInterval("user@ip", 0, GUID, "write2", true);
+
+    QCOMPARE(archive.getIntervalsCount(), 1);
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin" << "write1" << "write2");
+    QCOMPARE(archive.getMemoryUsage(), static_cast<qint64>(17));
+
+    archive.appendToInterval("user@ip", 0, GUID, "write3", false); // the interval is complete
+    QCOMPARE(archive.getMessages().size(), 3);
+}
+
+void TestIntervalArchive::replaceInterval()
+{
+    IntervalArchive archive;
+
+    archive.beginInterval("user@ip", 0, QByteArray(16, 'a'), "begin a");
+    archive.appendToInterval("user@ip", 0, QByteArray(16, 'a'), "write a", true);
+    archive.beginInterval("user@ip", 1, QByteArray(16, 'b'), "begin b");
+    archive.beginInterval("user@ip", 0, QByteArray(16, 'c'), "begin c");
+
+    QCOMPARE(archive.getIntervalsCount(), 2);
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin b" << "begin c");
+    QCOMPARE(archive.getMemoryUsage(), static_cast<qint64>(14));
+
+    archive.removeChannel("user@ip", 1);
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin c");
+}
+
+void TestIntervalArchive::ignoreUnknownInterval()
+{
+    IntervalArchive archive;
+
+    archive.appendToInterval("user@ip", 0, QByteArray(16, 'a'), "write", false); // begin not received
+    QCOMPARE(archive.getIntervalsCount(), 0);
+
+    archive.beginInterval("user@ip", 0, QByteArray(16, 'a'), "begin");
+    archive.appendToInterval("user@ip", 0, QByteArray(16, 'b'), "write", false); // other interval GUID
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin");
+}
+
+void TestIntervalArchive::removeUser()
+{
+    IntervalArchive archive;
+
+    archive.beginInterval("user1@ip", 0, QByteArray(16, 'a'), "begin a");
+    archive.beginInterval("user1@ip", 1, QByteArray(16, 'b'), "begin b");
+    archive.beginInterval("user2@ip", 0, QByteArray(16, 'c'), "begin c");
+
+    archive.removeUser("user1@ip");
+
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin c");
+    QCOMPARE(archive.getMemoryUsage(), static_cast<qint64>(7));
+}
+
+void TestIntervalArchive::evictOldestIntervals()
+{
+    IntervalArchive archive(20);
+
+    archive.beginInterval("user1@ip", 0, QByteArray(16, 'a'), "begin a"); // 7 bytes
+    archive.beginInterval("user2@ip", 0, QByteArray(16, 'b'), "begin b");
+    archive.appendToInterval("user1@ip", 0, QByteArray(16, 'a'), "write a", true); // 21 bytes, the oldest is discarded
+
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin b");
+    QVERIFY(archive.getMemoryUsage() <= archive.getMemoryLimit());
+
+    archive.setMemoryLimit(5);
+    QCOMPARE(archive.getIntervalsCount(), 0);
+    QCOMPARE(archive.getMemoryUsage(), static_cast<qint64>(0));
+}
+
+void TestIntervalArchive::evictReplacedIntervalsLast()
+{
+    IntervalArchive archive;
+
+    archive.beginInterval("user1@ip", 0, QByteArray(16, 'a'), "begin a");
+    archive.beginInterval("user2@ip", 0, QByteArray(16, 'b'), "begin b");
+    archive.beginInterval("user1@ip", 0, QByteArray(16, 'c'), "begin c"); // the newest interval
+
+    archive.setMemoryLimit(7);
+    QCOMPARE(archive.getMessages(), QList<QByteArray>() << "begin c");
+}
+
+void TestIntervalArchive::defaultLimitHoldsFullServer()
+{
+    IntervalArchive archive;
+
+    // 16 users with 2 channels, 128 kbps during 32 BPI at 90 BPM
+    const int intervalBytes = 128 * 1000 / 8 * 32 * 60 / 90;
+    const QByteArray part(16 * 1024, 'x');
+    for (int user = 0; user < 16; ++user) {
+        const QString userName = QString("user%1@ip").arg(user);
+        for (quint8 channel = 0; channel < 2; ++channel) {
+            const QByteArray GUID(16, static_cast<char>('a' + user * 2 + channel));
+            archive.beginInterval(userName, channel, GUID, "begin");
+            for (int bytes = 0; bytes < intervalBytes; bytes += part.size())
+                archive.appendToInterval(userName, channel, GUID, part, bytes + part.size() >= intervalBytes);
+        }
+    }
+
+    QCOMPARE(archive.getIntervalsCount(), 32);
+    QVERIFY(archive.getMemoryUsage() <= archive.getMemoryLimit());
+}
+
+void TestIntervalArchive::disabledArchive()
+{
+    IntervalArchive archive(0);
+
+    archive.beginInterval("user@ip", 0, QByteArray(16, 'a'), "begin");
+    archive.appendToInterval("user@ip", 0, QByteArray(16, 'a'), "write", true);
+
+    QCOMPARE(archive.getIntervalsCount(), 0);
+    QCOMPARE(archive.getMemoryUsage(), static_cast<qint64>(0));
+}
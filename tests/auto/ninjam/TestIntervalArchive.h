@@ -0,0 +1,21 @@
+#ifndef TEST_INTERVAL_ARCHIVE_H
+#define TEST_INTERVAL_ARCHIVE_H
+
+#include <QObject>
+
+class TestIntervalArchive : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void archiveInterval();
+    void replaceInterval();
+    void ignoreUnknownInterval();
+    void removeUser();
+    void evictOldestIntervals();
+    void evictReplacedIntervalsLast();
+    void defaultLimitHoldsFullServer();
+    void disabledArchive();
+};
+
+#endif
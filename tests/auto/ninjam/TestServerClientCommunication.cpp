@@ -13,6 +13,7 @@
 #include "ninjam/client/ClientMessages.h"
 #include "ninjam/client/ServerMessages.h"
 #include "ninjam/client/Service.h"
+#include "ninjam/client/Types.h"
 
 #include "ninjam/server/Server.h"
 
@@ -207,3 +208,61 @@ void TestServerClientCommunication::connectInNonEmptyServer()
     app.exec();
 }
 
+void TestServerClientCommunication::maskedChannelIsNotSent()
+{
+    int argc = 0;
+    char **argv = nullptr;
+
+    QCoreApplication app(argc, argv);
+
+    const quint16 serverPort = 2049;
+    Server server;
+    server.start(serverPort);
+
+    Service sender;
+    Service receiver;
+    int receivedIntervalParts = 0;
+    quint64 savedUploadBytes = 0;
+
+    connect(&receiver, &Service::disconnectedFromServer, &app, &QCoreApplication::quit);
+
+    connect(&sender, &Service::connectedInServer, [&](){
+        receiver.startServerConnection("localhost", serverPort, "receiver", QList<ChannelMetadata>());
+    });
+
+    // the mask is sent before the chat message, the sender uploads when the chat message is received
+    connect(&receiver, &Service::userChannelCreated, [&](const User &user, const UserChannel &channel){
+        receiver.setChannelMuted(user.getFullName(), channel.getIndex(), true);
+        receiver.sendPublicChatMessage("masked");
+    });
+
+    connect(&sender, &Service::publicChatMessageReceived, [&](const User &, const QString &msg){
+        if (msg == "masked") {
+            const QByteArray GUID(16, 'g');
+            sender.sendIntervalBegin(GUID, 0, true);
+            sender.sendIntervalPart(GUID, QByteArray(1024, 'x'), true);
+            sender.sendPublicChatMessage("uploaded"); // written after the audio messages
+        }
+    });
+
+    connect(&receiver, &Service::audioIntervalDownloading, [&](){
+        receivedIntervalParts++;
+    });
+
+    connect(&receiver, &Service::publicChatMessageReceived, [&](const User &, const QString &msg){
+        if (msg == "uploaded") {
+            savedUploadBytes = server.getSavedUploadBytes();
+            sender.disconnectFromServer(true);
+            receiver.disconnectFromServer(true);
+        }
+    });
+
+    ChannelMetadata channel;
+    channel.name = "channel";
+    sender.startServerConnection("localhost", serverPort, "sender", QList<ChannelMetadata>() << channel);
+
+    app.exec();
+
+    QCOMPARE(receivedIntervalParts, 0);
+    QVERIFY(savedUploadBytes > 1024); // interval begin and write messages
+}
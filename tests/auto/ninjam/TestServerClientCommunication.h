@@ -28,6 +28,8 @@ private slots:
 
     void connectInNonEmptyServer();
 
+    void maskedChannelIsNotSent();
+
 };
 
 #endif
@@ -1,7 +1,9 @@
 #include "TestServerMessagesHandler.h"
 #include "ninjam/client/ServerMessagesHandler.h"
 #include "ninjam/client/ServerMessages.h"
+#include "ninjam/MessageFramer.h"
 #include <QFile>
+#include <QBuffer>
 #include <QFileInfo>
 #include <QDir>
 
@@ -131,4 +133,42 @@ void TestServerMessagesHandler::handShakeMessages()
 
 }
 
+//-----------------------------------------------------------------------------------------------------------------
+
+void TestServerMessagesHandler::framedMessages()
+{
+    QFile wiresharkFile(":/wireshark data/ninbot 4 players connected.data");
+    QVERIFY2( wiresharkFile.open(QIODevice::ReadOnly), wiresharkFile.errorString().toStdString().c_str());
+    const QByteArray data = wiresharkFile.readAll();
+
+    // expected messages, parsed directly from the device
+    QBuffer buffer;
+    buffer.setData(data);
+    buffer.open(QIODevice::ReadOnly);
+
+    QList<MessageHeader> expectedHeaders;
+    QList<QByteArray> expectedPayloads;
+    while (buffer.bytesAvailable() >= 5) {
+        expectedHeaders.append(MessageHeader::from(&buffer));
+        expectedPayloads.append(buffer.read(expectedHeaders.last().getPayload()));
+    }
 
+    MessageFramer framer(64); // small ring, growing to receive the audio messages
+    MessageHeader header;
+    PayloadReader payload;
+    int messages = 0;
+    const int chunkSize = 7;
+    for (int offset = 0; offset < data.size(); offset += chunkSize) {
+        framer.append(data.constData() + offset, qMin(chunkSize, data.size() - offset));
+        while (framer.nextMessage(header, payload)) {
+            QVERIFY(messages < expectedHeaders.size());
+            QCOMPARE(header.getMessageType(), expectedHeaders.at(messages).getMessageType());
+            QCOMPARE(payload.viewBytes(payload.getSize()), expectedPayloads.at(messages));
+            messages++;
+        }
+    }
+
+    QVERIFY(!framer.hasError());
+    QCOMPARE(messages, expectedHeaders.size());
+    QCOMPARE(framer.getBufferedBytes(), 0u);
+}
@@ -11,6 +11,7 @@ class TestServerMessagesHandler : public QObject
 private slots:
     void handShakeMessages(); // test if ninjam server handshake messages are received and handled in the correct order
     void connectInFullServer(); // connect in a full server
+    void framedMessages(); // messages split in small chunks, crossing the framer ring buffer end
 };
 
 #endif // TESTSERVERMESSAGESHANDLER_H
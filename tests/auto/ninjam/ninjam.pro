@@ -13,6 +13,8 @@ VPATH += ../../../src/Common
 HEADERS += TestMessagesSerialization.h
 HEADERS += TestServerMessagesHandler.h
 HEADERS += TestServerClientCommunication.h
+HEADERS += TestIntervalArchive.h
+HEADERS += TestDownloadsGovernor.h
 
 HEADERS += log/logging.h
 HEADERS += TestServerInfo.h
@@ -20,24 +22,34 @@ HEADERS += ninjam/client/ServerInfo.h
 HEADERS += ninjam/client/User.h
 HEADERS += ninjam/client/UserChannel.h
 HEADERS += ninjam/client/Service.h
+HEADERS += ninjam/client/UploadScheduler.h
 HEADERS += ninjam/Ninjam.h
+HEADERS += ninjam/MessageFramer.h
 HEADERS += ninjam/server/Server.h
+HEADERS += ninjam/server/ClientConnection.h
+HEADERS += ninjam/server/IntervalArchive.h
 
 SOURCES += log/logging.cpp
 SOURCES += ninjam/Ninjam.cpp
+SOURCES += ninjam/MessageFramer.cpp
 SOURCES += TestServerInfo.cpp
 SOURCES += ninjam/client/ServerInfo.cpp
 SOURCES += ninjam/client/User.cpp
 SOURCES += ninjam/client/UserChannel.cpp
 SOURCES += ninjam/client/Service.cpp
+SOURCES += ninjam/client/UploadScheduler.cpp
 SOURCES += ninjam/client/ServerMessages.cpp
 SOURCES += ninjam/client/ServerMessagesHandler.cpp
 SOURCES += ninjam/client/ClientMessages.cpp
 SOURCES += ninjam/server/Server.cpp
+SOURCES += ninjam/server/ClientConnection.cpp
+SOURCES += ninjam/server/IntervalArchive.cpp
 
 SOURCES += TestServerMessagesHandler.cpp
 SOURCES += TestMessagesSerialization.cpp
 SOURCES += TestServerClientCommunication.cpp
+SOURCES += TestIntervalArchive.cpp
+SOURCES += TestDownloadsGovernor.cpp
 
 SOURCES += test_Ninjam.cpp
 
@@ -3,18 +3,24 @@
 #include "TestMessagesSerialization.h"
 #include "TestServerMessagesHandler.h"
 #include "TestServerClientCommunication.h"
+#include "TestIntervalArchive.h"
+#include "TestDownloadsGovernor.h"
 
 int main(int argc, char *argv[])
 {
     TestMessagesSerialization testServerMessages;
     TestServerInfo testServer;
     TestServerMessagesHandler testServerMessagesHandler;
+    TestIntervalArchive testIntervalArchive;
+    TestDownloadsGovernor testDownloadsGovernor;
     //TestServerClientCommunication testServerClientCommunication;
 
     int testResults = 0;
     testResults |= QTest::qExec(&testServerMessages, argc, argv);
     testResults |= QTest::qExec(&testServer, argc, argv);
     testResults |= QTest::qExec(&testServerMessagesHandler, argc, argv);
+    testResults |= QTest::qExec(&testIntervalArchive, argc, argv);
+    testResults |= QTest::qExec(&testDownloadsGovernor, argc, argv);
     //testResults |= QTest::qExec(&testServerClientCommunication, argc, argv);
     return testResults;
 }
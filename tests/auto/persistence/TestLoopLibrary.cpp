@@ -0,0 +1,163 @@
+#include "TestLoopLibrary.h"
+#include "looper/LoopLibrary.h"
+
+#include <QtTest/QtTest>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+using audio::LoopLibrary;
+using audio::LoopInfo;
+
+void TestLoopLibrary::init()
+{
+    loopsDir.reset(new QTemporaryDir());
+}
+
+void TestLoopLibrary::cleanup()
+{
+    loopsDir.reset();
+}
+
+void TestLoopLibrary::createLoopFile(const QString &name, int bpm, int bpi, int layers, const QVector<float> &peaks)
+{
+    QJsonObject root;
+    root["bpm"] = bpm;
+    root["bpi"] = bpi;
+    root["audioFormat"] = "ogg";
+
+    QJsonArray layersArray;
+    for (int l = 0; l < layers; ++l) {
+        QJsonObject layer;
+        layer["locked"] = l == 0;
+        layer["gain"] = 1.0;
+        layer["pan"] = 0.0;
+
+        QJsonArray peaksArray;
+        for (float peak : peaks)
+            peaksArray.append(peak);
+        layer["peaks"] = peaksArray;
+
+        layersArray.append(layer);
+    }
+    root["layers"] = layersArray;
+
+    QFile file(QDir(loopsDir->path()).absoluteFilePath(name + ".json"));
+    QVERIFY(file.open(QFile::WriteOnly));
+    file.write(QJsonDocument(root).toJson());
+}
+
+void TestLoopLibrary::loopsAreGroupedByBpm()
+{
+    createLoopFile("b", 120, 16, 2);
+    createLoopFile("a", 120, 32, 1);
+    createLoopFile("c", 90, 16, 4);
+
+    LoopLibrary library(loopsDir->path());
+
+    QCOMPARE(library.getLoopsCount(), 3);
+
+    const QList<LoopInfo> loops = library.getLoops(120);
+    QCOMPARE(loops.size(), 2);
+    QCOMPARE(loops.at(0).getName(), QString("a")); // sorted by name
+    QCOMPARE(loops.at(0).getBpi(), static_cast<quint16>(32));
+    QCOMPARE(loops.at(1).getName(), QString("b"));
+    QCOMPARE(loops.at(1).getLayersCount(), static_cast<quint8>(2));
+
+    QCOMPARE(library.getLoops(90).size(), 1);
+    QVERIFY(library.getLoops(100).isEmpty());
+}
+
+void TestLoopLibrary::bpmRange()
+{
+    createLoopFile("fast", 140, 16, 1);
+    createLoopFile("medium", 120, 16, 1);
+    createLoopFile("slow", 80, 16, 1);
+
+    LoopLibrary library(loopsDir->path());
+
+    const QList<LoopInfo> loops = library.getLoops(100, 400);
+    QCOMPARE(loops.size(), 2);
+    QCOMPARE(loops.at(0).getName(), QString("medium")); // lower BPMs first
+    QCOMPARE(loops.at(1).getName(), QString("fast"));
+
+    QCOMPARE(library.getLoops(0, 1000).size(), 3);
+}
+
+void TestLoopLibrary::invalidLoopsAreNotListed()
+{
+    createLoopFile("valid", 120, 16, 1);
+    createLoopFile("noLayers", 120, 16, 0);
+
+    QFile broken(QDir(loopsDir->path()).absoluteFilePath("broken.json"));
+    QVERIFY(broken.open(QFile::WriteOnly));
+    broken.write("{ not json");
+    broken.close();
+
+    LoopLibrary library(loopsDir->path());
+
+    QCOMPARE(library.getLoopsCount(), 1);
+    QCOMPARE(library.getLoops(120).first().getName(), QString("valid"));
+}
+
+void TestLoopLibrary::indexIsSavedWithThumbnails()
+{
+    const QVector<float> peaks = { 0.25f, 0.5f, 1.0f };
+    createLoopFile("loop", 120, 16, 2, peaks);
+
+    {
+        LoopLibrary library(loopsDir->path());
+        QCOMPARE(library.getLoopsCount(), 1);
+    }
+
+    QVERIFY(QFile::exists(QDir(loopsDir->path()).absoluteFilePath(LoopLibrary::INDEX_FILE_NAME)));
+
+    LoopLibrary library(loopsDir->path()); // using the index
+    const LoopInfo loop = library.getLoops(120).first();
+    QCOMPARE(loop.getLayersCount(), static_cast<quint8>(2));
+    QVERIFY(loop.getLayersInfo().first().locked);
+    QCOMPARE(loop.getThumbnailPeaks(), peaks);
+}
+
+void TestLoopLibrary::changedAndDeletedLoopsAreUpdated()
+{
+    createLoopFile("changed", 120, 16, 1);
+    createLoopFile("deleted", 120, 16, 1);
+
+    LoopLibrary library(loopsDir->path());
+    QCOMPARE(library.getLoops(120).size(), 2);
+
+    QSignalSpy spy(&library, SIGNAL(loopsChanged()));
+
+    createLoopFile("changed", 90, 16, 3); // different size, parsed again
+    QVERIFY(QFile::remove(QDir(loopsDir->path()).absoluteFilePath("deleted.json")));
+    createLoopFile("new", 120, 16, 1);
+
+    library.update();
+
+    QCOMPARE(spy.count(), 1);
+    QCOMPARE(library.getLoops(120).size(), 1);
+    QCOMPARE(library.getLoops(120).first().getName(), QString("new"));
+    QCOMPARE(library.getLoops(90).first().getLayersCount(), static_cast<quint8>(3));
+
+    library.update(); // nothing changed
+    QCOMPARE(spy.count(), 1);
+
+    LoopLibrary reloaded(loopsDir->path());
+    QCOMPARE(reloaded.getLoopsCount(), 2);
+}
+
+void TestLoopLibrary::corruptedIndexIsDiscarded()
+{
+    createLoopFile("loop", 120, 16, 1);
+
+    QFile index(QDir(loopsDir->path()).absoluteFilePath(LoopLibrary::INDEX_FILE_NAME));
+    QVERIFY(index.open(QFile::WriteOnly));
+    index.write("JTLI garbage");
+    index.close();
+
+    LoopLibrary library(loopsDir->path());
+    QCOMPARE(library.getLoopsCount(), 1);
+}
@@ -0,0 +1,30 @@
+#ifndef TESTLOOPLIBRARY_H
+#define TESTLOOPLIBRARY_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+#include <QVector>
+
+class TestLoopLibrary: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void loopsAreGroupedByBpm();
+    void bpmRange();
+    void invalidLoopsAreNotListed();
+    void indexIsSavedWithThumbnails();
+    void changedAndDeletedLoopsAreUpdated();
+    void corruptedIndexIsDiscarded();
+
+private:
+    void createLoopFile(const QString &name, int bpm, int bpi, int layers, const QVector<float> &peaks = QVector<float>());
+
+    QScopedPointer<QTemporaryDir> loopsDir;
+};
+
+#endif // TESTLOOPLIBRARY_H
@@ -0,0 +1,172 @@
+#include "TestLoopPersistence.h"
+#include "looper/Looper.h"
+#include "looper/LooperPersistence.h"
+#include "audio/core/SamplesBuffer.h"
+
+#include <QtTest/QtTest>
+#include <QSignalSpy>
+#include <QDir>
+#include <QFile>
+
+using audio::Looper;
+using audio::LoopSaver;
+using audio::LoopLoader;
+using audio::LoopInfo;
+using audio::SamplesBuffer;
+
+namespace {
+
+const uint FRAMES = 40000; // saved in 3 chunks
+const uint SAMPLE_RATE = 44100;
+
+SamplesBuffer createLayer(float value)
+{
+    SamplesBuffer samples(2, FRAMES);
+    for (uint i = 0; i < FRAMES; ++i) {
+        samples.set(0, i, value);
+        samples.set(1, i, -value);
+    }
+    return samples;
+}
+
+QByteArray readFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly))
+        return QByteArray();
+
+    return file.readAll();
+}
+
+QList<int> getProgress(const QSignalSpy &progressSpy)
+{
+    QList<int> progress;
+    for (const auto &arguments : progressSpy)
+        progress << arguments.first().toInt();
+    return progress;
+}
+
+} // namespace
+
+void TestLoopPersistence::init()
+{
+    loopsDir.reset(new QTemporaryDir());
+}
+
+void TestLoopPersistence::cleanup()
+{
+    loopsDir.reset();
+}
+
+bool TestLoopPersistence::saveLoop(const QString &loopName, float firstLayerValue, bool cancel, QList<int> *progress)
+{
+    Looper looper(Looper::AllLayers, 2);
+    looper.reserve(FRAMES);
+    looper.startNewCycle(FRAMES);
+    looper.setLayerSamples(0, createLayer(firstLayerValue));
+    looper.setLayerSamples(1, createLayer(firstLayerValue / 2));
+
+    LoopSaver saver(loopsDir->path(), &looper);
+    QSignalSpy progressSpy(&saver, &LoopSaver::progressChanged);
+    QSignalSpy finishedSpy(&saver, &LoopSaver::finished);
+
+    saver.save(loopName, 120, 16, false, 0, SAMPLE_RATE, 32);
+    if (cancel)
+        saver.cancel();
+
+    if (finishedSpy.isEmpty() && !finishedSpy.wait())
+        return false;
+
+    if (progress)
+        *progress = getProgress(progressSpy);
+
+    return finishedSpy.first().first().toBool();
+}
+
+QStringList TestLoopPersistence::getLoopFiles(const QString &loopName) const
+{
+    return QDir(QDir(loopsDir->path()).absoluteFilePath(loopName)).entryList(QDir::Files, QDir::Name);
+}
+
+void TestLoopPersistence::saveReportsProgress()
+{
+    QList<int> progress;
+    QVERIFY(saveLoop("loop", 0.5f, false, &progress));
+
+    QVERIFY(!progress.isEmpty());
+    QCOMPARE(progress.last(), 100);
+    for (int i = 1; i < progress.size(); ++i)
+        QVERIFY(progress.at(i) >= progress.at(i - 1));
+
+    QVERIFY(QFile::exists(QDir(loopsDir->path()).absoluteFilePath("loop.json")));
+    QCOMPARE(getLoopFiles("loop"), QStringList() << "layer_0.wav" << "layer_1.wav"); // no temporary files
+}
+
+void TestLoopPersistence::canceledSaveKeepsPreviousFiles()
+{
+    QVERIFY(saveLoop("loop", 0.5f, false));
+
+    const QDir loopDir(QDir(loopsDir->path()).absoluteFilePath("loop"));
+    const QByteArray json = readFile(QDir(loopsDir->path()).absoluteFilePath("loop.json"));
+    const QByteArray firstLayer = readFile(loopDir.absoluteFilePath("layer_0.wav"));
+    const QByteArray secondLayer = readFile(loopDir.absoluteFilePath("layer_1.wav"));
+
+    QVERIFY(!saveLoop("loop", 0.25f, true));
+
+    QCOMPARE(readFile(QDir(loopsDir->path()).absoluteFilePath("loop.json")), json);
+    QCOMPARE(readFile(loopDir.absoluteFilePath("layer_0.wav")), firstLayer);
+    QCOMPARE(readFile(loopDir.absoluteFilePath("layer_1.wav")), secondLayer);
+    QCOMPARE(getLoopFiles("loop"), QStringList() << "layer_0.wav" << "layer_1.wav"); // temporary files are discarded
+
+    QVERIFY(!saveLoop("canceled", 0.5f, true)); // a new loop is not listed
+    QVERIFY(!QFile::exists(QDir(loopsDir->path()).absoluteFilePath("canceled.json")));
+    QVERIFY(getLoopFiles("canceled").isEmpty());
+}
+
+void TestLoopPersistence::loadReportsProgress()
+{
+    QVERIFY(saveLoop("loop", 0.5f, false));
+
+    LoopInfo loopInfo = LoopLoader::loadLoopInfo(QDir(loopsDir->path()).absoluteFilePath("loop.json"));
+    QVERIFY(loopInfo.isValid());
+    QCOMPARE(loopInfo.getLayersCount(), quint8(2));
+
+    Looper looper(Looper::AllLayers, 2);
+    LoopLoader loader(loopsDir->path());
+    QSignalSpy progressSpy(&loader, &LoopLoader::progressChanged);
+    QSignalSpy finishedSpy(&loader, &LoopLoader::finished);
+
+    loader.load(loopInfo, &looper, SAMPLE_RATE, FRAMES);
+    QVERIFY(finishedSpy.wait());
+    QCOMPARE(finishedSpy.first().first().toBool(), true);
+
+    const QList<int> progress = getProgress(progressSpy);
+    QVERIFY(!progress.isEmpty());
+    QCOMPARE(progress.last(), 100);
+
+    const QList<SamplesBuffer> layers = looper.getLayersSamples();
+    QCOMPARE(layers.size(), 2);
+    QCOMPARE(layers.at(0).getFrameLenght(), FRAMES);
+    QCOMPARE(layers.at(0).get(0, FRAMES - 1), 0.5f);
+    QCOMPARE(layers.at(0).get(1, FRAMES - 1), -0.5f);
+    QCOMPARE(layers.at(1).get(0, 0), 0.25f);
+}
+
+void TestLoopPersistence::canceledLoad()
+{
+    QVERIFY(saveLoop("loop", 0.5f, false));
+
+    LoopInfo loopInfo = LoopLoader::loadLoopInfo(QDir(loopsDir->path()).absoluteFilePath("loop.json"));
+    QVERIFY(loopInfo.isValid());
+
+    Looper looper(Looper::AllLayers, 2);
+    LoopLoader loader(loopsDir->path());
+    QSignalSpy finishedSpy(&loader, &LoopLoader::finished);
+
+    loader.load(loopInfo, &looper, SAMPLE_RATE, FRAMES);
+    loader.cancel();
+
+    QVERIFY(finishedSpy.wait());
+    QCOMPARE(finishedSpy.first().first().toBool(), false);
+    QVERIFY(!loader.isRunning());
+}
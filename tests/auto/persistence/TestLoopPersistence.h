@@ -0,0 +1,29 @@
+#ifndef TESTLOOPPERSISTENCE_H
+#define TESTLOOPPERSISTENCE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+#include <QStringList>
+
+class TestLoopPersistence: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void saveReportsProgress();
+    void canceledSaveKeepsPreviousFiles();
+    void loadReportsProgress();
+    void canceledLoad();
+
+private:
+    bool saveLoop(const QString &loopName, float firstLayerValue, bool cancel, QList<int> *progress = nullptr);
+    QStringList getLoopFiles(const QString &loopName) const;
+
+    QScopedPointer<QTemporaryDir> loopsDir;
+};
+
+#endif // TESTLOOPPERSISTENCE_H
@@ -0,0 +1,135 @@
+#include "TestResampledAudioCache.h"
+#include "persistence/ResampledAudioCache.h"
+#include "file/WaveFileWriter.h"
+#include "audio/core/SamplesBuffer.h"
+
+#include <QtTest/QtTest>
+#include <QDir>
+
+#include <cmath>
+
+using persistence::ResampledAudioCache;
+using audio::SamplesBuffer;
+
+void TestResampledAudioCache::init()
+{
+    filesDir.reset(new QTemporaryDir());
+    cacheDir.reset(new QTemporaryDir());
+
+    auto &cache = ResampledAudioCache::getInstance();
+    cache.setCacheDir(QDir(cacheDir->path()));
+    cache.setMemoryLimit(ResampledAudioCache::DEFAULT_MEMORY_LIMIT);
+    cache.setDiskLimit(ResampledAudioCache::DEFAULT_DISK_LIMIT);
+    cache.clear();
+}
+
+void TestResampledAudioCache::cleanup()
+{
+    ResampledAudioCache::getInstance().clear();
+    cacheDir.reset();
+    filesDir.reset();
+}
+
+QString TestResampledAudioCache::createWaveFile(const QString &name, uint frames, quint32 sampleRate, uint channels, float frequency)
+{
+    SamplesBuffer buffer(channels, frames);
+    for (uint c = 0; c < channels; ++c) {
+        for (uint i = 0; i < frames; ++i)
+            buffer.set(c, i, 0.5f * static_cast<float>(std::sin(2.0 * M_PI * frequency * i / sampleRate)));
+    }
+
+    const QString filePath = QDir(filesDir->path()).absoluteFilePath(name);
+    audio::WaveFileWriter().write(filePath, buffer, sampleRate, 32);
+
+    return filePath;
+}
+
+int TestResampledAudioCache::diskEntries() const
+{
+    return QDir(cacheDir->path()).entryList(QStringList("*.pcm"), QDir::Files).size();
+}
+
+void TestResampledAudioCache::resampleToLocalSampleRate()
+{
+    const QString filePath = createWaveFile("click.wav", 4410, 44100);
+
+    SamplesBuffer samples(2);
+    QVERIFY(ResampledAudioCache::getInstance().load(filePath, 48000, samples));
+
+    QCOMPARE(samples.getFrameLenght(), 4800u);
+    QVERIFY(samples.isMono());
+    QCOMPARE(diskEntries(), 1);
+
+    // same rate, samples are just copied
+    SamplesBuffer original(2);
+    QVERIFY(ResampledAudioCache::getInstance().load(filePath, 44100, original));
+    QCOMPARE(original.getFrameLenght(), 4410u);
+    QCOMPARE(diskEntries(), 2);
+}
+
+void TestResampledAudioCache::maxFramesAreInFileSampleRate()
+{
+    const QString filePath = createWaveFile("layer.wav", 44100, 44100, 2);
+
+    SamplesBuffer samples(2, 22050);
+    QVERIFY(ResampledAudioCache::getInstance().load(filePath, 48000, samples));
+
+    QCOMPARE(samples.getFrameLenght(), 24000u);
+    QCOMPARE(samples.getChannels(), 2u);
+}
+
+void TestResampledAudioCache::diskEntriesAreReused()
+{
+    auto &cache = ResampledAudioCache::getInstance();
+    const QString filePath = createWaveFile("click.wav", 4410, 44100);
+
+    SamplesBuffer decoded(2);
+    QVERIFY(cache.load(filePath, 48000, decoded));
+
+    cache.setMemoryLimit(0); // discard memory entries, the next load is reading the disk entry
+
+    SamplesBuffer cached(2);
+    QVERIFY(cache.load(filePath, 48000, cached));
+
+    QCOMPARE(diskEntries(), 1);
+    QCOMPARE(cached.getFrameLenght(), decoded.getFrameLenght());
+    for (uint i = 0; i < decoded.getFrameLenght(); ++i)
+        QCOMPARE(cached.get(0, i), decoded.get(0, i));
+}
+
+void TestResampledAudioCache::changedFilesAreNotReused()
+{
+    auto &cache = ResampledAudioCache::getInstance();
+
+    const QString filePath = createWaveFile("click.wav", 4410, 44100);
+    SamplesBuffer first(2);
+    QVERIFY(cache.load(filePath, 48000, first));
+
+    createWaveFile("click.wav", 8820, 44100); // different size, the content hash is computed again
+    SamplesBuffer second(2);
+    QVERIFY(cache.load(filePath, 48000, second));
+
+    QCOMPARE(second.getFrameLenght(), 9600u);
+    QCOMPARE(diskEntries(), 2);
+}
+
+void TestResampledAudioCache::diskLimitEvictsOldestEntries()
+{
+    auto &cache = ResampledAudioCache::getInstance();
+    cache.setDiskLimit(100 * 1024); // only one entry (9600 frames, 2 channels) fits
+
+    const QDir dir(cacheDir->path());
+
+    SamplesBuffer samples(2);
+    QVERIFY(cache.load(createWaveFile("a.wav", 4410 * 2, 44100, 2, 440), 48000, samples));
+    const QStringList firstEntries = dir.entryList(QStringList("*.pcm"), QDir::Files);
+    QCOMPARE(firstEntries.size(), 1);
+
+    QTest::qWait(1100); // file modification times with 1 second resolution in some file systems
+
+    samples.setFrameLenght(0);
+    QVERIFY(cache.load(createWaveFile("b.wav", 4410 * 2, 44100, 2, 880), 48000, samples));
+    const QStringList secondEntries = dir.entryList(QStringList("*.pcm"), QDir::Files);
+    QCOMPARE(secondEntries.size(), 1);
+    QVERIFY(secondEntries.first() != firstEntries.first()); // the oldest entry was evicted
+}
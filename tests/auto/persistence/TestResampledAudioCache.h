@@ -0,0 +1,30 @@
+#ifndef TESTRESAMPLEDAUDIOCACHE_H
+#define TESTRESAMPLEDAUDIOCACHE_H
+
+#include <QObject>
+#include <QTemporaryDir>
+#include <QScopedPointer>
+
+class TestResampledAudioCache: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void init();
+    void cleanup();
+
+    void resampleToLocalSampleRate();
+    void maxFramesAreInFileSampleRate();
+    void diskEntriesAreReused();
+    void changedFilesAreNotReused();
+    void diskLimitEvictsOldestEntries();
+
+private:
+    QString createWaveFile(const QString &name, uint frames, quint32 sampleRate, uint channels = 1, float frequency = 440);
+    int diskEntries() const;
+
+    QScopedPointer<QTemporaryDir> filesDir;
+    QScopedPointer<QTemporaryDir> cacheDir;
+};
+
+#endif // TESTRESAMPLEDAUDIOCACHE_H
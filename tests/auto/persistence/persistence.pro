@@ -1,19 +1,89 @@
 
 QT += testlib
 QT -= gui
+QT += concurrent
 CONFIG += testcase
+CONFIG += c++11
 TEMPLATE = app
 TARGET = persistence
 INCLUDEPATH += .
 INCLUDEPATH += ../../../src/Common
+INCLUDEPATH += ../../../libs/includes/ogg
+INCLUDEPATH += ../../../libs/includes/vorbis
+INCLUDEPATH += ../../../libs/includes/minimp3
 VPATH += ../../../src/Common
 
+win32 {
+    !contains(QMAKE_TARGET.arch, x86_64) {
+        LIBS_PATH = "static/win32-msvc"
+    } else {
+        LIBS_PATH = "static/win64-msvc"
+    }
+}
+macx:LIBS_PATH = "static/mac64"
+linux {
+    contains(QMAKE_HOST.arch, x86_64) {
+        LIBS_PATH = "static/linux64"
+    } else {
+        LIBS_PATH = "static/linux32"
+    }
+}
+
+# audio files cache is using the file readers
+LIBS += -L$$PWD/../../../libs/$$LIBS_PATH -lminimp3 -lvorbisfile -lvorbisenc -lvorbis -logg
+
 # Input
 HEADERS += log/logging.h
 HEADERS += persistence/UsersDataCache.h
 HEADERS += persistence/CacheHeader.h
+HEADERS += persistence/ResampledAudioCache.h
+HEADERS += audio/core/SamplesBuffer.h
+HEADERS += audio/core/SamplesKernels.h
+HEADERS += audio/core/AudioPeak.h
+HEADERS += audio/core/PeakPyramid.h
+HEADERS += audio/Resampler.h
+HEADERS += audio/Mp3Decoder.h
+HEADERS += audio/vorbis/VorbisDecoder.h
+HEADERS += audio/vorbis/VorbisEncoder.h
+HEADERS += file/FileReader.h
+HEADERS += file/FileReaderFactory.h
+HEADERS += file/WaveFileReader.h
+HEADERS += file/WaveFileWriter.h
+HEADERS += file/OggFileReader.h
+HEADERS += file/Mp3FileReader.h
+HEADERS += looper/LoopInfo.h
+HEADERS += looper/LoopLibrary.h
+HEADERS += looper/Looper.h
+HEADERS += looper/LooperLayer.h
+HEADERS += looper/LooperPersistence.h
+HEADERS += TestResampledAudioCache.h
+HEADERS += TestLoopLibrary.h
+HEADERS += TestLoopPersistence.h
 
 SOURCES += log/logging.cpp
 SOURCES += persistence/UsersDataCache.cpp
 SOURCES += persistence/CacheHeader.cpp
+SOURCES += persistence/ResampledAudioCache.cpp
+SOURCES += audio/core/SamplesBuffer.cpp
+SOURCES += audio/core/SamplesKernels.cpp
+SOURCES += audio/core/AudioPeak.cpp
+SOURCES += audio/core/PeakPyramid.cpp
+SOURCES += audio/Resampler.cpp
+SOURCES += audio/Mp3Decoder.cpp
+SOURCES += audio/vorbis/VorbisDecoder.cpp
+SOURCES += audio/vorbis/VorbisEncoder.cpp
+SOURCES += file/FileReaderFactory.cpp
+SOURCES += file/WaveFileReader.cpp
+SOURCES += file/WaveFileWriter.cpp
+SOURCES += file/OggFileReader.cpp
+SOURCES += file/Mp3FileReader.cpp
+SOURCES += looper/LoopInfo.cpp
+SOURCES += looper/LoopLibrary.cpp
+SOURCES += looper/Looper.cpp
+SOURCES += looper/LooperStates.cpp
+SOURCES += looper/LooperLayer.cpp
+SOURCES += looper/LooperPersistence.cpp
+SOURCES += TestResampledAudioCache.cpp
+SOURCES += TestLoopLibrary.cpp
+SOURCES += TestLoopPersistence.cpp
 SOURCES += tst_UsersDataCache.cpp
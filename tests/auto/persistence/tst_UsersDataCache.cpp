@@ -4,6 +4,9 @@
 #include <QtTest/QtTest>
 #include "persistence/UsersDataCache.h"
 #include "persistence/CacheHeader.h"
+#include "TestResampledAudioCache.h"
+#include "TestLoopLibrary.h"
+#include "TestLoopPersistence.h"
 
 using namespace persistence;
 
@@ -182,6 +185,7 @@ void TestCacheEntry::setPanGuard()
 
 int main(int argc, char *argv[])
 {
+    QCoreApplication app(argc, argv); // loops are saved and loaded in the thread pool
     int status = 0;
 
     {
@@ -199,6 +203,21 @@ int main(int argc, char *argv[])
         status |= QTest::qExec(&test, argc, argv);
     }
 
+    {
+        TestResampledAudioCache test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+
+    {
+        TestLoopLibrary test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+
+    {
+        TestLoopPersistence test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+
     return status;
 }
 
@@ -0,0 +1,17 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase c++11
+TEMPLATE = app
+TARGET = testRecorder
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+VPATH += ../../../src/Common
+
+HEADERS += log/logging.h
+HEADERS += recorder/RecordingWriter.h
+HEADERS += recorder/JamRecorder.h
+
+SOURCES += log/logging.cpp
+SOURCES += recorder/RecordingWriter.cpp
+SOURCES += recorder/JamRecorder.cpp
+SOURCES += test_Recorder.cpp
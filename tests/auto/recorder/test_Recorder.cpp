@@ -0,0 +1,262 @@
+#include <QObject>
+#include <QString>
+#include <QtTest/QtTest>
+#include <QTemporaryDir>
+#include "recorder/RecordingWriter.h"
+#include "recorder/JamRecorder.h"
+
+using recorder::RecordingWriter;
+using recorder::JamRecorder;
+using recorder::JamTrack;
+using recorder::JamAudioFile;
+
+namespace {
+
+// captures the project metadata instead of writing a project file
+class FakeMetadataWriter : public recorder::JamMetadataWriter
+{
+public:
+    explicit FakeMetadataWriter(QList<JamTrack> *writtenTracks) :
+        writtenTracks(writtenTracks)
+    {
+
+    }
+
+    void write(const recorder::Jam &jam) override
+    {
+        *writtenTracks = jam.getJamTracks();
+    }
+
+    QString getWriterId() const override { return "Fake"; }
+    QString getWriterName() const override { return "Fake"; }
+
+    void setJamDir(const QString &newJamName, const QString &recordBasePath) override
+    {
+        jamDir = QDir(recordBasePath).absoluteFilePath(newJamName);
+        QDir().mkpath(jamDir);
+    }
+
+    QString getAudioAbsolutePath(const QString &audioFileName) override
+    {
+        return QDir(jamDir).absoluteFilePath(audioFileName);
+    }
+
+    QString getVideoAbsolutePath(const QString &videoFileName) override
+    {
+        Q_UNUSED(videoFileName);
+        return QString(); // videos are not saved
+    }
+
+    bool canUseSingleFilePerTrack() const override { return true; }
+
+private:
+    QList<JamTrack> *writtenTracks;
+    QString jamDir;
+};
+
+QByteArray oggStream(const QString &name) // the recorder only checks the ogg capture pattern
+{
+    return QByteArray("OggS") + name.toUtf8();
+}
+
+QByteArray readFile(const QString &filePath)
+{
+    QFile file(filePath);
+    if (!file.open(QFile::ReadOnly))
+        return QByteArray();
+
+    return file.readAll();
+}
+
+} // namespace
+
+class TestRecorder: public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void writerAppendChunks();
+    void writerReopenEvictedFiles();
+    void writerSpillsWhenQueueIsFull();
+    void singleFileRemoteOffsets();
+    void singleFileLocalOffsets();
+};
+
+void TestRecorder::writerAppendChunks()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QString filePath = QDir(dir.path()).absoluteFilePath("track.ogg");
+    QFile oldFile(filePath);
+    QVERIFY(oldFile.open(QFile::WriteOnly));
+    oldFile.write("old content");
+    oldFile.close();
+
+    auto &writer = RecordingWriter::getInstance();
+    writer.append(filePath, QByteArray("first "));
+    writer.append(filePath, QByteArray("second"));
+    writer.close(filePath);
+    writer.waitForPendingWrites();
+
+    QCOMPARE(readFile(filePath), QByteArray("first second")); // truncated in the first append
+
+    writer.append(filePath, QByteArray("new file"));
+    writer.close(filePath);
+    writer.waitForPendingWrites();
+
+    QCOMPARE(readFile(filePath), QByteArray("new file")); // truncated again after closing
+}
+
+void TestRecorder::writerReopenEvictedFiles()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    auto &writer = RecordingWriter::getInstance();
+
+    const int files = RecordingWriter::MAX_OPEN_FILES + 8;
+    for (int chunk = 0; chunk < 2; ++chunk) {
+        for (int f = 0; f < files; ++f)
+            writer.append(QDir(dir.path()).absoluteFilePath(QString::number(f)), QByteArray::number(chunk));
+    }
+
+    for (int f = 0; f < files; ++f)
+        writer.close(QDir(dir.path()).absoluteFilePath(QString::number(f)));
+
+    writer.waitForPendingWrites();
+
+    for (int f = 0; f < files; ++f)
+        QCOMPARE(readFile(QDir(dir.path()).absoluteFilePath(QString::number(f))), QByteArray("01")); // evicted files are reopened in append mode
+}
+
+void TestRecorder::writerSpillsWhenQueueIsFull()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    auto &writer = RecordingWriter::getInstance();
+    const qint64 maxQueuedBytes = writer.getMaxQueuedBytes();
+    const quint64 spilledBytes = writer.getSpilledBytes();
+    const quint64 droppedBytes = writer.getDroppedBytes();
+
+    QString filePath = QDir(dir.path()).absoluteFilePath("spilled.ogg");
+    QByteArray expected;
+    const int chunks = 256;
+
+    writer.setMaxQueuedBytes(0); // all appended data is spilled
+    for (int c = 0; c < chunks; ++c) {
+        const QByteArray chunk(1024, char('a' + c % 26));
+        writer.append(filePath, chunk);
+        expected.append(chunk);
+        QCOMPARE(writer.getQueuedBytes(), qint64(0)); // append() returned without waiting for the disk
+    }
+
+    writer.setMaxQueuedBytes(4096); // mixing queued and spilled data keeps the order
+    for (int c = 0; c < chunks; ++c) {
+        const QByteArray chunk(1024, char('A' + c % 26));
+        writer.append(filePath, chunk);
+        expected.append(chunk);
+        QVERIFY(writer.getQueuedBytes() <= 4096);
+    }
+
+    writer.close(filePath);
+    writer.waitForPendingWrites();
+    writer.setMaxQueuedBytes(maxQueuedBytes);
+
+    QCOMPARE(writer.getQueuedBytes(), qint64(0));
+    QVERIFY(writer.getSpilledBytes() >= spilledBytes + 1024 * chunks);
+    QCOMPARE(writer.getDroppedBytes(), droppedBytes);
+    QCOMPARE(readFile(filePath), expected);
+}
+
+void TestRecorder::singleFileRemoteOffsets()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QList<JamTrack> tracks;
+    JamRecorder jamRecorder(new FakeMetadataWriter(&tracks));
+    jamRecorder.setDirNameDateFormat(Qt::ISODate);
+    jamRecorder.setSingleFilePerTrack(true);
+    jamRecorder.startRecording("local", QDir(dir.path()), 120, 16, 44100); // 8 seconds intervals
+
+    QByteArray expected;
+    for (int interval = 0; interval < 4; ++interval) {
+        if (interval == 1) {
+            jamRecorder.addRemoteUserAudio("remote", QList<QByteArray>() << "voice chat", 0); // not recorded
+        } else {
+            QByteArray stream = oggStream(QString("interval %1 ").arg(interval));
+            QList<QByteArray> chunks;
+            chunks << stream.left(6) << stream.mid(6);
+            jamRecorder.addRemoteUserAudio("remote", chunks, 0);
+            expected.append(stream);
+        }
+        jamRecorder.newInterval();
+    }
+
+    jamRecorder.stopRecording();
+    RecordingWriter::getInstance().waitForPendingWrites();
+
+    QCOMPARE(tracks.size(), 1);
+    QList<JamAudioFile> audioFiles = tracks.first().getAudioFiles();
+    QCOMPARE(audioFiles.size(), 3);
+
+    // each interval starts where the previous chained stream ends in the track file
+    const int intervalIndexes[] = {0, 2, 3};
+    for (int i = 0; i < audioFiles.size(); ++i) {
+        QCOMPARE(audioFiles.at(i).getPath(), audioFiles.first().getPath());
+        QCOMPARE(audioFiles.at(i).getIntervalIndex(), uint(intervalIndexes[i]));
+        QCOMPARE(audioFiles.at(i).getSourceOffset(), i * 8.0);
+    }
+
+    QCOMPARE(readFile(audioFiles.first().getPath()), expected);
+}
+
+void TestRecorder::singleFileLocalOffsets()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    QList<JamTrack> tracks;
+    JamRecorder jamRecorder(new FakeMetadataWriter(&tracks));
+    jamRecorder.setDirNameDateFormat(Qt::ISODate);
+    jamRecorder.setSingleFilePerTrack(true);
+    jamRecorder.startRecording("local", QDir(dir.path()), 120, 16, 44100);
+
+    // recording started in the middle of the first interval, the partial stream is not stored
+    jamRecorder.appendLocalUserAudio(oggStream("partial "), 0, false);
+    jamRecorder.newInterval();
+
+    QByteArray expected;
+    for (int interval = 1; interval < 4; ++interval) {
+        QByteArray stream = oggStream(QString("local %1 ").arg(interval));
+        jamRecorder.appendLocalUserAudio(stream.left(5), 0, true);
+        jamRecorder.appendLocalUserAudio(stream.mid(5), 0, false);
+        expected.append(stream);
+        jamRecorder.newInterval();
+    }
+
+    jamRecorder.stopRecording();
+    RecordingWriter::getInstance().waitForPendingWrites();
+
+    QCOMPARE(tracks.size(), 1);
+    QList<JamAudioFile> audioFiles = tracks.first().getAudioFiles();
+    QCOMPARE(audioFiles.size(), 3);
+
+    for (int i = 0; i < audioFiles.size(); ++i) {
+        QCOMPARE(audioFiles.at(i).getPath(), audioFiles.first().getPath());
+        QCOMPARE(audioFiles.at(i).getIntervalIndex(), uint(i + 1));
+        QCOMPARE(audioFiles.at(i).getSourceOffset(), i * 8.0);
+    }
+
+    QCOMPARE(readFile(audioFiles.first().getPath()), expected);
+}
+
+int main(int argc, char *argv[])
+{
+    TestRecorder test;
+    return QTest::qExec(&test, argc, argv);
+}
+
+#include "test_Recorder.moc"
@@ -0,0 +1,9 @@
+TEMPLATE = subdirs
+
+
+SUBDIRS += kernels
+SUBDIRS += decoder
+SUBDIRS += engine
+SUBDIRS += resampler
+SUBDIRS += ninjam
+SUBDIRS += upload
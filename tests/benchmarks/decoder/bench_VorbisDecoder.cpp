@@ -0,0 +1,188 @@
+#include <QObject>
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include "audio/vorbis/VorbisDecoder.h"
+#include "audio/vorbis/VorbisEncoder.h"
+#include "audio/vorbis/Vorbis.h"
+#include "audio/core/SamplesBuffer.h"
+
+#include <vorbis/vorbisfile.h>
+
+#include <cmath>
+#include <cstring>
+
+/**
+ * Decode a 2 minutes interval using the old input path (QByteArray front erase in each
+ * libvorbisfile read callback) and the current vorbis::Decoder (chunk list + read cursor).
+ */
+
+namespace {
+
+// the input path used by vorbis::Decoder before the chunk list, kept here as reference
+class FrontEraseDecoder
+{
+public:
+    explicit FrontEraseDecoder(const QByteArray &data) :
+        input(data),
+        initialized(false)
+    {
+        ov_callbacks callbacks;
+        callbacks.read_func = readOgg;
+        callbacks.seek_func = nullptr;
+        callbacks.close_func = nullptr;
+        callbacks.tell_func = nullptr;
+
+        initialized = ov_open_callbacks(this, &vorbisFile, nullptr, 0, callbacks) == 0;
+    }
+
+    ~FrontEraseDecoder()
+    {
+        if (initialized)
+            ov_clear(&vorbisFile);
+    }
+
+    qint64 decodeAll(int maxSamplesToDecode)
+    {
+        if (!initialized)
+            return 0;
+
+        qint64 total = 0;
+        float **outBuffer;
+        long samples;
+        while ((samples = ov_read_float(&vorbisFile, &outBuffer, maxSamplesToDecode, nullptr)) > 0)
+            total += samples;
+
+        return total;
+    }
+
+private:
+    static size_t readOgg(void *out, size_t size, size_t nmemb, void *instance)
+    {
+        auto decoder = static_cast<FrontEraseDecoder *>(instance);
+        size_t len = qMin(size * nmemb, static_cast<size_t>(decoder->input.size()));
+        if (len > 0) {
+            memcpy(out, decoder->input.data(), len);
+            decoder->input.remove(0, static_cast<int>(len));
+        }
+        return len;
+    }
+
+    QByteArray input;
+    OggVorbis_File vorbisFile;
+    bool initialized;
+};
+
+} // namespace
+
+class BenchVorbisDecoder : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void frontErase();
+    void chunkList();
+    void chunkList_downloadedParts();
+
+private:
+    static const int SAMPLE_RATE = 44100;
+    static const int INTERVAL_SECONDS = 120;
+    static const int DECODE_BLOCK = 256; // samples requested by the audio thread in each decode() call
+    static const int DOWNLOAD_PART_SIZE = 4096; // bytes in each DownloadIntervalWrite payload
+
+    static qint64 decodeAll(vorbis::Decoder &decoder);
+    static void report(const char *name, qint64 samples, qint64 nanoseconds);
+
+    QByteArray interval;
+    qint64 expectedSamples;
+};
+
+void BenchVorbisDecoder::initTestCase()
+{
+    vorbis::Encoder encoder(2, SAMPLE_RATE, vorbis::EncoderQualityNormal);
+
+    static const uint BLOCK = 4096;
+    audio::SamplesBuffer block(2, BLOCK);
+    const int totalSamples = SAMPLE_RATE * INTERVAL_SECONDS;
+    for (int offset = 0; offset < totalSamples; offset += BLOCK) {
+        for (uint i = 0; i < BLOCK; ++i) {
+            const float t = static_cast<float>(offset + i) / SAMPLE_RATE;
+            block.set(0, i, 0.5f * std::sin(2.0f * 3.14159f * 220.0f * t));
+            block.set(1, i, 0.5f * std::sin(2.0f * 3.14159f * 330.0f * t));
+        }
+        interval.append(encoder.encode(block));
+    }
+    interval.append(encoder.finishIntervalEncoding());
+
+    QVERIFY(!interval.isEmpty());
+    qInfo("Encoded interval: %d seconds, %d KB", INTERVAL_SECONDS, interval.size() / 1024);
+
+    FrontEraseDecoder reference(interval);
+    expectedSamples = reference.decodeAll(DECODE_BLOCK);
+    QVERIFY(expectedSamples > 0);
+}
+
+qint64 BenchVorbisDecoder::decodeAll(vorbis::Decoder &decoder)
+{
+    qint64 total = 0;
+    while (!decoder.isFinished() && decoder.isValid())
+        total += decoder.decode(DECODE_BLOCK).getFrameLenght();
+
+    return total;
+}
+
+void BenchVorbisDecoder::report(const char *name, qint64 samples, qint64 nanoseconds)
+{
+    const double ms = nanoseconds / 1000000.0;
+    qInfo("%-26s %9.2f ms  (%.0fx realtime)", name, ms, (samples / static_cast<double>(SAMPLE_RATE)) / (ms / 1000.0));
+}
+
+void BenchVorbisDecoder::frontErase()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    FrontEraseDecoder decoder(interval);
+    qint64 samples = decoder.decodeAll(DECODE_BLOCK);
+
+    report("front erase (old)", samples, timer.nsecsElapsed());
+    QCOMPARE(samples, expectedSamples);
+}
+
+void BenchVorbisDecoder::chunkList()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    vorbis::Decoder decoder;
+    decoder.setInputData(interval);
+    qint64 samples = decodeAll(decoder);
+
+    report("chunk list", samples, timer.nsecsElapsed());
+    QCOMPARE(samples, expectedSamples);
+}
+
+void BenchVorbisDecoder::chunkList_downloadedParts()
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    vorbis::Decoder decoder;
+    for (int offset = 0; offset < interval.size(); offset += DOWNLOAD_PART_SIZE)
+        decoder.addInputData(interval.mid(offset, DOWNLOAD_PART_SIZE));
+
+    qint64 samples = decodeAll(decoder);
+
+    report("chunk list (4 KB parts)", samples, timer.nsecsElapsed());
+    QCOMPARE(samples, expectedSamples);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchVorbisDecoder bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_VorbisDecoder.moc"
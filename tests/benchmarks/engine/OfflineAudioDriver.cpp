@@ -0,0 +1,117 @@
+#include "OfflineAudioDriver.h"
+
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+const double PI = 3.14159265358979323846;
+}
+
+OfflineAudioDriver::OfflineAudioDriver(int inputs, int outputs, int sampleRate, int bufferSize) :
+    renderedFrames(0),
+    inputPosition(0)
+{
+    globalInputRange = audio::ChannelRange(0, inputs);
+    globalOutputRange = audio::ChannelRange(0, outputs);
+    this->sampleRate = sampleRate;
+    this->bufferSize = bufferSize;
+}
+
+void OfflineAudioDriver::setProcessCallback(ProcessCallback callback)
+{
+    processCallback = callback;
+}
+
+bool OfflineAudioDriver::start()
+{
+    recreateBuffers(); // emit buffersRecreated(), the engine is prepared before the first block
+
+    emit started();
+
+    return true;
+}
+
+int OfflineAudioDriver::getMaxInputs() const
+{
+    return globalInputRange.getChannels();
+}
+
+int OfflineAudioDriver::getMaxOutputs() const
+{
+    return globalOutputRange.getChannels();
+}
+
+void OfflineAudioDriver::fillInputs()
+{
+    // a different tone in each input, like musicians playing
+    const uint frames = inputBuffer.getFrameLenght();
+    for (uint c = 0; c < inputBuffer.getChannels(); ++c) {
+        float *samples = inputBuffer.getSamplesArray(c);
+        const double frequency = 110.0 * (c + 1);
+        for (uint i = 0; i < frames; ++i)
+            samples[i] = 0.3f * static_cast<float>(std::sin(2.0 * PI * frequency * (inputPosition + i) / sampleRate));
+    }
+    inputPosition += frames;
+}
+
+void OfflineAudioDriver::render(quint64 frames)
+{
+    if (!processCallback)
+        return;
+
+    QElapsedTimer timer;
+    quint64 framesProcessed = 0;
+    while (framesProcessed < frames) {
+        const uint blockFrames = static_cast<uint>(std::min<quint64>(bufferSize, frames - framesProcessed));
+        inputBuffer.setFrameLenght(blockFrames);
+        outputBuffer.setFrameLenght(blockFrames);
+        fillInputs();
+        outputBuffer.zero();
+
+        timer.start();
+        processCallback(inputBuffer, outputBuffer, sampleRate);
+        blockTimes.push_back(timer.nsecsElapsed());
+
+        framesProcessed += blockFrames;
+    }
+
+    renderedFrames += framesProcessed;
+}
+
+OfflineAudioDriver::Statistics OfflineAudioDriver::getStatistics() const
+{
+    Statistics statistics = {};
+    if (blockTimes.empty())
+        return statistics;
+
+    std::vector<qint64> sorted(blockTimes);
+    std::sort(sorted.begin(), sorted.end());
+
+    double total = 0;
+    for (auto time : sorted)
+        total += time;
+
+    const double mean = total / sorted.size();
+    double variance = 0;
+    for (auto time : sorted)
+        variance += (time - mean) * (time - mean);
+
+    statistics.blocks = sorted.size();
+    statistics.realtimeFactor = (renderedFrames / static_cast<double>(sampleRate)) / (total / 1000000000.0);
+    statistics.blockDuration = 1000000.0 * bufferSize / sampleRate;
+    statistics.mean = mean / 1000.0;
+    statistics.p50 = sorted[sorted.size() / 2] / 1000.0;
+    statistics.p99 = sorted[std::min(sorted.size() - 1, static_cast<size_t>(sorted.size() * 0.99))] / 1000.0;
+    statistics.max = sorted.back() / 1000.0;
+    statistics.jitter = std::sqrt(variance / sorted.size()) / 1000.0;
+
+    return statistics;
+}
+
+void OfflineAudioDriver::resetStatistics()
+{
+    blockTimes.clear();
+    renderedFrames = 0;
+}
@@ -0,0 +1,55 @@
+#ifndef OFFLINE_AUDIO_DRIVER_H
+#define OFFLINE_AUDIO_DRIVER_H
+
+#include "audio/core/AudioDriver.h"
+
+#include <functional>
+#include <vector>
+
+/**
+ * Headless audio driver clocking the audio callback as fast as possible, without a sound card.
+ * Local inputs receive a deterministic signal and the time spent in each block is measured.
+ */
+
+class OfflineAudioDriver : public audio::NullAudioDriver
+{
+
+public:
+    typedef std::function<void(const audio::SamplesBuffer &in, audio::SamplesBuffer &out, int sampleRate)> ProcessCallback;
+
+    OfflineAudioDriver(int inputs, int outputs, int sampleRate, int bufferSize);
+
+    void setProcessCallback(ProcessCallback callback); // MainController::process in Jamtaba
+
+    bool start() override;
+
+    void render(quint64 frames); // frames are rendered in blocks of 'bufferSize'
+
+    struct Statistics
+    {
+        quint64 blocks;
+        double realtimeFactor; // rendered audio time / wall time
+        double blockDuration; // microseconds of audio in each block
+        double mean; // microseconds of wall time in each block
+        double p50;
+        double p99;
+        double max;
+        double jitter; // standard deviation of block times
+    };
+
+    Statistics getStatistics() const;
+    void resetStatistics();
+
+    int getMaxInputs() const override;
+    int getMaxOutputs() const override;
+
+private:
+    void fillInputs();
+
+    ProcessCallback processCallback;
+    std::vector<qint64> blockTimes; // nanoseconds
+    quint64 renderedFrames;
+    quint64 inputPosition;
+};
+
+#endif // OFFLINE_AUDIO_DRIVER_H
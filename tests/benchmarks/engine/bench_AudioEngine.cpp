@@ -0,0 +1,327 @@
+#include <QObject>
+#include <QtTest>
+#include <QDir>
+#include <QFile>
+
+#include "OfflineAudioDriver.h"
+
+#include "audio/core/AudioMixer.h"
+#include "audio/core/AudioNode.h"
+#include "audio/core/ScratchArena.h"
+#include "audio/core/RenderEpoch.h"
+#include "audio/core/SamplesBuffer.h"
+#include "audio/core/LatencyProbes.h"
+#include "audio/NinjamTrackNode.h"
+#include "audio/MetronomeTrackNode.h"
+#include "audio/vorbis/VorbisEncoder.h"
+#include "audio/vorbis/Vorbis.h"
+#include "looper/Looper.h"
+#include "midi/MidiMessage.h"
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+/**
+ * Render the audio engine (mixer, remote Ninjam tracks decoding Ogg intervals, local inputs with
+ * looper layers and metronome) using a headless driver, reporting realtime factor, block jitter
+ * and the CPU used by each track. Recorded intervals (*.ogg) can be used setting the
+ * JAMTABA_BENCH_INTERVALS environment variable to a directory, synthetic intervals are used otherwise.
+ */
+
+using audio::SamplesBuffer;
+
+namespace {
+
+const double PI = 3.14159265358979323846;
+
+// measure the time spent by the wrapped node, used to report CPU per track
+class ProfiledNode : public audio::AudioNode
+{
+public:
+    ProfiledNode(const QString &name, audio::AudioNode *node) :
+        name(name),
+        node(node),
+        nanoseconds(0)
+    {
+    }
+
+    void processReplacing(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate, std::vector<midi::MidiMessage> &midiBuffer) override
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        node->processReplacing(in, out, sampleRate, midiBuffer);
+
+        nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    bool canBeRenderedInParallel() const override
+    {
+        return node->canBeRenderedInParallel();
+    }
+
+    QString getName() const { return name; }
+    quint64 getNanoseconds() const { return nanoseconds; }
+
+private:
+    QString name;
+    audio::AudioNode *node;
+    std::atomic<quint64> nanoseconds; // remote tracks can be rendered by parallel workers
+};
+
+// local input track, reading one channel from the driver input and playing looper layers
+class InputNode : public audio::AudioNode
+{
+public:
+    InputNode(uint inputChannel, quint8 looperLayers) :
+        inputChannel(inputChannel),
+        looper(audio::Looper::AllLayers, qMax(looperLayers, static_cast<quint8>(1))),
+        looperLayers(looperLayers)
+    {
+    }
+
+    void processReplacing(const SamplesBuffer &in, SamplesBuffer &out, int sampleRate, std::vector<midi::MidiMessage> &midiBuffer) override
+    {
+        internalInputBuffer.setFrameLenght(out.getFrameLenght());
+        internalInputBuffer.set(in, inputChannel % in.getChannels(), 1);
+
+        audio::AudioNode::processReplacing(in, out, sampleRate, midiBuffer);
+    }
+
+    void startNewInterval(uint intervalFrames)
+    {
+        if (!looperLayers)
+            return;
+
+        if (looper.isStopped()) { // first interval, recording all layers
+            looper.reserve(intervalFrames);
+            for (quint8 layer = 0; layer < looperLayers; ++layer)
+                looper.setLayerSamples(layer, createLayer(intervalFrames, layer));
+
+            looper.play();
+        }
+
+        looper.startNewCycle(intervalFrames);
+    }
+
+protected:
+    void preFaderProcess(SamplesBuffer &out) override
+    {
+        if (looperLayers)
+            looper.mixToBuffer(out);
+    }
+
+private:
+    static SamplesBuffer createLayer(uint frames, quint8 layer)
+    {
+        SamplesBuffer samples(2, frames);
+        for (uint i = 0; i < frames; ++i) {
+            float value = 0.2f * static_cast<float>(std::sin(2.0 * PI * (220.0 + 55.0 * layer) * i / 44100.0));
+            samples.set(0, i, value);
+            samples.set(1, i, value);
+        }
+        return samples;
+    }
+
+    uint inputChannel;
+    audio::Looper looper;
+    quint8 looperLayers;
+};
+
+SamplesBuffer createClick(float frequency)
+{
+    static const uint CLICK_FRAMES = 2048;
+    SamplesBuffer click(2, CLICK_FRAMES);
+    for (uint i = 0; i < CLICK_FRAMES; ++i) {
+        float value = static_cast<float>(std::sin(2.0 * PI * frequency * i / 44100.0) * (1.0 - i / static_cast<double>(CLICK_FRAMES)));
+        click.set(0, i, value);
+        click.set(1, i, value);
+    }
+    return click;
+}
+
+} // namespace
+
+class BenchAudioEngine : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void render();
+    void render_data();
+
+private:
+    static const int SAMPLE_RATE = 48000; // intervals are 44100, remote tracks are resampled like in a real jam
+    static const int BUFFER_SIZE = 128;
+    static const int BPI = 16;
+    static const int BPM = 120;
+    static const int INTERVALS = 4;
+
+    static QByteArray encodeSyntheticInterval(uint frames, int sampleRate, double frequency);
+
+    QList<QByteArray> intervals; // Ogg Vorbis intervals played by remote users
+};
+
+QByteArray BenchAudioEngine::encodeSyntheticInterval(uint frames, int sampleRate, double frequency)
+{
+    vorbis::Encoder encoder(2, sampleRate, vorbis::EncoderQualityNormal);
+
+    static const uint BLOCK = 4096;
+    SamplesBuffer block(2, BLOCK);
+    QByteArray encoded;
+    for (uint offset = 0; offset < frames; offset += BLOCK) {
+        for (uint i = 0; i < BLOCK; ++i) {
+            float value = 0.4f * static_cast<float>(std::sin(2.0 * PI * frequency * (offset + i) / sampleRate));
+            block.set(0, i, value);
+            block.set(1, i, -value);
+        }
+        encoded.append(encoder.encode(block));
+    }
+    encoded.append(encoder.finishIntervalEncoding());
+
+    return encoded;
+}
+
+void BenchAudioEngine::initTestCase()
+{
+    const QString intervalsDir = QString::fromLocal8Bit(qgetenv("JAMTABA_BENCH_INTERVALS"));
+    if (!intervalsDir.isEmpty()) {
+        QDir dir(intervalsDir);
+        for (const auto &fileName : dir.entryList(QStringList() << "*.ogg", QDir::Files, QDir::Name)) {
+            QFile file(dir.absoluteFilePath(fileName));
+            if (file.open(QIODevice::ReadOnly))
+                intervals.append(file.readAll());
+        }
+        qInfo("%d recorded intervals loaded from %s", intervals.size(), qPrintable(intervalsDir));
+    }
+
+    if (intervals.isEmpty()) {
+        const uint intervalFrames = 44100 * 60 * BPI / BPM;
+        for (int i = 0; i < 4; ++i)
+            intervals.append(encodeSyntheticInterval(intervalFrames, 44100, 110.0 * (i + 2)));
+    }
+
+    QVERIFY(!intervals.isEmpty());
+}
+
+void BenchAudioEngine::render_data()
+{
+    QTest::addColumn<int>("remoteUsers");
+    QTest::addColumn<int>("localInputs");
+    QTest::addColumn<int>("looperLayers");
+    QTest::addColumn<int>("renderWorkers");
+
+    QTest::newRow("2 remote, 1 input")                  << 2  << 1 << 0 << 0;
+    QTest::newRow("8 remote, 2 inputs, 4 layers")       << 8  << 2 << 4 << 0;
+    QTest::newRow("16 remote, 4 inputs, 8 layers")      << 16 << 4 << 8 << 0;
+    QTest::newRow("16 remote, 4 inputs, 8 layers, 3 workers") << 16 << 4 << 8 << 3;
+}
+
+void BenchAudioEngine::render()
+{
+    QFETCH(int, remoteUsers);
+    QFETCH(int, localInputs);
+    QFETCH(int, looperLayers);
+    QFETCH(int, renderWorkers);
+
+    const uint intervalFrames = (SAMPLE_RATE * 60 * BPI / BPM) / BUFFER_SIZE * BUFFER_SIZE; // blocks aligned with interval start
+
+    audio::ScratchArena scratchArena;
+    audio::RenderEpoch renderEpoch;
+    audio::AudioMixer mixer(SAMPLE_RATE, scratchArena, renderEpoch);
+    mixer.setRenderWorkers(renderWorkers);
+
+    std::vector<std::unique_ptr<audio::AudioNode>> nodes;
+    std::vector<std::unique_ptr<ProfiledNode>> profiledNodes;
+    std::vector<NinjamTrackNode *> remoteTracks;
+    std::vector<InputNode *> inputTracks;
+
+    auto addTrack = [&](const QString &name, audio::AudioNode *node) {
+        nodes.emplace_back(node);
+        profiledNodes.emplace_back(new ProfiledNode(name, node));
+        mixer.addNode(profiledNodes.back().get());
+    };
+
+    for (int i = 0; i < remoteUsers; ++i) {
+        auto track = new NinjamTrackNode(i);
+        remoteTracks.push_back(track);
+        addTrack(QString("remote %1").arg(i), track);
+    }
+
+    for (int i = 0; i < localInputs; ++i) {
+        auto input = new InputNode(i, looperLayers);
+        inputTracks.push_back(input);
+        addTrack(QString("input %1").arg(i), input);
+    }
+
+    auto metronome = new audio::MetronomeTrackNode(createClick(1760), createClick(880), createClick(1320));
+    metronome->setSamplesPerBeat(intervalFrames / BPI);
+    addTrack("metronome", metronome);
+
+    OfflineAudioDriver driver(qMax(localInputs, 1), 2, SAMPLE_RATE, BUFFER_SIZE);
+
+    QObject::connect(&driver, &audio::AudioDriver::buffersRecreated, [&](int maxInputChannels, int maxFrames) {
+        scratchArena.prepare(maxInputChannels, maxFrames);
+        mixer.prepareParallelRendering();
+    });
+
+    uint intervalPosition = 0;
+    const std::vector<midi::MidiMessage> midiBuffer;
+    driver.setProcessCallback([&](const SamplesBuffer &in, SamplesBuffer &out, int sampleRate) {
+        audio::RenderEpoch::Scope epochScope(renderEpoch);
+        audio::LatencyProbes::Scope probe(audio::LatencyProbes::MainControllerProcess);
+
+        if (intervalPosition == 0) {
+            for (auto track : remoteTracks)
+                track->startNewInterval(intervalFrames);
+
+            for (auto input : inputTracks)
+                input->startNewInterval(intervalFrames);
+        }
+
+        metronome->setIntervalPosition(intervalPosition);
+        mixer.process(in, out, sampleRate, midiBuffer);
+
+        intervalPosition = (intervalPosition + out.getFrameLenght()) % intervalFrames;
+    });
+
+    QVERIFY(driver.start());
+
+    for (int interval = 0; interval < INTERVALS; ++interval) {
+        // downloaded intervals are queued by network thread, not measured
+        for (uint t = 0; t < remoteTracks.size(); ++t)
+            remoteTracks[t]->addVorbisEncodedInterval(QList<QByteArray>() << intervals.at((interval + t) % intervals.size()));
+
+        driver.render(intervalFrames);
+    }
+
+    const auto statistics = driver.getStatistics();
+
+    qInfo("realtime factor %.1fx, block %.0f us: mean %.1f us, p50 %.1f us, p99 %.1f us, max %.1f us, jitter %.1f us",
+          statistics.realtimeFactor, statistics.blockDuration, statistics.mean, statistics.p50,
+          statistics.p99, statistics.max, statistics.jitter);
+
+    const double renderedNs = statistics.blocks * statistics.mean * 1000.0;
+    for (const auto &node : profiledNodes)
+        qInfo("    %-12s %5.1f%% cpu", qPrintable(node->getName()), 100.0 * node->getNanoseconds() / renderedNs);
+
+    for (auto &node : profiledNodes)
+        mixer.removeNode(node.get());
+
+    renderEpoch.reclaim();
+
+    QVERIFY2(statistics.realtimeFactor > 1.0, "The audio engine is slower than realtime");
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv); // remote tracks use the decode service thread
+    BenchAudioEngine bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_AudioEngine.moc"
@@ -0,0 +1,110 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase
+CONFIG += c++11
+TEMPLATE = app
+TARGET = engine
+
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+INCLUDEPATH += ../../../libs/includes/ogg
+INCLUDEPATH += ../../../libs/includes/vorbis
+INCLUDEPATH += ../../../libs/includes/minimp3
+VPATH += ../../../src/Common
+
+win32 {
+    !contains(QMAKE_TARGET.arch, x86_64) {
+        LIBS_PATH = "static/win32-msvc"
+    } else {
+        LIBS_PATH = "static/win64-msvc"
+    }
+}
+macx:LIBS_PATH = "static/mac64"
+linux {
+    contains(QMAKE_HOST.arch, x86_64) {
+        LIBS_PATH = "static/linux64"
+    } else {
+        LIBS_PATH = "static/linux32"
+    }
+}
+
+LIBS += -L$$PWD/../../../libs/$$LIBS_PATH -lminimp3 -lvorbisfile -lvorbisenc -lvorbis -logg
+
+HEADERS += log/Logging.h
+HEADERS += audio/core/AudioDriver.h
+HEADERS += audio/core/AudioNode.h
+HEADERS += audio/core/AudioNodeProcessor.h
+HEADERS += audio/core/AudioMixer.h
+HEADERS += audio/core/AudioPeak.h
+HEADERS += audio/core/Filters.h
+HEADERS += audio/core/LatencyProbes.h
+HEADERS += audio/core/ParallelRenderer.h
+HEADERS += audio/core/RenderEpoch.h
+HEADERS += audio/core/SamplesBuffer.h
+HEADERS += audio/core/SamplesBufferView.h
+HEADERS += audio/core/SamplesKernels.h
+HEADERS += audio/core/ScratchArena.h
+HEADERS += audio/core/PeakPyramid.h
+HEADERS += audio/DecodeService.h
+HEADERS += audio/MetronomeTrackNode.h
+HEADERS += audio/Mp3Decoder.h
+HEADERS += audio/NinjamTrackNode.h
+HEADERS += audio/Resampler.h
+HEADERS += audio/SamplesBufferResampler.h
+HEADERS += audio/vorbis/VorbisDecoder.h
+HEADERS += audio/vorbis/VorbisEncoder.h
+HEADERS += audio/Decoder.h
+HEADERS += audio/voicechat/VoiceChat.h
+HEADERS += audio/voicechat/VoiceChatDecoder.h
+HEADERS += file/FileReader.h
+HEADERS += file/FileReaderFactory.h
+HEADERS += file/Mp3FileReader.h
+HEADERS += file/OggFileReader.h
+HEADERS += file/WaveFileReader.h
+HEADERS += looper/Looper.h
+HEADERS += looper/LooperLayer.h
+HEADERS += looper/LooperStates.h
+HEADERS += midi/MidiDriver.h
+HEADERS += midi/MidiMessage.h
+HEADERS += MetronomeUtils.h
+HEADERS += persistence/ResampledAudioCache.h
+HEADERS += OfflineAudioDriver.h
+
+SOURCES += log/logging.cpp
+SOURCES += audio/core/AudioDriver.cpp
+SOURCES += audio/core/AudioNode.cpp
+SOURCES += audio/core/AudioNodeProcessor.cpp
+SOURCES += audio/core/AudioMixer.cpp
+SOURCES += audio/core/AudioPeak.cpp
+SOURCES += audio/core/Filters.cpp
+SOURCES += audio/core/LatencyProbes.cpp
+SOURCES += audio/core/ParallelRenderer.cpp
+SOURCES += audio/core/RenderEpoch.cpp
+SOURCES += audio/core/SamplesBuffer.cpp
+SOURCES += audio/core/SamplesKernels.cpp
+SOURCES += audio/core/ScratchArena.cpp
+SOURCES += audio/core/PeakPyramid.cpp
+SOURCES += audio/DecodeService.cpp
+SOURCES += audio/MetronomeTrackNode.cpp
+SOURCES += audio/Mp3Decoder.cpp
+SOURCES += audio/NinjamTrackNode.cpp
+SOURCES += audio/Resampler.cpp
+SOURCES += audio/SamplesBufferResampler.cpp
+SOURCES += audio/vorbis/VorbisDecoder.cpp
+SOURCES += audio/vorbis/VorbisEncoder.cpp
+SOURCES += audio/voicechat/VoiceChat.cpp
+SOURCES += audio/voicechat/VoiceChatDecoder.cpp
+SOURCES += file/FileReaderFactory.cpp
+SOURCES += file/Mp3FileReader.cpp
+SOURCES += file/OggFileReader.cpp
+SOURCES += file/WaveFileReader.cpp
+SOURCES += looper/Looper.cpp
+SOURCES += looper/LooperLayer.cpp
+SOURCES += looper/LooperStates.cpp
+SOURCES += midi/MidiDriver.cpp
+SOURCES += midi/MidiMessage.cpp
+SOURCES += MetronomeUtils.cpp
+SOURCES += persistence/ResampledAudioCache.cpp
+SOURCES += OfflineAudioDriver.cpp
+
+SOURCES += bench_AudioEngine.cpp
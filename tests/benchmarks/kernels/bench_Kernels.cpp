@@ -0,0 +1,256 @@
+#include <QObject>
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include "audio/core/SamplesKernels.h"
+
+#include <vector>
+#include <cmath>
+#include <functional>
+
+using audio::kernels::InstructionSet;
+using audio::kernels::Kernels;
+
+Q_DECLARE_METATYPE(InstructionSet)
+
+/**
+ * Compare the SIMD kernels against the scalar (reference) kernels, checking the output
+ * and printing the throughput (samples/sec) of each instruction set supported by the running CPU.
+ */
+
+class BenchKernels : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void scale();
+    void scale_data();
+
+    void ramp();
+    void ramp_data();
+
+    void add();
+    void add_data();
+
+    void mix();
+    void mix_data();
+
+    void peak();
+    void peak_data();
+
+    void scaleAndPeak();
+    void scaleAndPeak_data();
+
+    void dot();
+    void dot_data();
+
+private:
+    static const uint BLOCK_SIZE = 4099; // not multiple of vector size, testing the scalar tails too
+    static const int ITERATIONS = 20000;
+
+    void addInstructionSetsColumn();
+
+    static std::vector<float> createSamples(uint size, float frequency);
+
+    static void compare(const std::vector<float> &samples, const std::vector<float> &expected, float epsilon);
+
+    static void measure(const char *kernelName, InstructionSet set, std::function<void()> kernelCall);
+};
+
+void BenchKernels::addInstructionSetsColumn()
+{
+    QTest::addColumn<InstructionSet>("instructionSet");
+
+    for (auto set : {InstructionSet::Scalar, InstructionSet::SSE2, InstructionSet::AVX2, InstructionSet::NEON}) {
+        if (audio::kernels::isSupported(set))
+            QTest::newRow(audio::kernels::getName(set)) << set;
+    }
+}
+
+std::vector<float> BenchKernels::createSamples(uint size, float frequency)
+{
+    std::vector<float> samples(size);
+    for (uint i = 0; i < size; ++i)
+        samples[i] = std::sin(i * frequency) * ((i % 7) ? 0.9f : -0.5f);
+
+    return samples;
+}
+
+void BenchKernels::compare(const std::vector<float> &samples, const std::vector<float> &expected, float epsilon)
+{
+    QCOMPARE(samples.size(), expected.size());
+    for (size_t i = 0; i < samples.size(); ++i) {
+        if (std::abs(samples[i] - expected[i]) > epsilon)
+            QFAIL(qPrintable(QString("Sample %1 is %2, expected %3").arg(i).arg(samples[i]).arg(expected[i])));
+    }
+}
+
+void BenchKernels::measure(const char *kernelName, InstructionSet set, std::function<void()> kernelCall)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i)
+        kernelCall();
+
+    const qint64 elapsed = qMax(timer.nsecsElapsed(), static_cast<qint64>(1));
+    const double samplesPerSecond = (static_cast<double>(BLOCK_SIZE) * ITERATIONS) / (elapsed / 1000000000.0);
+
+    qInfo("%-14s %-7s %10.1f Msamples/sec", kernelName, audio::kernels::getName(set), samplesPerSecond / 1000000.0);
+}
+
+void BenchKernels::scale_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::scale()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    auto samples = createSamples(BLOCK_SIZE, 0.01f);
+    auto expected = samples;
+    kernels.scale(samples.data(), BLOCK_SIZE, 0.75f);
+    reference.scale(expected.data(), BLOCK_SIZE, 0.75f);
+    compare(samples, expected, 0.0f); // bit exact
+
+    measure("scale", instructionSet, [&]() { kernels.scale(samples.data(), BLOCK_SIZE, 1.0f); });
+}
+
+void BenchKernels::ramp_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::ramp()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    const float step = 1.0f / BLOCK_SIZE;
+    auto samples = createSamples(BLOCK_SIZE, 0.02f);
+    auto expected = samples;
+    kernels.ramp(samples.data(), BLOCK_SIZE, 0.0f, step);
+    reference.ramp(expected.data(), BLOCK_SIZE, 0.0f, step);
+    compare(samples, expected, 1e-5f); // gains are accumulated in different orders
+
+    measure("ramp", instructionSet, [&]() { kernels.ramp(samples.data(), BLOCK_SIZE, 1.0f, 0.0f); });
+}
+
+void BenchKernels::add_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::add()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    const auto source = createSamples(BLOCK_SIZE, 0.03f);
+    auto samples = createSamples(BLOCK_SIZE, 0.01f);
+    auto expected = samples;
+    kernels.add(samples.data(), source.data(), BLOCK_SIZE);
+    reference.add(expected.data(), source.data(), BLOCK_SIZE);
+    compare(samples, expected, 0.0f);
+
+    const auto silence = std::vector<float>(BLOCK_SIZE);
+    measure("add", instructionSet, [&]() { kernels.add(samples.data(), silence.data(), BLOCK_SIZE); });
+}
+
+void BenchKernels::mix_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::mix()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    const auto source = createSamples(BLOCK_SIZE, 0.03f);
+    auto samples = createSamples(BLOCK_SIZE, 0.01f);
+    auto expected = samples;
+    kernels.mix(samples.data(), source.data(), BLOCK_SIZE, 0.5f);
+    reference.mix(expected.data(), source.data(), BLOCK_SIZE, 0.5f);
+    compare(samples, expected, 1e-6f); // compilers can fuse multiply and add in scalar code
+
+    measure("mix", instructionSet, [&]() { kernels.mix(samples.data(), source.data(), BLOCK_SIZE, 0.0f); });
+}
+
+void BenchKernels::peak_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::peak()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    const auto samples = createSamples(BLOCK_SIZE, 0.05f);
+    float squares = 0;
+    float expectedSquares = 0;
+    QCOMPARE(kernels.peak(samples.data(), BLOCK_SIZE, &squares), reference.peak(samples.data(), BLOCK_SIZE, &expectedSquares));
+    QVERIFY(std::abs(squares - expectedSquares) <= expectedSquares * 1e-4f); // squares are summed in different orders
+
+    measure("peak", instructionSet, [&]() { kernels.peak(samples.data(), BLOCK_SIZE, &squares); });
+}
+
+void BenchKernels::scaleAndPeak_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::scaleAndPeak()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    auto samples = createSamples(BLOCK_SIZE, 0.05f);
+    auto expected = samples;
+    float squares = 0;
+    float expectedSquares = 0;
+    const float peak = kernels.scaleAndPeak(samples.data(), BLOCK_SIZE, 0.8f, &squares);
+    const float expectedPeak = reference.scaleAndPeak(expected.data(), BLOCK_SIZE, 0.8f, &expectedSquares);
+    QCOMPARE(peak, expectedPeak);
+    QVERIFY(std::abs(squares - expectedSquares) <= expectedSquares * 1e-4f);
+    compare(samples, expected, 0.0f);
+
+    measure("scaleAndPeak", instructionSet, [&]() { kernels.scaleAndPeak(samples.data(), BLOCK_SIZE, 1.0f, &squares); });
+}
+
+void BenchKernels::dot_data()
+{
+    addInstructionSetsColumn();
+}
+
+void BenchKernels::dot()
+{
+    QFETCH(InstructionSet, instructionSet);
+    const auto &kernels = audio::kernels::get(instructionSet);
+    const auto &reference = audio::kernels::get(InstructionSet::Scalar);
+
+    const auto a = createSamples(BLOCK_SIZE, 0.05f);
+    const auto b = createSamples(BLOCK_SIZE, 0.07f);
+    const float sum = kernels.dot(a.data(), b.data(), BLOCK_SIZE);
+    const float expectedSum = reference.dot(a.data(), b.data(), BLOCK_SIZE);
+    QVERIFY(std::abs(sum - expectedSum) <= 1e-3f); // products are summed in different orders
+
+    volatile float result = 0;
+    measure("dot", instructionSet, [&]() { result = kernels.dot(a.data(), b.data(), BLOCK_SIZE); });
+}
+
+int main(int argc, char *argv[])
+{
+    BenchKernels bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_Kernels.moc"
@@ -0,0 +1,16 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase
+CONFIG += c++11
+TEMPLATE = app
+TARGET = kernels
+
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+VPATH += ../../../src/Common
+
+HEADERS += audio/core/SamplesKernels.h
+
+SOURCES += audio/core/SamplesKernels.cpp
+
+SOURCES += bench_Kernels.cpp
@@ -0,0 +1,224 @@
+#include <QObject>
+#include <QtTest>
+#include <QFile>
+#include <QElapsedTimer>
+
+#include "ninjam/Ninjam.h"
+#include "ninjam/MessageFramer.h"
+#include "ninjam/client/ServerMessages.h"
+
+#include <cstring>
+
+/**
+ * Ninjam receive throughput, replaying a captured ninbot session (mostly DownloadIntervalWrite
+ * messages) in socket sized chunks. The per message device reads (header, then payload) used before
+ * the MessageFramer are compared with the framer parsing the payloads in place.
+ */
+
+using namespace ninjam;
+using namespace ninjam::client;
+
+namespace {
+
+// sequential device exposing the capture in chunks, like a socket receiving TCP segments
+class ChunkedDevice : public QIODevice
+{
+public:
+    explicit ChunkedDevice(const QByteArray &data) :
+        data(data),
+        received(0),
+        position(0)
+    {
+        open(QIODevice::ReadOnly | QIODevice::Unbuffered);
+    }
+
+    bool isSequential() const override { return true; }
+
+    qint64 bytesAvailable() const override
+    {
+        return (received - position) + QIODevice::bytesAvailable();
+    }
+
+    bool receive(qint64 bytes) // false when the entire capture was received
+    {
+        received = qMin(received + bytes, static_cast<qint64>(data.size()));
+        return position < data.size();
+    }
+
+protected:
+    qint64 readData(char *out, qint64 maxSize) override
+    {
+        const qint64 bytes = qMin(maxSize, received - position);
+        std::memcpy(out, data.constData() + position, bytes);
+        position += bytes;
+        return bytes;
+    }
+
+    qint64 writeData(const char *, qint64) override
+    {
+        return -1;
+    }
+
+private:
+    QByteArray data;
+    qint64 received;
+    qint64 position;
+};
+
+template <class T>
+quint32 parse(PayloadReader &payload)
+{
+    T::from(payload);
+    return 1;
+}
+
+template <class T>
+quint32 parse(QIODevice *device, quint32 payload)
+{
+    T::from(device, payload);
+    return 1;
+}
+
+quint32 parseMessage(const MessageHeader &header, PayloadReader &payload)
+{
+    switch (header.getMessageType()) {
+    case MessageType::AuthChallenge:            return parse<AuthChallengeMessage>(payload);
+    case MessageType::AuthReply:                return parse<AuthReplyMessage>(payload);
+    case MessageType::ServerConfigChangeNotify: return parse<ConfigChangeNotifyMessage>(payload);
+    case MessageType::UserInfoChangeNorify:     return parse<UserInfoChangeNotifyMessage>(payload);
+    case MessageType::ChatMessage:              return parse<ServerToClientChatMessage>(payload);
+    case MessageType::DownloadIntervalBegin:    return parse<DownloadIntervalBegin>(payload);
+    case MessageType::DownloadIntervalWrite:    return parse<DownloadIntervalWrite>(payload);
+    default:
+        return 0;
+    }
+}
+
+// the same parsing, reading the payload directly from the device
+quint32 parseMessage(const MessageHeader &header, QIODevice *device)
+{
+    switch (header.getMessageType()) {
+    case MessageType::AuthChallenge:            return parse<AuthChallengeMessage>(device, header.getPayload());
+    case MessageType::AuthReply:                return parse<AuthReplyMessage>(device, header.getPayload());
+    case MessageType::ServerConfigChangeNotify: return parse<ConfigChangeNotifyMessage>(device, header.getPayload());
+    case MessageType::UserInfoChangeNorify:     return parse<UserInfoChangeNotifyMessage>(device, header.getPayload());
+    case MessageType::ChatMessage:              return parse<ServerToClientChatMessage>(device, header.getPayload());
+    case MessageType::DownloadIntervalBegin:    return parse<DownloadIntervalBegin>(device, header.getPayload());
+    case MessageType::DownloadIntervalWrite:    return parse<DownloadIntervalWrite>(device, header.getPayload());
+    default:
+        device->read(header.getPayload());
+        return 0;
+    }
+}
+
+} // namespace
+
+class BenchMessageFramer : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+
+    void receive();
+    void receive_data();
+
+private:
+    static const int REPETITIONS = 200;
+    static const quint32 CAPTURED_MESSAGES = 261;
+
+    quint32 receiveUsingDevice(ChunkedDevice &device, int chunkSize);
+    quint32 receiveUsingFramer(ChunkedDevice &device, int chunkSize, MessageFramer &framer);
+
+    QByteArray capture;
+};
+
+const quint32 BenchMessageFramer::CAPTURED_MESSAGES;
+
+void BenchMessageFramer::initTestCase()
+{
+    QFile file(":/wireshark data/ninbot 4 players connected.data");
+    QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.errorString()));
+    capture = file.readAll();
+}
+
+void BenchMessageFramer::receive_data()
+{
+    QTest::addColumn<bool>("useFramer");
+    QTest::addColumn<int>("chunkSize");
+
+    const QList<int> chunkSizes = { 1460, 16 * 1024, 64 * 1024 }; // TCP segment, typical socket reads
+    for (int chunkSize : chunkSizes) {
+        QTest::newRow(qPrintable(QString("device, %1 bytes chunks").arg(chunkSize))) << false << chunkSize;
+        QTest::newRow(qPrintable(QString("framer, %1 bytes chunks").arg(chunkSize))) << true << chunkSize;
+    }
+}
+
+quint32 BenchMessageFramer::receiveUsingDevice(ChunkedDevice &device, int chunkSize)
+{
+    quint32 messages = 0;
+    MessageHeader header;
+    while (device.receive(chunkSize)) {
+        while (device.bytesAvailable() >= 5) {
+            if (!header.isValid())
+                header = MessageHeader::from(&device);
+
+            if (device.bytesAvailable() < header.getPayload())
+                break;
+
+            messages += parseMessage(header, &device);
+            header = MessageHeader();
+        }
+    }
+    return messages;
+}
+
+quint32 BenchMessageFramer::receiveUsingFramer(ChunkedDevice &device, int chunkSize, MessageFramer &framer)
+{
+    quint32 messages = 0;
+    MessageHeader header;
+    PayloadReader payload;
+    while (device.receive(chunkSize)) {
+        do {
+            framer.readFrom(&device);
+            while (framer.nextMessage(header, payload))
+                messages += parseMessage(header, payload);
+        } while (device.bytesAvailable() > 0);
+    }
+    return messages;
+}
+
+void BenchMessageFramer::receive()
+{
+    QFETCH(bool, useFramer);
+    QFETCH(int, chunkSize);
+
+    MessageFramer framer; // reused by all repetitions, like in a connection
+    quint32 messages = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < REPETITIONS; ++i) {
+        ChunkedDevice device(capture);
+        framer.clear();
+
+        messages = useFramer ? receiveUsingFramer(device, chunkSize, framer) : receiveUsingDevice(device, chunkSize);
+    }
+    const qint64 elapsed = qMax(timer.nsecsElapsed(), static_cast<qint64>(1));
+
+    QCOMPARE(messages, CAPTURED_MESSAGES);
+    QVERIFY(!framer.hasError());
+
+    const double megabytes = static_cast<double>(capture.size()) * REPETITIONS / (1024 * 1024);
+    const double seconds = elapsed / 1000000000.0;
+    qInfo("%-28s %8.1f MB/s, %6.0f ns per message", QTest::currentDataTag(), megabytes / seconds,
+          static_cast<double>(elapsed) / (static_cast<double>(messages) * REPETITIONS));
+}
+
+int main(int argc, char *argv[])
+{
+    BenchMessageFramer bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_MessageFramer.moc"
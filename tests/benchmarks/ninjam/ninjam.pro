@@ -0,0 +1,30 @@
+QT += testlib network
+QT -= gui
+CONFIG += testcase
+CONFIG += c++11
+TEMPLATE = app
+TARGET = ninjam
+
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+VPATH += ../../../src/Common
+
+HEADERS += log/Logging.h
+HEADERS += ninjam/Ninjam.h
+HEADERS += ninjam/MessageFramer.h
+HEADERS += ninjam/client/ClientMessages.h
+HEADERS += ninjam/client/ServerMessages.h
+HEADERS += ninjam/client/User.h
+HEADERS += ninjam/client/UserChannel.h
+
+SOURCES += log/logging.cpp
+SOURCES += ninjam/Ninjam.cpp
+SOURCES += ninjam/MessageFramer.cpp
+SOURCES += ninjam/client/ClientMessages.cpp
+SOURCES += ninjam/client/ServerMessages.cpp
+SOURCES += ninjam/client/User.cpp
+SOURCES += ninjam/client/UserChannel.cpp
+
+SOURCES += bench_MessageFramer.cpp
+
+RESOURCES += ../../auto/ninjam/ninjamTestsResources.qrc
@@ -0,0 +1,93 @@
+#include <QObject>
+#include <QtTest>
+#include <QElapsedTimer>
+
+#include "audio/Resampler.h"
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+Q_DECLARE_METATYPE(Resampler::Quality)
+
+/**
+ * CPU cost of each resampler quality, streaming one channel in audio callback sized blocks.
+ * The cost is printed as the percentage of one core used to resample one realtime channel.
+ */
+
+class BenchResampler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void streaming();
+    void streaming_data();
+
+private:
+    static const int OUT_BLOCK = 128; // samples requested by the audio callback
+    static const int SECONDS = 60;
+};
+
+void BenchResampler::streaming_data()
+{
+    QTest::addColumn<Resampler::Quality>("quality");
+    QTest::addColumn<int>("inSampleRate");
+    QTest::addColumn<int>("outSampleRate");
+
+    const QList<QPair<int, int>> rates = { {44100, 48000}, {48000, 44100}, {48000, 96000} };
+    const QList<QPair<Resampler::Quality, const char *>> qualities = { {Resampler::Fast, "Fast"}, {Resampler::Medium, "Medium"}, {Resampler::High, "High"} };
+
+    for (const auto &quality : qualities) {
+        for (const auto &rate : rates) {
+            const auto name = QString("%1, %2 to %3").arg(quality.second).arg(rate.first).arg(rate.second);
+            QTest::newRow(qPrintable(name)) << quality.first << rate.first << rate.second;
+        }
+    }
+}
+
+void BenchResampler::streaming()
+{
+    QFETCH(Resampler::Quality, quality);
+    QFETCH(int, inSampleRate);
+    QFETCH(int, outSampleRate);
+
+    const double ratio = static_cast<double>(inSampleRate) / outSampleRate;
+    const int maxInBlock = static_cast<int>(std::ceil(OUT_BLOCK * ratio));
+
+    std::vector<float> in(maxInBlock);
+    for (int i = 0; i < maxInBlock; ++i)
+        in[i] = std::sin(i * 0.05f) * 0.5f;
+
+    std::vector<float> out(OUT_BLOCK);
+
+    std::unique_ptr<Resampler> resampler(Resampler::create(quality));
+    resampler->prepare(maxInBlock);
+
+    const qint64 blocks = static_cast<qint64>(SECONDS) * outSampleRate / OUT_BLOCK;
+    double inPosition = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 block = 0; block < blocks; ++block) {
+        // block input lenght is changing like the remote tracks (117, 118, 117 ...)
+        const double nextPosition = inPosition + OUT_BLOCK * ratio;
+        const int inBlock = static_cast<int>(std::ceil(nextPosition)) - static_cast<int>(std::ceil(inPosition));
+        inPosition = nextPosition;
+
+        resampler->process(in.data(), inBlock, out.data(), OUT_BLOCK, ratio);
+    }
+    const qint64 elapsed = qMax(timer.nsecsElapsed(), static_cast<qint64>(1));
+
+    QVERIFY(std::isfinite(out[0]));
+
+    const double cpu = 100.0 * elapsed / (SECONDS * 1000000000.0);
+    qInfo("%-24s %6.3f%% cpu per channel (%.0fx realtime)", QTest::currentDataTag(), cpu, 100.0 / cpu);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchResampler bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_Resampler.moc"
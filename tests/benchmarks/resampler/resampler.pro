@@ -0,0 +1,18 @@
+QT += testlib
+QT -= gui
+CONFIG += testcase
+CONFIG += c++11
+TEMPLATE = app
+TARGET = resampler
+
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+VPATH += ../../../src/Common
+
+HEADERS += audio/core/SamplesKernels.h
+HEADERS += audio/Resampler.h
+
+SOURCES += audio/core/SamplesKernels.cpp
+SOURCES += audio/Resampler.cpp
+
+SOURCES += bench_Resampler.cpp
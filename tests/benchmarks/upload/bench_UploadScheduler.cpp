@@ -0,0 +1,132 @@
+#include <QObject>
+#include <QtTest>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+
+#include "ninjam/client/ClientMessages.h"
+#include "ninjam/client/UploadScheduler.h"
+
+#include <memory>
+
+/**
+ * Socket writes used to upload the messages produced by two audio channels and a video channel, one
+ * event loop iteration per encoded audio block. The immediate writes (one write and flush per message,
+ * as before the UploadScheduler) are compared with the coalesced writes.
+ *
+ * The write count is the number of send syscalls; with TCP_NODELAY small writes are sent in one packet
+ * each. Use 'strace -c -e trace=write,sendto' and tcpdump to confirm the numbers in a real session.
+ */
+
+using namespace ninjam::client;
+
+class BenchUploadScheduler : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void upload();
+    void upload_data();
+
+private:
+    static const int ITERATIONS = 2000;
+    static const int AUDIO_CHANNELS = 2;
+
+    QTcpServer server;
+    std::unique_ptr<QTcpSocket> client;
+    QTcpSocket *receiver;
+};
+
+void BenchUploadScheduler::initTestCase()
+{
+    QVERIFY(server.listen(QHostAddress::LocalHost));
+
+    client.reset(new QTcpSocket());
+    client->connectToHost(QHostAddress::LocalHost, server.serverPort());
+    QVERIFY(client->waitForConnected(5000));
+    QVERIFY(server.waitForNewConnection(5000));
+
+    receiver = server.nextPendingConnection();
+    QVERIFY(receiver);
+}
+
+void BenchUploadScheduler::cleanupTestCase()
+{
+    client.reset();
+    server.close();
+}
+
+void BenchUploadScheduler::upload_data()
+{
+    QTest::addColumn<bool>("coalescing");
+    QTest::addColumn<int>("packetsPerIteration"); // encoded packets per channel
+    QTest::addColumn<int>("packetSize");
+
+    QTest::newRow("intervalic, immediate") << false << 1 << 4096; // parts sent after 4096 bytes
+    QTest::newRow("intervalic, coalesced") << true << 1 << 4096;
+    QTest::newRow("voice chat, immediate") << false << 3 << 200; // all encoded packets are sent
+    QTest::newRow("voice chat, coalesced") << true << 3 << 200;
+}
+
+void BenchUploadScheduler::upload()
+{
+    QFETCH(bool, coalescing);
+    QFETCH(int, packetsPerIteration);
+    QFETCH(int, packetSize);
+
+    UploadScheduler scheduler;
+    scheduler.setSocket(client.get());
+    scheduler.setCoalescing(coalescing);
+
+    QList<QByteArray> GUIDs;
+    for (int c = 0; c <= AUDIO_CHANNELS; ++c) { // the last is the video channel
+        GUIDs.append(UploadIntervalBegin::createGUID());
+        scheduler.send(UploadIntervalBegin(GUIDs.last(), c, c < AUDIO_CHANNELS), c < AUDIO_CHANNELS ? UploadScheduler::Audio : UploadScheduler::Video);
+    }
+
+    const QByteArray packet(packetSize, 'x');
+    const QByteArray videoPart(4096, 'v');
+
+    qint64 receivedBytes = 0;
+    QElapsedTimer timer;
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i) {
+        for (int c = 0; c < AUDIO_CHANNELS; ++c) {
+            for (int p = 0; p < packetsPerIteration; ++p)
+                scheduler.send(UploadIntervalWrite(GUIDs.at(c), packet, false), UploadScheduler::Audio);
+        }
+
+        if (i % 4 == 0)
+            scheduler.send(UploadIntervalWrite(GUIDs.last(), videoPart, false), UploadScheduler::Video);
+
+        QCoreApplication::processEvents(); // the scheduler writes the messages of this iteration
+        receivedBytes += receiver->readAll().size();
+    }
+
+    scheduler.flush();
+    const qint64 elapsed = qMax(timer.nsecsElapsed(), static_cast<qint64>(1));
+
+    while (client->bytesToWrite() > 0 && client->waitForBytesWritten(1000)) {}
+    while (receiver->waitForReadyRead(100))
+        receivedBytes += receiver->readAll().size();
+
+    QVERIFY(scheduler.getSocketWrites() > 0);
+    QVERIFY(receivedBytes > 0);
+
+    qInfo("%-24s %7llu messages, %7llu socket writes (%.2f per message), %8.1f KB, %6.0f ns per message",
+          QTest::currentDataTag(), scheduler.getSentMessages(), scheduler.getSocketWrites(),
+          static_cast<double>(scheduler.getSocketWrites()) / scheduler.getSentMessages(),
+          receivedBytes / 1024.0, static_cast<double>(elapsed) / scheduler.getSentMessages());
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv); // the scheduler uses the event loop
+    BenchUploadScheduler bench;
+    return QTest::qExec(&bench, argc, argv);
+}
+
+#include "bench_UploadScheduler.moc"
@@ -0,0 +1,22 @@
+QT += testlib network
+QT -= gui
+CONFIG += testcase
+CONFIG += c++11
+TEMPLATE = app
+TARGET = upload
+
+INCLUDEPATH += .
+INCLUDEPATH += ../../../src/Common
+VPATH += ../../../src/Common
+
+HEADERS += log/Logging.h
+HEADERS += ninjam/Ninjam.h
+HEADERS += ninjam/client/ClientMessages.h
+HEADERS += ninjam/client/UploadScheduler.h
+
+SOURCES += log/logging.cpp
+SOURCES += ninjam/Ninjam.cpp
+SOURCES += ninjam/client/ClientMessages.cpp
+SOURCES += ninjam/client/UploadScheduler.cpp
+
+SOURCES += bench_UploadScheduler.cpp
@@ -6,6 +6,7 @@ SUBDIRS += IntervalProgress
 #SUBDIRS += jamWindow  # Problem in RtMidi constructor
 SUBDIRS += map
 SUBDIRS += privateServer
+SUBDIRS += serverLoad
 SUBDIRS += marqueeLabel
 SUBDIRS += multiStateButton
 SUBDIRS += peakMeters
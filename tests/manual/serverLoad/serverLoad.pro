@@ -0,0 +1,30 @@
+QT += core network
+QT -= gui
+CONFIG += console c++11
+TEMPLATE = app
+TARGET = serverLoad
+
+ROOT_PATH = "../../.."
+
+INCLUDEPATH += .
+INCLUDEPATH += $$ROOT_PATH/src/Common
+
+VPATH += $$ROOT_PATH/src/Common
+
+HEADERS += ninjam/Ninjam.h
+HEADERS += ninjam/MessageFramer.h
+HEADERS += ninjam/server/Server.h
+HEADERS += ninjam/server/ClientConnection.h
+HEADERS += ninjam/server/IntervalArchive.h
+
+SOURCES += ninjam/Ninjam.cpp
+SOURCES += ninjam/MessageFramer.cpp
+SOURCES += ninjam/server/Server.cpp
+SOURCES += ninjam/server/ClientConnection.cpp
+SOURCES += ninjam/server/IntervalArchive.cpp
+SOURCES += ninjam/client/ClientMessages.cpp
+SOURCES += ninjam/client/ServerMessages.cpp
+SOURCES += ninjam/client/User.cpp
+SOURCES += ninjam/client/UserChannel.cpp
+
+SOURCES += test_ServerLoad.cpp
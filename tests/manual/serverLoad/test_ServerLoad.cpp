@@ -0,0 +1,251 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTcpSocket>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include "ninjam/Ninjam.h"
+#include "ninjam/MessageFramer.h"
+#include "ninjam/client/ServerMessages.h"
+#include "ninjam/client/ClientMessages.h"
+#include "ninjam/server/Server.h"
+
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+/**
+ * Load generator for the Ninjam server. Hundreds of simulated clients connect, do the handshake and
+ * upload intervals at a fixed bitrate, while the received bytes are counted. The expected download
+ * rate (every upload is sent to all other users) is printed with the measured rates every second.
+ * Using --listening each client receives only a percentage of the other users (sending user masks).
+ *
+ * By default an in-process server is started (--threads sets the server IO threads), use --host
+ * to load an external server.
+ */
+
+using namespace ninjam;
+using namespace ninjam::client;
+
+namespace {
+
+class SimulatedClient : public QObject
+{
+    Q_OBJECT
+
+public:
+    SimulatedClient(const QString &name, quint32 bytesPerSecond, int listening) :
+        name(name),
+        bytesPerSecond(bytesPerSecond),
+        listening(listening),
+        intervalMs(8000),
+        ready(false),
+        receivedBytes(0),
+        sentBytes(0)
+    {
+        connect(&socket, &QIODevice::readyRead, this, &SimulatedClient::readMessages);
+        connect(&socket, &QTcpSocket::disconnected, [=]() { ready = false; });
+    }
+
+    void connectTo(const QString &host, quint16 port)
+    {
+        socket.connectToHost(host, port);
+    }
+
+    void upload(int elapsedMs) // called periodically
+    {
+        if (!ready)
+            return;
+
+        const QByteArray chunk(static_cast<int>(static_cast<qint64>(bytesPerSecond) * elapsedMs / 1000), 'x');
+
+        bool lastPart = intervalTimer.isValid() && intervalTimer.elapsed() >= intervalMs;
+        if (!GUID.isEmpty())
+            write(UploadIntervalWrite(GUID, chunk, lastPart));
+
+        if (GUID.isEmpty() || lastPart) {
+            GUID = UploadIntervalBegin::createGUID();
+            write(UploadIntervalBegin(GUID, 0, true));
+            intervalTimer.start();
+        }
+    }
+
+    inline bool isReady() const { return ready; }
+    inline quint64 getReceivedBytes() const { return receivedBytes; }
+    inline quint64 getSentBytes() const { return sentBytes; }
+
+private slots:
+    void readMessages()
+    {
+        receivedBytes += framer.readFrom(&socket);
+
+        MessageHeader header;
+        PayloadReader payload;
+        while (framer.nextMessage(header, payload)) {
+            switch (header.getMessageType()) {
+            case MessageType::AuthChallenge: {
+                auto challenge = AuthChallengeMessage::from(payload);
+                write(ClientAuthUserMessage(name, challenge.getChallenge(), challenge.getProtocolVersion(), QString()));
+                break;
+            }
+            case MessageType::AuthReply:
+                if (AuthReplyMessage::from(payload).userIsAuthenticated()) {
+                    ClientSetChannel setChannel;
+                    setChannel.addChannel("load", 0);
+                    write(setChannel);
+                    ready = true;
+                }
+                break;
+
+            case MessageType::ServerConfigChangeNotify: {
+                auto config = ConfigChangeNotifyMessage::from(payload);
+                if (config.getBpm() > 0)
+                    intervalMs = 60000 * config.getBpi() / config.getBpm();
+                break;
+            }
+            case MessageType::UserInfoChangeNotify:
+                if (listening < 100) {
+                    for (const auto &user : UserInfoChangeNotifyMessage::from(payload).getUsers()) {
+                        const bool receiving = static_cast<int>(qHash(name + user.getFullName()) % 100) < listening;
+                        write(ClientSetUserMask(user.getFullName(), receiving ? 0xffffffff : 0));
+                    }
+                }
+                break;
+
+            case MessageType::KeepAlive:
+                write(ClientKeepAlive());
+                break;
+
+            default:
+                break; // other messages are not used
+            }
+        }
+
+        if (socket.bytesAvailable() > 0) // the framer buffer was full
+            QMetaObject::invokeMethod(this, "readMessages", Qt::QueuedConnection);
+    }
+
+private:
+    void write(const ClientMessage &message)
+    {
+        const qint64 before = socket.bytesToWrite();
+        message.serializeTo(&socket);
+        sentBytes += socket.bytesToWrite() - before;
+    }
+
+    QString name;
+    quint32 bytesPerSecond;
+    int listening; // percentage of the other users received
+    quint32 intervalMs;
+    QTcpSocket socket;
+    MessageFramer framer;
+    QByteArray GUID;
+    QElapsedTimer intervalTimer;
+    bool ready;
+    quint64 receivedBytes;
+    quint64 sentBytes;
+};
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Ninjam server load generator");
+    parser.addHelpOption();
+
+    QCommandLineOption clientsOption("clients", "Simulated clients.", "count", "64");
+    QCommandLineOption threadsOption("threads", "In-process server IO threads.", "count", "0");
+    QCommandLineOption hostOption("host", "External server host, an in-process server is used by default.", "host");
+    QCommandLineOption portOption("port", "Server port.", "port", "2049");
+    QCommandLineOption bitrateOption("bitrate", "Uploaded bitrate per client, in kbps.", "kbps", "96");
+    QCommandLineOption secondsOption("seconds", "Test duration.", "seconds", "30");
+    QCommandLineOption listeningOption("listening", "Percentage of the other users received by each client.", "percent", "100");
+    for (const auto &option : { clientsOption, threadsOption, hostOption, portOption, bitrateOption, secondsOption, listeningOption })
+        parser.addOption(option);
+    parser.process(app);
+
+    const int clientsCount = qBound(1, parser.value(clientsOption).toInt(), 255);
+    const quint16 port = parser.value(portOption).toUShort();
+    const quint32 bytesPerSecond = parser.value(bitrateOption).toUInt() * 1000 / 8;
+    const int seconds = parser.value(secondsOption).toInt();
+    const int listening = qBound(0, parser.value(listeningOption).toInt(), 100);
+
+    std::unique_ptr<server::Server> server;
+    QString host = parser.value(hostOption);
+    if (host.isEmpty()) {
+        host = "127.0.0.1";
+        server.reset(new server::Server());
+        server->setMaxUsers(static_cast<quint8>(clientsCount));
+        server->setIOThreads(parser.value(threadsOption).toInt());
+        server->start(port);
+        if (!server->isStarted()) {
+            qCritical() << "Can't start the server in port" << port;
+            return 1;
+        }
+    }
+
+    std::vector<std::unique_ptr<SimulatedClient>> clients;
+    for (int i = 0; i < clientsCount; ++i) {
+        clients.emplace_back(new SimulatedClient(QString("load%1").arg(i), bytesPerSecond, listening));
+        clients.back()->connectTo(host, port);
+    }
+
+    static const int UPLOAD_PERIOD = 250; // ms
+
+    QElapsedTimer uploadTimer;
+    uploadTimer.start();
+    QTimer uploadTicker;
+    QObject::connect(&uploadTicker, &QTimer::timeout, [&]() {
+        const int elapsed = static_cast<int>(uploadTimer.restart());
+        for (auto &client : clients)
+            client->upload(elapsed);
+    });
+    uploadTicker.start(UPLOAD_PERIOD);
+
+    quint64 lastReceived = 0;
+    quint64 lastSent = 0;
+    QElapsedTimer statsTimer;
+    statsTimer.start();
+    QTimer statsTicker;
+    QObject::connect(&statsTicker, &QTimer::timeout, [&]() {
+        const double elapsed = qMax(statsTimer.restart(), static_cast<qint64>(1)) / 1000.0;
+
+        int connected = 0;
+        quint64 received = 0;
+        quint64 sent = 0;
+        for (const auto &client : clients) {
+            connected += client->isReady() ? 1 : 0;
+            received += client->getReceivedBytes();
+            sent += client->getSentBytes();
+        }
+
+        const double expected = static_cast<double>(connected) * (connected - 1) * bytesPerSecond * listening / 100; // uploads sent to the listening users
+        std::printf("%3d/%3d clients, upload %8.1f KB/s, download %9.1f KB/s (expected %9.1f KB/s)",
+                    connected, clientsCount, (sent - lastSent) / elapsed / 1024, (received - lastReceived) / elapsed / 1024, expected / 1024);
+        if (server)
+            std::printf(", server out %9.1f KB/s (saved %9.1f KB/s)", server->getUploadTransferRate() / 1024.0,
+                        server->getSavedUploadTransferRate() / 1024.0);
+        std::printf("\n");
+        std::fflush(stdout);
+
+        lastReceived = received;
+        lastSent = sent;
+    });
+    statsTicker.start(1000);
+
+    QTimer::singleShot(seconds * 1000, &app, SLOT(quit()));
+
+    const int result = app.exec();
+
+    clients.clear();
+    if (server)
+        server->shutdown();
+
+    return result;
+}
+
+#include "test_ServerLoad.moc"